@@ -0,0 +1,299 @@
+#include "stdafx.h"
+#include "Profiler.h"
+#include "Core/IO/File.h"
+#include "Core/IO/JSONValue.h"
+#include "Core/Logging/Log.h"
+#include "Core/Threading/JobSystem.h"
+//-----------------------------------------------------------------------------
+Profiler gProfiler;
+//-----------------------------------------------------------------------------
+// Track of the frame markers in the Chrome trace
+static const uint32_t FRAME_TRACK_ID = PROFILER_GPU_THREAD_ID - 1;
+//-----------------------------------------------------------------------------
+static double toMicroseconds(int64_t time)
+{
+	return static_cast<double>(time) * 1.0e-3;
+}
+//-----------------------------------------------------------------------------
+static JSONValue makeTraceMetadata(uint32_t threadId, const std::string& name)
+{
+	JSONValue event;
+	event["name"] = "thread_name";
+	event["ph"] = "M";
+	event["pid"] = 0;
+	event["tid"] = threadId;
+	event["args"]["name"] = name;
+	return event;
+}
+//-----------------------------------------------------------------------------
+static JSONValue makeTraceEvent(const char* name, const char* category, int64_t begin, int64_t end, uint32_t threadId)
+{
+	JSONValue event;
+	event["name"] = name;
+	event["cat"] = category;
+	event["ph"] = "X";
+	event["ts"] = toMicroseconds(begin);
+	event["dur"] = toMicroseconds(end - begin);
+	event["pid"] = 0;
+	event["tid"] = threadId;
+	return event;
+}
+//-----------------------------------------------------------------------------
+Profiler::~Profiler()
+{
+	Destroy();
+}
+//-----------------------------------------------------------------------------
+bool Profiler::Create(const ProfilerCreateInfo& createInfo)
+{
+	Destroy();
+
+	unsigned capacity = 2;
+	while (capacity < createInfo.threadEventCapacity)
+		capacity *= 2;
+
+	{
+		std::lock_guard<std::mutex> lock(m_threadsMutex);
+		m_frames.resize(std::max(createInfo.frameCount, 1u));
+		m_threadEventCapacity = capacity;
+	}
+	m_spikeThreshold = createInfo.spikeThreshold;
+	m_spikeCaptureFile = createInfo.spikeCaptureFile;
+	m_startTime = std::chrono::steady_clock::now();
+	m_frameBegin = 0;
+	m_frameIndex = 0;
+	m_nextSpikeCapture = 0;
+	m_generation.fetch_add(1, std::memory_order_relaxed);
+	m_enabled.store(createInfo.enable, std::memory_order_relaxed);
+	return true;
+}
+//-----------------------------------------------------------------------------
+void Profiler::Destroy()
+{
+	m_enabled.store(false, std::memory_order_relaxed);
+	{
+		std::lock_guard<std::mutex> lock(m_threadsMutex);
+		// a thread that passed the enabled check may still write its last event, so the rings are retired instead of freed
+		for (auto& thread : m_threads)
+			m_retiredThreads.push_back(std::move(thread));
+		m_threads.clear();
+		// threads registered with the retired rings register again
+		m_generation.fetch_add(1, std::memory_order_relaxed);
+		m_frames.clear();
+	}
+	m_counters.clear();
+}
+//-----------------------------------------------------------------------------
+int64_t Profiler::GetTime() const
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_startTime).count();
+}
+//-----------------------------------------------------------------------------
+void Profiler::AddEvent(const char* name, int64_t begin, int64_t end, uint32_t depth)
+{
+	ThreadEvents* thread = getThreadEvents();
+	if (!thread) return;
+
+	const uint64_t write = thread->write.load(std::memory_order_relaxed);
+	if (write - thread->read.load(std::memory_order_acquire) > thread->mask)
+	{
+		thread->dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	thread->events[write & thread->mask] = { name, begin, end, thread->id, depth };
+	// Publish the event to the main thread
+	thread->write.store(write + 1, std::memory_order_release);
+}
+//-----------------------------------------------------------------------------
+void Profiler::AddFrameEvents(uint64_t frameIndex, std::span<const ProfilerEvent> events)
+{
+	if (ProfilerFrame* frame = findFrame(frameIndex))
+		frame->events.insert(frame->events.end(), events.begin(), events.end());
+}
+//-----------------------------------------------------------------------------
+void Profiler::SetCounter(const char* name, int64_t value)
+{
+	for (ProfilerCounter& counter : m_counters)
+	{
+		if (counter.name == name)
+		{
+			counter.value = value;
+			return;
+		}
+	}
+	m_counters.push_back({ name, value });
+}
+//-----------------------------------------------------------------------------
+void Profiler::EndFrame()
+{
+	if (m_frames.empty()) return;
+
+	const int64_t now = GetTime();
+	ProfilerFrame& frame = m_frames[m_frameIndex % m_frames.size()];
+	frame.index = m_frameIndex;
+	frame.begin = m_frameBegin;
+	frame.end = now;
+	frame.events.clear();
+	frame.counters.swap(m_counters);
+	m_counters.clear();
+	frame.droppedEvents = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(m_threadsMutex);
+		for (const auto& thread : m_threads)
+		{
+			const uint64_t write = thread->write.load(std::memory_order_acquire);
+			uint64_t read = thread->read.load(std::memory_order_relaxed);
+			for (; read < write; read++)
+				frame.events.push_back(thread->events[read & thread->mask]);
+			// Hand the drained slots back to the thread
+			thread->read.store(read, std::memory_order_release);
+			frame.droppedEvents += thread->dropped.exchange(0, std::memory_order_relaxed);
+		}
+	}
+
+	m_frameIndex++;
+	m_frameBegin = now;
+
+	if (m_spikeThreshold > 0.0 && frame.GetDuration() > m_spikeThreshold)
+	{
+		LogWarning("Profiler: frame " + std::to_string(frame.index) + " took " + std::to_string(frame.GetDuration()) + " ms");
+		// GPU scopes of the spike frame are not resolved yet, the trace holds them for the earlier frames
+		if (!m_spikeCaptureFile.empty() && frame.index >= m_nextSpikeCapture)
+		{
+			if (ExportChromeTrace(m_spikeCaptureFile))
+				LogPrint("Profiler: spike capture written to " + m_spikeCaptureFile);
+			m_nextSpikeCapture = m_frameIndex + m_frames.size();
+		}
+	}
+}
+//-----------------------------------------------------------------------------
+void Profiler::ToChromeTrace(JSONValue& dest) const
+{
+	JSONArray events;
+	{
+		std::lock_guard<std::mutex> lock(m_threadsMutex);
+		for (const auto& thread : m_threads)
+			events.push_back(makeTraceMetadata(thread->id, thread->name));
+	}
+	events.push_back(makeTraceMetadata(FRAME_TRACK_ID, "Frames"));
+	events.push_back(makeTraceMetadata(PROFILER_GPU_THREAD_ID, "GPU"));
+
+	// Oldest frame first
+	for (unsigned age = GetNumFrames(); age-- > 0;)
+	{
+		const ProfilerFrame& frame = *GetFrame(age);
+		const std::string frameName = "Frame " + std::to_string(frame.index);
+		JSONValue frameEvent = makeTraceEvent(frameName.c_str(), "frame", frame.begin, frame.end, FRAME_TRACK_ID);
+		if (frame.droppedEvents)
+			frameEvent["args"]["droppedEvents"] = frame.droppedEvents;
+		events.push_back(frameEvent);
+
+		for (const ProfilerEvent& event : frame.events)
+			events.push_back(makeTraceEvent(event.name, event.threadId == PROFILER_GPU_THREAD_ID ? "gpu" : "cpu", event.begin, event.end, event.threadId));
+
+		for (const ProfilerCounter& counter : frame.counters)
+		{
+			JSONValue event;
+			event["name"] = counter.name;
+			event["ph"] = "C";
+			event["ts"] = toMicroseconds(frame.begin);
+			event["pid"] = 0;
+			event["args"]["value"] = static_cast<double>(counter.value);
+			events.push_back(event);
+		}
+	}
+
+	dest.SetEmptyObject();
+	dest["traceEvents"] = events;
+	dest["displayTimeUnit"] = "ms";
+}
+//-----------------------------------------------------------------------------
+bool Profiler::ExportChromeTrace(const std::string& fileName) const
+{
+	JSONValue trace;
+	ToChromeTrace(trace);
+	std::string text;
+	trace.ToString(text, 0);
+
+	File file(fileName, FILE_WRITE);
+	if (!file.IsOpen() || file.Write(text.data(), text.length()) != text.length())
+	{
+		LogError("Profiler: failed to write trace " + fileName);
+		return false;
+	}
+	return true;
+}
+//-----------------------------------------------------------------------------
+const ProfilerFrame* Profiler::GetFrame(unsigned age) const
+{
+	if (age >= GetNumFrames()) return nullptr;
+	return &m_frames[(m_frameIndex - 1 - age) % m_frames.size()];
+}
+//-----------------------------------------------------------------------------
+uint32_t& Profiler::GetThreadDepth()
+{
+	static thread_local uint32_t depth = 0;
+	return depth;
+}
+//-----------------------------------------------------------------------------
+Profiler::ThreadEvents* Profiler::getThreadEvents()
+{
+	static thread_local ThreadEvents* threadEvents = nullptr;
+	static thread_local uint32_t threadGeneration = 0;
+	if (threadGeneration == m_generation.load(std::memory_order_relaxed))
+		return threadEvents;
+
+	std::lock_guard<std::mutex> lock(m_threadsMutex);
+	// destroyed: the thread keeps its retired ring to take it back after the next Create()
+	if (m_frames.empty())
+		return nullptr;
+	threadGeneration = m_generation.load(std::memory_order_relaxed);
+
+	// the retired ring of the thread is taken back when it has the same capacity, so that repeated Create() and Destroy() keep one ring per thread
+	std::unique_ptr<ThreadEvents> thread;
+	auto retired = std::find_if(m_retiredThreads.begin(), m_retiredThreads.end(), [](const auto& ring) { return ring.get() == threadEvents; });
+	if (retired != m_retiredThreads.end() && (*retired)->mask == m_threadEventCapacity - 1)
+	{
+		thread = std::move(*retired);
+		m_retiredThreads.erase(retired);
+		// events left from the previous profiler are discarded, nothing drains a retired ring
+		thread->read.store(thread->write.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		thread->dropped.store(0, std::memory_order_relaxed);
+	}
+	else
+	{
+		thread = std::make_unique<ThreadEvents>();
+		thread->events.reset(new ProfilerEvent[m_threadEventCapacity]);
+		thread->mask = m_threadEventCapacity - 1;
+	}
+	thread->id = static_cast<uint32_t>(m_threads.size());
+
+	const JobSystem& jobSystem = GetJobSystem();
+	const unsigned threadIndex = jobSystem.GetThreadIndex();
+	if (threadIndex == 0)
+		thread->name = "Main Thread";
+	else if (threadIndex < jobSystem.GetNumThreads())
+		thread->name = "Worker " + std::to_string(threadIndex);
+	else
+		thread->name = "Thread " + std::to_string(thread->id);
+
+	threadEvents = thread.get();
+	m_threads.push_back(std::move(thread));
+	return threadEvents;
+}
+//-----------------------------------------------------------------------------
+ProfilerFrame* Profiler::findFrame(uint64_t frameIndex)
+{
+	if (m_frames.empty() || frameIndex >= m_frameIndex || m_frameIndex - frameIndex > m_frames.size())
+		return nullptr;
+	ProfilerFrame& frame = m_frames[frameIndex % m_frames.size()];
+	return frame.index == frameIndex ? &frame : nullptr;
+}
+//-----------------------------------------------------------------------------
+Profiler& GetProfiler()
+{
+	return gProfiler;
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
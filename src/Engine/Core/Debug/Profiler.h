@@ -0,0 +1,180 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+
+class JSONValue;
+
+// Default number of frames kept by the profiler.
+static const unsigned DEFAULT_PROFILER_FRAMES = 120;
+// Default capacity of the event ring of one thread.
+static const unsigned DEFAULT_PROFILER_THREAD_EVENTS = 16384;
+// Thread id of the GPU scopes in the captured frames.
+static const uint32_t PROFILER_GPU_THREAD_ID = 0xFFFFu;
+
+struct ProfilerCreateInfo final
+{
+	bool enable = true;
+	// Number of frames kept in the capture ring.
+	unsigned frameCount = DEFAULT_PROFILER_FRAMES;
+	// Capacity of the event ring of each thread, rounded up to a power of two. Events that do not fit before the frame ends are dropped.
+	unsigned threadEventCapacity = DEFAULT_PROFILER_THREAD_EVENTS;
+	// Frames longer than this many milliseconds are logged as spikes. Zero disables spike detection.
+	double spikeThreshold = 0.0;
+	// Chrome trace file written with the captured frames when a spike is detected. Empty to only log the spike.
+	std::string spikeCaptureFile;
+};
+
+// Timed scope of one thread. Times are nanoseconds since the profiler was created.
+struct ProfilerEvent final
+{
+	// Name of the scope. Must outlive the profiler, usually a string literal.
+	const char* name;
+	int64_t begin;
+	int64_t end;
+	uint32_t threadId;
+	// Nesting depth of the scope in its thread.
+	uint32_t depth;
+};
+
+// Named value of a frame, such as draw calls or uploaded bytes.
+struct ProfilerCounter final
+{
+	const char* name;
+	int64_t value;
+};
+
+// Events and counters of one finished frame.
+struct ProfilerFrame final
+{
+	// Return frame duration in milliseconds.
+	double GetDuration() const { return static_cast<double>(end - begin) * 1.0e-6; }
+
+	uint64_t index = 0;
+	int64_t begin = 0;
+	int64_t end = 0;
+	std::vector<ProfilerEvent> events;
+	std::vector<ProfilerCounter> counters;
+	// Number of events lost because a thread ring was full.
+	unsigned droppedEvents = 0;
+};
+
+// Hierarchical CPU scope profiler with a ring of the last captured frames. Recording a scope is lock-free: each thread writes to its own event ring, which the main thread drains at the end of the frame.
+class Profiler final
+{
+public:
+	Profiler() = default;
+	~Profiler();
+
+	bool Create(const ProfilerCreateInfo& createInfo);
+	// Stop recording and drop the captured frames. The thread rings stay allocated until the profiler object is destroyed, because other threads may still be finishing a scope with them.
+	void Destroy();
+
+	// Return time in nanoseconds since the profiler was created.
+	int64_t GetTime() const;
+	// Record a finished scope of the calling thread. Thread-safe.
+	void AddEvent(const char* name, int64_t begin, int64_t end, uint32_t depth);
+	// Add events measured later, such as GPU timer queries, to a captured frame. Ignored if the frame has left the ring. Main thread only.
+	void AddFrameEvents(uint64_t frameIndex, std::span<const ProfilerEvent> events);
+	// Set a counter of the current frame. Main thread only.
+	void SetCounter(const char* name, int64_t value);
+
+	// Finish the frame: drain the thread rings into the capture ring and check for a spike. Called by EngineDevice in Present().
+	void EndFrame();
+
+	// Write the captured frames as a Chrome trace, viewable in chrome://tracing or Perfetto.
+	void ToChromeTrace(JSONValue& dest) const;
+	bool ExportChromeTrace(const std::string& fileName) const;
+
+	void SetEnabled(bool enable) { m_enabled.store(enable, std::memory_order_relaxed); }
+	bool IsEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+	// Return index of the frame being recorded.
+	uint64_t GetFrameIndex() const { return m_frameIndex; }
+	// Return number of captured frames.
+	unsigned GetNumFrames() const { return static_cast<unsigned>(std::min<uint64_t>(m_frameIndex, m_frames.size())); }
+	// Return a captured frame, 0 is the most recent one.
+	const ProfilerFrame* GetFrame(unsigned age) const;
+	// Return nesting depth of the calling thread, incremented by the open scopes.
+	static uint32_t& GetThreadDepth();
+
+private:
+	Profiler(Profiler&&) = delete;
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(Profiler&&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+	// Single producer, single consumer event ring of one thread.
+	struct ThreadEvents
+	{
+		std::unique_ptr<ProfilerEvent[]> events;
+		uint64_t mask = 0;
+		std::string name;
+		uint32_t id = 0;
+		alignas(64) std::atomic<uint64_t> write = 0;
+		alignas(64) std::atomic<uint64_t> read = 0;
+		std::atomic<unsigned> dropped = 0;
+	};
+
+	ThreadEvents* getThreadEvents();
+	ProfilerFrame* findFrame(uint64_t frameIndex);
+
+	std::vector<std::unique_ptr<ThreadEvents>> m_threads;
+	// Rings of the threads registered before the last Destroy(). Threads keep a pointer to their ring in a thread_local, so it is never freed while they may run.
+	std::vector<std::unique_ptr<ThreadEvents>> m_retiredThreads;
+	// Guards registering a thread, which happens once per thread, and the thread and frame rings.
+	mutable std::mutex m_threadsMutex;
+	std::vector<ProfilerFrame> m_frames;
+	std::vector<ProfilerCounter> m_counters;
+	std::chrono::steady_clock::time_point m_startTime;
+	int64_t m_frameBegin = 0;
+	uint64_t m_frameIndex = 0;
+	// Frame index from which the next spike is written to the capture file, so the file holds frames not yet written.
+	uint64_t m_nextSpikeCapture = 0;
+	unsigned m_threadEventCapacity = DEFAULT_PROFILER_THREAD_EVENTS;
+	// Incremented by Create() and Destroy(), so threads register again with a recreated profiler.
+	std::atomic<uint32_t> m_generation = 0;
+	double m_spikeThreshold = 0.0;
+	std::string m_spikeCaptureFile;
+	std::atomic<bool> m_enabled = false;
+};
+
+Profiler& GetProfiler();
+
+// Records the lifetime of the object as a profiler scope.
+class ProfileScope final
+{
+public:
+	explicit ProfileScope(const char* name)
+	{
+		Profiler& profiler = GetProfiler();
+		if (!profiler.IsEnabled()) return;
+		m_name = name;
+		m_begin = profiler.GetTime();
+		m_depth = Profiler::GetThreadDepth()++;
+	}
+	~ProfileScope()
+	{
+		if (!m_name) return;
+		Profiler& profiler = GetProfiler();
+		Profiler::GetThreadDepth()--;
+		profiler.AddEvent(m_name, m_begin, profiler.GetTime(), m_depth);
+	}
+
+private:
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+	const char* m_name = nullptr;
+	int64_t m_begin = 0;
+	uint32_t m_depth = 0;
+};
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+
+#if USE_PROFILER
+// Profile the enclosing scope. The name must be a string literal.
+#	define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#else
+#	define PROFILE_SCOPE(name)
+#endif
\ No newline at end of file
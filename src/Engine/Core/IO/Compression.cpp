@@ -0,0 +1,165 @@
+#include "stdafx.h"
+#include "Compression.h"
+//-----------------------------------------------------------------------------
+// Minimum match length of the format
+static const size_t LZ4_MIN_MATCH = 4;
+// The last bytes of a block are always literals
+static const size_t LZ4_LAST_LITERALS = 5;
+// A match can not start closer than this to the end of a block
+static const size_t LZ4_MATCH_LIMIT = 12;
+static const size_t LZ4_MAX_OFFSET = 65535;
+static const unsigned LZ4_HASH_BITS = 12;
+//-----------------------------------------------------------------------------
+static uint32_t ReadU32(const uint8_t* ptr)
+{
+	uint32_t value;
+	memcpy(&value, ptr, sizeof value);
+	return value;
+}
+//-----------------------------------------------------------------------------
+static uint8_t* WriteLength(uint8_t* op, size_t length)
+{
+	while (length >= 255)
+	{
+		*op++ = 255;
+		length -= 255;
+	}
+	*op++ = (uint8_t)length;
+	return op;
+}
+//-----------------------------------------------------------------------------
+static uint8_t* WriteSequence(uint8_t* op, const uint8_t* literals, size_t numLiterals, size_t offset, size_t matchLength)
+{
+	uint8_t* token = op++;
+	*token = (uint8_t)(std::min(numLiterals, (size_t)15) << 4);
+	if (numLiterals >= 15)
+		op = WriteLength(op, numLiterals - 15);
+	if (numLiterals)
+		memcpy(op, literals, numLiterals);
+	op += numLiterals;
+
+	// The last sequence has literals only
+	if (!matchLength)
+		return op;
+
+	*op++ = (uint8_t)(offset & 0xff);
+	*op++ = (uint8_t)(offset >> 8);
+
+	const size_t extraLength = matchLength - LZ4_MIN_MATCH;
+	*token |= (uint8_t)std::min(extraLength, (size_t)15);
+	if (extraLength >= 15)
+		op = WriteLength(op, extraLength - 15);
+	return op;
+}
+//-----------------------------------------------------------------------------
+static bool ReadLength(const uint8_t*& ip, const uint8_t* end, size_t& length)
+{
+	uint8_t byte;
+	do
+	{
+		if (ip >= end)
+			return false;
+		byte = *ip++;
+		length += byte;
+	} while (byte == 255);
+	return true;
+}
+//-----------------------------------------------------------------------------
+size_t CompressBoundLZ4(size_t srcSize)
+{
+	return srcSize + srcSize / 255 + 16;
+}
+//-----------------------------------------------------------------------------
+size_t CompressDataLZ4(void* dest, const void* src, size_t srcSize)
+{
+	const uint8_t* const base = static_cast<const uint8_t*>(src);
+	const uint8_t* const end = base + srcSize;
+	const uint8_t* ip = base;
+	const uint8_t* anchor = base;
+	uint8_t* op = static_cast<uint8_t*>(dest);
+
+	if (srcSize > LZ4_MATCH_LIMIT)
+	{
+		const uint8_t* const matchStartLimit = end - LZ4_MATCH_LIMIT;
+		const uint8_t* const matchEndLimit = end - LZ4_LAST_LITERALS;
+		// Last position of each hashed 4-byte sequence, greedy single-probe search
+		std::vector<int64_t> table(size_t(1) << LZ4_HASH_BITS, -1);
+
+		while (ip < matchStartLimit)
+		{
+			const uint32_t sequence = ReadU32(ip);
+			const uint32_t hash = (sequence * 2654435761u) >> (32 - LZ4_HASH_BITS);
+			const int64_t candidate = table[hash];
+			table[hash] = ip - base;
+
+			if (candidate < 0 || (size_t)(ip - base - candidate) > LZ4_MAX_OFFSET || ReadU32(base + candidate) != sequence)
+			{
+				++ip;
+				continue;
+			}
+
+			const uint8_t* match = base + candidate;
+			size_t matchLength = LZ4_MIN_MATCH;
+			while (ip + matchLength < matchEndLimit && ip[matchLength] == match[matchLength])
+				++matchLength;
+
+			op = WriteSequence(op, anchor, ip - anchor, ip - match, matchLength);
+			ip += matchLength;
+			anchor = ip;
+		}
+	}
+
+	op = WriteSequence(op, anchor, end - anchor, 0, 0);
+	return op - static_cast<uint8_t*>(dest);
+}
+//-----------------------------------------------------------------------------
+bool DecompressDataLZ4(void* dest, size_t destSize, const void* src, size_t srcSize)
+{
+	const uint8_t* ip = static_cast<const uint8_t*>(src);
+	const uint8_t* const ipEnd = ip + srcSize;
+	uint8_t* const opBegin = static_cast<uint8_t*>(dest);
+	uint8_t* op = opBegin;
+	uint8_t* const opEnd = op + destSize;
+
+	while (ip < ipEnd)
+	{
+		const uint8_t token = *ip++;
+
+		size_t numLiterals = token >> 4;
+		if (numLiterals == 15 && !ReadLength(ip, ipEnd, numLiterals))
+			return false;
+		if (numLiterals > (size_t)(ipEnd - ip) || numLiterals > (size_t)(opEnd - op))
+			return false;
+		if (numLiterals)
+			memcpy(op, ip, numLiterals);
+		ip += numLiterals;
+		op += numLiterals;
+
+		// The last sequence ends after its literals
+		if (ip == ipEnd)
+			break;
+
+		if (ipEnd - ip < 2)
+			return false;
+		const size_t offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (!offset || offset > (size_t)(op - opBegin))
+			return false;
+
+		size_t matchLength = token & 15;
+		if (matchLength == 15 && !ReadLength(ip, ipEnd, matchLength))
+			return false;
+		matchLength += LZ4_MIN_MATCH;
+		if (matchLength > (size_t)(opEnd - op))
+			return false;
+
+		// The match may overlap the output it is copied to, copy forward byte by byte
+		const uint8_t* match = op - offset;
+		for (size_t i = 0; i < matchLength; ++i)
+			op[i] = match[i];
+		op += matchLength;
+	}
+
+	return op == opEnd;
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
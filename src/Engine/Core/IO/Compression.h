@@ -0,0 +1,8 @@
+#pragma once
+
+// Return the maximum size of LZ4 compressed data for the given input size.
+size_t CompressBoundLZ4(size_t srcSize);
+// Compress data to the LZ4 block format. The destination must hold CompressBoundLZ4(srcSize) bytes. Return the compressed size.
+size_t CompressDataLZ4(void* dest, const void* src, size_t srcSize);
+// Decompress LZ4 block format data. Return true if the input was valid and decompressed to exactly destSize bytes.
+bool DecompressDataLZ4(void* dest, size_t destSize, const void* src, size_t srcSize);
\ No newline at end of file
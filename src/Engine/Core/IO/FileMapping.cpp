@@ -0,0 +1,110 @@
+#include "stdafx.h"
+#include "FileMapping.h"
+#include "FileSystem.h"
+#if PLATFORM_WINDOWS
+#	define WIN32_LEAN_AND_MEAN
+#	define NOMINMAX
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+//-----------------------------------------------------------------------------
+FileMapping::~FileMapping()
+{
+	Close();
+}
+//-----------------------------------------------------------------------------
+bool FileMapping::Open(const std::string& fileName)
+{
+	Close();
+
+	if (fileName.empty())
+		return false;
+
+	const std::string nativeName = FileSystem::NativePath(fileName);
+
+#if PLATFORM_WINDOWS
+	HANDLE file = CreateFileW(std::filesystem::path(nativeName).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize))
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	m_size = static_cast<size_t>(fileSize.QuadPart);
+	// An empty file can not be mapped, but is still a valid file
+	if (m_size)
+	{
+		m_mappingHandle = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (m_mappingHandle)
+			m_data = static_cast<const unsigned char*>(MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	}
+	// The mapping keeps the file open
+	CloseHandle(file);
+
+	if (m_size && !m_data)
+	{
+		Close();
+		return false;
+	}
+#else
+	const int fd = open(nativeName.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0 || !S_ISREG(fileStat.st_mode))
+	{
+		close(fd);
+		return false;
+	}
+
+	m_size = static_cast<size_t>(fileStat.st_size);
+	// An empty file can not be mapped, but is still a valid file
+	if (m_size)
+	{
+		void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data != MAP_FAILED)
+			m_data = static_cast<const unsigned char*>(data);
+	}
+	// The mapping keeps the file open
+	close(fd);
+
+	if (m_size && !m_data)
+	{
+		m_size = 0;
+		return false;
+	}
+#endif
+
+	m_name = fileName;
+	m_open = true;
+	return true;
+}
+//-----------------------------------------------------------------------------
+void FileMapping::Close()
+{
+#if PLATFORM_WINDOWS
+	if (m_data)
+		UnmapViewOfFile(m_data);
+	if (m_mappingHandle)
+		CloseHandle(m_mappingHandle);
+	m_mappingHandle = nullptr;
+#else
+	if (m_data)
+		munmap(const_cast<unsigned char*>(m_data), m_size);
+#endif
+
+	m_data = nullptr;
+	m_size = 0;
+	m_name.clear();
+	m_open = false;
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Core/Object/Ptr.h"
+
+// Read-only memory mapping of a whole file. Shared by the streams that read from it, and unmapped when the last one is destroyed.
+class FileMapping : public RefCounted
+{
+public:
+	FileMapping() = default;
+	~FileMapping();
+
+	// Map a file. Return true on success.
+	bool Open(const std::string& fileName);
+	// Unmap the file.
+	void Close();
+
+	// Return the mapped data, or null if not open or the file is empty.
+	const unsigned char* Data() const { return m_data; }
+	// Return size of the file in bytes.
+	size_t Size() const { return m_size; }
+	// Return the file name.
+	const std::string& Name() const { return m_name; }
+	// Return whether is open.
+	bool IsOpen() const { return m_open; }
+
+private:
+	FileMapping(FileMapping&&) = delete;
+	FileMapping(const FileMapping&) = delete;
+	FileMapping& operator=(FileMapping&&) = delete;
+	FileMapping& operator=(const FileMapping&) = delete;
+
+	const unsigned char* m_data = nullptr;
+	size_t m_size = 0;
+#if PLATFORM_WINDOWS
+	// File mapping object handle.
+	void* m_mappingHandle = nullptr;
+#endif
+	std::string m_name;
+	bool m_open = false;
+};
\ No newline at end of file
@@ -15,6 +15,19 @@ bool FileSystem::IsDirectory(const std::string& path) noexcept
 	return std::filesystem::is_directory(path);
 }
 //-----------------------------------------------------------------------------
+bool FileSystem::CreateDir(const std::string& pathName)
+{
+	std::error_code error;
+	std::filesystem::create_directories(pathName, error);
+	return !error && std::filesystem::is_directory(pathName);
+}
+//-----------------------------------------------------------------------------
+bool FileSystem::DeleteFile(const std::string& fileName)
+{
+	std::error_code error;
+	return std::filesystem::remove(fileName, error) && !error;
+}
+//-----------------------------------------------------------------------------
 unsigned FileSystem::LastModifiedTime(const std::string& fileName)
 {
 	std::filesystem::file_time_type info = std::filesystem::last_write_time(fileName);
@@ -199,6 +212,28 @@ std::string FileSystem::NativePath(const std::string& pathName)
 	return ret;
 }
 //-----------------------------------------------------------------------------
+std::string FileSystem::UserDataDir(const std::string& applicationName)
+{
+	std::string base;
+#if PLATFORM_WINDOWS
+	char* localAppData = nullptr;
+	size_t length = 0;
+	if (_dupenv_s(&localAppData, &length, "LOCALAPPDATA") == 0 && localAppData)
+	{
+		base = localAppData;
+		free(localAppData);
+	}
+#elif !PLATFORM_EMSCRIPTEN
+	if (const char* dataHome = std::getenv("XDG_DATA_HOME"); dataHome && dataHome[0])
+		base = dataHome;
+	else if (const char* home = std::getenv("HOME"); home && home[0])
+		base = std::string(home) + "/.local/share";
+#endif
+	if (base.empty())
+		return {};
+	return AddTrailingSlash(base) + applicationName + "/";
+}
+//-----------------------------------------------------------------------------
 bool FileSystem::IsAbsolutePath(const std::string& pathName)
 {
 	if (pathName.empty())
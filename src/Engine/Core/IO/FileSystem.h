@@ -77,6 +77,9 @@ namespace FileSystem
 	// Return whether a path is absolute.
 	bool IsAbsolutePath(const std::string& pathName);
 
+	// Return the per-user data directory of an application with a trailing slash, such as %LOCALAPPDATA%/Name/ or ~/.local/share/Name/, or an empty string if the platform has none. The directory is not created.
+	[[nodiscard]] std::string UserDataDir(const std::string& applicationName);
+
 	bool IsFileExtension(const std::string& pathName, const std::string& extension);
 
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 ﻿#include "stdafx.h"
 #include "Image.h"
+#include "MemoryMappedStream.h"
 #include "Core/Logging/Log.h"
 //-----------------------------------------------------------------------------
 inline Image::PixelFormat convertSTBToEngine(int nrChannels)
@@ -65,11 +66,19 @@ bool Image::LoadFromMemory(const uint8_t* data, size_t dataSize)
 //-----------------------------------------------------------------------------
 bool Image::LoadFromFile(const std::string& fileName, bool verticallyFlip)
 {
+	// Decode straight from the mapped file instead of through buffered reads
+	MemoryMappedStream file(fileName);
+	if (!file.IsOpen() || !file.Size())
+	{
+		LogError("IMAGE: Failed to open file " + fileName);
+		return false;
+	}
+
 	stbi_set_flip_vertically_on_load(verticallyFlip ? 1 : 0);
 
 	const int desiredСhannels = STBI_default;
 	int nrChannels = 0;
-	m_pixelData = stbi_load(fileName.c_str(), &m_width, &m_height, &nrChannels, desiredСhannels);
+	m_pixelData = stbi_load_from_memory(file.Data(), (int)file.Size(), &m_width, &m_height, &nrChannels, desiredСhannels);
 	m_imageFormat = convertSTBToEngine(nrChannels);
 
 	if (!m_pixelData || nrChannels < STBI_grey || nrChannels > STBI_rgb_alpha || m_width == 0 || m_height == 0)
@@ -6,6 +6,9 @@ const JSONValue JSONValue::EMPTY;
 const std::string JSONValue::emptyString;
 const JSONArray JSONValue::emptyJSONArray;
 const JSONObject JSONValue::emptyJSONObject;
+static PoolAllocator<std::string> stringAllocator;
+static PoolAllocator<JSONArray> arrayAllocator;
+static PoolAllocator<JSONObject> objectAllocator;
 //-----------------------------------------------------------------------------
 JSONValue::JSONValue() :
 	type(JSON_NULL)
@@ -662,15 +665,15 @@ void JSONValue::SetType(JSONType newType)
 	switch (type)
 	{
 	case JSON_STRING:
-		delete reinterpret_cast<std::string*>(data.objectValue);
+		stringAllocator.Free(reinterpret_cast<std::string*>(data.objectValue));
 		break;
 
 	case JSON_ARRAY:
-		delete reinterpret_cast<JSONArray*>(data.objectValue);
+		arrayAllocator.Free(reinterpret_cast<JSONArray*>(data.objectValue));
 		break;
 
 	case JSON_OBJECT:
-		delete reinterpret_cast<JSONObject*>(data.objectValue);
+		objectAllocator.Free(reinterpret_cast<JSONObject*>(data.objectValue));
 		break;
 
 	default:
@@ -682,15 +685,15 @@ void JSONValue::SetType(JSONType newType)
 	switch (type)
 	{
 	case JSON_STRING:
-		data.objectValue = new std::string();
+		data.objectValue = stringAllocator.Allocate();
 		break;
 
 	case JSON_ARRAY:
-		data.objectValue = new JSONArray();
+		data.objectValue = arrayAllocator.Allocate();
 		break;
 
 	case JSON_OBJECT:
-		data.objectValue = new JSONObject();
+		data.objectValue = objectAllocator.Allocate();
 		break;
 
 	default:
@@ -1,10 +1,12 @@
 #pragma once
 
+#include "Core/Object/PoolAllocator.h"
+
 class JSONValue;
 class Stream;
 
 typedef std::vector<JSONValue> JSONArray;
-typedef std::map<std::string, JSONValue> JSONObject;
+typedef std::map<std::string, JSONValue, std::less<std::string>, PoolStlAllocator<std::pair<const std::string, JSONValue>>> JSONObject;
 
 // JSON value types.
 enum JSONType
@@ -0,0 +1,76 @@
+#include "stdafx.h"
+#include "MemoryMappedStream.h"
+//-----------------------------------------------------------------------------
+MemoryMappedStream::MemoryMappedStream(const std::string& fileName)
+{
+	Open(fileName);
+}
+//-----------------------------------------------------------------------------
+MemoryMappedStream::MemoryMappedStream(FileMapping* mapping, size_t offset, size_t numBytes, const std::string& name)
+{
+	if (!mapping || !mapping->IsOpen() || offset > mapping->Size() || numBytes > mapping->Size() - offset)
+		return;
+
+	m_mapping = mapping;
+	m_data = mapping->Data() ? mapping->Data() + offset : nullptr;
+	m_size = numBytes;
+	m_name = name;
+}
+//-----------------------------------------------------------------------------
+bool MemoryMappedStream::Open(const std::string& fileName)
+{
+	Close();
+
+	SharedPtr<FileMapping> mapping(new FileMapping());
+	if (!mapping->Open(fileName))
+		return false;
+
+	m_mapping = mapping;
+	m_data = mapping->Data();
+	m_size = mapping->Size();
+	m_name = fileName;
+	return true;
+}
+//-----------------------------------------------------------------------------
+void MemoryMappedStream::Close()
+{
+	m_mapping.Reset();
+	m_data = nullptr;
+	m_position = 0;
+	m_size = 0;
+	m_name.clear();
+}
+//-----------------------------------------------------------------------------
+size_t MemoryMappedStream::Read(void* dest, size_t numBytes)
+{
+	if (numBytes + m_position > m_size)
+		numBytes = m_size - m_position;
+	if (!numBytes)
+		return 0;
+
+	memcpy(dest, m_data + m_position, numBytes);
+	m_position += numBytes;
+	return numBytes;
+}
+//-----------------------------------------------------------------------------
+size_t MemoryMappedStream::Seek(size_t newPosition)
+{
+	m_position = std::min(newPosition, m_size);
+	return m_position;
+}
+//-----------------------------------------------------------------------------
+size_t MemoryMappedStream::Write(const void*, size_t)
+{
+	return 0;
+}
+//-----------------------------------------------------------------------------
+const unsigned char* MemoryMappedStream::View(size_t numBytes)
+{
+	if (numBytes > m_size - m_position)
+		return nullptr;
+
+	const unsigned char* view = m_data + m_position;
+	m_position += numBytes;
+	return view;
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Stream.h"
+#include "FileMapping.h"
+
+// Read-only stream over a memory-mapped file or a part of it. Read() copies out of the mapping, View() and Data() point into it without copying.
+class MemoryMappedStream : public Stream
+{
+public:
+	MemoryMappedStream() = default;
+	// Construct by mapping a whole file.
+	MemoryMappedStream(const std::string& fileName);
+	// Construct over a range of a mapped file. The stream keeps the mapping alive.
+	MemoryMappedStream(FileMapping* mapping, size_t offset, size_t numBytes, const std::string& name);
+
+	// Read bytes from the mapping. Return number of bytes actually read.
+	size_t Read(void* dest, size_t numBytes) override;
+	// Set position in bytes from the beginning of the stream.
+	size_t Seek(size_t newPosition) override;
+	// Write is not supported. Return zero.
+	size_t Write(const void* data, size_t numBytes) override;
+	// Return whether read operations are allowed.
+	bool IsReadable() const override { return m_mapping.Get() != nullptr; }
+	// Return whether write operations are allowed.
+	bool IsWritable() const override { return false; }
+
+	// Map a whole file. Return true on success.
+	bool Open(const std::string& fileName);
+	// Release the mapping.
+	void Close();
+	// Return whether is open.
+	bool IsOpen() const { return m_mapping.Get() != nullptr; }
+
+	// Return a pointer to the next numBytes bytes and advance the position, or null if fewer bytes remain. The pointer stays valid while the stream exists.
+	const unsigned char* View(size_t numBytes);
+	// Return pointer to the whole stream data.
+	const unsigned char* Data() const { return m_data; }
+	// Return the mapping.
+	FileMapping* Mapping() const { return m_mapping; }
+
+	using Stream::Read;
+	using Stream::Write;
+
+private:
+	SharedPtr<FileMapping> m_mapping;
+	const unsigned char* m_data = nullptr;
+};
\ No newline at end of file
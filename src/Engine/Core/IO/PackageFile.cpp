@@ -0,0 +1,238 @@
+#include "stdafx.h"
+#include "PackageFile.h"
+#include "File.h"
+#include "MemoryMappedStream.h"
+#include "VectorBuffer.h"
+#include "Compression.h"
+#include "StringHash.h"
+#include "Core/Logging/Log.h"
+//-----------------------------------------------------------------------------
+static const char PACKAGE_ID[4] = { 'T', 'P', 'A', 'K' };
+static const uint32_t PACKAGE_VERSION = 1;
+// Keeps the table of contents readable in place
+static const size_t PACKAGE_TOC_ALIGNMENT = alignof(PackageEntry);
+//-----------------------------------------------------------------------------
+static bool EqualsIgnoreCase(const char* a, size_t length, const std::string& b)
+{
+	if (length != b.length())
+		return false;
+
+	for (size_t i = 0; i < length; ++i)
+	{
+		if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i]))
+			return false;
+	}
+	return true;
+}
+//-----------------------------------------------------------------------------
+static size_t AlignOffset(size_t offset, size_t alignment)
+{
+	return (offset + alignment - 1) / alignment * alignment;
+}
+//-----------------------------------------------------------------------------
+static void WritePadding(File& file, size_t alignment)
+{
+	static const unsigned char zeros[256] = {};
+	size_t padding = AlignOffset(file.Position(), alignment) - file.Position();
+	while (padding)
+	{
+		const size_t numBytes = std::min(padding, sizeof zeros);
+		file.Write(zeros, numBytes);
+		padding -= numBytes;
+	}
+}
+//-----------------------------------------------------------------------------
+bool PackageFile::Open(const std::string& fileName)
+{
+	Close();
+
+	SharedPtr<FileMapping> mapping(new FileMapping());
+	if (!mapping->Open(fileName))
+	{
+		LogError("Could not open package file " + fileName);
+		return false;
+	}
+
+	PackageHeader header;
+	if (mapping->Size() < sizeof header)
+	{
+		LogError(fileName + " is not a valid package file");
+		return false;
+	}
+	memcpy(&header, mapping->Data(), sizeof header);
+
+	if (memcmp(header.id, PACKAGE_ID, sizeof PACKAGE_ID) != 0 || header.version != PACKAGE_VERSION)
+	{
+		LogError(fileName + " is not a valid package file");
+		return false;
+	}
+
+	const uint64_t size = mapping->Size();
+	const uint64_t tocSize = (uint64_t)header.numEntries * sizeof(PackageEntry);
+	if (header.tocOffset % PACKAGE_TOC_ALIGNMENT || header.tocOffset > size || tocSize > size - header.tocOffset || header.namesOffset > size || header.namesSize > size - header.namesOffset)
+	{
+		LogError("Corrupt table of contents in package file " + fileName);
+		return false;
+	}
+
+	m_mapping = mapping;
+	m_entries = reinterpret_cast<const PackageEntry*>(mapping->Data() + header.tocOffset);
+	m_numEntries = header.numEntries;
+	m_names = reinterpret_cast<const char*>(mapping->Data() + header.namesOffset);
+	m_namesSize = (size_t)header.namesSize;
+	m_name = fileName;
+	return true;
+}
+//-----------------------------------------------------------------------------
+void PackageFile::Close()
+{
+	m_mapping.Reset();
+	m_entries = nullptr;
+	m_numEntries = 0;
+	m_names = nullptr;
+	m_namesSize = 0;
+	m_name.clear();
+}
+//-----------------------------------------------------------------------------
+AutoPtr<Stream> PackageFile::OpenEntry(const std::string& name) const
+{
+	const PackageEntry* entry = FindEntry(name);
+	if (!entry)
+		return AutoPtr<Stream>();
+
+	if (entry->offset > m_mapping->Size() || entry->packedSize > m_mapping->Size() - entry->offset)
+	{
+		LogError("Corrupt entry " + name + " in package file " + m_name);
+		return AutoPtr<Stream>();
+	}
+
+	if (entry->compression == PACKAGE_COMPRESSION_NONE && entry->packedSize == entry->size)
+		return AutoPtr<Stream>(new MemoryMappedStream(m_mapping, (size_t)entry->offset, (size_t)entry->size, name));
+
+	if (entry->compression == PACKAGE_COMPRESSION_LZ4)
+	{
+		AutoPtr<VectorBuffer> buffer(new VectorBuffer());
+		buffer->Resize((size_t)entry->size);
+		if (DecompressDataLZ4(buffer->ModifiableData(), (size_t)entry->size, m_mapping->Data() + entry->offset, (size_t)entry->packedSize))
+		{
+			buffer->SetName(name);
+			return AutoPtr<Stream>(buffer.Detach());
+		}
+	}
+
+	LogError("Corrupt entry " + name + " in package file " + m_name);
+	return AutoPtr<Stream>();
+}
+//-----------------------------------------------------------------------------
+const PackageEntry* PackageFile::FindEntry(const std::string& name) const
+{
+	if (!m_entries)
+		return nullptr;
+
+	const uint32_t hash = StringHash(name).Value();
+	const PackageEntry* end = m_entries + m_numEntries;
+	const PackageEntry* it = std::lower_bound(m_entries, end, hash, [](const PackageEntry& entry, uint32_t value) { return entry.nameHash < value; });
+
+	// Several names may share a hash, compare the names to find the right one
+	for (; it != end && it->nameHash == hash; ++it)
+	{
+		if (it->nameOffset <= m_namesSize && it->nameLength <= m_namesSize - it->nameOffset && EqualsIgnoreCase(m_names + it->nameOffset, it->nameLength, name))
+			return it;
+	}
+
+	return nullptr;
+}
+//-----------------------------------------------------------------------------
+std::string PackageFile::EntryName(const PackageEntry& entry) const
+{
+	if (!m_names || entry.nameOffset > m_namesSize || entry.nameLength > m_namesSize - entry.nameOffset)
+		return std::string();
+
+	return std::string(m_names + entry.nameOffset, entry.nameLength);
+}
+//-----------------------------------------------------------------------------
+bool PackageFile::Write(const std::string& fileName, const std::vector<PackageSource>& sources, bool compress, unsigned alignment)
+{
+	alignment = std::max(alignment, 1u);
+
+	File file(fileName, FILE_WRITE);
+	if (!file.IsOpen())
+	{
+		LogError("Could not open package file " + fileName + " for writing");
+		return false;
+	}
+
+	PackageHeader header = {};
+	memcpy(header.id, PACKAGE_ID, sizeof PACKAGE_ID);
+	header.version = PACKAGE_VERSION;
+	header.numEntries = (uint32_t)sources.size();
+	header.alignment = alignment;
+	// Placeholder, rewritten when the offsets are known
+	file.Write(&header, sizeof header);
+
+	std::vector<PackageEntry> entries;
+	entries.reserve(sources.size());
+	std::string names;
+	std::vector<unsigned char> data;
+	std::vector<unsigned char> packed;
+
+	for (size_t i = 0; i < sources.size(); ++i)
+	{
+		File source(sources[i].fileName);
+		if (!source.IsOpen())
+		{
+			LogError("Could not open " + sources[i].fileName + " for packaging");
+			return false;
+		}
+
+		data.resize(source.Size());
+		if (data.size() && source.Read(data.data(), data.size()) != data.size())
+		{
+			LogError("Could not read " + sources[i].fileName + " for packaging");
+			return false;
+		}
+
+		PackageEntry entry = {};
+		entry.nameHash = StringHash(sources[i].name).Value();
+		entry.nameOffset = (uint32_t)names.size();
+		entry.nameLength = (uint32_t)sources[i].name.length();
+		entry.size = data.size();
+		names += sources[i].name;
+
+		const unsigned char* stored = data.data();
+		entry.packedSize = data.size();
+		if (compress && data.size())
+		{
+			packed.resize(CompressBoundLZ4(data.size()));
+			const size_t packedSize = CompressDataLZ4(packed.data(), data.data(), data.size());
+			// Data that does not shrink is cheaper to read uncompressed and zero-copy
+			if (packedSize < data.size() - data.size() / 16)
+			{
+				entry.compression = PACKAGE_COMPRESSION_LZ4;
+				entry.packedSize = packedSize;
+				stored = packed.data();
+			}
+		}
+
+		WritePadding(file, alignment);
+		entry.offset = file.Position();
+		if (entry.packedSize)
+			file.Write(stored, (size_t)entry.packedSize);
+		entries.push_back(entry);
+	}
+
+	std::stable_sort(entries.begin(), entries.end(), [](const PackageEntry& a, const PackageEntry& b) { return a.nameHash < b.nameHash; });
+
+	WritePadding(file, PACKAGE_TOC_ALIGNMENT);
+	header.tocOffset = file.Position();
+	if (entries.size())
+		file.Write(entries.data(), entries.size() * sizeof(PackageEntry));
+	header.namesOffset = file.Position();
+	header.namesSize = names.size();
+	file.Write(names.data(), names.size());
+
+	file.Seek(0);
+	file.Write(&header, sizeof header);
+	return true;
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
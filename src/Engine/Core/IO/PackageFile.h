@@ -0,0 +1,105 @@
+#pragma once
+
+#include "FileMapping.h"
+#include "Core/Object/AutoPtr.h"
+
+class Stream;
+
+// Default alignment of entry data in a package.
+static const unsigned DEFAULT_PACKAGE_ALIGNMENT = 16;
+
+enum PackageCompression
+{
+	PACKAGE_COMPRESSION_NONE = 0,
+	PACKAGE_COMPRESSION_LZ4
+};
+
+// Package file header, at the beginning of the file.
+struct PackageHeader
+{
+	// File ID "TPAK".
+	char id[4];
+	uint32_t version;
+	uint32_t numEntries;
+	// Alignment of entry data.
+	uint32_t alignment;
+	// Offset of the table of contents, an array of entries sorted by name hash.
+	uint64_t tocOffset;
+	// Offset and size of the name table.
+	uint64_t namesOffset;
+	uint64_t namesSize;
+};
+
+// Package table of contents entry.
+struct PackageEntry
+{
+	// Case-insensitive StringHash of the name.
+	uint32_t nameHash;
+	// Position of the name in the name table.
+	uint32_t nameOffset;
+	uint32_t nameLength;
+	// PackageCompression of the data.
+	uint32_t compression;
+	// Offset of the data from the beginning of the package.
+	uint64_t offset;
+	// Size of the stored data.
+	uint64_t packedSize;
+	// Size of the data after decompression.
+	uint64_t size;
+};
+
+// Source file to be stored in a package.
+struct PackageSource
+{
+	// Resource name of the entry.
+	std::string name;
+	// File to read the data from.
+	std::string fileName;
+};
+
+// Read-only archive of resource files, mounted to the ResourceCache with AddPackageFile(). The file is memory-mapped and the table of contents is read in place, so opening the package and looking up entries does no file I/O. Thread-safe for reading.
+class PackageFile : public RefCounted
+{
+public:
+	PackageFile() = default;
+
+	// Open and map a package file. Return true on success.
+	bool Open(const std::string& fileName);
+	// Close the package.
+	void Close();
+
+	// Open an entry for reading. Uncompressed entries are returned as a zero-copy MemoryMappedStream. Return null if not found or corrupt.
+	AutoPtr<Stream> OpenEntry(const std::string& name) const;
+	// Return an entry by name, or null if not found.
+	const PackageEntry* FindEntry(const std::string& name) const;
+	// Return whether an entry exists.
+	bool Exists(const std::string& name) const { return FindEntry(name) != nullptr; }
+	// Return the name of an entry.
+	std::string EntryName(const PackageEntry& entry) const;
+
+	// Return the file name.
+	const std::string& Name() const { return m_name; }
+	// Return number of entries.
+	size_t NumEntries() const { return m_numEntries; }
+	// Return whether is open.
+	bool IsOpen() const { return m_mapping.Get() != nullptr; }
+
+	// Write a package from source files. Entries are LZ4 compressed if requested and the data shrinks. Return true on success.
+	static bool Write(const std::string& fileName, const std::vector<PackageSource>& sources, bool compress, unsigned alignment = DEFAULT_PACKAGE_ALIGNMENT);
+
+private:
+	PackageFile(PackageFile&&) = delete;
+	PackageFile(const PackageFile&) = delete;
+	PackageFile& operator=(PackageFile&&) = delete;
+	PackageFile& operator=(const PackageFile&) = delete;
+
+	// Mapping of the whole package. Streams of uncompressed entries share it, so it stays valid after the package is closed.
+	SharedPtr<FileMapping> m_mapping;
+	// Table of contents in the mapping.
+	const PackageEntry* m_entries = nullptr;
+	size_t m_numEntries = 0;
+	// Name table in the mapping.
+	const char* m_names = nullptr;
+	size_t m_namesSize = 0;
+	std::string m_name;
+};
\ No newline at end of file
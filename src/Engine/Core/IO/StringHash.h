@@ -50,6 +50,8 @@ public:
 	bool operator!=(const StringHash& rhs) const { return m_value != rhs.m_value; }
 	bool operator<(const StringHash& rhs) const { return m_value < rhs.m_value; }
 	bool operator>(const StringHash& rhs) const { return m_value > rhs.m_value; }
+	// Without this, C++20 pair and tuple comparisons would fall back to the bool conversion and treat all non-zero hashes as equal.
+	std::strong_ordering operator<=>(const StringHash& rhs) const { return m_value <=> rhs.m_value; }
 
 	operator bool() const { return m_value != 0; }
 	unsigned Value() const { return m_value; }
@@ -34,20 +34,17 @@ void LogSystem::Destroy()
 //-----------------------------------------------------------------------------
 void LogSystem::Print(const std::string& msg) noexcept
 {
-	puts(msg.c_str());
-#if PLATFORM_DESKTOP
-	if (m_logFile) fputs((msg + "\n").c_str(), m_logFile);
-#endif
+	print("", msg);
 }
 //-----------------------------------------------------------------------------
 void LogSystem::Warning(const std::string& msg) noexcept
 {
-	Print("Warning: " + msg);
+	print("Warning: ", msg);
 }
 //-----------------------------------------------------------------------------
 void LogSystem::Error(const std::string& msg) noexcept
 {
-	Print("Error: " + msg);
+	print("Error: ", msg);
 }
 //-----------------------------------------------------------------------------
 void LogSystem::Fatal(const std::string& msg) noexcept
@@ -57,6 +54,21 @@ void LogSystem::Fatal(const std::string& msg) noexcept
 	Error(msg);
 }
 //-----------------------------------------------------------------------------
+void LogSystem::print(const char* prefix, const std::string& msg) noexcept
+{
+	// prefix and line end are written separately so that no temporary string is built per message
+	fputs(prefix, stdout);
+	puts(msg.c_str());
+#if PLATFORM_DESKTOP
+	if (m_logFile)
+	{
+		fputs(prefix, m_logFile);
+		fputs(msg.c_str(), m_logFile);
+		fputc('\n', m_logFile);
+	}
+#endif
+}
+//-----------------------------------------------------------------------------
 LogSystem& GetLogSystem()
 {
 	return gLogSystem;
@@ -25,6 +25,8 @@ private:
 	LogSystem& operator=(LogSystem&&) = delete;
 	LogSystem& operator=(const LogSystem&) = delete;
 
+	void print(const char* prefix, const std::string& msg) noexcept;
+
 #if PLATFORM_DESKTOP
 	FILE* m_logFile = nullptr;
 #endif
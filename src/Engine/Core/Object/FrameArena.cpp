@@ -0,0 +1,156 @@
+#include "stdafx.h"
+#include "FrameArena.h"
+#include "Core/Logging/Log.h"
+//-----------------------------------------------------------------------------
+FrameArena gFrameArena;
+//-----------------------------------------------------------------------------
+// Buffers are aligned to a cache line so that any smaller alignment is satisfied from offset zero
+static const size_t FRAME_ARENA_BUFFER_ALIGNMENT = 64;
+// Overflow allocations that can be tracked without growing the bookkeeping vector
+static const size_t FRAME_ARENA_RESERVED_OVERFLOW = 64;
+//-----------------------------------------------------------------------------
+FrameArena::~FrameArena()
+{
+	Destroy();
+}
+//-----------------------------------------------------------------------------
+bool FrameArena::Create(const FrameArenaCreateInfo& createInfo)
+{
+	Destroy();
+
+	m_doubleBuffered = createInfo.doubleBuffered;
+	resizeBuffer(0, createInfo.capacity);
+	m_overflow[0].reserve(FRAME_ARENA_RESERVED_OVERFLOW);
+	if (m_doubleBuffered)
+	{
+		resizeBuffer(1, createInfo.capacity);
+		m_overflow[1].reserve(FRAME_ARENA_RESERVED_OVERFLOW);
+	}
+
+	LogPrint("FrameArena Create");
+	return true;
+}
+//-----------------------------------------------------------------------------
+void FrameArena::Destroy()
+{
+	for (unsigned i = 0; i < 2; ++i)
+	{
+		releaseOverflow(i, 0);
+		resizeBuffer(i, 0);
+	}
+
+	m_current = 0;
+	m_offset = 0;
+	m_overflowBytes = 0;
+	m_highWater = 0;
+}
+//-----------------------------------------------------------------------------
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+	assert(alignment && (alignment & (alignment - 1)) == 0);
+
+	const Buffer& buffer = m_buffers[m_current];
+	if (buffer.data && alignment <= FRAME_ARENA_BUFFER_ALIGNMENT)
+	{
+		const size_t alignedOffset = (m_offset + alignment - 1) & ~(alignment - 1);
+		if (alignedOffset + size <= buffer.capacity)
+		{
+			m_offset = alignedOffset + size;
+			m_highWater = std::max(m_highWater, m_offset + m_overflowBytes);
+			return buffer.data + alignedOffset;
+		}
+	}
+
+	return allocateOverflow(size, alignment);
+}
+//-----------------------------------------------------------------------------
+FrameArenaMarker FrameArena::GetMarker() const
+{
+	FrameArenaMarker marker;
+	marker.offset = m_offset;
+	marker.overflowCount = m_overflow[m_current].size();
+	marker.frame = m_frame;
+	return marker;
+}
+//-----------------------------------------------------------------------------
+void FrameArena::Rewind(const FrameArenaMarker& marker)
+{
+	// A marker from an earlier frame refers to memory that has already been recycled
+	assert(marker.frame == m_frame);
+	if (marker.frame != m_frame)
+		return;
+
+	assert(marker.offset <= m_offset);
+	m_overflowBytes -= releaseOverflow(m_current, marker.overflowCount);
+	m_offset = std::min(marker.offset, m_offset);
+}
+//-----------------------------------------------------------------------------
+void FrameArena::EndFrame()
+{
+	m_lastFrameHighWater = m_highWater;
+	m_peakHighWater = std::max(m_peakHighWater, m_highWater);
+
+	// In double-buffered mode the buffer of this frame stays untouched for one more frame and the older one is recycled
+	if (m_doubleBuffered)
+		m_current ^= 1;
+	releaseOverflow(m_current, 0);
+
+	// The recycled buffer holds no live data, so it can be grown to fit the worst frame seen so far
+	if (m_buffers[m_current].capacity < m_peakHighWater)
+	{
+		size_t newCapacity = std::max(m_buffers[m_current].capacity, FRAME_ARENA_BUFFER_ALIGNMENT);
+		while (newCapacity < m_peakHighWater)
+			newCapacity *= 2;
+		resizeBuffer(m_current, newCapacity);
+	}
+
+	m_offset = 0;
+	m_overflowBytes = 0;
+	m_highWater = 0;
+	++m_frame;
+}
+//-----------------------------------------------------------------------------
+void* FrameArena::allocateOverflow(size_t size, size_t alignment)
+{
+	std::vector<OverflowAllocation>& overflow = m_overflow[m_current];
+	if (overflow.empty())
+		LogWarning("FrameArena capacity " + std::to_string(m_buffers[m_current].capacity) + " exceeded, falling back to heap for this frame");
+
+	alignment = std::max(alignment, alignof(std::max_align_t));
+	void* data = ::operator new(size ? size : 1, std::align_val_t(alignment));
+	overflow.push_back({ data, size, alignment });
+
+	m_overflowBytes += size;
+	m_highWater = std::max(m_highWater, m_offset + m_overflowBytes);
+	return data;
+}
+//-----------------------------------------------------------------------------
+size_t FrameArena::releaseOverflow(unsigned buffer, size_t keepCount)
+{
+	size_t releasedBytes = 0;
+	std::vector<OverflowAllocation>& overflow = m_overflow[buffer];
+	while (overflow.size() > keepCount)
+	{
+		const OverflowAllocation& allocation = overflow.back();
+		::operator delete(allocation.data, std::align_val_t(allocation.alignment));
+		releasedBytes += allocation.size;
+		overflow.pop_back();
+	}
+	return releasedBytes;
+}
+//-----------------------------------------------------------------------------
+void FrameArena::resizeBuffer(unsigned buffer, size_t capacity)
+{
+	Buffer& target = m_buffers[buffer];
+	if (target.data)
+		::operator delete(target.data, std::align_val_t(FRAME_ARENA_BUFFER_ALIGNMENT));
+
+	target.data = capacity ? static_cast<uint8_t*>(::operator new(capacity, std::align_val_t(FRAME_ARENA_BUFFER_ALIGNMENT))) : nullptr;
+	target.capacity = capacity;
+}
+//-----------------------------------------------------------------------------
+FrameArena& GetFrameArena()
+{
+	return gFrameArena;
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
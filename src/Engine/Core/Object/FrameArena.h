@@ -0,0 +1,137 @@
+#pragma once
+
+// Default size of one frame arena buffer.
+static const size_t DEFAULT_FRAME_ARENA_CAPACITY = 4 * 1024 * 1024;
+
+struct FrameArenaCreateInfo final
+{
+	// Size of one buffer. The arena grows to the observed high-water mark when a frame overflows.
+	size_t capacity = DEFAULT_FRAME_ARENA_CAPACITY;
+	// Keep two buffers so that data allocated in a frame stays valid until the end of the next frame.
+	bool doubleBuffered = true;
+};
+
+// Position in the frame arena to rewind to.
+struct FrameArenaMarker final
+{
+	// Offset in the current buffer.
+	size_t offset = 0;
+	// Number of overflow allocations.
+	size_t overflowCount = 0;
+	// Frame the marker was taken in.
+	uint64_t frame = 0;
+};
+
+// Linear allocator for transient per-frame data. Allocation is a pointer bump, and memory is reclaimed all at once at the end of the frame. Not thread-safe, use from the main thread.
+class FrameArena final
+{
+public:
+	FrameArena() = default;
+	~FrameArena();
+
+	bool Create(const FrameArenaCreateInfo& createInfo);
+	void Destroy();
+
+	// Allocate uninitialized memory that stays valid until the end of the frame, or the end of the next frame in double-buffered mode.
+	void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+	// Allocate uninitialized memory for count objects.
+	template <class T> T* AllocateArray(size_t count) { return static_cast<T*>(Allocate(count * sizeof(T), alignof(T))); }
+
+	// Return the current position to rewind to later.
+	FrameArenaMarker GetMarker() const;
+	// Free everything allocated after the marker was taken.
+	void Rewind(const FrameArenaMarker& marker);
+
+	// Finish the frame: record the high-water mark and recycle the buffer. Called by EngineDevice in Present().
+	void EndFrame();
+
+	bool IsDoubleBuffered() const { return m_doubleBuffered; }
+	// Return capacity of the current buffer.
+	size_t GetCapacity() const { return m_buffers[m_current].capacity; }
+	// Return bytes allocated in the current frame.
+	size_t GetUsed() const { return m_offset + m_overflowBytes; }
+	// Return the highest number of bytes in use at once during the current frame.
+	size_t GetHighWater() const { return m_highWater; }
+	// Return the high-water mark of the previous frame.
+	size_t GetLastFrameHighWater() const { return m_lastFrameHighWater; }
+	// Return the highest high-water mark of all frames so far.
+	size_t GetPeakHighWater() const { return m_peakHighWater; }
+	// Return number of allocations that did not fit the buffer in the current frame. Non-zero means the frame hit the heap.
+	size_t GetOverflowCount() const { return m_overflow[m_current].size(); }
+	uint64_t GetFrameIndex() const { return m_frame; }
+
+private:
+	FrameArena(FrameArena&&) = delete;
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(FrameArena&&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	struct Buffer
+	{
+		uint8_t* data = nullptr;
+		size_t capacity = 0;
+	};
+
+	struct OverflowAllocation
+	{
+		void* data;
+		size_t size;
+		size_t alignment;
+	};
+
+	void* allocateOverflow(size_t size, size_t alignment);
+	size_t releaseOverflow(unsigned buffer, size_t keepCount);
+	void resizeBuffer(unsigned buffer, size_t capacity);
+
+	Buffer m_buffers[2];
+	std::vector<OverflowAllocation> m_overflow[2];
+	unsigned m_current = 0;
+	size_t m_offset = 0;
+	size_t m_overflowBytes = 0;
+	size_t m_highWater = 0;
+	size_t m_lastFrameHighWater = 0;
+	size_t m_peakHighWater = 0;
+	uint64_t m_frame = 0;
+	bool m_doubleBuffered = false;
+};
+
+FrameArena& GetFrameArena();
+
+// Rewinds the frame arena to its position at construction when going out of scope.
+class FrameArenaScope final
+{
+public:
+	explicit FrameArenaScope(FrameArena& arena = GetFrameArena()) : m_arena(arena), m_marker(arena.GetMarker()) {}
+	~FrameArenaScope() { m_arena.Rewind(m_marker); }
+
+private:
+	FrameArenaScope(const FrameArenaScope&) = delete;
+	FrameArenaScope& operator=(const FrameArenaScope&) = delete;
+
+	FrameArena& m_arena;
+	FrameArenaMarker m_marker;
+};
+
+// STL-compatible allocator adaptor over the frame arena. Deallocation is a no-op, memory is reclaimed when the frame ends or a scope rewinds.
+template <class T> class FrameStlAllocator
+{
+public:
+	typedef T value_type;
+
+	FrameStlAllocator() noexcept : m_arena(&GetFrameArena()) {}
+	explicit FrameStlAllocator(FrameArena& arena) noexcept : m_arena(&arena) {}
+	template <class U> FrameStlAllocator(const FrameStlAllocator<U>& other) noexcept : m_arena(other.GetArena()) {}
+
+	T* allocate(size_t n) { return m_arena->AllocateArray<T>(n); }
+	void deallocate(T*, size_t) noexcept {}
+
+	FrameArena* GetArena() const noexcept { return m_arena; }
+
+	template <class U> bool operator==(const FrameStlAllocator<U>& rhs) const noexcept { return m_arena == rhs.GetArena(); }
+	template <class U> bool operator!=(const FrameStlAllocator<U>& rhs) const noexcept { return m_arena != rhs.GetArena(); }
+
+private:
+	FrameArena* m_arena;
+};
+
+template <class T> using FrameVector = std::vector<T, FrameStlAllocator<T>>;
\ No newline at end of file
@@ -9,9 +9,8 @@ std::map<StringHash, StringHash> baseTypes;
 //-----------------------------------------------------------------------------
 void Object::ReleaseRef()
 {
-	assert(refCount && refCount->refs > 0);
-	--(refCount->refs);
-	if (refCount->refs == 0)
+	assert(refCount && LoadRefs(refCount->refs) > 0);
+	if (DecrementRefs(refCount->refs) == 0)
 		Destroy(this);
 }
 //-----------------------------------------------------------------------------
@@ -1,7 +1,7 @@
 #pragma once
 
 #include "Core/IO/StringHash.h"
-#include "Core/Object/Allocator.h"
+#include "Core/Object/PoolAllocator.h"
 #include "Core/Object/Event.h"
 
 class ObjectFactory;
@@ -102,7 +102,7 @@ public:
 	void Destroy(Object* object) override { return m_allocator.Free(static_cast<T*>(object)); }
 
 private:
-	Allocator<T> m_allocator;
+	PoolAllocator<T> m_allocator;
 };
 
 #define OBJECT(typeName) \
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "Allocator.h"
+
+// Assumed size of a CPU cache line. Pool blocks and size class state are aligned to it.
+static const size_t CACHE_LINE_SIZE = 64;
+// Smallest pooled allocation size.
+static const size_t POOL_MIN_NODE_SIZE = 8;
+// Largest pooled allocation size. Larger requests go to the system allocator.
+static const size_t POOL_MAX_NODE_SIZE = 1024;
+// Size of one pool block requested from the system.
+static const size_t POOL_BLOCK_SIZE = 64 * 1024;
+
+// Pool allocator statistics.
+struct PoolAllocatorStats
+{
+	// Number of blocks currently held by all size classes.
+	size_t blocks;
+	// Bytes currently held by all size classes.
+	size_t reservedBytes;
+	// Number of blocks returned to the system so far.
+	size_t releasedBlocks;
+};
+
+// Allocate memory from the size class pools. Thread-safe. Requests larger than POOL_MAX_NODE_SIZE are forwarded to the system allocator.
+void* PoolAllocate(size_t size);
+// Free memory allocated with PoolAllocate. The size must match the allocation request. Thread-safe.
+void PoolFree(void* ptr, size_t size);
+// Make sure at least count nodes of the given size are available without growing the pool.
+void PoolReserve(size_t size, size_t count);
+// Return the calling thread's cached nodes to the shared free lists.
+void PoolFlushThreadCache();
+// Return completely unused blocks to the system. Nodes cached by other threads keep their blocks alive. Return number of bytes released.
+size_t PoolReleaseEmptyBlocks();
+// Return pool statistics.
+PoolAllocatorStats PoolGetStats();
+// Return the node size that an allocation request is rounded up to, or the size itself if not pooled.
+size_t PoolNodeSize(size_t size);
+
+// Pooled allocator template class. Allocates objects of a specific class from the shared size class pools. Thread-safe.
+template <class T> class PoolAllocator
+{
+public:
+	// Construct with initial capacity.
+	PoolAllocator(size_t capacity = 0)
+	{
+		if (capacity)
+			Reserve(capacity);
+	}
+
+	// Reserve capacity for objects.
+	void Reserve(size_t capacity)
+	{
+		PoolReserve(sizeof(T), capacity);
+	}
+
+	// Allocate and default-construct an object.
+	T* Allocate()
+	{
+		T* newObject = static_cast<T*>(PoolAllocate(sizeof(T)));
+		new(newObject) T();
+
+		return newObject;
+	}
+
+	// Allocate and copy-construct an object.
+	T* Allocate(const T& object)
+	{
+		T* newObject = static_cast<T*>(PoolAllocate(sizeof(T)));
+		new(newObject) T(object);
+
+		return newObject;
+	}
+
+	// Destruct and free an object.
+	void Free(T* object)
+	{
+		if (!object)
+			return;
+
+		object->~T();
+		PoolFree(object, sizeof(T));
+	}
+
+private:
+	static_assert(alignof(T) <= 16, "PoolAllocator supports alignment up to 16 bytes");
+
+	// Prevent copy construction.
+	PoolAllocator(const PoolAllocator<T>& rhs);
+	// Prevent assignment.
+	PoolAllocator<T>& operator=(const PoolAllocator<T>& rhs);
+};
+
+// STL-compatible allocator adaptor over the size class pools, for node-based containers.
+template <class T> class PoolStlAllocator
+{
+public:
+	typedef T value_type;
+
+	PoolStlAllocator() noexcept = default;
+	template <class U> PoolStlAllocator(const PoolStlAllocator<U>&) noexcept {}
+
+	T* allocate(size_t n) { return static_cast<T*>(PoolAllocate(n * sizeof(T))); }
+	void deallocate(T* ptr, size_t n) noexcept { PoolFree(ptr, n * sizeof(T)); }
+
+	template <class U> bool operator==(const PoolStlAllocator<U>&) const noexcept { return true; }
+	template <class U> bool operator!=(const PoolStlAllocator<U>&) const noexcept { return false; }
+};
\ No newline at end of file
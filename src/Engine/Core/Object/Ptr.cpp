@@ -1,8 +1,8 @@
 #include "stdafx.h"
 #include "Ptr.h"
-#include "Allocator.h"
+#include "PoolAllocator.h"
 
-static Allocator<RefCount> refCountAllocator;
+static PoolAllocator<RefCount> refCountAllocator;
 
 RefCounted::RefCounted() :
 	refCount(nullptr)
@@ -13,36 +13,46 @@ RefCounted::~RefCounted()
 {
 	if (refCount)
 	{
-		assert(refCount->refs == 0);
-		if (refCount->weakRefs == 0)
-			refCountAllocator.Free(refCount);
-		else
-			refCount->expired = true;
+		assert(LoadRefs(refCount->refs) == 0);
+		// Mark expired before dropping the owner's weak reference, so that weak pointers never see a freed structure as alive
+		SetRefExpired(refCount->expired);
+		ReleaseWeakRef(refCount);
 	}
 }
 
 void RefCounted::AddRef()
 {
-	if (!refCount)
-		refCount = refCountAllocator.Allocate();
-
-	++(refCount->refs);
+	IncrementRefs(RefCountPtr()->refs);
 }
 
 void RefCounted::ReleaseRef()
 {
-	assert(refCount && refCount->refs > 0);
-	--(refCount->refs);
-	if (refCount->refs == 0)
+	assert(refCount && LoadRefs(refCount->refs) > 0);
+	if (DecrementRefs(refCount->refs) == 0)
 		delete this;
 }
 
 RefCount* RefCounted::RefCountPtr()
 {
+#if USE_THREADSAFE_REFCOUNT
+	// Two threads may take the first reference at the same time, only one of the structures is kept
+	std::atomic_ref<RefCount*> sharedRefCount(refCount);
+	RefCount* current = sharedRefCount.load(std::memory_order_acquire);
+	if (!current)
+	{
+		RefCount* newRefCount = refCountAllocator.Allocate();
+		if (sharedRefCount.compare_exchange_strong(current, newRefCount, std::memory_order_acq_rel, std::memory_order_acquire))
+			current = newRefCount;
+		else
+			refCountAllocator.Free(newRefCount);
+	}
+	return current;
+#else
 	if (!refCount)
 		refCount = refCountAllocator.Allocate();
 
 	return refCount;
+#endif
 }
 
 RefCount* RefCounted::AllocateRefCount()
@@ -53,4 +63,11 @@ RefCount* RefCounted::AllocateRefCount()
 void RefCounted::FreeRefCount(RefCount* refCount)
 {
 	refCountAllocator.Free(refCount);
+}
+
+void RefCounted::ReleaseWeakRef(RefCount* refCount)
+{
+	assert(refCount && LoadRefs(refCount->weakRefs) > 0);
+	if (DecrementRefs(refCount->weakRefs) == 0)
+		refCountAllocator.Free(refCount);
 }
\ No newline at end of file
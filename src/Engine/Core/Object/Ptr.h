@@ -3,25 +3,116 @@
 class RefCounted;
 template <class T> class WeakPtr;
 
+// Reference counting shared between threads. Increments are relaxed, decrements acquire-release.
+struct AtomicRefPolicy
+{
+	// Reference counter.
+	typedef std::atomic<unsigned> Counter;
+	// Expired flag.
+	typedef std::atomic<bool> ExpiredFlag;
+
+	// Return the value of a reference counter.
+	static unsigned Load(const Counter& counter) { return counter.load(std::memory_order_relaxed); }
+	// Increment a reference counter. A new reference can only be made from an existing one, so no ordering is needed.
+	static void Increment(Counter& counter) { counter.fetch_add(1, std::memory_order_relaxed); }
+	// Decrement a reference counter and return the new value. Acquire-release, so that the thread reaching zero sees all writes made through other references before destroying the object.
+	static unsigned Decrement(Counter& counter) { return counter.fetch_sub(1, std::memory_order_acq_rel) - 1; }
+	// Increment a reference counter only if it is not zero. Return true on success.
+	static bool TryIncrement(Counter& counter)
+	{
+		unsigned refs = counter.load(std::memory_order_relaxed);
+		while (refs != 0)
+		{
+			if (counter.compare_exchange_weak(refs, refs + 1, std::memory_order_acquire, std::memory_order_relaxed))
+				return true;
+		}
+		return false;
+	}
+	// Return whether the object has been destroyed.
+	static bool IsExpired(const ExpiredFlag& expired) { return expired.load(std::memory_order_acquire); }
+	// Mark the object destroyed.
+	static void SetExpired(ExpiredFlag& expired) { expired.store(true, std::memory_order_release); }
+};
+
+// Reference counting confined to one thread at a time.
+struct PlainRefPolicy
+{
+	// Reference counter.
+	typedef unsigned Counter;
+	// Expired flag.
+	typedef bool ExpiredFlag;
+
+	// Return the value of a reference counter.
+	static unsigned Load(const Counter& counter) { return counter; }
+	// Increment a reference counter.
+	static void Increment(Counter& counter) { ++counter; }
+	// Decrement a reference counter and return the new value.
+	static unsigned Decrement(Counter& counter) { return --counter; }
+	// Increment a reference counter only if it is not zero. Return true on success.
+	static bool TryIncrement(Counter& counter)
+	{
+		if (counter == 0)
+			return false;
+		++counter;
+		return true;
+	}
+	// Return whether the object has been destroyed.
+	static bool IsExpired(const ExpiredFlag& expired) { return expired; }
+	// Mark the object destroyed.
+	static void SetExpired(ExpiredFlag& expired) { expired = true; }
+};
+
+// Policy of RefCounted, SharedPtr and WeakPtr.
+#if USE_THREADSAFE_REFCOUNT
+typedef AtomicRefPolicy RefPolicy;
+#else
+typedef PlainRefPolicy RefPolicy;
+#endif
+// Reference counter.
+typedef RefPolicy::Counter RefCounter;
+// Expired flag.
+typedef RefPolicy::ExpiredFlag RefExpiredFlag;
+
 // Reference count structure. Used in both intrusive and non-intrusive reference counting.
 struct RefCount
 {
-	// Construct with zero refcounts.
+	// Construct with zero strong refcount. The owner holds one weak reference until the object is destroyed.
 	RefCount() :
 		refs(0),
-		weakRefs(0),
+		weakRefs(1),
 		expired(false)
 	{
 	}
 
 	// Number of strong references. These keep the object alive.
-	unsigned refs;
-	// Number of weak references.
-	unsigned weakRefs;
+	RefCounter refs;
+	// Number of weak references, plus one held by the owner while the object is alive. The structure is freed when this reaches zero.
+	RefCounter weakRefs;
 	// Expired flag. The object is no longer safe to access after this is set true.
-	bool expired;
+	RefExpiredFlag expired;
 };
 
+// Return the value of a reference counter.
+inline unsigned LoadRefs(const RefCounter& counter) { return RefPolicy::Load(counter); }
+// Increment a reference counter.
+inline void IncrementRefs(RefCounter& counter) { RefPolicy::Increment(counter); }
+// Decrement a reference counter and return the new value.
+inline unsigned DecrementRefs(RefCounter& counter) { return RefPolicy::Decrement(counter); }
+// Increment a reference counter only if it is not zero. Return true on success.
+inline bool TryIncrementRefs(RefCounter& counter) { return RefPolicy::TryIncrement(counter); }
+// Return whether the object has been destroyed.
+inline bool IsRefExpired(const RefExpiredFlag& expired) { return RefPolicy::IsExpired(expired); }
+// Mark the object destroyed.
+inline void SetRefExpired(RefExpiredFlag& expired) { RefPolicy::SetExpired(expired); }
+
+// Return the number of weak references, excluding the one held by the owner while alive.
+inline unsigned LoadWeakRefs(const RefCount& refCount)
+{
+	const bool expired = IsRefExpired(refCount.expired);
+	const unsigned weakRefs = LoadRefs(refCount.weakRefs);
+	return (expired || weakRefs == 0) ? weakRefs : weakRefs - 1;
+}
+
 // Base class for intrusively reference counted objects that can be pointed to with SharedPtr and WeakPtr. These are not copy-constructible and not assignable.
 class RefCounted
 {
@@ -40,9 +131,9 @@ public:
 	virtual void ReleaseRef();
 
 	// Return the number of strong references.
-	unsigned Refs() const { return refCount ? refCount->refs : 0; }
+	unsigned Refs() const { return refCount ? LoadRefs(refCount->refs) : 0; }
 	// Return the number of weak references.
-	unsigned WeakRefs() const { return refCount ? refCount->weakRefs : 0; }
+	unsigned WeakRefs() const { return refCount ? LoadWeakRefs(*refCount) : 0; }
 	// Return pointer to the reference count structure. Allocate if not allocated yet.
 	RefCount* RefCountPtr();
 
@@ -50,6 +141,8 @@ public:
 	static RefCount* AllocateRefCount();
 	// Free a reference count structure.
 	static void FreeRefCount(RefCount* refCount);
+	// Release a weak reference, or the owner's reference after marking the object expired. Free the structure when the last one is gone.
+	static void ReleaseWeakRef(RefCount* refCount);
 
 private:
 	// Prevent copy construction.
@@ -223,7 +316,7 @@ public:
 		ptr = rhs.ptr;
 		refCount = rhs.refCount;
 		if (refCount)
-			++(refCount->weakRefs);
+			IncrementRefs(refCount->weakRefs);
 		return *this;
 	}
 
@@ -237,7 +330,7 @@ public:
 		ptr = rhs.Get();
 		refCount = ptr ? ptr->RefCountPtr() : nullptr;
 		if (refCount)
-			++(refCount->weakRefs);
+			IncrementRefs(refCount->weakRefs);
 		return *this;
 	}
 
@@ -251,7 +344,7 @@ public:
 		ptr = rhs;
 		refCount = ptr ? ptr->RefCountPtr() : nullptr;
 		if (refCount)
-			++(refCount->weakRefs);
+			IncrementRefs(refCount->weakRefs);
 		return *this;
 	}
 
@@ -260,10 +353,8 @@ public:
 	{
 		if (refCount)
 		{
-			--(refCount->weakRefs);
 			// If expired and no more weak references, destroy the reference count
-			if (refCount->expired && refCount->weakRefs == 0)
-				RefCounted::FreeRefCount(refCount);
+			RefCounted::ReleaseWeakRef(refCount);
 			ptr = nullptr;
 			refCount = nullptr;
 		}
@@ -306,20 +397,34 @@ public:
 	// Return the object or null if it has been destroyed.
 	T* Get() const
 	{
-		if (refCount && !refCount->expired)
+		if (refCount && !IsRefExpired(refCount->expired))
 			return ptr;
 		else
 			return nullptr;
 	}
 
+	// Return a strong reference to the object, or null if it has been destroyed or is being destroyed. Safe to call while another thread releases the last strong reference.
+	SharedPtr<T> Lock() const
+	{
+		SharedPtr<T> ret;
+		// Only take a strong reference while at least one other still exists, so a dying object is never resurrected
+		if (refCount && TryIncrementRefs(refCount->refs))
+		{
+			ret = ptr;
+			// The shared pointer now holds its own reference, drop the temporary one. This can not reach zero
+			DecrementRefs(refCount->refs);
+		}
+		return ret;
+	}
+
 	// Return the number of strong references.
-	unsigned Refs() const { return refCount ? refCount->refs : 0; }
+	unsigned Refs() const { return refCount ? LoadRefs(refCount->refs) : 0; }
 	// Return the number of weak references.
-	unsigned WeakRefs() const { return refCount ? refCount->weakRefs : 0; }
+	unsigned WeakRefs() const { return refCount ? LoadWeakRefs(*refCount) : 0; }
 	// Return whether is a null pointer.
 	bool IsNull() const { return ptr == nullptr; }
 	// Return whether the object has been destroyed. Returns false if is a null pointer.
-	bool IsExpired() const { return refCount && refCount->expired; }
+	bool IsExpired() const { return refCount && IsRefExpired(refCount->expired); }
 
 private:
 	// %Object pointer.
@@ -387,7 +492,7 @@ public:
 		ptr = rhs.ptr;
 		refCount = rhs.refCount;
 		if (refCount)
-			++(refCount->refs);
+			IncrementRefs(refCount->refs);
 
 		return *this;
 	}
@@ -405,7 +510,7 @@ public:
 			ptr = rhs;
 			refCount = RefCounted::AllocateRefCount();
 			if (refCount)
-				++(refCount->refs);
+				IncrementRefs(refCount->refs);
 		}
 
 		return *this;
@@ -427,14 +532,12 @@ public:
 	{
 		if (refCount)
 		{
-			--(refCount->refs);
-			if (refCount->refs == 0)
+			if (DecrementRefs(refCount->refs) == 0)
 			{
-				refCount->expired = true;
+				SetRefExpired(refCount->expired);
 				delete[] ptr;
-				// If no weak refs, destroy the ref count now too
-				if (refCount->weakRefs == 0)
-					RefCounted::FreeRefCount(refCount);
+				// Release the owner's weak reference. If no weak refs, this destroys the ref count now too
+				RefCounted::ReleaseWeakRef(refCount);
 			}
 		}
 
@@ -449,7 +552,7 @@ public:
 		ptr = static_cast<T*>(rhs.Get());
 		refCount = rhs.RefCountPtr();
 		if (refCount)
-			++(refCount->refs);
+			IncrementRefs(refCount->refs);
 	}
 
 	// Perform a reinterpret cast from a shared array pointer of another type.
@@ -459,15 +562,15 @@ public:
 		ptr = reinterpret_cast<T*>(rhs.Get());
 		refCount = rhs.RefCountPtr();
 		if (refCount)
-			++(refCount->refs);
+			IncrementRefs(refCount->refs);
 	}
 
 	// Return the raw pointer.
 	T* Get() const { return ptr; }
 	// Return the number of strong references.
-	unsigned Refs() const { return refCount ? refCount->refs : 0; }
+	unsigned Refs() const { return refCount ? LoadRefs(refCount->refs) : 0; }
 	// Return the number of weak references.
-	unsigned WeakRefs() const { return refCount ? refCount->weakRefs : 0; }
+	unsigned WeakRefs() const { return refCount ? LoadWeakRefs(*refCount) : 0; }
 	// Return pointer to the reference count structure.
 	RefCount* RefCountPtr() const { return refCount; }
 	// Check if the pointer is null.
@@ -542,7 +645,7 @@ public:
 		ptr = rhs.Get();
 		refCount = rhs.RefCountPtr();
 		if (refCount)
-			++(refCount->weakRefs);
+			IncrementRefs(refCount->weakRefs);
 
 		return *this;
 	}
@@ -557,7 +660,7 @@ public:
 		ptr = rhs.ptr;
 		refCount = rhs.refCount;
 		if (refCount)
-			++(refCount->weakRefs);
+			IncrementRefs(refCount->weakRefs);
 
 		return *this;
 	}
@@ -610,9 +713,7 @@ public:
 	{
 		if (refCount)
 		{
-			--(refCount->weakRefs);
-			if (refCount->expired && refCount->weakRefs == 0)
-				RefCounted::FreeRefCount(refCount);
+			RefCounted::ReleaseWeakRef(refCount);
 		}
 
 		ptr = nullptr;
@@ -626,7 +727,7 @@ public:
 		ptr = static_cast<T*>(rhs.Get());
 		refCount = rhs.refCount;
 		if (refCount)
-			++(refCount->weakRefs);
+			IncrementRefs(refCount->weakRefs);
 	}
 
 	// Perform a reinterpret cast from a weak array pointer of another type.
@@ -636,13 +737,13 @@ public:
 		ptr = reinterpret_cast<T*>(rhs.Get());
 		refCount = rhs.refCount;
 		if (refCount)
-			++(refCount->weakRefs);
+			IncrementRefs(refCount->weakRefs);
 	}
 
 	// Return raw pointer. If array has destroyed, return null.
 	T* Get() const
 	{
-		if (!refCount || refCount->expired)
+		if (!refCount || IsRefExpired(refCount->expired))
 			return nullptr;
 		else
 			return ptr;
@@ -651,11 +752,11 @@ public:
 	// Check if the pointer is null.
 	bool IsNull() const { return refCount == nullptr; }
 	// Return number of strong references.
-	unsigned Refs() const { return (refCount && refCount->refs >= 0) ? refCount->refs : 0; }
+	unsigned Refs() const { return refCount ? LoadRefs(refCount->refs) : 0; }
 	// Return number of weak references.
-	unsigned WeakRefs() const { return refCount ? refCount->weakRefs : 0; }
+	unsigned WeakRefs() const { return refCount ? LoadWeakRefs(*refCount) : 0; }
 	// Return whether the array has been destroyed. Returns false if is a null pointer.
-	bool IsExpired() const { return refCount ? refCount->expired : false; }
+	bool IsExpired() const { return refCount ? IsRefExpired(refCount->expired) : false; }
 
 private:
 	// Prevent direct assignment from a weak array pointer of different type.
@@ -0,0 +1,293 @@
+#include "stdafx.h"
+#include "BackgroundLoader.h"
+#include "ResourceCache.h"
+#include "Resource.h"
+#include "Core/IO/Stream.h"
+#include "Core/Logging/Log.h"
+#include <chrono>
+
+BackgroundLoader::BackgroundLoader(ResourceCache* owner_, unsigned numThreads) :
+	owner(owner_),
+	nextSequence(0),
+	shutdown(false)
+{
+	assert(owner);
+
+	for (unsigned i = 0; i < std::max(numThreads, 1u); ++i)
+		threads.emplace_back(&BackgroundLoader::WorkerLoop, this);
+}
+
+BackgroundLoader::~BackgroundLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		shutdown = true;
+	}
+	queueCondition.notify_all();
+
+	for (size_t i = 0; i < threads.size(); ++i)
+		threads[i].join();
+}
+
+bool BackgroundLoader::QueueResource(StringHash type, const std::string& nameIn, int priority, Resource* caller)
+{
+	std::string name = owner->SanitateResourceName(nameIn);
+	if (name.empty())
+		return false;
+
+	ResourceKey key(type, StringHash(name));
+
+	std::lock_guard<std::mutex> lock(queueMutex);
+
+	auto it = items.find(key);
+	if (it != items.end())
+	{
+		// Already queued. Requeue with the higher priority; the stale queue entry is skipped by the workers
+		BackgroundLoadItem& item = it->second;
+		if (priority > item.priority && item.state == BACKGROUND_LOAD_QUEUED)
+		{
+			item.priority = priority;
+			queue.push(QueueEntry{ priority, nextSequence++, key });
+		}
+
+		AddDependency(caller, key);
+		return true;
+	}
+
+	// Loaded already, nothing to wait for
+	if (owner->IsLoaded(key))
+		return false;
+
+	SharedPtr<Object> newObject = Object::Create(type);
+	if (!newObject)
+	{
+		LogError("Could not load unknown resource type " + type.ToString());
+		return false;
+	}
+	Resource* newResource = dynamic_cast<Resource*>(newObject.Get());
+	if (!newResource)
+	{
+		LogError(Object::TypeNameFromType(type) + " is not a resource");
+		return false;
+	}
+
+	newResource->SetName(name);
+
+	BackgroundLoadItem& item = items[key];
+	item.resource = newResource;
+	item.priority = priority;
+	queue.push(QueueEntry{ priority, nextSequence++, key });
+	AddDependency(caller, key);
+
+	queueCondition.notify_one();
+	return true;
+}
+
+void BackgroundLoader::FinishResources(float maxTimeMs)
+{
+	const auto startTime = std::chrono::steady_clock::now();
+
+	for (;;)
+	{
+		ResourceKey readyKey;
+		bool ready = false;
+
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			for (size_t i = 0; i < loadedItems.size(); ++i)
+			{
+				auto it = items.find(loadedItems[i]);
+				if (it != items.end() && it->second.dependencies.empty())
+				{
+					readyKey = loadedItems[i];
+					ready = true;
+					break;
+				}
+			}
+		}
+
+		if (!ready)
+			break;
+
+		FinishItem(readyKey);
+
+		const std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - startTime;
+		if (elapsed.count() >= maxTimeMs)
+			break;
+	}
+}
+
+void BackgroundLoader::WaitForResource(const ResourceKey& key)
+{
+	for (;;)
+	{
+		std::unique_lock<std::mutex> lock(queueMutex);
+
+		auto it = items.find(key);
+		if (it == items.end())
+			return;
+
+		BackgroundLoadItem& item = it->second;
+		if (item.state == BACKGROUND_LOAD_QUEUED)
+		{
+			// Not picked up by a worker yet, load on this thread instead of waiting
+			item.state = BACKGROUND_LOAD_LOADING;
+			LoadItem(lock, key);
+		}
+		else if (item.state == BACKGROUND_LOAD_LOADING)
+			loadedCondition.wait(lock);
+		else if (item.state == BACKGROUND_LOAD_FINISHING)
+			return;
+		else if (!item.dependencies.empty())
+		{
+			ResourceKey dependency = *item.dependencies.begin();
+			lock.unlock();
+			WaitForResource(dependency);
+		}
+		else
+		{
+			lock.unlock();
+			FinishItem(key);
+			return;
+		}
+	}
+}
+
+bool BackgroundLoader::IsQueued(const ResourceKey& key) const
+{
+	std::lock_guard<std::mutex> lock(queueMutex);
+	return items.find(key) != items.end();
+}
+
+size_t BackgroundLoader::NumQueuedResources() const
+{
+	std::lock_guard<std::mutex> lock(queueMutex);
+	return items.size();
+}
+
+void BackgroundLoader::WorkerLoop()
+{
+	std::unique_lock<std::mutex> lock(queueMutex);
+
+	for (;;)
+	{
+		queueCondition.wait(lock, [this]() { return shutdown || !queue.empty(); });
+		if (shutdown)
+			return;
+
+		QueueEntry entry = queue.top();
+		queue.pop();
+
+		// Skip entries that were requeued with a higher priority or taken over by the main thread
+		auto it = items.find(entry.key);
+		if (it == items.end() || it->second.state != BACKGROUND_LOAD_QUEUED)
+			continue;
+
+		it->second.state = BACKGROUND_LOAD_LOADING;
+		LoadItem(lock, entry.key);
+	}
+}
+
+void BackgroundLoader::LoadItem(std::unique_lock<std::mutex>& lock, const ResourceKey& key)
+{
+	// Items in the loading state are never erased, so the reference stays valid while unlocked
+	BackgroundLoadItem& item = items[key];
+	SharedPtr<Resource> resource = item.resource;
+
+	lock.unlock();
+	bool success = false;
+	AutoPtr<Stream> stream = owner->OpenResource(resource->Name());
+	if (stream)
+	{
+		LogPrint("Loading resource " + resource->Name() + " in background");
+		success = resource->BeginLoad(*stream);
+	}
+	lock.lock();
+
+	item.success = success;
+	item.state = BACKGROUND_LOAD_LOADED;
+	loadedItems.push_back(key);
+	loadedCondition.notify_all();
+}
+
+void BackgroundLoader::FinishItem(const ResourceKey& key)
+{
+	SharedPtr<Resource> resource;
+	bool success = false;
+
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+
+		auto it = items.find(key);
+		if (it == items.end())
+			return;
+
+		BackgroundLoadItem& item = it->second;
+		if (item.state != BACKGROUND_LOAD_LOADED)
+			return;
+		assert(item.dependencies.empty());
+		resource = item.resource;
+		success = item.success;
+
+		// Release the resources waiting for this one
+		for (auto depIt = item.dependents.begin(); depIt != item.dependents.end(); ++depIt)
+		{
+			auto dependentIt = items.find(*depIt);
+			if (dependentIt != items.end())
+				dependentIt->second.dependencies.erase(key);
+		}
+
+		// Keep the item until stored, so that the resource is never missing from both the queue and the cache
+		item.state = BACKGROUND_LOAD_FINISHING;
+		loadedItems.erase(std::find(loadedItems.begin(), loadedItems.end(), key));
+	}
+
+	if (success)
+		success = resource->EndLoad();
+
+	if (success)
+		owner->StoreResource(key, resource);
+	else
+		LogError("Failed to load resource " + resource->Name());
+
+	std::lock_guard<std::mutex> lock(queueMutex);
+	items.erase(key);
+}
+
+void BackgroundLoader::AddDependency(Resource* caller, const ResourceKey& key)
+{
+	if (!caller)
+		return;
+
+	ResourceKey callerKey(caller->Type(), caller->NameHash());
+	auto callerIt = items.find(callerKey);
+	// A resource that is already finishing has released its dependents and is stored before the caller can finish
+	if (callerKey == key || callerIt == items.end() || items[key].state == BACKGROUND_LOAD_FINISHING)
+		return;
+
+	// A cycle would never finish, load such resources without waiting for each other
+	if (DependsOn(key, callerKey))
+	{
+		LogWarning("Circular resource dependency between " + caller->Name() + " and " + items[key].resource->Name());
+		return;
+	}
+
+	callerIt->second.dependencies.insert(key);
+	items[key].dependents.insert(callerKey);
+}
+
+bool BackgroundLoader::DependsOn(const ResourceKey& from, const ResourceKey& to) const
+{
+	auto it = items.find(from);
+	if (it == items.end())
+		return false;
+
+	const std::set<ResourceKey>& dependencies = it->second.dependencies;
+	for (auto depIt = dependencies.begin(); depIt != dependencies.end(); ++depIt)
+	{
+		if (*depIt == to || DependsOn(*depIt, to))
+			return true;
+	}
+
+	return false;
+}
\ No newline at end of file
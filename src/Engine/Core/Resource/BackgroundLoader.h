@@ -0,0 +1,103 @@
+#pragma once
+
+#include "ResourceMap.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+class ResourceCache;
+
+/// Background load state.
+enum BackgroundLoadState
+{
+	BACKGROUND_LOAD_QUEUED = 0,
+	BACKGROUND_LOAD_LOADING,
+	BACKGROUND_LOAD_LOADED,
+	BACKGROUND_LOAD_FINISHING
+};
+
+/// Queued background load of one resource.
+struct BackgroundLoadItem
+{
+	/// Resource being loaded.
+	SharedPtr<Resource> resource;
+	/// Load priority. Higher priorities are loaded first.
+	int priority = 0;
+	/// Load state.
+	BackgroundLoadState state = BACKGROUND_LOAD_QUEUED;
+	/// BeginLoad result.
+	bool success = false;
+	/// Resources that must finish before this one.
+	std::set<ResourceKey> dependencies;
+	/// Resources that wait for this one.
+	std::set<ResourceKey> dependents;
+};
+
+/// Worker threads that run Resource::BeginLoad for the resource cache. EndLoad is run on the main thread, after all dependencies have finished.
+class BackgroundLoader
+{
+public:
+	/// Construct and start the worker threads.
+	BackgroundLoader(ResourceCache* owner, unsigned numThreads);
+	/// Destruct. Stop the worker threads. Resources still queued are dropped.
+	~BackgroundLoader();
+
+	/// Queue a resource for loading. When called with a caller resource, the caller does not finish before the queued resource. Return true if queued now or earlier. Thread-safe.
+	bool QueueResource(StringHash type, const std::string& name, int priority, Resource* caller);
+	/// Finish loaded resources on the main thread, spending at most the given time. A resource is always finished if it is ready, even if the time is exceeded.
+	void FinishResources(float maxTimeMs);
+	/// Load and finish a queued resource and its dependencies immediately. Main thread only.
+	void WaitForResource(const ResourceKey& key);
+
+	/// Return whether a resource is queued or being loaded.
+	bool IsQueued(const ResourceKey& key) const;
+	/// Return number of resources queued or being loaded.
+	size_t NumQueuedResources() const;
+
+private:
+	/// Priority queue entry.
+	struct QueueEntry
+	{
+		/// Load priority.
+		int priority;
+		/// Queue order among equal priorities.
+		unsigned long long sequence;
+		/// Resource key.
+		ResourceKey key;
+
+		/// Compare for the priority queue: higher priority first, then first queued first.
+		bool operator < (const QueueEntry& rhs) const { return priority != rhs.priority ? priority < rhs.priority : sequence > rhs.sequence; }
+	};
+
+	/// Worker thread function.
+	void WorkerLoop();
+	/// Run BeginLoad of an item and mark it loaded. The item must be in the loading state. Called with the queue lock held, which is released during loading.
+	void LoadItem(std::unique_lock<std::mutex>& lock, const ResourceKey& key);
+	/// Run EndLoad of a loaded item without pending dependencies and store it to the cache. Main thread only.
+	void FinishItem(const ResourceKey& key);
+	/// Record that the caller waits for a resource. Called with the queue lock held.
+	void AddDependency(Resource* caller, const ResourceKey& key);
+	/// Return whether one queued resource already waits for another, directly or through other resources. Called with the queue lock held.
+	bool DependsOn(const ResourceKey& from, const ResourceKey& to) const;
+
+	/// Resource cache.
+	ResourceCache* owner;
+	/// Worker threads.
+	std::vector<std::thread> threads;
+	/// Queued and loading resources.
+	std::map<ResourceKey, BackgroundLoadItem> items;
+	/// Resources waiting for a worker.
+	std::priority_queue<QueueEntry> queue;
+	/// Resources whose BeginLoad has finished.
+	std::vector<ResourceKey> loadedItems;
+	/// Guards the items and queues.
+	mutable std::mutex queueMutex;
+	/// Signals workers that resources were queued.
+	std::condition_variable queueCondition;
+	/// Signals the main thread that resources have been loaded.
+	std::condition_variable loadedCondition;
+	/// Next queue sequence number.
+	unsigned long long nextSequence;
+	/// Shutdown flag for the workers.
+	bool shutdown;
+};
\ No newline at end of file
@@ -3,12 +3,16 @@
 #include "Resource.h"
 #include "TempImage.h"
 #include "JSONFile.h"
-#include "Core/IO/File.h"
+#include "Core/IO/MemoryMappedStream.h"
 #include "Core/Utilities/StringUtilities.h"
 #include "Core/Logging/Log.h"
 #include "Core/IO/FileSystem.h"
+#include "Core/Debug/Profiler.h"
 
-ResourceCache::ResourceCache()
+ResourceCache::ResourceCache() :
+	searchPackagesFirst(true),
+	finishBackgroundResourcesMs(DEFAULT_FINISH_BACKGROUND_RESOURCES_MS),
+	mainThreadId(std::this_thread::get_id())
 {
 	RegisterSubsystem(this);
 	RegisterResourceLibrary();
@@ -16,6 +20,8 @@ ResourceCache::ResourceCache()
 
 ResourceCache::~ResourceCache()
 {
+	// Stop the workers before the resources they load are released
+	backgroundLoader.Reset();
 	UnloadAllResources(true);
 	RemoveSubsystem(this);
 }
@@ -46,6 +52,24 @@ bool ResourceCache::AddResourceDir(const std::string& pathName, bool addFirst)
 	return true;
 }
 
+bool ResourceCache::AddPackageFile(const std::string& fileName, bool addFirst)
+{
+	SharedPtr<PackageFile> package(new PackageFile());
+	if (!package->Open(fileName))
+		return false;
+
+	// Re-adding a package reopens it in the new position
+	RemovePackageFile(fileName);
+
+	if (addFirst)
+		packageFiles.insert(packageFiles.begin(), package);
+	else
+		packageFiles.push_back(package);
+
+	LogPrint("Added resource package " + fileName + " with " + std::to_string(package->NumEntries()) + " files");
+	return true;
+}
+
 bool ResourceCache::AddManualResource(Resource* resource)
 {
 	if (!resource)
@@ -60,7 +84,7 @@ bool ResourceCache::AddManualResource(Resource* resource)
 		return false;
 	}
 
-	resources[std::make_pair(resource->Type(), StringHash(resource->Name()))] = resource;
+	StoreResource(std::make_pair(resource->Type(), StringHash(resource->Name())), resource);
 	return true;
 }
 
@@ -80,36 +104,47 @@ void ResourceCache::RemoveResourceDir(const std::string& pathName)
 	}
 }
 
+void ResourceCache::RemovePackageFile(const std::string& fileName)
+{
+	for (size_t i = 0; i < packageFiles.size(); ++i)
+	{
+		if (packageFiles[i]->Name() == fileName)
+		{
+			// Streams already opened from the package keep its mapping alive
+			packageFiles.erase(packageFiles.begin() + i);
+			LogPrint("Removed resource package " + fileName);
+			return;
+		}
+	}
+}
+
 void ResourceCache::UnloadResource(StringHash type, const std::string& name, bool force)
 {
 	auto key = std::make_pair(type, StringHash(name));
-	auto it = resources.find(key);
-	if (it == resources.end())
+	Resource* resource = resources.Find(key);
+	if (!resource)
 		return;
 
-	Resource* resource = it->second;
 	if (resource->Refs() == 1 || force)
-		resources.erase(key);
+		EraseResource(key);
 }
 
 void ResourceCache::UnloadResources(StringHash type, bool force)
 {
 	// In case resources refer to other resources, repeat until there are no further unloads
+	std::vector<ResourceKey> unloadKeys;
 	for (;;)
 	{
 		size_t unloaded = 0;
 
-		for (auto it = resources.begin(); it != resources.end();)
+		resources.KeysByType(unloadKeys, type);
+		for (size_t i = 0; i < unloadKeys.size(); ++i)
 		{
-			auto current = it++;
-			if (current->first.first == type)
+			Resource* resource = resources.Find(unloadKeys[i]);
+			if (resource && (resource->Refs() == 1 || force))
 			{
-				Resource* resource = current->second;
-				if (resource->Refs() == 1 || force)
-				{
-					resources.erase(current);
-					++unloaded;
-				}
+				EraseResource(unloadKeys[i]);
+				++unloaded;
 			}
 		}
 
@@ -121,21 +156,19 @@ void ResourceCache::UnloadResources(StringHash type, bool force)
 void ResourceCache::UnloadResources(StringHash type, const std::string& partialName, bool force)
 {
 	// In case resources refer to other resources, repeat until there are no further unloads
+	std::vector<ResourceKey> unloadKeys;
 	for (;;)
 	{
 		size_t unloaded = 0;
 
-		for (auto it = resources.begin(); it != resources.end();)
+		resources.KeysByType(unloadKeys, type);
+		for (size_t i = 0; i < unloadKeys.size(); ++i)
 		{
-			auto current = it++;
-			if (current->first.first == type)
+			Resource* resource = resources.Find(unloadKeys[i]);
+			if (resource && StringUtils::StartsWith(resource->Name(), partialName) && (resource->Refs() == 1 || force))
 			{
-				Resource* resource = current->second;
-				if (StringUtils::StartsWith(resource->Name(), partialName) && (resource->Refs() == 1 || force))
-				{
-					resources.erase(current);
-					++unloaded;
-				}
+				EraseResource(unloadKeys[i]);
+				++unloaded;
 			}
 		}
 
@@ -147,17 +180,18 @@ void ResourceCache::UnloadResources(StringHash type, const std::string& partialN
 void ResourceCache::UnloadResources(const std::string& partialName, bool force)
 {
 	// In case resources refer to other resources, repeat until there are no further unloads
+	std::vector<ResourceKey> unloadKeys;
 	for (;;)
 	{
 		size_t unloaded = 0;
 
-		for (auto it = resources.begin(); it != resources.end();)
+		resources.Keys(unloadKeys);
+		for (size_t i = 0; i < unloadKeys.size(); ++i)
 		{
-			auto current = it++;
-			Resource* resource = current->second;
-			if (StringUtils::StartsWith(resource->Name(), partialName) && (resource->Refs() == 1 || force))
+			Resource* resource = resources.Find(unloadKeys[i]);
+			if (resource && StringUtils::StartsWith(resource->Name(), partialName) && (resource->Refs() == 1 || force))
 			{
-				resources.erase(current);
+				EraseResource(unloadKeys[i]);
 				++unloaded;
 			}
 		}
@@ -170,17 +204,18 @@ void ResourceCache::UnloadResources(const std::string& partialName, bool force)
 void ResourceCache::UnloadAllResources(bool force)
 {
 	// In case resources refer to other resources, repeat until there are no further unloads
+	std::vector<ResourceKey> unloadKeys;
 	for (;;)
 	{
 		size_t unloaded = 0;
 
-		for (auto it = resources.begin(); it != resources.end();)
+		resources.Keys(unloadKeys);
+		for (size_t i = 0; i < unloadKeys.size(); ++i)
 		{
-			auto current = it++;
-			Resource* resource = current->second;
-			if (resource->Refs() == 1 || force)
+			Resource* resource = resources.Find(unloadKeys[i]);
+			if (resource && (resource->Refs() == 1 || force))
 			{
-				resources.erase(current);
+				EraseResource(unloadKeys[i]);
 				++unloaded;
 			}
 		}
@@ -204,20 +239,22 @@ AutoPtr<Stream> ResourceCache::OpenResource(const std::string& nameIn)
 	std::string name = SanitateResourceName(nameIn);
 	AutoPtr<Stream> ret;
 
-	for (size_t i = 0; i < resourceDirs.size(); ++i)
+	if (searchPackagesFirst)
 	{
-		if (FileSystem::Exists(resourceDirs[i] + name))
-		{
-			// Construct the file first with full path, then rename it to not contain the resource path,
-			// so that the file's name can be used in further OpenResource() calls (for example over the network)
-			ret = new File(resourceDirs[i] + name);
-			break;
-		}
+		ret = OpenPackageResource(name);
+		if (!ret)
+			ret = OpenLooseResource(name);
+	}
+	else
+	{
+		ret = OpenLooseResource(name);
+		if (!ret)
+			ret = OpenPackageResource(name);
 	}
 
 	// Fallback using absolute path
 	if (!ret)
-		ret = new File(name);
+		ret = new MemoryMappedStream(name);
 
 	if (!ret->IsReadable())
 	{
@@ -238,9 +275,12 @@ Resource* ResourceCache::LoadResource(StringHash type, const std::string& nameIn
 
 	// Check for existing resource
 	auto key = std::make_pair(type, StringHash(name));
-	auto it = resources.find(key);
-	if (it != resources.end())
-		return it->second;
+	if (Resource* existing = resources.Find(key))
+		return existing;
+
+	// If being loaded in the background, finish it now instead of loading a second copy
+	if (backgroundLoader && backgroundLoader->IsQueued(key))
+		return WaitForResource(type, name);
 
 	SharedPtr<Object> newObject = Create(type);
 	if (!newObject)
@@ -264,25 +304,121 @@ Resource* ResourceCache::LoadResource(StringHash type, const std::string& nameIn
 	newResource->SetName(name);
 	newResource->Load(*stream);
 	// Store to cache
-	resources[key] = newResource;
+	StoreResource(key, newResource);
 	return newResource;
 }
 
-void ResourceCache::ResourcesByType(std::vector<Resource*>& result, StringHash type) const
+bool ResourceCache::BackgroundLoadResource(StringHash type, const std::string& name, int priority, Resource* caller)
 {
-	result.clear();
+	if (!backgroundLoader)
+	{
+		// Workers are started on first use, which must happen on the main thread
+		assert(std::this_thread::get_id() == mainThreadId);
+		const unsigned numThreads = std::clamp(std::thread::hardware_concurrency() / 2, 1u, MAX_BACKGROUND_LOAD_THREADS);
+		backgroundLoader = new BackgroundLoader(this, numThreads);
+	}
+
+	return backgroundLoader->QueueResource(type, name, priority, caller);
+}
 
-	for (auto it = resources.begin(); it != resources.end(); ++it)
+void ResourceCache::UpdateBackgroundLoading()
+{
+	PROFILE_SCOPE("ResourceCache::UpdateBackgroundLoading");
+	if (backgroundLoader)
 	{
-		if (it->second->Type() == type)
-			result.push_back(it->second);
+		backgroundLoader->FinishResources(finishBackgroundResourcesMs);
+		resources.PublishSnapshot();
 	}
 }
 
+Resource* ResourceCache::WaitForResource(StringHash type, const std::string& nameIn)
+{
+	assert(std::this_thread::get_id() == mainThreadId);
+
+	std::string name = SanitateResourceName(nameIn);
+	if (name.empty())
+		return nullptr;
+
+	auto key = std::make_pair(type, StringHash(name));
+	const bool queued = backgroundLoader && backgroundLoader->IsQueued(key);
+	if (queued)
+		backgroundLoader->WaitForResource(key);
+
+	if (Resource* existing = resources.Find(key))
+		return existing;
+
+	// If not queued in the background, load synchronously. A failed background load is not retried
+	return queued ? nullptr : LoadResource(type, name);
+}
+
+bool ResourceCache::IsLoaded(const ResourceKey& key) const
+{
+	// Most queries from the loader threads are for resources loaded frames ago, answer those without locking. Removals discard the snapshot, so a hit is never an unloaded resource
+	if (resources.SnapshotContains(key))
+		return true;
+
+	std::lock_guard<std::mutex> lock(resourceMutex);
+	return resources.Find(key) != nullptr;
+}
+
+void ResourceCache::StoreResource(const ResourceKey& key, Resource* resource)
+{
+	std::lock_guard<std::mutex> lock(resourceMutex);
+	resources.Insert(key, resource);
+}
+
+void ResourceCache::EraseResource(const ResourceKey& key)
+{
+	SharedPtr<Resource> removed;
+	{
+		std::lock_guard<std::mutex> lock(resourceMutex);
+		removed = resources.Erase(key);
+	}
+	// The resource is destroyed here, outside the lock: its destructor may unload other resources
+}
+
+AutoPtr<Stream> ResourceCache::OpenPackageResource(const std::string& name) const
+{
+	for (size_t i = 0; i < packageFiles.size(); ++i)
+	{
+		if (packageFiles[i]->Exists(name))
+			return packageFiles[i]->OpenEntry(name);
+	}
+
+	return AutoPtr<Stream>();
+}
+
+AutoPtr<Stream> ResourceCache::OpenLooseResource(const std::string& name) const
+{
+	for (size_t i = 0; i < resourceDirs.size(); ++i)
+	{
+		if (FileSystem::Exists(resourceDirs[i] + name))
+		{
+			// Construct the file first with full path, then rename it to not contain the resource path,
+			// so that the file's name can be used in further OpenResource() calls (for example over the network)
+			// Loose files are mapped so that resources read them without going through stdio buffering
+			return AutoPtr<Stream>(new MemoryMappedStream(resourceDirs[i] + name));
+		}
+	}
+
+	return AutoPtr<Stream>();
+}
+
+void ResourceCache::ResourcesByType(std::vector<Resource*>& result, StringHash type) const
+{
+	resources.ResourcesByType(result, type);
+}
+
 bool ResourceCache::Exists(const std::string& nameIn) const
 {
 	std::string name = SanitateResourceName(nameIn);
 
+	for (size_t i = 0; i < packageFiles.size(); ++i)
+	{
+		if (packageFiles[i]->Exists(name))
+			return true;
+	}
+
 	for (size_t i = 0; i < resourceDirs.size(); ++i)
 	{
 		if (FileSystem::Exists(resourceDirs[i] + name))
@@ -297,12 +433,27 @@ unsigned ResourceCache::LastModifiedTime(const std::string& nameIn) const
 {
 	std::string name = SanitateResourceName(nameIn);
 
+	if (searchPackagesFirst)
+	{
+		for (size_t i = 0; i < packageFiles.size(); ++i)
+		{
+			if (packageFiles[i]->Exists(name))
+				return FileSystem::LastModifiedTime(packageFiles[i]->Name());
+		}
+	}
+
 	for (size_t i = 0; i < resourceDirs.size(); ++i)
 	{
 		if (FileSystem::Exists(resourceDirs[i] + name))
 			return FileSystem::LastModifiedTime(resourceDirs[i] + name);
 	}
 
+	for (size_t i = 0; i < packageFiles.size(); ++i)
+	{
+		if (packageFiles[i]->Exists(name))
+			return FileSystem::LastModifiedTime(packageFiles[i]->Name());
+	}
+
 	// Fallback using absolute path
 	return FileSystem::LastModifiedTime(name);
 }
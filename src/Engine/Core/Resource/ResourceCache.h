@@ -1,16 +1,24 @@
 #pragma once
 
 #include "Core/Object/Object.h"
+#include "Core/Object/AutoPtr.h"
+#include "Core/IO/PackageFile.h"
+#include "BackgroundLoader.h"
+#include "ResourceMap.h"
 
 class Resource;
 class Stream;
 
-typedef std::map<std::pair<StringHash, StringHash>, SharedPtr<Resource> > ResourceMap;
+/// Default time per frame spent finishing background loaded resources.
+static const float DEFAULT_FINISH_BACKGROUND_RESOURCES_MS = 5.0f;
+/// Maximum number of background loader threads.
+static const unsigned MAX_BACKGROUND_LOAD_THREADS = 4;
 
 /// %Resource cache subsystem. Loads resources on demand and stores them for later access.
 class ResourceCache : public Object
 {
 	OBJECT(ResourceCache);
+	friend class BackgroundLoader;
 
 public:
 	/// Construct and register subsystem and object types.
@@ -20,11 +28,17 @@ public:
 
 	/// Add a resource directory. Return true on success.
 	bool AddResourceDir(const std::string& pathName, bool addFirst = false);
+	/// Add a package file. Return true on success.
+	bool AddPackageFile(const std::string& fileName, bool addFirst = false);
 	/// Add a manually created resource. If returns success, the resource cache takes ownership of it.
 	bool AddManualResource(Resource* resource);
 	/// Remove a resource directory.
 	void RemoveResourceDir(const std::string& pathName);
-	/// Open a resource file stream from the resource directories. Return a pointer to the stream, or null if not found.
+	/// Remove a package file.
+	void RemovePackageFile(const std::string& fileName);
+	/// Set whether package files are searched before the resource directories. Default true, which avoids file system calls for packaged resources; set false to let loose files override packaged ones.
+	void SetSearchPackagesFirst(bool enable) { searchPackagesFirst = enable; }
+	/// Open a resource file stream from the package files or resource directories. Return a pointer to the stream, or null if not found.
 	AutoPtr<Stream> OpenResource(const std::string& name);
 	/// Load and return a resource.
 	Resource* LoadResource(StringHash type, const std::string& name);
@@ -44,16 +58,36 @@ public:
 	template <class T> T* LoadResource(const std::string& name) { return static_cast<T*>(LoadResource(T::TypeStatic(), name)); }
 	/// Load and return a resource, template version.
 	template <class T> T* LoadResource(const char* name) { return static_cast<T*>(LoadResource(T::TypeStatic(), name)); }
+	/// Queue a resource to be loaded on a worker thread. EndLoad is called later on the main thread from UpdateBackgroundLoading(). Return true if queued now or earlier, false if already loaded or failed. Thread-safe; when called from a resource's BeginLoad with the resource as caller, the caller does not finish before the queued resource.
+	bool BackgroundLoadResource(StringHash type, const std::string& name, int priority = 0, Resource* caller = nullptr);
+	/// Queue a resource to be loaded on a worker thread, template version.
+	template <class T> bool BackgroundLoadResource(const std::string& name, int priority = 0, Resource* caller = nullptr) { return BackgroundLoadResource(T::TypeStatic(), name, priority, caller); }
+	/// Finish background loaded resources within the time budget. Called by EngineDevice once per frame.
+	void UpdateBackgroundLoading();
+	/// Wait for a background loaded resource and its dependencies to finish and return it, or null if failed. If not queued, load it synchronously.
+	Resource* WaitForResource(StringHash type, const std::string& name);
+	/// Wait for a background loaded resource, template version.
+	template <class T> T* WaitForResource(const std::string& name) { return static_cast<T*>(WaitForResource(T::TypeStatic(), name)); }
+	/// Set time per frame spent finishing background loaded resources.
+	void SetFinishBackgroundResourcesMs(float ms) { finishBackgroundResourcesMs = std::max(ms, 0.0f); }
 
 	/// Return resources by type.
 	void ResourcesByType(std::vector<Resource*>& result, StringHash type) const;
 	/// Return resource directories.
 	const std::vector<std::string>& ResourceDirs() const { return resourceDirs; }
-	/// Return whether a file exists in the resource directories.
+	/// Return package files.
+	const std::vector<SharedPtr<PackageFile> >& PackageFiles() const { return packageFiles; }
+	/// Return whether package files are searched before the resource directories.
+	bool SearchPackagesFirst() const { return searchPackagesFirst; }
+	/// Return number of resources queued or being loaded in the background.
+	size_t NumBackgroundLoadResources() const { return backgroundLoader ? backgroundLoader->NumQueuedResources() : 0; }
+	/// Return time per frame spent finishing background loaded resources.
+	float FinishBackgroundResourcesMs() const { return finishBackgroundResourcesMs; }
+	/// Return whether a file exists in the package files or resource directories.
 	bool Exists(const std::string& name) const;
-	/// Return last modified time of a file from the resource directories, or 0 if doesn't exist.
+	/// Return last modified time of a file from the package files or resource directories, or 0 if doesn't exist. For packaged files this is the time of the package.
 	unsigned LastModifiedTime(const std::string& name) const;
-	/// Return an absolute filename from a resource name.
+	/// Return an absolute filename from a resource name. Empty for packaged files.
 	std::string ResourceFileName(const std::string& name) const;
 
 	/// Return resources by type, template version.
@@ -77,8 +111,32 @@ public:
 	std::string SanitateResourceDirName(const std::string& name) const;
 
 private:
+	/// Return whether a resource is in the cache. Thread-safe.
+	bool IsLoaded(const ResourceKey& key) const;
+	/// Store a finished resource to the cache. Main thread only.
+	void StoreResource(const ResourceKey& key, Resource* resource);
+	/// Remove a resource from the cache and release it after unlocking. Main thread only.
+	void EraseResource(const ResourceKey& key);
+	/// Open a resource from the package files. Return null if not found.
+	AutoPtr<Stream> OpenPackageResource(const std::string& name) const;
+	/// Open a resource from the resource directories. Return null if not found.
+	AutoPtr<Stream> OpenLooseResource(const std::string& name) const;
+
+	/// Resources. Modified only from the main thread under resourceMutex, so that other threads can read under the same lock or from the published snapshot.
 	ResourceMap resources;
 	std::vector<std::string> resourceDirs;
+	/// Package files.
+	std::vector<SharedPtr<PackageFile> > packageFiles;
+	/// Whether package files are searched before the resource directories.
+	bool searchPackagesFirst;
+	/// Guards modifications of the resources.
+	mutable std::mutex resourceMutex;
+	/// Background loader, created on first use.
+	AutoPtr<BackgroundLoader> backgroundLoader;
+	/// Time per frame spent finishing background loaded resources.
+	float finishBackgroundResourcesMs;
+	/// Thread that created the cache.
+	std::thread::id mainThreadId;
 };
 
 /// Register Resource related object factories and attributes.
@@ -0,0 +1,273 @@
+#include "stdafx.h"
+#include "ResourceMap.h"
+#include "Resource.h"
+
+/// Initial number of hash table slots.
+static const size_t MIN_RESOURCE_MAP_CAPACITY = 64;
+
+static unsigned long long PackResourceKey(const ResourceKey& key)
+{
+	return ((unsigned long long)key.first.Value() << 32) | key.second.Value();
+}
+
+static unsigned HashResourceKey(const ResourceKey& key)
+{
+	// String hashes of similar names differ mostly in the low bits, mix so that the slot index depends on all bits
+	unsigned hash = key.first.Value() * 0x9e3779b1u ^ key.second.Value();
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6bu;
+	hash ^= hash >> 13;
+	return hash;
+}
+
+ResourceKeySnapshot::ResourceKeySnapshot(size_t numKeys)
+{
+	// Keep at most half full so that probe sequences stay short
+	size_t capacity = MIN_RESOURCE_MAP_CAPACITY;
+	while (capacity < numKeys * 2)
+		capacity *= 2;
+
+	keys.resize(capacity);
+	mask = capacity - 1;
+}
+
+void ResourceKeySnapshot::Insert(const ResourceKey& key)
+{
+	const unsigned long long packed = PackResourceKey(key);
+	size_t index = HashResourceKey(key) & mask;
+	while (keys[index] && keys[index] != packed)
+		index = (index + 1) & mask;
+	keys[index] = packed;
+}
+
+bool ResourceKeySnapshot::Contains(const ResourceKey& key) const
+{
+	const unsigned long long packed = PackResourceKey(key);
+	for (size_t index = HashResourceKey(key) & mask; keys[index]; index = (index + 1) & mask)
+	{
+		if (keys[index] == packed)
+			return true;
+	}
+
+	return false;
+}
+
+ResourceMap::ResourceMap() :
+	count(0),
+	snapshotDirty(false)
+{
+	slots.resize(MIN_RESOURCE_MAP_CAPACITY);
+}
+
+ResourceMap::~ResourceMap()
+{
+	Clear();
+}
+
+Resource* ResourceMap::Find(const ResourceKey& key) const
+{
+	const Slot& slot = slots[FindSlot(key, HashResourceKey(key))];
+	return slot.resource;
+}
+
+void ResourceMap::Insert(const ResourceKey& key, Resource* resource)
+{
+	if (!resource)
+	{
+		Erase(key);
+		return;
+	}
+
+	const unsigned hash = HashResourceKey(key);
+	size_t index = FindSlot(key, hash);
+	Slot& existing = slots[index];
+
+	if (existing.resource)
+	{
+		// Replace in place, the key and its type index position stay the same
+		TypeIndex& typeIndex = types[key.first];
+		typeIndex.resources[existing.typePosition] = resource;
+		existing.resource = resource;
+		return;
+	}
+
+	// Grow at 75% load
+	if ((count + 1) * 4 > slots.size() * 3)
+	{
+		Rehash(slots.size() * 2);
+		index = FindSlot(key, hash);
+	}
+
+	TypeIndex& typeIndex = types[key.first];
+	Slot& slot = slots[index];
+	slot.key = key;
+	slot.hash = hash;
+	slot.typePosition = (unsigned)typeIndex.resources.size();
+	slot.resource = resource;
+	typeIndex.names.push_back(key.second);
+	typeIndex.resources.push_back(resource);
+
+	++count;
+	snapshotDirty = true;
+}
+
+SharedPtr<Resource> ResourceMap::Erase(const ResourceKey& key)
+{
+	const size_t index = FindSlot(key, HashResourceKey(key));
+	if (!slots[index].resource)
+		return SharedPtr<Resource>();
+
+	return EraseSlot(index);
+}
+
+void ResourceMap::Clear()
+{
+	// Release the resources only after the map is consistent again, in case their destruction releases other resources
+	std::vector<Slot> oldSlots;
+	oldSlots.swap(slots);
+	slots.resize(MIN_RESOURCE_MAP_CAPACITY);
+	types.clear();
+	count = 0;
+	InvalidateSnapshot();
+}
+
+void ResourceMap::Keys(std::vector<ResourceKey>& result) const
+{
+	result.clear();
+	result.reserve(count);
+
+	for (auto it = types.begin(); it != types.end(); ++it)
+	{
+		const std::vector<StringHash>& names = it->second.names;
+		for (size_t i = 0; i < names.size(); ++i)
+			result.push_back(std::make_pair(it->first, names[i]));
+	}
+}
+
+void ResourceMap::KeysByType(std::vector<ResourceKey>& result, StringHash type) const
+{
+	result.clear();
+
+	auto it = types.find(type);
+	if (it == types.end())
+		return;
+
+	const std::vector<StringHash>& names = it->second.names;
+	result.reserve(names.size());
+	for (size_t i = 0; i < names.size(); ++i)
+		result.push_back(std::make_pair(type, names[i]));
+}
+
+void ResourceMap::ResourcesByType(std::vector<Resource*>& result, StringHash type) const
+{
+	auto it = types.find(type);
+	if (it != types.end())
+		result = it->second.resources;
+	else
+		result.clear();
+}
+
+void ResourceMap::PublishSnapshot()
+{
+	if (!snapshotDirty)
+		return;
+
+	std::shared_ptr<ResourceKeySnapshot> newSnapshot = std::make_shared<ResourceKeySnapshot>(count);
+	for (auto it = types.begin(); it != types.end(); ++it)
+	{
+		const std::vector<StringHash>& names = it->second.names;
+		for (size_t i = 0; i < names.size(); ++i)
+			newSnapshot->Insert(std::make_pair(it->first, names[i]));
+	}
+
+	snapshot.store(std::move(newSnapshot), std::memory_order_release);
+	snapshotDirty = false;
+}
+
+bool ResourceMap::SnapshotContains(const ResourceKey& key) const
+{
+	std::shared_ptr<const ResourceKeySnapshot> current = snapshot.load(std::memory_order_acquire);
+	return current && current->Contains(key);
+}
+
+size_t ResourceMap::FindSlot(const ResourceKey& key, unsigned hash) const
+{
+	const size_t mask = slots.size() - 1;
+	size_t index = hash & mask;
+
+	while (slots[index].resource && (slots[index].hash != hash || slots[index].key != key))
+		index = (index + 1) & mask;
+
+	return index;
+}
+
+void ResourceMap::Rehash(size_t newCapacity)
+{
+	std::vector<Slot> oldSlots(newCapacity);
+	oldSlots.swap(slots);
+
+	const size_t mask = newCapacity - 1;
+	for (size_t i = 0; i < oldSlots.size(); ++i)
+	{
+		Slot& oldSlot = oldSlots[i];
+		if (!oldSlot.resource)
+			continue;
+
+		size_t index = oldSlot.hash & mask;
+		while (slots[index].resource)
+			index = (index + 1) & mask;
+		slots[index] = std::move(oldSlot);
+	}
+}
+
+SharedPtr<Resource> ResourceMap::EraseSlot(size_t index)
+{
+	const size_t mask = slots.size() - 1;
+	// Hand the resource to the caller, in case its destruction releases other resources or must happen outside a lock
+	SharedPtr<Resource> resource = slots[index].resource;
+	const ResourceKey key = slots[index].key;
+	const unsigned typePosition = slots[index].typePosition;
+
+	// Remove from the type index by moving the last resource of the type to the freed position
+	auto typeIt = types.find(key.first);
+	TypeIndex& typeIndex = typeIt->second;
+	if (typePosition + 1 < typeIndex.resources.size())
+	{
+		const StringHash movedName = typeIndex.names.back();
+		typeIndex.names[typePosition] = movedName;
+		typeIndex.resources[typePosition] = typeIndex.resources.back();
+		const ResourceKey movedKey(key.first, movedName);
+		slots[FindSlot(movedKey, HashResourceKey(movedKey))].typePosition = typePosition;
+	}
+	typeIndex.names.pop_back();
+	typeIndex.resources.pop_back();
+	if (typeIndex.resources.empty())
+		types.erase(typeIt);
+
+	// Backward shift deletion: move following entries of the probe sequence into the gap, so that no tombstones are needed
+	size_t gap = index;
+	size_t next = (gap + 1) & mask;
+	while (slots[next].resource)
+	{
+		const size_t home = slots[next].hash & mask;
+		// The entry can move to the gap if its home slot is not cyclically between the gap and its current slot
+		if (((next - home) & mask) >= ((next - gap) & mask))
+		{
+			slots[gap] = std::move(slots[next]);
+			gap = next;
+		}
+		next = (next + 1) & mask;
+	}
+	slots[gap] = Slot();
+
+	--count;
+	InvalidateSnapshot();
+	return resource;
+}
+
+void ResourceMap::InvalidateSnapshot()
+{
+	// A removed key must not be reported by the old snapshot, e.g. to a loader thread deciding whether to queue the resource again
+	snapshot.store(std::shared_ptr<const ResourceKeySnapshot>(), std::memory_order_release);
+	snapshotDirty = true;
+}
\ No newline at end of file
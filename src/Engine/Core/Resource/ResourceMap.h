@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Core/IO/StringHash.h"
+#include "Core/Object/Ptr.h"
+#include <map>
+
+class Resource;
+
+/// Resource cache key: type and name hash.
+typedef std::pair<StringHash, StringHash> ResourceKey;
+
+/// Immutable set of resource keys, read by other threads without locking.
+class ResourceKeySnapshot
+{
+public:
+	/// Construct with capacity for the given number of keys.
+	explicit ResourceKeySnapshot(size_t numKeys);
+
+	/// Add a key. Only used while building the snapshot.
+	void Insert(const ResourceKey& key);
+	/// Return whether the key was in the cache when the snapshot was taken.
+	bool Contains(const ResourceKey& key) const;
+
+private:
+	/// Keys packed as type hash in the high and name hash in the low bits. Zero marks an empty slot.
+	std::vector<unsigned long long> keys;
+	/// Slot index mask.
+	size_t mask;
+};
+
+/// Open addressing hash table of resources with a secondary index by type. Modified from the main thread only.
+class ResourceMap
+{
+public:
+	/// Construct empty.
+	ResourceMap();
+	/// Destruct.
+	~ResourceMap();
+
+	/// Return a resource by key, or null if not found.
+	Resource* Find(const ResourceKey& key) const;
+	/// Insert a resource, replacing any resource with the same key.
+	void Insert(const ResourceKey& key, Resource* resource);
+	/// Remove a resource. Return it, or null if not found, so that the caller can release it outside any lock.
+	SharedPtr<Resource> Erase(const ResourceKey& key);
+	/// Remove all resources.
+	void Clear();
+
+	/// Return the keys of all resources.
+	void Keys(std::vector<ResourceKey>& result) const;
+	/// Return the keys of resources of a type.
+	void KeysByType(std::vector<ResourceKey>& result, StringHash type) const;
+	/// Return resources of a type.
+	void ResourcesByType(std::vector<Resource*>& result, StringHash type) const;
+	/// Return number of resources.
+	size_t Size() const { return count; }
+
+	/// Publish a snapshot of the current keys for other threads, if the map has changed since the last one. Main thread only.
+	void PublishSnapshot();
+	/// Return whether a key was in the map when the latest snapshot was published. Thread-safe and lock-free. Resources added after the snapshot are not seen. Removals discard the snapshot, so a true result is never stale.
+	bool SnapshotContains(const ResourceKey& key) const;
+
+private:
+	/// Hash table slot. Empty when the resource is null.
+	struct Slot
+	{
+		/// Resource key.
+		ResourceKey key;
+		/// Cached hash of the key.
+		unsigned hash = 0;
+		/// Position in the type index.
+		unsigned typePosition = 0;
+		/// Resource.
+		SharedPtr<Resource> resource;
+	};
+
+	/// Resources of one type, in insertion order except for removals.
+	struct TypeIndex
+	{
+		/// Resource name hashes.
+		std::vector<StringHash> names;
+		/// Resources.
+		std::vector<Resource*> resources;
+	};
+
+	/// Return the slot index of a key, or the empty slot where it would be inserted.
+	size_t FindSlot(const ResourceKey& key, unsigned hash) const;
+	/// Resize the slot array and rehash.
+	void Rehash(size_t newCapacity);
+	/// Remove the resource at a slot and close the gap. Return the removed resource.
+	SharedPtr<Resource> EraseSlot(size_t index);
+	/// Discard the published snapshot after a removal, until the next PublishSnapshot().
+	void InvalidateSnapshot();
+
+	/// Hash table slots. Capacity is a power of two.
+	std::vector<Slot> slots;
+	/// Secondary index by type.
+	std::map<StringHash, TypeIndex> types;
+	/// Number of resources.
+	size_t count;
+	/// Whether changed since the last snapshot.
+	bool snapshotDirty;
+	/// Latest published snapshot.
+	std::atomic<std::shared_ptr<const ResourceKeySnapshot> > snapshot;
+};
\ No newline at end of file
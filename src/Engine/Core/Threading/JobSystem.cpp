@@ -0,0 +1,374 @@
+#include "stdafx.h"
+#include "JobSystem.h"
+#include "Core/Object/PoolAllocator.h"
+#include "Core/Logging/Log.h"
+//-----------------------------------------------------------------------------
+JobSystem gJobSystem;
+//-----------------------------------------------------------------------------
+// Number of ParallelFor batches per thread, so that threads that finish early can steal the rest
+static const size_t PARALLEL_FOR_BATCHES_PER_THREAD = 4;
+static const unsigned INVALID_THREAD_INDEX = ~0u;
+//-----------------------------------------------------------------------------
+struct Job
+{
+	JobFunction function;
+	// Counter decremented when the job finishes
+	JobCounter* counter = nullptr;
+	bool mainThread = false;
+};
+//-----------------------------------------------------------------------------
+static PoolAllocator<Job> jobAllocator;
+static thread_local unsigned threadIndex = INVALID_THREAD_INDEX;
+//-----------------------------------------------------------------------------
+JobCounter::~JobCounter()
+{
+	// Destroying a counter with unfinished jobs leaves them pointing to freed memory
+	assert(IsDone());
+}
+//-----------------------------------------------------------------------------
+JobQueue::JobQueue(unsigned capacity)
+{
+	unsigned size = 2;
+	while (size < capacity)
+		size *= 2;
+
+	m_jobs.reset(new std::atomic<Job*>[size]);
+	m_mask = static_cast<int64_t>(size) - 1;
+}
+//-----------------------------------------------------------------------------
+bool JobQueue::Push(Job* job)
+{
+	const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+	const int64_t top = m_top.load(std::memory_order_acquire);
+	if (bottom - top > m_mask)
+		return false;
+
+	m_jobs[bottom & m_mask].store(job, std::memory_order_relaxed);
+	// Publish the job to thieves
+	m_bottom.store(bottom + 1, std::memory_order_release);
+	return true;
+}
+//-----------------------------------------------------------------------------
+Job* JobQueue::Pop()
+{
+	// Reserve the bottom job before looking at the top, so that a thief can not take it at the same time unnoticed
+	const int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+	m_bottom.store(bottom, std::memory_order_seq_cst);
+	int64_t top = m_top.load(std::memory_order_seq_cst);
+
+	if (top > bottom)
+	{
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	Job* job = m_jobs[bottom & m_mask].load(std::memory_order_relaxed);
+	if (top == bottom)
+	{
+		// Last job in the queue, race against the thieves for it
+		if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			job = nullptr;
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+	}
+	return job;
+}
+//-----------------------------------------------------------------------------
+Job* JobQueue::Steal()
+{
+	int64_t top = m_top.load(std::memory_order_seq_cst);
+	const int64_t bottom = m_bottom.load(std::memory_order_seq_cst);
+	if (top >= bottom)
+		return nullptr;
+
+	Job* job = m_jobs[top & m_mask].load(std::memory_order_relaxed);
+	// Lost to the owner or another thief
+	if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		return nullptr;
+	return job;
+}
+//-----------------------------------------------------------------------------
+JobSystem::~JobSystem()
+{
+	Destroy();
+}
+//-----------------------------------------------------------------------------
+bool JobSystem::Create(const JobSystemCreateInfo& createInfo)
+{
+	Destroy();
+
+	unsigned numThreads = createInfo.numThreads;
+	if (!numThreads)
+		numThreads = std::max(std::thread::hardware_concurrency(), 1u) - 1;
+#if PLATFORM_EMSCRIPTEN
+	// No threads without pthreads support, jobs run on the main thread while it waits
+	numThreads = 0;
+#endif
+
+	threadIndex = 0;
+	m_shutdown = false;
+	for (unsigned i = 0; i <= numThreads; ++i)
+		m_queues.push_back(std::make_unique<JobQueue>(createInfo.queueCapacity));
+	for (unsigned i = 1; i <= numThreads; ++i)
+		m_threads.emplace_back(&JobSystem::workerLoop, this, i);
+
+	LogPrint("JobSystem Create: " + std::to_string(numThreads) + " worker threads");
+	return true;
+}
+//-----------------------------------------------------------------------------
+void JobSystem::Destroy()
+{
+	if (m_queues.empty())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_shutdown = true;
+	}
+	m_sleepCondition.notify_all();
+	for (size_t i = 0; i < m_threads.size(); ++i)
+		m_threads[i].join();
+	m_threads.clear();
+
+	// Finish the remaining jobs so that no counter is left waiting
+	for (;;)
+	{
+		Job* job = popMainThreadJob();
+		if (!job)
+			job = findJob(0);
+		if (!job)
+			break;
+		execute(job);
+	}
+
+	m_queues.clear();
+}
+//-----------------------------------------------------------------------------
+void JobSystem::Run(JobFunction function, JobCounter* counter, JobCounter* dependency)
+{
+	schedule(createJob(std::move(function), counter, false), dependency);
+}
+//-----------------------------------------------------------------------------
+void JobSystem::RunOnMainThread(JobFunction function, JobCounter* counter, JobCounter* dependency)
+{
+	schedule(createJob(std::move(function), counter, true), dependency);
+}
+//-----------------------------------------------------------------------------
+void JobSystem::Wait(JobCounter& counter)
+{
+	const unsigned index = GetThreadIndex();
+
+	while (!counter.IsDone())
+	{
+		Job* job = index == 0 ? popMainThreadJob() : nullptr;
+		if (!job)
+			job = findJob(index);
+
+		if (job)
+			execute(job);
+		else
+			std::this_thread::yield();
+	}
+
+	// The thread that finished the last job may still hold the lock, wait for it before the counter can be destroyed
+	std::lock_guard<std::mutex> lock(counter.m_mutex);
+}
+//-----------------------------------------------------------------------------
+void JobSystem::ParallelFor(size_t count, size_t minBatchSize, const std::function<void(size_t, size_t)>& function)
+{
+	if (!count)
+		return;
+
+	minBatchSize = std::max(minBatchSize, (size_t)1);
+	const size_t maxBatches = std::max(GetNumThreads(), 1u) * PARALLEL_FOR_BATCHES_PER_THREAD;
+	const size_t numBatches = std::min((count + minBatchSize - 1) / minBatchSize, maxBatches);
+	if (numBatches <= 1)
+	{
+		function(0, count);
+		return;
+	}
+
+	const size_t batchSize = (count + numBatches - 1) / numBatches;
+	JobCounter counter;
+	for (size_t begin = batchSize; begin < count; begin += batchSize)
+	{
+		const size_t end = std::min(begin + batchSize, count);
+		Run([&function, begin, end]() { function(begin, end); }, &counter);
+	}
+
+	// The calling thread takes the first batch instead of idling
+	function(0, batchSize);
+	Wait(counter);
+}
+//-----------------------------------------------------------------------------
+void JobSystem::RunMainThreadJobs()
+{
+	assert(IsMainThread());
+
+	// Jobs queued while running these are left for the next call, so that a job requeueing itself can not stall the frame
+	std::deque<Job*> jobs;
+	{
+		std::lock_guard<std::mutex> lock(m_mainThreadMutex);
+		jobs.swap(m_mainThreadJobs);
+	}
+
+	for (size_t i = 0; i < jobs.size(); ++i)
+		execute(jobs[i]);
+}
+//-----------------------------------------------------------------------------
+unsigned JobSystem::GetThreadIndex() const
+{
+	return threadIndex < m_queues.size() ? threadIndex : GetNumThreads();
+}
+//-----------------------------------------------------------------------------
+Job* JobSystem::createJob(JobFunction&& function, JobCounter* counter, bool mainThread)
+{
+	Job* job = jobAllocator.Allocate();
+	job->function = std::move(function);
+	job->counter = counter;
+	job->mainThread = mainThread;
+
+	if (counter)
+		counter->m_value.fetch_add(1, std::memory_order_relaxed);
+	return job;
+}
+//-----------------------------------------------------------------------------
+void JobSystem::schedule(Job* job, JobCounter* dependency)
+{
+	if (dependency)
+	{
+		std::lock_guard<std::mutex> lock(dependency->m_mutex);
+		if (!dependency->IsDone())
+		{
+			dependency->m_waitingJobs.push_back(job);
+			return;
+		}
+	}
+
+	enqueue(job);
+}
+//-----------------------------------------------------------------------------
+void JobSystem::enqueue(Job* job)
+{
+	// Not created, run immediately
+	if (m_queues.empty())
+	{
+		execute(job);
+		return;
+	}
+
+	if (job->mainThread)
+	{
+		std::lock_guard<std::mutex> lock(m_mainThreadMutex);
+		m_mainThreadJobs.push_back(job);
+		return;
+	}
+
+	// Count before pushing, so that a worker going to sleep either sees the job or gets woken up
+	m_queuedJobs.fetch_add(1, std::memory_order_seq_cst);
+
+	const unsigned index = GetThreadIndex();
+	if (index >= m_queues.size() || !m_queues[index]->Push(job))
+	{
+		std::lock_guard<std::mutex> lock(m_overflowMutex);
+		m_overflowJobs.push_back(job);
+	}
+
+	wakeWorkers();
+}
+//-----------------------------------------------------------------------------
+Job* JobSystem::findJob(unsigned index)
+{
+	if (m_queuedJobs.load(std::memory_order_seq_cst) == 0)
+		return nullptr;
+
+	Job* job = index < m_queues.size() ? m_queues[index]->Pop() : nullptr;
+
+	if (!job)
+	{
+		std::lock_guard<std::mutex> lock(m_overflowMutex);
+		if (!m_overflowJobs.empty())
+		{
+			job = m_overflowJobs.front();
+			m_overflowJobs.pop_front();
+		}
+	}
+
+	// Steal starting from the next thread, so that thieves spread over the queues
+	const size_t numQueues = m_queues.size();
+	for (size_t i = 1; !job && i <= numQueues; ++i)
+	{
+		const size_t victim = (index + i) % numQueues;
+		if (victim != index)
+			job = m_queues[victim]->Steal();
+	}
+
+	if (job)
+		m_queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+	return job;
+}
+//-----------------------------------------------------------------------------
+Job* JobSystem::popMainThreadJob()
+{
+	std::lock_guard<std::mutex> lock(m_mainThreadMutex);
+	if (m_mainThreadJobs.empty())
+		return nullptr;
+
+	Job* job = m_mainThreadJobs.front();
+	m_mainThreadJobs.pop_front();
+	return job;
+}
+//-----------------------------------------------------------------------------
+void JobSystem::execute(Job* job)
+{
+	job->function();
+
+	if (JobCounter* counter = job->counter)
+	{
+		std::vector<Job*> releasedJobs;
+		{
+			// Decrement under the lock, so that no job can be added to the waiting list after it has been released
+			std::lock_guard<std::mutex> lock(counter->m_mutex);
+			if (counter->m_value.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				releasedJobs.swap(counter->m_waitingJobs);
+		}
+
+		for (size_t i = 0; i < releasedJobs.size(); ++i)
+			enqueue(releasedJobs[i]);
+	}
+
+	jobAllocator.Free(job);
+}
+//-----------------------------------------------------------------------------
+void JobSystem::wakeWorkers()
+{
+	if (m_sleepingWorkers.load(std::memory_order_seq_cst) > 0)
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_sleepCondition.notify_one();
+	}
+}
+//-----------------------------------------------------------------------------
+void JobSystem::workerLoop(unsigned index)
+{
+	threadIndex = index;
+
+	while (!m_shutdown.load(std::memory_order_relaxed))
+	{
+		if (Job* job = findJob(index))
+		{
+			execute(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_sleepingWorkers.fetch_add(1, std::memory_order_seq_cst);
+		m_sleepCondition.wait(lock, [this]() { return m_shutdown.load(std::memory_order_relaxed) || m_queuedJobs.load(std::memory_order_seq_cst) > 0; });
+		m_sleepingWorkers.fetch_sub(1, std::memory_order_relaxed);
+	}
+}
+//-----------------------------------------------------------------------------
+JobSystem& GetJobSystem()
+{
+	return gJobSystem;
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
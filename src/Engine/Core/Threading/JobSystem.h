@@ -0,0 +1,138 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Default capacity of the job queue of one thread.
+static const unsigned DEFAULT_JOB_QUEUE_CAPACITY = 4096;
+
+struct JobSystemCreateInfo final
+{
+	// Number of worker threads in addition to the main thread. Zero uses one per hardware thread, minus the main thread.
+	unsigned numThreads = 0;
+	// Capacity of the job queue of each thread, rounded up to a power of two. Jobs that do not fit are queued to a shared overflow queue.
+	unsigned queueCapacity = DEFAULT_JOB_QUEUE_CAPACITY;
+};
+
+typedef std::function<void()> JobFunction;
+
+struct Job;
+
+// Counts unfinished jobs. Incremented when a job is run with the counter, decremented when the job finishes. Used to wait for a group of jobs, or as the dependency of further jobs.
+class JobCounter final
+{
+	friend class JobSystem;
+public:
+	JobCounter() = default;
+	~JobCounter();
+
+	// Return whether all jobs of the counter have finished.
+	bool IsDone() const { return m_value.load(std::memory_order_acquire) == 0; }
+	// Return number of unfinished jobs.
+	unsigned GetValue() const { return m_value.load(std::memory_order_acquire); }
+
+private:
+	JobCounter(JobCounter&&) = delete;
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(JobCounter&&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+	std::atomic<unsigned> m_value = 0;
+	// Guards the decrement to zero and the waiting jobs.
+	std::mutex m_mutex;
+	// Jobs that start when the counter reaches zero.
+	std::vector<Job*> m_waitingJobs;
+};
+
+// Fixed-capacity work-stealing deque. The owning thread pushes and pops at the bottom, other threads steal from the top.
+class JobQueue final
+{
+public:
+	explicit JobQueue(unsigned capacity);
+
+	// Push a job. Owner thread only. Return false if the queue is full.
+	bool Push(Job* job);
+	// Pop the most recently pushed job. Owner thread only.
+	Job* Pop();
+	// Steal the oldest job. Any thread.
+	Job* Steal();
+
+private:
+	JobQueue(JobQueue&&) = delete;
+	JobQueue(const JobQueue&) = delete;
+	JobQueue& operator=(JobQueue&&) = delete;
+	JobQueue& operator=(const JobQueue&) = delete;
+
+	// Owner and thieves are kept on separate cache lines.
+	alignas(64) std::atomic<int64_t> m_top = 0;
+	alignas(64) std::atomic<int64_t> m_bottom = 0;
+	std::unique_ptr<std::atomic<Job*>[]> m_jobs;
+	int64_t m_mask;
+};
+
+// Runs jobs on a pool of worker threads. Each thread has its own queue and idle threads steal from the others. The main thread helps while waiting and runs the jobs that need the GL context.
+class JobSystem final
+{
+public:
+	JobSystem() = default;
+	~JobSystem();
+
+	bool Create(const JobSystemCreateInfo& createInfo);
+	void Destroy();
+
+	// Run a job on any thread. The counter is incremented now and decremented when the job finishes. If a dependency is given, the job starts only after the dependency counter reaches zero. Thread-safe.
+	void Run(JobFunction function, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+	// Run a job on the main thread, from Wait() or RunMainThreadJobs(). Use for work that needs the GL context. Thread-safe.
+	void RunOnMainThread(JobFunction function, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+	// Run other jobs until the counter reaches zero. On the main thread this also runs main thread jobs.
+	void Wait(JobCounter& counter);
+	// Split the index range [0, count) into batches of at least minBatchSize indices, run them in parallel and wait for all of them. The function is called with the begin and end index of a batch.
+	void ParallelFor(size_t count, size_t minBatchSize, const std::function<void(size_t, size_t)>& function);
+
+	// Run the queued main thread jobs. Called by EngineDevice in Update().
+	void RunMainThreadJobs();
+
+	// Return number of threads that run jobs, including the main thread.
+	unsigned GetNumThreads() const { return static_cast<unsigned>(m_queues.size()); }
+	// Return index of the calling thread: 0 for the main thread, 1 and up for worker threads. Other threads return GetNumThreads().
+	unsigned GetThreadIndex() const;
+	bool IsMainThread() const { return GetThreadIndex() == 0; }
+
+private:
+	JobSystem(JobSystem&&) = delete;
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(JobSystem&&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	Job* createJob(JobFunction&& function, JobCounter* counter, bool mainThread);
+	// Queue a job once its dependency has finished.
+	void schedule(Job* job, JobCounter* dependency);
+	// Queue a job that is ready to run.
+	void enqueue(Job* job);
+	// Take a job from the own queue, the overflow queue or another thread's queue.
+	Job* findJob(unsigned threadIndex);
+	Job* popMainThreadJob();
+	void execute(Job* job);
+	void wakeWorkers();
+	void workerLoop(unsigned threadIndex);
+
+	// Queues indexed by thread index. The main thread owns the first one.
+	std::vector<std::unique_ptr<JobQueue>> m_queues;
+	std::vector<std::thread> m_threads;
+	// Jobs queued from threads without a queue, or that did not fit a full queue.
+	std::deque<Job*> m_overflowJobs;
+	std::mutex m_overflowMutex;
+	std::deque<Job*> m_mainThreadJobs;
+	std::mutex m_mainThreadMutex;
+	// Number of jobs in all queues, for putting idle workers to sleep.
+	std::atomic<unsigned> m_queuedJobs = 0;
+	std::atomic<unsigned> m_sleepingWorkers = 0;
+	std::mutex m_sleepMutex;
+	std::condition_variable m_sleepCondition;
+	std::atomic<bool> m_shutdown = false;
+};
+
+JobSystem& GetJobSystem();
\ No newline at end of file
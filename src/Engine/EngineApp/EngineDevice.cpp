@@ -2,6 +2,7 @@
 #include "EngineDevice.h"
 #include "Platform/InputSystem.h"
 #include "Graphics/GraphicsSystem.h"
+#include "Core/Resource/ResourceCache.h"
 //-----------------------------------------------------------------------------
 #if defined(_MSC_VER)
 #	pragma comment( lib, "3rdparty.lib" )
@@ -10,6 +11,9 @@
 bool isExitRequested = true;
 //-----------------------------------------------------------------------------
 extern LogSystem gLogSystem;
+extern Profiler gProfiler;
+extern FrameArena gFrameArena;
+extern JobSystem gJobSystem;
 extern InputSystem gInputSystem;
 extern WindowSystem gWindowSystem;
 extern RenderSystem gRenderSystem;
@@ -34,6 +38,11 @@ void mainLoop()
 EngineDevice::EngineDevice(const EngineDeviceCreateInfo& createInfo)
 {
 	if (!gLogSystem.Create(createInfo.log)) return;
+#if USE_PROFILER
+	if (!gProfiler.Create(createInfo.profiler)) return;
+#endif
+	if (!gFrameArena.Create(createInfo.frameArena)) return;
+	if (!gJobSystem.Create(createInfo.jobs)) return;
 
 	if (!gWindowSystem.Create(createInfo.window)) return;
 	if (!gInputSystem.Create()) return;
@@ -68,6 +77,11 @@ EngineDevice::~EngineDevice()
 	gRenderSystem.Destroy();
 	gInputSystem.Destroy();
 	gWindowSystem.Destroy();
+	gJobSystem.Destroy();
+	gFrameArena.Destroy();
+#if USE_PROFILER
+	gProfiler.Destroy();
+#endif
 	gLogSystem.Destroy();
 }
 //-----------------------------------------------------------------------------
@@ -112,10 +126,18 @@ void EngineDevice::RunApp(std::shared_ptr<IApp> app)
 //-----------------------------------------------------------------------------
 void EngineDevice::Update()
 {
+	PROFILE_SCOPE("Update");
 	gWindowSystem.Update();
 	m_timestamp.Update();
 	gInputSystem.Update();
 
+	// Run the GL jobs queued by other threads since the last frame
+	gJobSystem.RunMainThreadJobs();
+
+	// Finish resources loaded in the background since the last frame
+	if (ResourceCache* cache = Object::Subsystem<ResourceCache>())
+		cache->UpdateBackgroundLoading();
+
 #if USE_PHYSICS
 	if (m_physicsSystemEnable)
 		gPhysicsSystem.Update();
@@ -128,13 +150,42 @@ void EngineDevice::Update()
 //-----------------------------------------------------------------------------
 void EngineDevice::Render()
 {
+	PROFILE_SCOPE("Render");
+	PROFILE_GPU_SCOPE("Render");
 	m_currentApp->Render();
 }
 //-----------------------------------------------------------------------------
 void EngineDevice::Present()
 {
-	gWindowSystem.Present();
+	{
+		PROFILE_SCOPE("Present");
+		gWindowSystem.Present();
+	}
+#if USE_PROFILER
+	// Before RenderSystem::EndFrame(), which starts the GPU queries of the next profiler frame
+	updateProfiler();
+#endif
+	gRenderSystem.EndFrame();
+	gFrameArena.EndFrame();
+}
+//-----------------------------------------------------------------------------
+#if USE_PROFILER
+void EngineDevice::updateProfiler()
+{
+	const RenderStatistics& statistics = gRenderSystem.GetStatistics();
+	const unsigned stateChanges = statistics.stateCalls + statistics.programBinds + statistics.vertexArrayBinds + statistics.bufferBinds
+		+ statistics.textureBinds + statistics.samplerBinds + statistics.framebufferBinds;
+
+	gProfiler.SetCounter("Draw Calls", statistics.drawCalls);
+	gProfiler.SetCounter("State Changes", stateChanges);
+	gProfiler.SetCounter("Uniform Calls", statistics.uniformCalls);
+	gProfiler.SetCounter("Bytes Uploaded", static_cast<int64_t>(statistics.bytesUploaded));
+	gProfiler.SetCounter("Frame Arena Bytes", static_cast<int64_t>(gFrameArena.GetHighWater()));
+	// Frame allocations that did not fit in the arena and went to the heap
+	gProfiler.SetCounter("Frame Arena Overflows", static_cast<int64_t>(gFrameArena.GetOverflowCount()));
+	gProfiler.EndFrame();
 }
+#endif
 //-----------------------------------------------------------------------------
 void ExitRequest()
 {
@@ -1,6 +1,9 @@
 ﻿#pragma once
 
 #include "Core/Logging/LogSystem.h"
+#include "Core/Debug/Profiler.h"
+#include "Core/Object/FrameArena.h"
+#include "Core/Threading/JobSystem.h"
 #include "EngineApp/EngineTimestamp.h"
 #include "Platform/WindowSystem.h"
 #include "RenderAPI/RenderSystem.h"
@@ -10,6 +13,9 @@
 struct EngineDeviceCreateInfo final
 {
 	LogCreateInfo log;
+	ProfilerCreateInfo profiler;
+	FrameArenaCreateInfo frameArena;
+	JobSystemCreateInfo jobs;
 	WindowCreateInfo window;
 	RenderCreateInfo render;
 	PhysicsCreateInfo physics;
@@ -30,6 +36,10 @@ public:
 	void Present();
 
 private:
+#if USE_PROFILER
+	void updateProfiler();
+#endif
+
 	EngineDevice(EngineDevice&&) = delete;
 	EngineDevice(const EngineDevice&) = delete;
 	EngineDevice& operator=(EngineDevice&&) = delete;
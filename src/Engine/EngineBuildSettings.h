@@ -1,3 +1,9 @@
 ﻿#pragma once
 
-#define USE_PHYSICS 1
\ No newline at end of file
+#define USE_PHYSICS 1
+
+// Use atomic reference counts in RefCounted, SharedPtr and WeakPtr so that objects can be shared between threads
+#define USE_THREADSAFE_REFCOUNT 1
+
+// Compile the PROFILE_SCOPE and PROFILE_GPU_SCOPE markers and collect the per-frame counters
+#define USE_PROFILER 1
\ No newline at end of file
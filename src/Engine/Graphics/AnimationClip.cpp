@@ -0,0 +1,261 @@
+#include "stdafx.h"
+#include "AnimationClip.h"
+#include "GraphicsResource.h"
+
+// Largest magnitude of the three smallest components of a unit quaternion, 1 / sqrt(2).
+static const float SMALLEST_THREE_RANGE = 0.70710678f;
+// Largest quantized value of a smallest-three component, 15 bits.
+static const float QUATERNION_QUANTIZATION = 32767.0f;
+// Largest quantized value of a vector component, 16 bits.
+static const float VECTOR_QUANTIZATION = 65535.0f;
+//-----------------------------------------------------------------------------
+static CompressedQuaternion CompressQuaternion(const glm::quat& rotation)
+{
+	const glm::quat q = glm::normalize(rotation);
+	const float components[4] = { q.x, q.y, q.z, q.w };
+	unsigned largest = 0;
+	for (unsigned i = 1; i < 4; i++)
+	{
+		if (fabsf(components[i]) > fabsf(components[largest]))
+			largest = i;
+	}
+	// q and -q are the same rotation, flip so that the dropped component is positive and can be rebuilt from the other three
+	const float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+
+	CompressedQuaternion key;
+	for (unsigned i = 0, j = 0; i < 4; i++)
+	{
+		if (i == largest) continue;
+		const float normalized = components[i] * sign / SMALLEST_THREE_RANGE * 0.5f + 0.5f;
+		key.data[j++] = static_cast<uint16_t>(std::clamp(normalized, 0.0f, 1.0f) * QUATERNION_QUANTIZATION + 0.5f);
+	}
+	key.data[0] |= static_cast<uint16_t>((largest & 1u) << 15);
+	key.data[1] |= static_cast<uint16_t>((largest >> 1) << 15);
+	return key;
+}
+//-----------------------------------------------------------------------------
+static glm::quat DecompressQuaternion(const CompressedQuaternion& key)
+{
+	const unsigned largest = (key.data[0] >> 15) | ((key.data[1] >> 15) << 1);
+	float components[4];
+	float sum = 0.0f;
+	for (unsigned i = 0, j = 0; i < 4; i++)
+	{
+		if (i == largest) continue;
+		const float value = ((key.data[j++] & 0x7FFF) / QUATERNION_QUANTIZATION * 2.0f - 1.0f) * SMALLEST_THREE_RANGE;
+		components[i] = value;
+		sum += value * value;
+	}
+	components[largest] = sqrtf(std::max(1.0f - sum, 0.0f));
+
+	glm::quat q;
+	q.x = components[0];
+	q.y = components[1];
+	q.z = components[2];
+	q.w = components[3];
+	return q;
+}
+//-----------------------------------------------------------------------------
+static glm::vec3 DecompressVector(const AnimationVectorTrack& track, const CompressedVector3& key)
+{
+	return track.minimum + track.extent * glm::vec3(key.data[0], key.data[1], key.data[2]) / VECTOR_QUANTIZATION;
+}
+//-----------------------------------------------------------------------------
+static void CompressVectorTrack(AnimationVectorTrack& track, std::span<const float> times, std::span<const glm::vec3> values)
+{
+	assert(times.size() == values.size());
+	const size_t count = std::min(times.size(), values.size());
+	if (!count) return;
+
+	glm::vec3 minimum = values[0];
+	glm::vec3 maximum = values[0];
+	for (size_t i = 1; i < count; i++)
+	{
+		minimum = glm::min(minimum, values[i]);
+		maximum = glm::max(maximum, values[i]);
+	}
+
+	track = {};
+	const glm::vec3 extent = maximum - minimum;
+	if (std::max(std::max(extent.x, extent.y), extent.z) <= ANIMATION_CONSTANT_VECTOR_TOLERANCE)
+	{
+		track.minimum = values[0];
+		return;
+	}
+
+	track.minimum = minimum;
+	track.extent = extent;
+	track.times.assign(times.begin(), times.begin() + count);
+	track.keys.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			const float normalized = extent[c] > 0.0f ? (values[i][c] - minimum[c]) / extent[c] : 0.0f;
+			track.keys[i].data[c] = static_cast<uint16_t>(std::clamp(normalized, 0.0f, 1.0f) * VECTOR_QUANTIZATION + 0.5f);
+		}
+	}
+}
+//-----------------------------------------------------------------------------
+// Return the key at or before time, starting from the key found by the previous sample of the track.
+static uint32_t FindKey(const std::vector<float>& times, float time, uint32_t& cursor)
+{
+	const uint32_t last = static_cast<uint32_t>(times.size() - 1);
+	uint32_t key = std::min(cursor, last);
+	if (times[key] <= time)
+	{
+		// Playback reaches the next key at most once per frame, anything further is a jump
+		if (key < last && times[key + 1] <= time)
+		{
+			key++;
+			if (key < last && times[key + 1] <= time)
+				key = static_cast<uint32_t>(std::upper_bound(times.begin() + key + 1, times.end(), time) - times.begin() - 1);
+		}
+	}
+	else
+	{
+		const auto next = std::upper_bound(times.begin(), times.begin() + key, time);
+		key = next == times.begin() ? 0 : static_cast<uint32_t>(next - times.begin() - 1);
+	}
+	cursor = key;
+	return key;
+}
+//-----------------------------------------------------------------------------
+// Return the interpolation factor between a key and the next one.
+static float KeyFactor(const std::vector<float>& times, uint32_t key, float time)
+{
+	if (key + 1 >= times.size()) return 0.0f;
+	const float span = times[key + 1] - times[key];
+	return span > 0.0f ? std::clamp((time - times[key]) / span, 0.0f, 1.0f) : 0.0f;
+}
+//-----------------------------------------------------------------------------
+static glm::vec3 SampleVectorTrack(const AnimationVectorTrack& track, float time, uint32_t& cursor)
+{
+	if (track.keys.empty()) return track.minimum;
+
+	const uint32_t key = FindKey(track.times, time, cursor);
+	const glm::vec3 value = DecompressVector(track, track.keys[key]);
+	const float factor = KeyFactor(track.times, key, time);
+	if (factor <= 0.0f) return value;
+	return glm::mix(value, DecompressVector(track, track.keys[key + 1]), factor);
+}
+//-----------------------------------------------------------------------------
+static glm::quat SampleRotationTrack(const AnimationRotationTrack& track, float time, uint32_t& cursor)
+{
+	if (track.keys.empty()) return track.constant;
+
+	const uint32_t key = FindKey(track.times, time, cursor);
+	const glm::quat value = DecompressQuaternion(track.keys[key]);
+	const float factor = KeyFactor(track.times, key, time);
+	if (factor <= 0.0f) return value;
+
+	// Normalized lerp along the shorter arc, keys are close enough for it to match slerp
+	glm::quat next = DecompressQuaternion(track.keys[key + 1]);
+	if (glm::dot(value, next) < 0.0f) next = -next;
+	return glm::normalize(value * (1.0f - factor) + next * factor);
+}
+//-----------------------------------------------------------------------------
+void AnimationClip::Create(int boneCount, float duration, float frameTime)
+{
+	const size_t count = static_cast<size_t>(std::max(boneCount, 0));
+	m_translations.assign(count, AnimationVectorTrack());
+	m_rotations.assign(count, AnimationRotationTrack());
+	m_scales.assign(count, AnimationVectorTrack());
+	for (AnimationVectorTrack& track : m_scales)
+		track.minimum = glm::vec3(1.0f);
+	m_duration = duration;
+	m_frameTime = frameTime;
+}
+//-----------------------------------------------------------------------------
+void AnimationClip::SetTranslation(int bone, std::span<const float> times, std::span<const glm::vec3> values)
+{
+	assert(bone >= 0 && bone < GetBoneCount());
+	CompressVectorTrack(m_translations[bone], times, values);
+}
+//-----------------------------------------------------------------------------
+void AnimationClip::SetRotation(int bone, std::span<const float> times, std::span<const glm::quat> values)
+{
+	assert(bone >= 0 && bone < GetBoneCount());
+	assert(times.size() == values.size());
+	const size_t count = std::min(times.size(), values.size());
+	if (!count) return;
+
+	AnimationRotationTrack& track = m_rotations[bone];
+	track = {};
+	const glm::quat first = glm::normalize(values[0]);
+	bool constant = true;
+	for (size_t i = 1; i < count && constant; i++)
+		constant = 1.0f - fabsf(glm::dot(first, glm::normalize(values[i]))) <= ANIMATION_CONSTANT_ROTATION_TOLERANCE;
+	if (constant)
+	{
+		track.constant = first;
+		return;
+	}
+
+	track.times.assign(times.begin(), times.begin() + count);
+	track.keys.resize(count);
+	for (size_t i = 0; i < count; i++)
+		track.keys[i] = CompressQuaternion(values[i]);
+}
+//-----------------------------------------------------------------------------
+void AnimationClip::SetScale(int bone, std::span<const float> times, std::span<const glm::vec3> values)
+{
+	assert(bone >= 0 && bone < GetBoneCount());
+	CompressVectorTrack(m_scales[bone], times, values);
+}
+//-----------------------------------------------------------------------------
+void AnimationClip::Sample(float time, AnimationCursor& cursor, TempTransform* localPose) const
+{
+	// Sampled through the SoA overload so that both layouts share one sampling loop
+	thread_local std::vector<glm::vec3> translations, scales;
+	thread_local std::vector<glm::quat> rotations;
+	const size_t count = m_rotations.size();
+	translations.resize(count);
+	rotations.resize(count);
+	scales.resize(count);
+	Sample(time, cursor, translations.data(), rotations.data(), scales.data());
+
+	for (size_t b = 0; b < count; b++)
+		localPose[b] = { translations[b], rotations[b], scales[b] };
+}
+//-----------------------------------------------------------------------------
+void AnimationClip::Sample(float time, AnimationCursor& cursor, glm::vec3* translations, glm::quat* rotations, glm::vec3* scales) const
+{
+	time = std::clamp(time, 0.0f, m_duration);
+	if (cursor.m_keys.size() != m_rotations.size() * 3)
+		cursor.m_keys.assign(m_rotations.size() * 3, 0);
+
+	for (size_t b = 0; b < m_rotations.size(); b++)
+	{
+		uint32_t* keys = &cursor.m_keys[b * 3];
+		translations[b] = SampleVectorTrack(m_translations[b], time, keys[0]);
+		rotations[b] = SampleRotationTrack(m_rotations[b], time, keys[1]);
+		scales[b] = SampleVectorTrack(m_scales[b], time, keys[2]);
+	}
+}
+//-----------------------------------------------------------------------------
+unsigned AnimationClip::GetConstantTrackCount() const
+{
+	unsigned count = 0;
+	for (size_t b = 0; b < m_rotations.size(); b++)
+	{
+		count += m_translations[b].keys.empty() ? 1 : 0;
+		count += m_rotations[b].keys.empty() ? 1 : 0;
+		count += m_scales[b].keys.empty() ? 1 : 0;
+	}
+	return count;
+}
+//-----------------------------------------------------------------------------
+size_t AnimationClip::GetMemorySize() const
+{
+	size_t size = sizeof(AnimationClip);
+	for (size_t b = 0; b < m_rotations.size(); b++)
+	{
+		size += sizeof(AnimationVectorTrack) * 2 + sizeof(AnimationRotationTrack);
+		size += (m_translations[b].times.capacity() + m_rotations[b].times.capacity() + m_scales[b].times.capacity()) * sizeof(float);
+		size += (m_translations[b].keys.capacity() + m_scales[b].keys.capacity()) * sizeof(CompressedVector3);
+		size += m_rotations[b].keys.capacity() * sizeof(CompressedQuaternion);
+	}
+	return size;
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
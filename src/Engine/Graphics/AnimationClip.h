@@ -0,0 +1,85 @@
+#pragma once
+
+struct TempTransform;
+
+// Largest difference to the first key for which a translation or scale track is stored as a single constant key.
+static const float ANIMATION_CONSTANT_VECTOR_TOLERANCE = 1.0e-5f;
+// Largest angle difference to the first key, as 1 - |dot|, for which a rotation track is stored as a single constant key.
+static const float ANIMATION_CONSTANT_ROTATION_TOLERANCE = 1.0e-7f;
+
+// Rotation key: the three smallest components of the unit quaternion quantized to 15 bits, the index of the largest one in the top bits of the first two.
+struct CompressedQuaternion
+{
+	uint16_t data[3];
+};
+
+// Translation or scale key: each component quantized to 16 bits over the range of its track.
+struct CompressedVector3
+{
+	uint16_t data[3];
+};
+
+// Keyframes of the translation or scale of one bone. A constant track has no keys and stores its value in minimum.
+struct AnimationVectorTrack
+{
+	std::vector<float> times;
+	std::vector<CompressedVector3> keys;
+	glm::vec3 minimum = glm::vec3(0.0f);
+	glm::vec3 extent = glm::vec3(0.0f);
+};
+
+// Keyframes of the rotation of one bone. A constant track has no keys and stores its value in constant.
+struct AnimationRotationTrack
+{
+	std::vector<float> times;
+	std::vector<CompressedQuaternion> keys;
+	glm::quat constant = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+};
+
+// Playback position in the tracks of a clip, one per playing instance. Sampling forward from the previous time steps to the next key at most, so that a frame costs O(1) per track. Jumps and rewinds fall back to a binary search.
+class AnimationCursor
+{
+public:
+	// Forget the positions, the next sample searches every track.
+	void Reset() { m_keys.clear(); }
+
+private:
+	friend class AnimationClip;
+
+	// Index of the key at or before the last sampled time, per track: translation, rotation and scale of each bone.
+	std::vector<uint32_t> m_keys;
+};
+
+// Animation with per-track keyframes instead of one baked pose per frame: memory grows with the number of keys, not with the clip length.
+// Rotations use smallest-three quantization, translations and scales are quantized over the range of their track, and constant tracks keep a single value.
+class AnimationClip
+{
+public:
+	// Start a clip of boneCount constant tracks with the identity transform. frameTime is the interval of the frames of the frame-based UpdateModelAnimation().
+	void Create(int boneCount, float duration, float frameTime);
+
+	// Compress the keys of a channel of a bone. Times are in seconds and ascending.
+	void SetTranslation(int bone, std::span<const float> times, std::span<const glm::vec3> values);
+	void SetRotation(int bone, std::span<const float> times, std::span<const glm::quat> values);
+	void SetScale(int bone, std::span<const float> times, std::span<const glm::vec3> values);
+
+	// Sample the local transforms of all bones at a time in seconds, clamped to the clip, interpolating linearly between keys.
+	void Sample(float time, AnimationCursor& cursor, TempTransform* localPose) const;
+	// Sample into separate translation, rotation and scale arrays of GetBoneCount() elements.
+	void Sample(float time, AnimationCursor& cursor, glm::vec3* translations, glm::quat* rotations, glm::vec3* scales) const;
+
+	int GetBoneCount() const { return static_cast<int>(m_rotations.size()); }
+	float GetDuration() const { return m_duration; }
+	float GetFrameTime() const { return m_frameTime; }
+	// Return the number of tracks stored as a single constant key.
+	unsigned GetConstantTrackCount() const;
+	// Return the bytes used by the keyframes.
+	size_t GetMemorySize() const;
+
+private:
+	std::vector<AnimationVectorTrack> m_translations;
+	std::vector<AnimationRotationTrack> m_rotations;
+	std::vector<AnimationVectorTrack> m_scales;
+	float m_duration = 0.0f;
+	float m_frameTime = 0.0f;
+};
\ No newline at end of file
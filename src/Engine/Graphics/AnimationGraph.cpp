@@ -0,0 +1,240 @@
+#include "stdafx.h"
+#include "AnimationGraph.h"
+#include "Core/Debug/Profiler.h"
+#include "Core/Threading/JobSystem.h"
+//-----------------------------------------------------------------------------
+// Normalized lerp along the shorter arc.
+static glm::quat BlendRotations(const glm::quat& a, const glm::quat& b, float weight)
+{
+	const glm::quat target = glm::dot(a, b) < 0.0f ? -b : b;
+	return glm::normalize(a * (1.0f - weight) + target * weight);
+}
+//-----------------------------------------------------------------------------
+// Invert the parent composition of BuildPoseFromParentJoints() for one bone of a model space pose.
+static void ModelToLocal(glm::vec3& translation, glm::quat& rotation, glm::vec3& scale, const TempTransform* modelPose, const NewBoneInfo* bones, int bone)
+{
+	const TempTransform& transform = modelPose[bone];
+	const int parent = bones[bone].parent;
+	if (parent < 0 || parent >= bone)
+	{
+		translation = transform.translation;
+		rotation = transform.rotation;
+		scale = transform.scale;
+		return;
+	}
+
+	const TempTransform& parentTransform = modelPose[parent];
+	const glm::quat inverseParent = glm::inverse(parentTransform.rotation);
+	translation = inverseParent * (transform.translation - parentTransform.translation);
+	rotation = inverseParent * transform.rotation;
+	scale = transform.scale / parentTransform.scale;
+}
+//-----------------------------------------------------------------------------
+void AnimationPose::Resize(int boneCount)
+{
+	const size_t count = static_cast<size_t>(std::max(boneCount, 0));
+	translations.resize(count, glm::vec3(0.0f));
+	rotations.resize(count, glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+	scales.resize(count, glm::vec3(1.0f));
+}
+//-----------------------------------------------------------------------------
+void SampleAnimation(AnimationPose& pose, const ModelAnimation& animation, AnimationCursor& cursor, float time, float frameRate)
+{
+	pose.Resize(animation.boneCount);
+	if (animation.clip != nullptr)
+	{
+		assert(animation.clip->GetBoneCount() == animation.boneCount);
+		animation.clip->Sample(time, cursor, pose.translations.data(), pose.rotations.data(), pose.scales.data());
+		return;
+	}
+	if (animation.framePoses == nullptr || animation.frameCount <= 0) return;
+
+	// Baked poses are in model space: blend the local transforms of the two frames around the time
+	const float frame = std::clamp(time * frameRate, 0.0f, static_cast<float>(animation.frameCount - 1));
+	const int frame0 = static_cast<int>(frame);
+	const int frame1 = std::min(frame0 + 1, animation.frameCount - 1);
+	const float weight = frame - static_cast<float>(frame0);
+	for (int b = 0; b < animation.boneCount; b++)
+	{
+		glm::vec3 translation0, translation1, scale0, scale1;
+		glm::quat rotation0, rotation1;
+		ModelToLocal(translation0, rotation0, scale0, animation.framePoses[frame0], animation.bones, b);
+		ModelToLocal(translation1, rotation1, scale1, animation.framePoses[frame1], animation.bones, b);
+		pose.translations[b] = glm::mix(translation0, translation1, weight);
+		pose.rotations[b] = BlendRotations(rotation0, rotation1, weight);
+		pose.scales[b] = glm::mix(scale0, scale1, weight);
+	}
+}
+//-----------------------------------------------------------------------------
+void BlendPoses(AnimationPose& pose, const AnimationPose& a, const AnimationPose& b, float weight)
+{
+	assert(a.GetBoneCount() == b.GetBoneCount());
+	const size_t count = std::min(a.rotations.size(), b.rotations.size());
+	pose.Resize(static_cast<int>(count));
+	weight = std::clamp(weight, 0.0f, 1.0f);
+
+	for (size_t i = 0; i < count; i++)
+		pose.translations[i] = glm::mix(a.translations[i], b.translations[i], weight);
+	for (size_t i = 0; i < count; i++)
+		pose.rotations[i] = BlendRotations(a.rotations[i], b.rotations[i], weight);
+	for (size_t i = 0; i < count; i++)
+		pose.scales[i] = glm::mix(a.scales[i], b.scales[i], weight);
+}
+//-----------------------------------------------------------------------------
+void AddPose(AnimationPose& pose, const AnimationPose& base, const AnimationPose& additive, const AnimationPose& reference, float weight)
+{
+	assert(base.GetBoneCount() == additive.GetBoneCount() && base.GetBoneCount() == reference.GetBoneCount());
+	const size_t count = std::min(std::min(base.rotations.size(), additive.rotations.size()), reference.rotations.size());
+	pose.Resize(static_cast<int>(count));
+
+	const glm::quat identity(1.0f, 0.0f, 0.0f, 0.0f);
+	for (size_t i = 0; i < count; i++)
+		pose.translations[i] = base.translations[i] + (additive.translations[i] - reference.translations[i]) * weight;
+	for (size_t i = 0; i < count; i++)
+	{
+		// The additive rotation is relative to the reference, applied in the local space of the base bone
+		const glm::quat delta = glm::inverse(reference.rotations[i]) * additive.rotations[i];
+		pose.rotations[i] = glm::normalize(base.rotations[i] * BlendRotations(identity, delta, weight));
+	}
+	for (size_t i = 0; i < count; i++)
+		pose.scales[i] = base.scales[i] * glm::mix(glm::vec3(1.0f), additive.scales[i] / reference.scales[i], weight);
+}
+//-----------------------------------------------------------------------------
+void ResolveModelPose(TempTransform* modelPose, const AnimationPose& pose, const NewBoneInfo* bones)
+{
+	const int boneCount = pose.GetBoneCount();
+	for (int b = 0; b < boneCount; b++)
+	{
+		modelPose[b].translation = pose.translations[b];
+		modelPose[b].rotation = pose.rotations[b];
+		modelPose[b].scale = pose.scales[b];
+	}
+	BuildPoseFromParentJoints(bones, boneCount, modelPose);
+}
+//-----------------------------------------------------------------------------
+void PoseGraph::Create(const NewBoneInfo* bones, int boneCount)
+{
+	m_nodes.clear();
+	m_scratch.clear();
+	m_bones = bones;
+	m_boneCount = std::max(boneCount, 0);
+}
+//-----------------------------------------------------------------------------
+unsigned PoseGraph::AddSample(const ModelAnimation* animation, float frameRate)
+{
+	assert(animation != nullptr && animation->boneCount == m_boneCount);
+	Node node;
+	node.type = PoseNodeType::Sample;
+	node.animation = animation;
+	node.frameRate = frameRate;
+	return addNode(node);
+}
+//-----------------------------------------------------------------------------
+unsigned PoseGraph::AddBlend(unsigned a, unsigned b)
+{
+	assert(a < m_nodes.size() && b < m_nodes.size());
+	Node node;
+	node.type = PoseNodeType::Blend;
+	node.inputs[0] = a;
+	node.inputs[1] = b;
+	return addNode(node);
+}
+//-----------------------------------------------------------------------------
+unsigned PoseGraph::AddAdditive(unsigned base, unsigned additive, unsigned reference)
+{
+	assert(base < m_nodes.size() && additive < m_nodes.size() && reference < m_nodes.size());
+	Node node;
+	node.type = PoseNodeType::Additive;
+	node.inputs[0] = base;
+	node.inputs[1] = additive;
+	node.inputs[2] = reference;
+	return addNode(node);
+}
+//-----------------------------------------------------------------------------
+void PoseGraph::Prepare()
+{
+	// The last slot is shared by threads outside the job system
+	const size_t threadCount = GetJobSystem().GetNumThreads() + 1;
+	m_scratch.resize(threadCount);
+	for (std::vector<AnimationPose>& poses : m_scratch)
+	{
+		poses.resize(m_nodes.size());
+		for (AnimationPose& pose : poses)
+			pose.Resize(m_boneCount);
+	}
+}
+//-----------------------------------------------------------------------------
+bool PoseGraph::IsPrepared() const
+{
+	return m_scratch.size() == GetJobSystem().GetNumThreads() + 1 && m_scratch[0].size() == m_nodes.size();
+}
+//-----------------------------------------------------------------------------
+void PoseGraph::Evaluate(PoseGraphInstance& instance) const
+{
+	if (!IsPrepared())
+	{
+		LogError("PoseGraph::Evaluate(): Prepare() was not called after the graph or the JobSystem changed");
+		return;
+	}
+	evaluate(instance, m_scratch[GetJobSystem().GetThreadIndex()]);
+}
+//-----------------------------------------------------------------------------
+void PoseGraph::Evaluate(std::span<PoseGraphInstance* const> instances, unsigned batchSize) const
+{
+	PROFILE_SCOPE("PoseGraph::Evaluate");
+
+	if (!IsPrepared())
+	{
+		LogError("PoseGraph::Evaluate(): Prepare() was not called after the graph or the JobSystem changed");
+		return;
+	}
+
+	JobSystem& jobSystem = GetJobSystem();
+	jobSystem.ParallelFor(instances.size(), std::max(batchSize, 1u), [&](size_t begin, size_t end)
+	{
+		std::vector<AnimationPose>& poses = m_scratch[jobSystem.GetThreadIndex()];
+		for (size_t i = begin; i < end; i++)
+			evaluate(*instances[i], poses);
+	});
+}
+//-----------------------------------------------------------------------------
+unsigned PoseGraph::addNode(const Node& node)
+{
+	m_nodes.push_back(node);
+	m_scratch.clear();
+	return static_cast<unsigned>(m_nodes.size() - 1);
+}
+//-----------------------------------------------------------------------------
+void PoseGraph::evaluate(PoseGraphInstance& instance, std::vector<AnimationPose>& poses) const
+{
+	assert(instance.m_graph == this && instance.m_parameters.size() == m_nodes.size());
+	if (m_nodes.empty()) return;
+
+	for (size_t n = 0; n < m_nodes.size(); n++)
+	{
+		const Node& node = m_nodes[n];
+		const float parameter = instance.m_parameters[n];
+		switch (node.type)
+		{
+		case PoseNodeType::Sample:
+			SampleAnimation(poses[n], *node.animation, instance.m_cursors[n], parameter, node.frameRate);
+			break;
+		case PoseNodeType::Blend:
+			BlendPoses(poses[n], poses[node.inputs[0]], poses[node.inputs[1]], parameter);
+			break;
+		case PoseNodeType::Additive:
+			AddPose(poses[n], poses[node.inputs[0]], poses[node.inputs[1]], poses[node.inputs[2]], parameter);
+			break;
+		}
+	}
+	ResolveModelPose(instance.m_modelPose.data(), poses.back(), m_bones);
+}
+//-----------------------------------------------------------------------------
+void PoseGraphInstance::Create(const PoseGraph& graph)
+{
+	m_graph = &graph;
+	m_parameters.assign(graph.GetNodeCount(), 0.0f);
+	m_cursors.assign(graph.GetNodeCount(), AnimationCursor());
+	m_modelPose.resize(static_cast<size_t>(graph.GetBoneCount()));
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
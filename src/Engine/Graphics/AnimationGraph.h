@@ -0,0 +1,120 @@
+#pragma once
+
+#include "GraphicsResource.h"
+#include "AnimationClip.h"
+
+// Frame rate of baked animations, which store no rate of their own.
+static const float DEFAULT_BAKED_ANIMATION_FRAME_RATE = 60.0f;
+// Smallest number of instances evaluated by one job.
+static const unsigned DEFAULT_POSE_GRAPH_BATCH_SIZE = 8;
+
+// Local bone transforms in SoA form: translations, rotations and scales in separate arrays, so that blends run over contiguous components.
+struct AnimationPose
+{
+	// Resize the arrays. Does not allocate when the bone count is unchanged.
+	void Resize(int boneCount);
+	int GetBoneCount() const { return static_cast<int>(rotations.size()); }
+
+	std::vector<glm::vec3> translations;
+	std::vector<glm::quat> rotations;
+	std::vector<glm::vec3> scales;
+};
+
+// Sample an animation at a time in seconds, clamped to the animation. Clips interpolate their keys through the cursor; baked animations interpolate the two nearest frames at frameRate, converted back to local space.
+void SampleAnimation(AnimationPose& pose, const ModelAnimation& animation, AnimationCursor& cursor, float time, float frameRate = DEFAULT_BAKED_ANIMATION_FRAME_RATE);
+// Blend from a to b by weight, rotations along the shorter arc. The result may alias a or b.
+void BlendPoses(AnimationPose& pose, const AnimationPose& a, const AnimationPose& b, float weight);
+// Layer the difference between an additive pose and its reference pose, e.g. the first frame of the additive animation, on a base pose, scaled by weight. The result may alias base.
+void AddPose(AnimationPose& pose, const AnimationPose& base, const AnimationPose& additive, const AnimationPose& reference, float weight);
+// Convert local transforms to model space with BuildPoseFromParentJoints(): parents come before their children in the NewBoneInfo order.
+void ResolveModelPose(TempTransform* modelPose, const AnimationPose& pose, const NewBoneInfo* bones);
+
+enum class PoseNodeType : uint8_t
+{
+	// Sample an animation at the time given by the parameter.
+	Sample,
+	// Blend two nodes by the weight given by the parameter.
+	Blend,
+	// Layer an additive node on a base node, scaled by the weight given by the parameter.
+	Additive
+};
+
+class PoseGraphInstance;
+
+// Blend tree shared by many animated instances. Nodes are evaluated in the order they are added and only read earlier nodes; the last node is the output.
+// Intermediate poses live in per-thread scratch poses reused by every instance, so that an instance only stores its parameters, cursors and resolved pose.
+// The scratch poses are sized by Prepare() once the graph is built, evaluation never allocates.
+class PoseGraph
+{
+public:
+	PoseGraph() = default;
+
+	// Start a graph for a skeleton. The bones must outlive the graph.
+	void Create(const NewBoneInfo* bones, int boneCount);
+
+	// Add a node sampling an animation of the skeleton. Return the node index.
+	unsigned AddSample(const ModelAnimation* animation, float frameRate = DEFAULT_BAKED_ANIMATION_FRAME_RATE);
+	// Add a node blending two earlier nodes. Return the node index.
+	unsigned AddBlend(unsigned a, unsigned b);
+	// Add a node layering the difference between additive and reference on base. Return the node index.
+	unsigned AddAdditive(unsigned base, unsigned additive, unsigned reference);
+
+	// Size the scratch poses for the nodes and the JobSystem threads. Call after the last node is added and after the JobSystem is created, before Evaluate().
+	void Prepare();
+	bool IsPrepared() const;
+
+	// Evaluate one instance on the calling thread, the main thread or a job.
+	void Evaluate(PoseGraphInstance& instance) const;
+	// Evaluate many instances, split into batches of at least batchSize instances across the JobSystem threads. Call from the main thread.
+	void Evaluate(std::span<PoseGraphInstance* const> instances, unsigned batchSize = DEFAULT_POSE_GRAPH_BATCH_SIZE) const;
+
+	unsigned GetNodeCount() const { return static_cast<unsigned>(m_nodes.size()); }
+	int GetBoneCount() const { return m_boneCount; }
+
+private:
+	PoseGraph(PoseGraph&&) = delete;
+	PoseGraph(const PoseGraph&) = delete;
+	PoseGraph& operator=(PoseGraph&&) = delete;
+	PoseGraph& operator=(const PoseGraph&) = delete;
+
+	struct Node
+	{
+		PoseNodeType type;
+		const ModelAnimation* animation = nullptr;
+		float frameRate = DEFAULT_BAKED_ANIMATION_FRAME_RATE;
+		unsigned inputs[3] = {};
+	};
+
+	unsigned addNode(const Node& node);
+	void evaluate(PoseGraphInstance& instance, std::vector<AnimationPose>& poses) const;
+
+	std::vector<Node> m_nodes;
+	const NewBoneInfo* m_bones = nullptr;
+	int m_boneCount = 0;
+	// One pose per node for each thread, indexed by JobSystem::GetThreadIndex(). Sized by Prepare(), Evaluate() only writes the poses of the calling thread.
+	mutable std::vector<std::vector<AnimationPose>> m_scratch;
+};
+
+// Animation state of one character evaluated by a PoseGraph.
+class PoseGraphInstance
+{
+public:
+	// Size the state for a graph. Create again after nodes are added to the graph.
+	void Create(const PoseGraph& graph);
+
+	// Set the parameter of a node: the time in seconds of a sample node, the weight of a blend or additive node.
+	void SetParameter(unsigned node, float value) { m_parameters[node] = value; }
+	float GetParameter(unsigned node) const { return m_parameters[node]; }
+
+	// Return the model space pose of the last evaluation, for UpdateModelPose().
+	std::span<const TempTransform> GetModelPose() const { return m_modelPose; }
+
+private:
+	friend class PoseGraph;
+
+	const PoseGraph* m_graph = nullptr;
+	std::vector<float> m_parameters;
+	// Keyframe positions of the sample nodes, empty for the other nodes.
+	std::vector<AnimationCursor> m_cursors;
+	std::vector<TempTransform> m_modelPose;
+};
\ No newline at end of file
@@ -0,0 +1,229 @@
+#include "stdafx.h"
+#include "CookedModel.h"
+#include "GraphicsSystem.h"
+#include "RenderAPI/RenderSystem.h"
+#include "Core/IO/File.h"
+#include "Core/IO/MemoryMappedStream.h"
+//-----------------------------------------------------------------------------
+static const char COOKED_MODEL_ID[4] = { 'T', 'M', 'S', 'H' };
+static const uint32_t COOKED_MODEL_VERSION = 2;
+// The vertex data is uploaded as is, so the vertex must not contain padding
+static_assert(sizeof(StaticMeshVertex) == 11 * sizeof(float), "StaticMeshVertex layout does not match the cooked model format");
+//-----------------------------------------------------------------------------
+static bool IsValidRange(uint64_t offset, uint64_t numBytes, uint64_t size)
+{
+	return offset <= size && numBytes <= size - offset;
+}
+//-----------------------------------------------------------------------------
+static void WritePadding(File& file, size_t alignment)
+{
+	static const unsigned char zeros[COOKED_MODEL_DATA_ALIGNMENT] = {};
+	const size_t padding = (file.Position() + alignment - 1) / alignment * alignment - file.Position();
+	if (padding)
+		file.Write(zeros, padding);
+}
+//-----------------------------------------------------------------------------
+static void StoreAABB(const BoundingAABB& aabb, float* min, float* max)
+{
+	for (int i = 0; i < 3; i++)
+	{
+		min[i] = aabb.min[i];
+		max[i] = aabb.max[i];
+	}
+}
+//-----------------------------------------------------------------------------
+static BoundingAABB LoadAABB(const float* min, const float* max)
+{
+	return BoundingAABB(glm::vec3(min[0], min[1], min[2]), glm::vec3(max[0], max[1], max[2]));
+}
+//-----------------------------------------------------------------------------
+// The indices are uploaded as is, so an index past the vertices would make the GPU read outside the vertex buffer
+template <class T> static bool AreIndicesInRange(const unsigned char* data, uint32_t indexCount, uint32_t vertexCount)
+{
+	for (uint32_t i = 0; i < indexCount; i++)
+	{
+		T index;
+		memcpy(&index, data + (size_t)i * sizeof(T), sizeof(T));
+		if (index >= vertexCount)
+			return false;
+	}
+	return true;
+}
+//-----------------------------------------------------------------------------
+StaticModelRef GraphicsSystem::loadCookedModel(const std::string& fileName, const char* pathMaterialFiles, unsigned sourceModifiedTime, bool keepMeshData)
+{
+	MemoryMappedStream file(fileName);
+	if (!file.IsOpen() || file.Size() < sizeof(CookedModelHeader))
+	{
+		LogError("Could not open cooked model " + fileName);
+		return {};
+	}
+
+	// The mapping is page aligned, so the tables are read in place
+	const CookedModelHeader* header = reinterpret_cast<const CookedModelHeader*>(file.Data());
+	if (memcmp(header->id, COOKED_MODEL_ID, sizeof COOKED_MODEL_ID) != 0 || header->version != COOKED_MODEL_VERSION || header->vertexSize != sizeof(StaticMeshVertex))
+	{
+		LogError(fileName + " is not a valid cooked model");
+		return {};
+	}
+
+	if (sourceModifiedTime && header->sourceModifiedTime != sourceModifiedTime)
+	{
+		LogPrint("Cooked model " + fileName + " is out of date");
+		return {};
+	}
+
+	const uint64_t size = file.Size();
+	if (!header->numSubMeshes || header->subMeshesOffset % alignof(CookedSubMesh) ||
+		!IsValidRange(header->subMeshesOffset, (uint64_t)header->numSubMeshes * sizeof(CookedSubMesh), size) ||
+		!IsValidRange(header->stringsOffset, header->stringsSize, size))
+	{
+		LogError("Corrupt cooked model " + fileName);
+		return {};
+	}
+
+	const CookedSubMesh* subMeshes = reinterpret_cast<const CookedSubMesh*>(file.Data() + header->subMeshesOffset);
+	const char* strings = reinterpret_cast<const char*>(file.Data() + header->stringsOffset);
+
+	StaticModelRef model(new StaticModel());
+	model->subMeshes.resize(header->numSubMeshes);
+	model->aabb = LoadAABB(header->aabbMin, header->aabbMax);
+
+	for (uint32_t i = 0; i < header->numSubMeshes; i++)
+	{
+		const CookedSubMesh& subMesh = subMeshes[i];
+		if ((subMesh.indexSize != sizeof(uint16_t) && subMesh.indexSize != sizeof(uint32_t)) ||
+			!IsValidRange(subMesh.vertexOffset, (uint64_t)subMesh.vertexCount * header->vertexSize, size) ||
+			!IsValidRange(subMesh.indexOffset, (uint64_t)subMesh.indexCount * subMesh.indexSize, size) ||
+			!IsValidRange(subMesh.nameOffset, subMesh.nameLength, header->stringsSize) ||
+			!IsValidRange(subMesh.diffuseTextureOffset, subMesh.diffuseTextureLength, header->stringsSize))
+		{
+			LogError("Corrupt cooked model " + fileName);
+			return {};
+		}
+
+		StaticMesh& mesh = model->subMeshes[i];
+		mesh.meshName.assign(strings + subMesh.nameOffset, subMesh.nameLength);
+		mesh.globalAABB = LoadAABB(subMesh.aabbMin, subMesh.aabbMax);
+
+		if (subMesh.diffuseTextureLength)
+		{
+			const std::string diffuseMap = pathMaterialFiles + std::string(strings + subMesh.diffuseTextureOffset, subMesh.diffuseTextureLength);
+			mesh.material.diffuseTexture = GetRenderSystem().CreateTexture2D(diffuseMap.c_str(), true);
+		}
+
+		// Upload straight from the mapped file, no StaticMeshVertex vectors are built
+		const unsigned char* vertexData = file.Data() + subMesh.vertexOffset;
+		const unsigned char* indexData = file.Data() + subMesh.indexOffset;
+		const bool indicesInRange = subMesh.indexSize == sizeof(uint16_t) ?
+			AreIndicesInRange<uint16_t>(indexData, subMesh.indexCount, subMesh.vertexCount) :
+			AreIndicesInRange<uint32_t>(indexData, subMesh.indexCount, subMesh.vertexCount);
+		if (!indicesInRange)
+		{
+			LogError("Corrupt cooked model " + fileName);
+			return {};
+		}
+		mesh.geometry = GetRenderSystem().CreateGeometryBuffer(
+			BufferUsage::StaticDraw,
+			subMesh.vertexCount, header->vertexSize, vertexData,
+			subMesh.indexCount, subMesh.indexSize == sizeof(uint16_t) ? IndexFormat::UInt16 : IndexFormat::UInt32, indexData,
+			staticMeshVertexFormat());
+
+		if (keepMeshData)
+		{
+			mesh.vertices.resize(subMesh.vertexCount);
+			memcpy(mesh.vertices.data(), vertexData, (size_t)subMesh.vertexCount * header->vertexSize);
+			if (subMesh.indexSize == sizeof(uint16_t))
+			{
+				const uint16_t* indices = reinterpret_cast<const uint16_t*>(indexData);
+				mesh.indices.assign(indices, indices + subMesh.indexCount);
+			}
+			else
+			{
+				mesh.indices.resize(subMesh.indexCount);
+				memcpy(mesh.indices.data(), indexData, (size_t)subMesh.indexCount * sizeof(uint32_t));
+			}
+		}
+	}
+
+	return model;
+}
+//-----------------------------------------------------------------------------
+bool GraphicsSystem::writeCookedModel(const std::string& fileName, const std::vector<StaticMesh>& meshes, const std::vector<std::string>& diffuseTextures, unsigned sourceModifiedTime)
+{
+	File file(fileName, FILE_WRITE);
+	if (!file.IsOpen())
+	{
+		LogWarning("Could not open cooked model " + fileName + " for writing");
+		return false;
+	}
+
+	CookedModelHeader header = {};
+	header.version = COOKED_MODEL_VERSION;
+	header.sourceModifiedTime = sourceModifiedTime;
+	header.numSubMeshes = (uint32_t)meshes.size();
+	header.vertexSize = sizeof(StaticMeshVertex);
+	header.subMeshesOffset = sizeof(CookedModelHeader);
+
+	std::vector<CookedSubMesh> subMeshes(meshes.size());
+	std::string strings;
+	BoundingAABB aabb = meshes.empty() ? BoundingAABB() : meshes[0].globalAABB;
+
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		CookedSubMesh& subMesh = subMeshes[i];
+		subMesh.vertexCount = (uint32_t)meshes[i].vertices.size();
+		subMesh.indexCount = (uint32_t)meshes[i].indices.size();
+		// 16-bit indices are enough for most submeshes and halve the index data
+		subMesh.indexSize = meshes[i].vertices.size() <= 65536 ? sizeof(uint16_t) : sizeof(uint32_t);
+		subMesh.nameOffset = (uint32_t)strings.size();
+		subMesh.nameLength = (uint32_t)meshes[i].meshName.length();
+		strings += meshes[i].meshName;
+		if (i < diffuseTextures.size())
+		{
+			subMesh.diffuseTextureOffset = (uint32_t)strings.size();
+			subMesh.diffuseTextureLength = (uint32_t)diffuseTextures[i].length();
+			strings += diffuseTextures[i];
+		}
+		StoreAABB(meshes[i].globalAABB, subMesh.aabbMin, subMesh.aabbMax);
+		aabb.Merge(meshes[i].globalAABB);
+	}
+
+	header.stringsOffset = header.subMeshesOffset + subMeshes.size() * sizeof(CookedSubMesh);
+	header.stringsSize = (uint32_t)strings.size();
+	StoreAABB(aabb, header.aabbMin, header.aabbMax);
+
+	// The ID is left zero until the end, so that a partially written file is never loaded. The submesh table is rewritten when the data offsets are known
+	file.Write(&header, sizeof header);
+	file.Write(subMeshes.data(), subMeshes.size() * sizeof(CookedSubMesh));
+	file.Write(strings.data(), strings.size());
+
+	std::vector<uint16_t> shortIndices;
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		CookedSubMesh& subMesh = subMeshes[i];
+
+		WritePadding(file, COOKED_MODEL_DATA_ALIGNMENT);
+		subMesh.vertexOffset = file.Position();
+		file.Write(meshes[i].vertices.data(), meshes[i].vertices.size() * sizeof(StaticMeshVertex));
+
+		WritePadding(file, COOKED_MODEL_DATA_ALIGNMENT);
+		subMesh.indexOffset = file.Position();
+		if (subMesh.indexSize == sizeof(uint16_t))
+		{
+			shortIndices.resize(meshes[i].indices.size());
+			for (size_t j = 0; j < shortIndices.size(); j++)
+				shortIndices[j] = (uint16_t)meshes[i].indices[j];
+			file.Write(shortIndices.data(), shortIndices.size() * sizeof(uint16_t));
+		}
+		else
+			file.Write(meshes[i].indices.data(), meshes[i].indices.size() * sizeof(uint32_t));
+	}
+
+	memcpy(header.id, COOKED_MODEL_ID, sizeof COOKED_MODEL_ID);
+	file.Seek(0);
+	file.Write(&header, sizeof header);
+	file.Write(subMeshes.data(), subMeshes.size() * sizeof(CookedSubMesh));
+	return true;
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
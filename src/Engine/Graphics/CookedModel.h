@@ -0,0 +1,53 @@
+#pragma once
+
+// Binary cooked static model, written next to the source model by GraphicsSystem and used in place from a memory-mapped file.
+// Layout: header, submesh table, string table, then the vertex and index data of each submesh aligned to COOKED_MODEL_DATA_ALIGNMENT.
+
+// File extension of cooked models.
+static const char* const COOKED_MODEL_EXTENSION = ".tmesh";
+// Alignment of vertex and index data in a cooked model.
+static const unsigned COOKED_MODEL_DATA_ALIGNMENT = 16;
+
+// Cooked model header, at the beginning of the file.
+struct CookedModelHeader
+{
+	// File ID "TMSH".
+	char id[4];
+	uint32_t version;
+	// Last modified time of the source model, or 0 if the cooked model is used without checking the source.
+	uint32_t sourceModifiedTime;
+	uint32_t numSubMeshes;
+	// Size of one vertex, the vertex data is an array of StaticMeshVertex.
+	uint32_t vertexSize;
+	// Size of the string table.
+	uint32_t stringsSize;
+	// Offset of the submesh table.
+	uint64_t subMeshesOffset;
+	// Offset of the string table.
+	uint64_t stringsOffset;
+	// Bounding box of the whole model.
+	float aabbMin[3];
+	float aabbMax[3];
+};
+
+// Cooked model submesh table entry.
+struct CookedSubMesh
+{
+	// Offsets of the vertex and index data from the beginning of the file.
+	uint64_t vertexOffset;
+	uint64_t indexOffset;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	// Size of one index, 2 or 4 bytes.
+	uint32_t indexSize;
+	// Position of the mesh name in the string table.
+	uint32_t nameOffset;
+	uint32_t nameLength;
+	// Position of the diffuse texture file name in the string table, relative to the material path of the model. Zero length if none.
+	uint32_t diffuseTextureOffset;
+	uint32_t diffuseTextureLength;
+	uint32_t reserved;
+	// Bounding box of the submesh.
+	float aabbMin[3];
+	float aabbMax[3];
+};
\ No newline at end of file
@@ -1,19 +1,92 @@
 #include "stdafx.h"
 #include "DebugDraw.h"
 #include "RenderAPI/RenderSystem.h"
+#include "EngineApp/EngineTimestamp.h"
 //-----------------------------------------------------------------------------
 namespace {
+	// batches in the order they are uploaded and drawn: depth tested, then on top of the scene
+	enum BatchType
+	{
+		PointsBatch,
+		LinesBatch,
+		OverlayPointsBatch,
+		OverlayLinesBatch,
+		BatchCount
+	};
+
+	struct Vertex
+	{
+		glm::vec3 position;
+		glm::vec3 color;
+	};
+
+	// primitives that stay visible for several frames, one expiry time per primitive
+	struct TimedBatch
+	{
+		std::vector<Vertex> vertices;
+		std::vector<double> expiry;
+	};
+
 	ShaderProgramRef shaderProgram;
 	Uniform uniformProjectionMatrix;
-	Uniform uniformColor;
 	VertexBufferRef vb;
 	VertexArrayRef vao;
-	std::map<unsigned, std::vector<glm::vec3>> Points;
-	std::map<unsigned, std::vector<glm::vec3>> Lines;
+	unsigned vbCapacity = 0;
+	// one-frame primitives keep their capacity between frames, so steady-state frames do not touch the heap
+	std::vector<Vertex> Batches[BatchCount];
+	TimedBatch TimedBatches[BatchCount];
+	bool DepthTest = true;
+	float Duration = 0.0f;
+
+	unsigned verticesPerPrimitive(unsigned batch)
+	{
+		return (batch == LinesBatch || batch == OverlayLinesBatch) ? 2 : 1;
+	}
+
+	void addPrimitive(bool line, const glm::vec3* positions, unsigned rgb)
+	{
+		const unsigned batch = (line ? LinesBatch : PointsBatch) + (DepthTest ? 0 : OverlayPointsBatch);
+		const glm::vec3 color = RGBToVec(rgb);
+		const unsigned count = line ? 2 : 1;
+		if (Duration > 0.0f)
+		{
+			TimedBatch& timed = TimedBatches[batch];
+			for (unsigned i = 0; i < count; i++)
+				timed.vertices.push_back({ positions[i], color });
+			timed.expiry.push_back(EngineTimestamp::GetTime() + Duration);
+		}
+		else
+		{
+			for (unsigned i = 0; i < count; i++)
+				Batches[batch].push_back({ positions[i], color });
+		}
+	}
+
+	// remove the timed primitives that have expired, keeping the order of the others
+	void removeExpired(double time)
+	{
+		for (unsigned batch = 0; batch < BatchCount; batch++)
+		{
+			TimedBatch& timed = TimedBatches[batch];
+			const unsigned primitiveSize = verticesPerPrimitive(batch);
+			size_t kept = 0;
+			for (size_t i = 0; i < timed.expiry.size(); i++)
+			{
+				if (timed.expiry[i] <= time) continue;
+				if (kept != i)
+				{
+					timed.expiry[kept] = timed.expiry[i];
+					for (unsigned j = 0; j < primitiveSize; j++)
+						timed.vertices[kept * primitiveSize + j] = timed.vertices[i * primitiveSize + j];
+				}
+				kept++;
+			}
+			timed.expiry.resize(kept);
+			timed.vertices.resize(kept * primitiveSize);
+		}
+	}
 }
 //-----------------------------------------------------------------------------
-// TODO:  ,     ,     ,       (   ).    .    
-//-----------------------------------------------------------------------------
 void drawGround(float scale)
 { // 10x10
 	// outer
@@ -88,13 +161,13 @@ inline void orthoVec(glm::vec3* left, glm::vec3* up, glm::vec3 v)
 //-----------------------------------------------------------------------------
 void DebugDraw::DrawPoint(const glm::vec3& from, unsigned rgb)
 {
-	Points[rgb].push_back(from);
+	addPrimitive(false, &from, rgb);
 }
 //-----------------------------------------------------------------------------
 void DebugDraw::DrawLine(const glm::vec3& from, const glm::vec3& to, unsigned rgb)
 {
-	Lines[rgb].push_back(from);
-	Lines[rgb].push_back(to);
+	const glm::vec3 positions[2] = { from, to };
+	addPrimitive(true, positions, rgb);
 }
 //-----------------------------------------------------------------------------
 void DebugDraw::DrawLineDashed(glm::vec3 from, glm::vec3 to, unsigned rgb)
@@ -657,65 +730,113 @@ void DebugDraw::DrawFrustum(const glm::mat4& projview, unsigned rgb)
 	DrawBounds(points, rgb);
 }
 //-----------------------------------------------------------------------------
+void DebugDraw::SetDepthTest(bool enable)
+{
+	DepthTest = enable;
+}
+//-----------------------------------------------------------------------------
+void DebugDraw::SetDuration(float seconds)
+{
+	Duration = std::max(seconds, 0.0f);
+}
+//-----------------------------------------------------------------------------
+void DebugDraw::ClearTimed()
+{
+	for (auto& timed : TimedBatches)
+	{
+		timed.vertices.clear();
+		timed.expiry.clear();
+	}
+}
+//-----------------------------------------------------------------------------
 void DebugDraw::Flush(const glm::mat4& ViewProj)
 {
-	if (Points.empty() && Lines.empty()) return;
+	PROFILE_SCOPE("DebugDraw::Flush");
+	removeExpired(EngineTimestamp::GetTime());
+
+	size_t vertexCount = 0;
+	for (unsigned batch = 0; batch < BatchCount; batch++)
+		vertexCount += Batches[batch].size() + TimedBatches[batch].vertices.size();
+	if (!vertexCount || !vao) return;
 
 	auto& renderSystem = GetRenderSystem();
 
+	// all batches go to the buffer in one upload. Mapping with invalidate orphans the storage the GPU may still read, so the upload never waits for the previous frame
+	if (vertexCount > vbCapacity)
+	{
+		vbCapacity = std::max(static_cast<unsigned>(vertexCount), vbCapacity * 2);
+		renderSystem.UpdateBuffer(vb, 0, vbCapacity, (unsigned)sizeof(Vertex), nullptr);
+	}
+	Vertex* vertices = static_cast<Vertex*>(renderSystem.MapBuffer(vb, 0, static_cast<unsigned>(vertexCount * sizeof(Vertex)), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+	if (!vertices)
+	{
+		LogError("DebugDraw: failed to map the vertex buffer");
+		for (auto& batch : Batches)
+			batch.clear();
+		return;
+	}
+
+	unsigned first[BatchCount];
+	unsigned count[BatchCount];
+	unsigned offset = 0;
+	for (unsigned batch = 0; batch < BatchCount; batch++)
+	{
+		const std::vector<Vertex>& frameVertices = Batches[batch];
+		const std::vector<Vertex>& timedVertices = TimedBatches[batch].vertices;
+		if (!frameVertices.empty())
+			memcpy(vertices + offset, frameVertices.data(), frameVertices.size() * sizeof(Vertex));
+		if (!timedVertices.empty())
+			memcpy(vertices + offset + frameVertices.size(), timedVertices.data(), timedVertices.size() * sizeof(Vertex));
+
+		first[batch] = offset;
+		count[batch] = static_cast<unsigned>(frameVertices.size() + timedVertices.size());
+		offset += count[batch];
+	}
+	renderSystem.UnmapBuffer(vb);
+
 	renderSystem.Bind(shaderProgram);
 	renderSystem.SetUniform(uniformProjectionMatrix, ViewProj);
-	
-	//glEnable(GL_DEPTH_TEST);
-	//glDepthFunc(GL_LEQUAL);
+
 	//glEnable(GL_PROGRAM_POINT_SIZE); // for GL_POINTS
 	//glEnable(GL_LINE_SMOOTH); // for GL_LINES (thin)
 
-	// Draw Points
+	// one draw per primitive type and pass. A pass binds its depth state only when it has vertices, the state of the caller is restored afterwards
+	const DepthState previousDepthState = renderSystem.GetCurrentDepthState();
+	const DepthState depthState = { .compareFunction = ComparisonFunction::Less, .enable = true, .depthWrite = true };
+	const DepthState overlayDepthState = { .enable = false, .depthWrite = false };
+	int boundPass = -1;
+	for (unsigned batch = 0; batch < BatchCount; batch++)
 	{
-		//glPointSize(6);
-		for (auto& it : Points)
+		if (!count[batch]) continue;
+		const int pass = batch < OverlayPointsBatch ? 0 : 1;
+		if (pass != boundPass)
 		{
-			renderSystem.SetUniform(uniformColor, RGBToVec(it.first));
-			const size_t count = it.second.size();
-
-			renderSystem.UpdateBuffer(vb, 0, (unsigned)count, (unsigned)sizeof(glm::vec3), it.second.data());
-			renderSystem.Draw(vao, PrimitiveTopology::Points);
+			renderSystem.Bind(pass == 0 ? depthState : overlayDepthState);
+			boundPass = pass;
 		}
-		//glPointSize(1);
+		const PrimitiveTopology primitive = verticesPerPrimitive(batch) == 2 ? PrimitiveTopology::Lines : PrimitiveTopology::Points;
+		renderSystem.DrawRange(vao, first[batch], count[batch], primitive);
 	}
+	renderSystem.Bind(previousDepthState);
 
-	// Draw Lines
-	{
-		for (auto& it : Lines)
-		{
-			renderSystem.SetUniform(uniformColor, RGBToVec(it.first));
-			const size_t count = it.second.size();
-			renderSystem.UpdateBuffer(vb, 0, (unsigned)count, (unsigned)sizeof(glm::vec3), it.second.data());
-			renderSystem.Draw(vao, PrimitiveTopology::Lines);
-		}
-	}
-
-	//glEnable(GL_DEPTH_TEST);
-	//glDepthFunc(GL_LESS);
 	//glDisable(GL_LINE_SMOOTH);
 	//glDisable(GL_PROGRAM_POINT_SIZE);
 
-	Points.clear(); // TODO:    -    
-	Lines.clear(); // TODO:    -    
+	for (auto& batch : Batches)
+		batch.clear();
 }
 //-----------------------------------------------------------------------------
 bool DebugDraw::Init()
 {
 	const std::string vertexSource = R"(
 layout(location = 0) in vec3 aPosition;
+layout(location = 1) in vec3 aColor;
 uniform mat4 uMVP;
-uniform vec3 uColor;
 out vec3 fColor;
 void main()
 {
 	gl_Position =  uMVP * vec4(aPosition, 1);
-	fColor = uColor;
+	fColor = aColor;
 }
 )";
 
@@ -730,10 +851,15 @@ void main()
 	auto& renderSystem = GetRenderSystem();
 	shaderProgram = renderSystem.CreateShaderProgram({ vertexSource.c_str() }, { fragmentSource.c_str() });
 	uniformProjectionMatrix = renderSystem.GetUniform(shaderProgram, "uMVP");
-	uniformColor = renderSystem.GetUniform(shaderProgram, "uColor");
 
-	vb = renderSystem.CreateVertexBuffer(BufferUsage::DynamicDraw, 1, (unsigned)sizeof(glm::vec3), nullptr);
-	vao = renderSystem.CreateVertexArray(vb, nullptr, shaderProgram);
+	const VertexAttribute attribs[] =
+	{
+		{ .location = 0, .size = 3, .normalized = false, .stride = sizeof(Vertex), .offset = (void*)offsetof(Vertex, position) },
+		{ .location = 1, .size = 3, .normalized = false, .stride = sizeof(Vertex), .offset = (void*)offsetof(Vertex, color) },
+	};
+	vbCapacity = 1024;
+	vb = renderSystem.CreateVertexBuffer(BufferUsage::StreamDraw, vbCapacity, (unsigned)sizeof(Vertex), nullptr);
+	vao = renderSystem.CreateVertexArray(vb, nullptr, attribs);
 
 	return true;
 }
@@ -743,8 +869,13 @@ void DebugDraw::Close()
 	shaderProgram.reset();
 	vb.reset();
 	vao.reset();
-	Points.clear();
-	Lines.clear();
+	vbCapacity = 0;
+	for (auto& batch : Batches)
+		batch = {};
+	for (auto& timed : TimedBatches)
+		timed = {};
+	DepthTest = true;
+	Duration = 0.0f;
 }
 //-----------------------------------------------------------------------------
 void DebugDraw::DrawDemo()
@@ -47,6 +47,13 @@ namespace DebugDraw
 
 	void DrawFrustum(const glm::mat4& projview, unsigned rgb);
 
+	// primitives drawn after this call are depth tested against the scene (default) or drawn on top of it
+	void SetDepthTest(bool enable);
+	// primitives drawn after this call stay visible for the given number of seconds, 0 for one frame (default)
+	void SetDuration(float seconds);
+	void ClearTimed();
+
+	// upload all primitives in one buffer update and draw them with one draw per primitive type and pass
 	void Flush(const glm::mat4& ViewProj);
 
 	bool Init();
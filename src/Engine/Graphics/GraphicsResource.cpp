@@ -1,7 +1,10 @@
 ﻿#include "stdafx.h"
 #include "GraphicsResource.h"
 #include "GraphicsSystem.h"
+#include "CookedModel.h"
+#include "MeshOptimizer.h"
 #include "RenderAPI/RenderSystem.h"
+#include "Core/IO/FileSystem.h"
 //-----------------------------------------------------------------------------
 namespace std
 {
@@ -10,11 +13,28 @@ namespace std
 	{
 		size_t operator()(const StaticMeshVertex& vertex) const
 		{
-			return ((hash<glm::vec3>()(vertex.positions) ^ (hash<glm::vec2>()(vertex.texCoords) << 1)) >> 1);
+			// hash every attribute compared by operator==, otherwise vertices differing only in normal or color always collide
+			size_t seed = hash<glm::vec3>()(vertex.positions);
+			combine(seed, hash<glm::vec3>()(vertex.normals));
+			combine(seed, hash<glm::vec3>()(vertex.colors));
+			combine(seed, hash<glm::vec2>()(vertex.texCoords));
+			return seed;
+		}
+
+	private:
+		static void combine(size_t& seed, size_t value)
+		{
+			seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
 		}
 	};
 } // namespace std
 //-----------------------------------------------------------------------------
+// Last modified time of a model source file, or 0 if it does not exist. Taken from the path tinyobj reads, so that the cooked model is checked against the file it was cooked from.
+static unsigned modelSourceModifiedTime(const std::string& fileName)
+{
+	return FileSystem::Exists(fileName) ? FileSystem::LastModifiedTime(fileName) : 0;
+}
+//-----------------------------------------------------------------------------
 RenderTargetRef GraphicsSystem::CreateRenderTarget(uint16_t width, uint16_t height)
 {
 	auto& renderSystem = GetRenderSystem();
@@ -40,13 +60,60 @@ RenderTargetRef GraphicsSystem::CreateRenderTarget(uint16_t width, uint16_t heig
 	return std::move(rt);
 }
 //-----------------------------------------------------------------------------
-StaticModelRef GraphicsSystem::CreateModel(const char* fileName, const char* pathMaterialFiles)
+StaticModelRef GraphicsSystem::CreateModel(const char* fileName, const char* pathMaterialFiles, bool keepMeshData)
 {
-	// TODO: переделать сделав нормальное получение расшиерия
-	if (std::string(fileName).find(".obj") != std::string::npos)
-		return loadObjFile(fileName, pathMaterialFiles);
+	const std::string extension = FileSystem::Extension(fileName, true);
+	if (extension == COOKED_MODEL_EXTENSION)
+		return loadCookedModel(fileName, pathMaterialFiles, 0, keepMeshData);
+	if (extension != ".obj")
+		return {};
+
+	// use the cooked model while it was cooked from the current source, a cooked model shipped without the source is always used
+	const std::string cookedFileName = FileSystem::PathAndFileName(fileName) + COOKED_MODEL_EXTENSION;
+	const unsigned sourceModifiedTime = modelSourceModifiedTime(fileName);
+	if (FileSystem::Exists(cookedFileName))
+	{
+		if (StaticModelRef model = loadCookedModel(cookedFileName, pathMaterialFiles, sourceModifiedTime, keepMeshData))
+			return model;
+	}
 
-	return {};
+	std::vector<StaticMesh> meshes;
+	std::vector<std::string> diffuseTextures;
+	if (!loadObjFile(fileName, pathMaterialFiles, meshes, diffuseTextures))
+		return {};
+
+	if (writeCookedModel(cookedFileName, meshes, diffuseTextures, sourceModifiedTime))
+		LogPrint("Cooked model " + cookedFileName);
+
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		if (diffuseTextures[i].empty()) continue;
+
+		std::string diffuseMap = pathMaterialFiles + diffuseTextures[i];
+		meshes[i].material.diffuseTexture = GetRenderSystem().CreateTexture2D(diffuseMap.c_str(), true);
+	}
+
+	StaticModelRef model = createMeshBuffer(std::move(meshes));
+	// release the CPU copy so that the result matches a model loaded from the cooked file
+	if (!keepMeshData)
+	{
+		for (size_t i = 0; i < model->subMeshes.size(); i++)
+		{
+			model->subMeshes[i].vertices = std::vector<StaticMeshVertex>();
+			model->subMeshes[i].indices = std::vector<uint32_t>();
+		}
+	}
+	return model;
+}
+//-----------------------------------------------------------------------------
+bool GraphicsSystem::CookModel(const char* fileName, const char* cookedFileName, const char* pathMaterialFiles)
+{
+	std::vector<StaticMesh> meshes;
+	std::vector<std::string> diffuseTextures;
+	if (!loadObjFile(fileName, pathMaterialFiles, meshes, diffuseTextures))
+		return false;
+
+	return writeCookedModel(cookedFileName, meshes, diffuseTextures, modelSourceModifiedTime(fileName));
 }
 //-----------------------------------------------------------------------------
 StaticModelRef GraphicsSystem::CreateModel(std::vector<StaticMesh>&& meshes)
@@ -72,6 +139,35 @@ void GraphicsSystem::Draw(StaticModelRef model)
 	}
 }
 //-----------------------------------------------------------------------------
+void GraphicsSystem::DrawInstanced(StaticModelRef model, std::span<const glm::mat4> transforms)
+{
+	if (!model || transforms.empty()) return;
+
+	auto& renderSystem = GetRenderSystem();
+	if (!model->instanceBuffer)
+	{
+		model->instanceBuffer = renderSystem.CreateVertexBuffer(BufferUsage::StreamDraw);
+		if (!renderSystem.IsValid(model->instanceBuffer)) return;
+	}
+	renderSystem.UpdateBuffer(model->instanceBuffer, 0, (unsigned)transforms.size(), sizeof(glm::mat4), transforms.data());
+
+	for (size_t i = 0; i < model->subMeshes.size(); i++)
+	{
+		StaticMesh& subMesh = model->subMeshes[i];
+		if (!renderSystem.IsValid(subMesh.geometry)) continue;
+
+		// same vertex and index buffers as the geometry, plus the instance buffer
+		if (!subMesh.instancedVao)
+		{
+			subMesh.instancedVao = renderSystem.CreateVertexArray(subMesh.geometry->GetVBO(), subMesh.geometry->GetIBO(), staticMeshVertexFormat(), model->instanceBuffer, staticMeshInstanceFormat());
+			if (!renderSystem.IsValid(subMesh.instancedVao)) continue;
+		}
+
+		renderSystem.Bind(subMesh.material.diffuseTexture, 0);
+		renderSystem.DrawInstanced(subMesh.instancedVao, (unsigned)transforms.size(), PrimitiveTopology::Triangles);
+	}
+}
+//-----------------------------------------------------------------------------
 std::vector<glm::vec3> GraphicsSystem::GetVertexInMesh(const StaticMesh& mesh) const
 {
 	std::vector<glm::vec3> v;
@@ -84,12 +180,18 @@ std::vector<glm::vec3> GraphicsSystem::GetVertexInMesh(const StaticMesh& mesh) c
 //-----------------------------------------------------------------------------
 std::vector<glm::vec3> GraphicsSystem::GetVertexInModel(StaticModelRef model) const
 {
+	size_t indexCount = 0;
+	for (size_t i = 0; i < model->subMeshes.size(); i++)
+		indexCount += model->subMeshes[i].indices.size();
+
+	// append straight into the result instead of building a temporary per submesh
 	std::vector<glm::vec3> v;
+	v.reserve(indexCount);
 	for (size_t i = 0; i < model->subMeshes.size(); i++)
 	{
-		auto subV = GetVertexInMesh(model->subMeshes[i]);
-		// https://www.techiedelight.com/ru/concatenate-two-vectors-cpp/
-		std::move(subV.begin(), subV.end(), std::back_inserter(v));
+		const StaticMesh& mesh = model->subMeshes[i];
+		for (size_t j = 0; j < mesh.indices.size(); j++)
+			v.push_back(mesh.vertices[mesh.indices[j]].positions);
 	}
 	return v;
 }
@@ -106,45 +208,79 @@ TrianglesInfo GraphicsSystem::GetTrianglesInMesh(const StaticMesh& mesh) const
 //-----------------------------------------------------------------------------
 TrianglesInfo GraphicsSystem::GetTrianglesInModel(StaticModelRef model) const
 {
-	TrianglesInfo info;
-	unsigned prevIndex = 0;
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
 	for (size_t i = 0; i < model->subMeshes.size(); i++)
 	{
-		TrianglesInfo infoSubMesh = GetTrianglesInMesh(model->subMeshes[i]);
-
-		info.vertices.insert(info.vertices.end(), infoSubMesh.vertices.begin(), infoSubMesh.vertices.end());
-
-		for (size_t j = 0; j < infoSubMesh.indexes.size(); j++)
-			info.indexes.push_back(infoSubMesh.indexes[j] + prevIndex);
+		vertexCount += model->subMeshes[i].vertices.size();
+		indexCount += model->subMeshes[i].indices.size();
+	}
 
-		prevIndex += infoSubMesh.indexes.size();
+	// append straight into the result instead of building a temporary TrianglesInfo per submesh
+	TrianglesInfo info;
+	info.vertices.reserve(vertexCount);
+	info.indexes.reserve(indexCount);
+	unsigned baseVertex = 0;
+	for (size_t i = 0; i < model->subMeshes.size(); i++)
+	{
+		const StaticMesh& mesh = model->subMeshes[i];
+		for (size_t j = 0; j < mesh.vertices.size(); j++)
+			info.vertices.push_back(mesh.vertices[j].positions);
+		for (size_t j = 0; j < mesh.indices.size(); j++)
+			info.indexes.push_back(mesh.indices[j] + baseVertex);
+
+		// indices of the next submesh are relative to its own first vertex
+		baseVertex += static_cast<unsigned>(mesh.vertices.size());
 	}
 
 	return info;
 }
 //-----------------------------------------------------------------------------
-StaticModelRef GraphicsSystem::createMeshBuffer(std::vector<StaticMesh>&& meshes)
+const std::vector<VertexAttribute>& GraphicsSystem::staticMeshVertexFormat()
 {
-	const std::vector<VertexAttribute> formatVertex =
+	static const std::vector<VertexAttribute> formatVertex =
 	{
 		{.location = 0, .size = 3, .normalized = false, .stride = sizeof(StaticMeshVertex), .offset = (void*)offsetof(StaticMeshVertex, positions)},
 		{.location = 1, .size = 3, .normalized = false, .stride = sizeof(StaticMeshVertex), .offset = (void*)offsetof(StaticMeshVertex, normals)},
 		{.location = 2, .size = 3, .normalized = false, .stride = sizeof(StaticMeshVertex), .offset = (void*)offsetof(StaticMeshVertex, colors)},
 		{.location = 3, .size = 2, .normalized = false, .stride = sizeof(StaticMeshVertex), .offset = (void*)offsetof(StaticMeshVertex, texCoords)}
 	};
-
+	return formatVertex;
+}
+//-----------------------------------------------------------------------------
+const std::vector<VertexAttribute>& GraphicsSystem::staticMeshInstanceFormat()
+{
+	// a mat4 attribute takes one location per column
+	static const std::vector<VertexAttribute> formatInstance =
+	{
+		{.location = StaticMeshInstanceLocation + 0, .size = 4, .normalized = false, .stride = sizeof(glm::mat4), .offset = (void*)(0 * sizeof(glm::vec4)), .divisor = 1},
+		{.location = StaticMeshInstanceLocation + 1, .size = 4, .normalized = false, .stride = sizeof(glm::mat4), .offset = (void*)(1 * sizeof(glm::vec4)), .divisor = 1},
+		{.location = StaticMeshInstanceLocation + 2, .size = 4, .normalized = false, .stride = sizeof(glm::mat4), .offset = (void*)(2 * sizeof(glm::vec4)), .divisor = 1},
+		{.location = StaticMeshInstanceLocation + 3, .size = 4, .normalized = false, .stride = sizeof(glm::mat4), .offset = (void*)(3 * sizeof(glm::vec4)), .divisor = 1}
+	};
+	return formatInstance;
+}
+//-----------------------------------------------------------------------------
+StaticModelRef GraphicsSystem::createMeshBuffer(std::vector<StaticMesh>&& meshes)
+{
 	StaticModelRef model(new StaticModel());
 	model->subMeshes = std::move(meshes);
 	model->aabb.min = model->subMeshes[0].globalAABB.min;
 	model->aabb.max = model->subMeshes[0].globalAABB.max;
 
+	std::vector<uint16_t> shortIndices;
 	for (size_t i = 0; i < model->subMeshes.size(); i++)
 	{
+		// upload 16-bit indices when they can address every vertex
+		const IndexFormat indexFormat = SelectIndexFormat(model->subMeshes[i].vertices.size());
+		if (indexFormat == IndexFormat::UInt16)
+			ConvertIndices16(shortIndices, model->subMeshes[i].indices);
+
 		model->subMeshes[i].geometry = GetRenderSystem().CreateGeometryBuffer(
 			BufferUsage::StaticDraw,
 			(unsigned)model->subMeshes[i].vertices.size(), sizeof(model->subMeshes[i].vertices[0]), model->subMeshes[i].vertices.data(),
-			(unsigned)model->subMeshes[i].indices.size(), IndexFormat::UInt32, model->subMeshes[i].indices.data(), 
-			formatVertex);
+			(unsigned)model->subMeshes[i].indices.size(), indexFormat, indexFormat == IndexFormat::UInt16 ? (const void*)shortIndices.data() : model->subMeshes[i].indices.data(),
+			staticMeshVertexFormat());
 
 		// compute AABB
 		{
@@ -154,7 +290,7 @@ StaticModelRef GraphicsSystem::createMeshBuffer(std::vector<StaticMesh>&& meshes
 	return model;
 }
 //-----------------------------------------------------------------------------
-StaticModelRef GraphicsSystem::loadObjFile(const char* fileName, const char* pathMaterialFiles)
+bool GraphicsSystem::loadObjFile(const char* fileName, const char* pathMaterialFiles, std::vector<StaticMesh>& meshes, std::vector<std::string>& diffuseTextures)
 {
 	tinyobj::ObjReaderConfig readerConfig;
 	readerConfig.mtl_search_path = pathMaterialFiles; // Path to material files
@@ -164,7 +300,7 @@ StaticModelRef GraphicsSystem::loadObjFile(const char* fileName, const char* pat
 	{
 		if (!reader.Error().empty())
 			LogError("TinyObjReader: " + reader.Error());
-		return {};
+		return false;
 	}
 	if (!reader.Warning().empty())
 		LogWarning("TinyObjReader: " + reader.Warning());
@@ -173,8 +309,15 @@ StaticModelRef GraphicsSystem::loadObjFile(const char* fileName, const char* pat
 	auto& shapes = reader.GetShapes();
 	auto& materials = reader.GetMaterials();
 	const bool isFindMaterials = !materials.empty();
+	if (shapes.empty())
+	{
+		LogError("TinyObjReader: no shapes in " + std::string(fileName));
+		return false;
+	}
 
-	std::vector<StaticMesh> meshes(shapes.size());
+	meshes.clear();
+	meshes.resize(shapes.size());
+	diffuseTextures.assign(shapes.size(), std::string());
 	std::vector<int> materialIds(shapes.size());
 
 	// Loop over shapes
@@ -183,6 +326,8 @@ StaticModelRef GraphicsSystem::loadObjFile(const char* fileName, const char* pat
 		meshes[shapeId].meshName = shapes[shapeId].name;
 
 		std::unordered_map<StaticMeshVertex, uint32_t> uniqueVertices;
+		uniqueVertices.reserve(shapes[shapeId].mesh.indices.size());
+		meshes[shapeId].indices.reserve(shapes[shapeId].mesh.indices.size());
 
 		// Loop over faces(polygon)
 		size_t index_offset = 0;
@@ -237,37 +382,35 @@ StaticModelRef GraphicsSystem::loadObjFile(const char* fileName, const char* pat
 					.texCoords = { tx,ty }
 				};
 
-				if (uniqueVertices.count(vertex) == 0)
-				{
-					uniqueVertices[vertex] = static_cast<uint32_t>(meshes[shapeId].vertices.size());
+				// single lookup, the vertex is added if it was not seen before
+				const auto it = uniqueVertices.try_emplace(vertex, static_cast<uint32_t>(meshes[shapeId].vertices.size()));
+				if (it.second)
 					meshes[shapeId].vertices.emplace_back(vertex);
-				}
 
-				meshes[shapeId].indices.emplace_back(uniqueVertices[vertex]);
+				meshes[shapeId].indices.emplace_back(it.first->second);
 			}
 			index_offset += fv;
 		}
 	}
 
-	// load materials
+	// reorder for the vertex cache and overdraw before the meshes are cooked and uploaded
+	for (size_t i = 0; i < meshes.size(); i++)
+		LogMeshOptimization(meshes[i].meshName, OptimizeMesh(meshes[i]));
+
+	// material textures, loaded by the caller relative to pathMaterialFiles
 	if (isFindMaterials)
 	{
 		for (size_t i = 0; i < shapes.size(); i++)
 		{
 			const size_t matId = static_cast<size_t>(materialIds[i]);
-
-
-			if (materials[matId].diffuse_texname.empty()) continue;
-
-			std::string diffuseMap = pathMaterialFiles + materials[matId].diffuse_texname;
-			meshes[i].material.diffuseTexture = GetRenderSystem().CreateTexture2D(diffuseMap.c_str(), true);
+			diffuseTextures[i] = materials[matId].diffuse_texname;
 		}
 	}
 
 	// compute AABB
 	computeSubMeshesAABB(meshes);
 
-	return createMeshBuffer(std::move(meshes));
+	return true;
 }
 //-----------------------------------------------------------------------------
 void GraphicsSystem::computeSubMeshesAABB(std::vector<StaticMesh>& meshes)
@@ -3,6 +3,11 @@
 #include "RenderAPI/RenderResource.h"
 #include "Core/Geometry/BoundingAABB.h"
 
+struct SkinnedMeshData;
+struct SkinningPalette;
+class AnimationClip;
+class AnimationCursor;
+
 class RenderTarget final
 {
 public:
@@ -56,6 +61,9 @@ public:
 	float shininess = 1.0f;
 };
 
+// First attribute location of the per-instance mat4 transform used by GraphicsSystem::DrawInstanced(), occupies locations 4-7.
+constexpr unsigned StaticMeshInstanceLocation = 4;
+
 class StaticMeshVertex final
 {
 public:
@@ -93,6 +101,8 @@ public:
 	std::string meshName;
 
 	GeometryBufferRef geometry;
+	// geometry with the instance transforms of the model, created by the first GraphicsSystem::DrawInstanced()
+	VertexArrayRef instancedVao;
 
 	// global bouncing box
 	BoundingAABB globalAABB;
@@ -111,6 +121,8 @@ public:
 	std::vector<StaticMesh> subMeshes;
 	// bouncing box
 	BoundingAABB aabb;
+	// instance transforms of the last GraphicsSystem::DrawInstanced(), shared by all submeshes
+	VertexBufferRef instanceBuffer;
 };
 using StaticModelRef = std::shared_ptr<StaticModel>;
 
@@ -131,6 +143,24 @@ public:
 	glm::vec2 texCoords2; // Vertex texture second coordinates (UV - 2 components per vertex) (shader-location = 5)
 };
 
+// Vertex of a GPU skinned mesh: the NewMeshVertex attributes followed by the bone influences
+class SkinnedMeshVertex final
+{
+public:
+	[[nodiscard]] static const std::vector<VertexAttribute> GetAttribs();
+
+	NewMeshVertex vertex;
+	uint8_t boneIds[4];   // Bone indices into the palette (uvec4, shader-location = 6)
+	glm::vec4 boneWeights; // Bone weights (shader-location = 7)
+};
+
+// Where the bone transforms of an animated model are applied
+enum class SkinningMode : uint8_t
+{
+	CPU, // UpdateModelAnimation() skins the vertices and rewrites the vertex buffers
+	GPU  // UpdateModelAnimation() updates the bone palette, BindModelSkinning() pushes it to the frame uniform ring, the vertex shader skins (see GetSkinningShaderSource())
+};
+
 // TODO: возможно переименовать в baseMesh и убрать staticmesh
 class NewMesh final
 {
@@ -154,6 +184,7 @@ public:
 	float* animNormals;     // Animated normals (after bones transformations)
 	unsigned char* boneIds; // Vertex bone ids, max 255 bone ids, up to 4 bones influence by vertex (skinning)
 	float* boneWeights;     // Vertex bone weight, up to 4 bones influence by vertex (skinning)
+	std::shared_ptr<SkinnedMeshData> skin; // Bind pose and bone data in SoA form, created by UploadMesh for meshes with bones
 
 	GeometryBufferRef geometry;
 };
@@ -201,13 +232,17 @@ public:
 	int boneCount = 0;          // Number of bones
 	NewBoneInfo* bones = nullptr;        // Bones information (skeleton)
 	TempTransform* bindPose = nullptr;    // Bones base transformation (pose)
+	SkinningMode skinning = SkinningMode::CPU;
+	std::shared_ptr<SkinningPalette> bonePalette; // Bone matrix rows of the current pose sized by GetSkinningPaletteBones(boneCount), see CreateSkinningPalette() (GPU skinning)
 };
 
 struct ModelAnimation {
 	int boneCount;          // Number of bones
 	int frameCount;         // Number of animation frames
 	NewBoneInfo* bones;        // Bones information (skeleton)
-	TempTransform** framePoses; // Poses array by frame
+	TempTransform** framePoses; // Poses array by frame, null when clip is set
+	AnimationClip* clip;    // Compressed keyframes sampled at any time (glTF)
+	AnimationCursor* cursor; // Playback position in clip of the frame-based UpdateModelAnimation(), null when clip is null
 	char name[32];          // Animation name
 };
 
@@ -231,10 +266,15 @@ enum MaterialMapIndex {
 #define MAX_MATERIAL_MAPS              12       // Maximum number of shader maps supported
 
 // TEMP Func
-NewModel LoadModel(const std::string& fileName);
+NewModel LoadModel(const std::string& fileName, SkinningMode skinning = SkinningMode::CPU);
 NewModel LoadModelFromMesh(NewMesh mesh);
 ModelAnimation* LoadModelAnimations(const std::string& fileName, unsigned int& animCount);// Load model animations from file
-void UpdateModelAnimation(const NewModel& model, const ModelAnimation& anim, int frame); // Update model animation pose
+void UpdateModelAnimation(const NewModel& model, const ModelAnimation& anim, int frame); // Update model animation pose, a clip is sampled with the cursor of the animation
+void UpdateModelAnimation(const NewModel& model, const ModelAnimation& anim, AnimationCursor& cursor, float time); // Update model animation pose at a time in seconds, the cursor keeps the keyframe positions between calls (animations with a clip only)
+void UnloadModelAnimations(ModelAnimation* animations, unsigned int animCount); // Unload animation array data
+bool BindModelSkinning(const NewModel& model); // Bind the bone palette of a GPU skinned model before each draw of its meshes, pushed to the frame uniform ring once per frame. False if the ring is full
+void UpdateModelPose(const NewModel& model, const TempTransform* pose, int boneCount); // Skin a model with a model space pose, e.g. PoseGraphInstance::GetModelPose()
+void BuildPoseFromParentJoints(const NewBoneInfo* bones, int boneCount, TempTransform* transforms); // Convert local bone transforms to model space, parents before children
 
 struct tempVec3
 {
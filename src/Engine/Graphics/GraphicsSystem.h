@@ -19,8 +19,11 @@ public:
 
 	RenderTargetRef CreateRenderTarget(uint16_t width, uint16_t height);
 
-	StaticModelRef CreateModel(const char* fileName, const char* pathMaterialFiles = "./");
+	// Load a .obj model through its cooked binary model, which is written next to the source when missing or out of date, or a cooked .tmesh model directly. Submesh vertices and indices stay in memory for the mesh queries unless keepMeshData is cleared.
+	StaticModelRef CreateModel(const char* fileName, const char* pathMaterialFiles = "./", bool keepMeshData = true);
 	StaticModelRef CreateModel(std::vector<StaticMesh>&& meshes);
+	// Cook a .obj model offline into a binary model. Return true on success.
+	bool CookModel(const char* fileName, const char* cookedFileName, const char* pathMaterialFiles = "./");
 
 	void ResizeRenderTarget(RenderTargetRef rt, uint16_t width, uint16_t height);
 
@@ -29,6 +32,9 @@ public:
 
 	void Draw(StaticMesh& subMesh);
 	void Draw(StaticModelRef model);
+	// Draw the model once per transform with one instanced draw call per submesh. The shader reads the transform as a mat4 attribute at StaticMeshInstanceLocation.
+	void DrawInstanced(StaticModelRef model, std::span<const glm::mat4> transforms);
+	// The mesh queries need the vertices and indices, which a model created without keepMeshData does not keep.
 	std::vector<glm::vec3> GetVertexInMesh(const StaticMesh& mesh) const;
 	std::vector<glm::vec3> GetVertexInModel(StaticModelRef model) const;
 
@@ -42,8 +48,12 @@ private:
 	GraphicsSystem& operator=(const GraphicsSystem&) = delete;
 
 	StaticModelRef createMeshBuffer(std::vector<StaticMesh>&& meshes);
-	StaticModelRef loadObjFile(const char* fileName, const char* pathMaterialFiles = "./");
+	bool loadObjFile(const char* fileName, const char* pathMaterialFiles, std::vector<StaticMesh>& meshes, std::vector<std::string>& diffuseTextures);
+	StaticModelRef loadCookedModel(const std::string& fileName, const char* pathMaterialFiles, unsigned sourceModifiedTime, bool keepMeshData);
+	bool writeCookedModel(const std::string& fileName, const std::vector<StaticMesh>& meshes, const std::vector<std::string>& diffuseTextures, unsigned sourceModifiedTime);
 	void computeSubMeshesAABB(std::vector<StaticMesh>& meshes);
+	static const std::vector<VertexAttribute>& staticMeshVertexFormat();
+	static const std::vector<VertexAttribute>& staticMeshInstanceFormat();
 };
 
 GraphicsSystem& GetGraphicsSystem();
\ No newline at end of file
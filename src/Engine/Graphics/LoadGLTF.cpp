@@ -1,22 +1,20 @@
 #include "stdafx.h"
 #include "GraphicsResource.h"
 #include "GraphicsSystem.h"
+#include "AnimationClip.h"
 #include "Core/IO/FileSystem.h"
 #include "Core/IO/Image.h"
+#include "Core/IO/MemoryMappedStream.h"
 #include "RenderAPI/RenderSystem.h"
 #include <cgltf.h>
 //-----------------------------------------------------------------------------
 NewMaterial LoadMaterialDefault();
 const char* strprbrk(const char* s, const char* charset);
-unsigned char* LoadFileData(const char* fileName, int* dataSize);
 const char* GetDirectoryPath(const char* filePath);
-tempVec3 Vector3Lerp(glm::vec3 v1, glm::vec3 v2, float amount);
-tempVec4 QuaternionNlerp(glm::vec4 q1, glm::vec4 q2, float amount);
-tempVec4 QuaternionSlerp(glm::vec4 q1, glm::vec4 q2, float amount);
 //-----------------------------------------------------------------------------
 // Build pose from parent joints
 // NOTE: Required for animations loading (required by IQM and GLTF)
-void BuildPoseFromParentJoints(NewBoneInfo* bones, int boneCount, TempTransform* transforms)
+void BuildPoseFromParentJoints(const NewBoneInfo* bones, int boneCount, TempTransform* transforms)
 {
 	for (int i = 0; i < boneCount; i++)
 	{
@@ -110,15 +108,22 @@ ImageRef LoadImageFromCgltfImage(cgltf_image* cgltfImage, const char* texPath)
 	}
 	else if (cgltfImage->buffer_view->buffer->data != NULL)    // Check if image is provided as data buffer
 	{
-		unsigned char* data = (unsigned char*)malloc(cgltfImage->buffer_view->size);
+		unsigned char* data = NULL;
+		unsigned char* copiedData = NULL;
 		int offset = (int)cgltfImage->buffer_view->offset;
 		int stride = (int)cgltfImage->buffer_view->stride ? (int)cgltfImage->buffer_view->stride : 1;
 
-		// Copy buffer data to memory for loading
-		for (unsigned int i = 0; i < cgltfImage->buffer_view->size; i++)
+		// Tightly packed image data is decoded in place, for a .glb file straight from the mapped file
+		if (stride == 1) data = (unsigned char*)cgltfImage->buffer_view->buffer->data + offset;
+		else
 		{
-			data[i] = ((unsigned char*)cgltfImage->buffer_view->buffer->data)[offset];
-			offset += stride;
+			// Copy buffer data to memory for loading
+			data = copiedData = (unsigned char*)malloc(cgltfImage->buffer_view->size);
+			for (unsigned int i = 0; i < cgltfImage->buffer_view->size; i++)
+			{
+				data[i] = ((unsigned char*)cgltfImage->buffer_view->buffer->data)[offset];
+				offset += stride;
+			}
 		}
 
 		// Check mime_type for image: (cgltfImage->mime_type == "image/png")
@@ -129,7 +134,7 @@ ImageRef LoadImageFromCgltfImage(cgltf_image* cgltfImage, const char* texPath)
 			(strcmp(cgltfImage->mime_type, "image/jpeg") == 0)) image->LoadFromMemory(data, (int)cgltfImage->buffer_view->size);
 		else LogWarning("MODEL: glTF image data MIME type not recognized" + std::string(texPath) + "/" + std::string(cgltfImage->uri));
 
-		free(data);
+		free(copiedData);
 	}
 
 	return image;
@@ -179,15 +184,18 @@ NewModel LoadGLTF(const std::string& fileName)
 
 	NewModel model = { };
 
-	// glTF file loading
-	int dataSize = 0;
-	unsigned char* fileData = LoadFileData(fileName.c_str(), &dataSize);
-	if (fileData == NULL) return model;
+	// glTF file loading, parsed straight from the mapped file
+	MemoryMappedStream fileData(fileName);
+	if (!fileData.IsOpen())
+	{
+		LogWarning("FILEIO: [" + fileName + "] Failed to open file");
+		return model;
+	}
 
 	// glTF data loading
 	cgltf_options options = {};
 	cgltf_data* data = NULL;
-	cgltf_result result = cgltf_parse(&options, fileData, dataSize, &data);
+	cgltf_result result = cgltf_parse(&options, fileData.Data(), fileData.Size(), &data);
 
 
 	if (result == cgltf_result_success)
@@ -606,81 +614,38 @@ NewModel LoadGLTF(const std::string& fileName)
 	}
 	else LogWarning("MODEL: [" + std::string(fileName) + "] Failed to load glTF data");
 
-	// WARNING: cgltf requires the file pointer available while reading data
-	free(fileData);
-
+	// WARNING: cgltf requires the file data available while reading data, the mapping is released when fileData goes out of scope
 	return model;
 }
 //-----------------------------------------------------------------------------
-// Get interpolated pose for bone sampler at a specific time. Returns true on success.
-bool GetPoseAtTimeGLTF(cgltf_accessor* input, cgltf_accessor* output, float time, void* data)
+// Read all keys of an animation channel with one accessor pass. Returns true on success.
+bool ReadChannelGLTF(const cgltf_animation_channel* channel, unsigned components, std::vector<float>& times, std::vector<float>& values)
 {
-	// Input and output should have the same count
-	float tstart = 0.0f;
-	float tend = 0.0f;
-	int keyframe = 0;       // Defaults to first pose
-
-	for (int i = 0; i < (int)input->count - 1; i++)
-	{
-		cgltf_bool r1 = cgltf_accessor_read_float(input, i, &tstart, 1);
-		if (!r1) return false;
-
-		cgltf_bool r2 = cgltf_accessor_read_float(input, i + 1, &tend, 1);
-		if (!r2) return false;
-
-		if ((tstart <= time) && (time < tend))
-		{
-			keyframe = i;
-			break;
-		}
-	}
-
-	float t = (time - tstart) / (tend - tstart);
-	t = (t < 0.0f) ? 0.0f : t;
-	t = (t > 1.0f) ? 1.0f : t;
-
-	if (output->component_type != cgltf_component_type_r_32f) return false;
+	const cgltf_accessor* input = channel->sampler->input;
+	const cgltf_accessor* output = channel->sampler->output;
 
-	if (output->type == cgltf_type_vec3)
-	{
-		float tmp[3] = { 0.0f };
-		cgltf_accessor_read_float(output, keyframe, tmp, 3);
-		glm::vec3 v1 = { tmp[0], tmp[1], tmp[2] };
-		cgltf_accessor_read_float(output, keyframe + 1, tmp, 3);
-		glm::vec3 v2 = { tmp[0], tmp[1], tmp[2] };
-
-		tempVec3* r = (tempVec3*)data;
-		*r = Vector3Lerp(v1, v2, t);
-	}
-	else if (output->type == cgltf_type_vec4)
-	{
-		float tmp[4] = { 0.0f };
-		cgltf_accessor_read_float(output, keyframe, tmp, 4);
-		glm::vec4 v1 = { tmp[0], tmp[1], tmp[2], tmp[3] };
-		cgltf_accessor_read_float(output, keyframe + 1, tmp, 4);
-		glm::vec4 v2 = { tmp[0], tmp[1], tmp[2], tmp[3] };
-		tempVec4* r = (tempVec4*)data;
-
-		// Only v4 is for rotations, so we know it's a quaternion
-		*r = QuaternionSlerp(v1, v2, t);
-	}
+	// Input and output should have the same count
+	if (output->component_type != cgltf_component_type_r_32f || cgltf_num_components(output->type) != components || input->count != output->count)
+		return false;
 
-	return true;
+	times.resize(input->count);
+	values.resize(output->count * components);
+	return cgltf_accessor_unpack_floats(input, times.data(), times.size()) == times.size()
+		&& cgltf_accessor_unpack_floats(output, values.data(), values.size()) == values.size();
 }
 //-----------------------------------------------------------------------------
 #define GLTF_ANIMDELAY 17    // Animation frames delay, (~1000 ms/60 FPS = 16.666666* ms)
 ModelAnimation* LoadModelAnimationsGLTF(const std::string& fileName, unsigned int& animCount)
 {
-	// glTF file loading
-	int dataSize = 0;
-	unsigned char* fileData = LoadFileData(fileName.c_str(), &dataSize);
+	// glTF file loading, parsed straight from the mapped file
+	MemoryMappedStream fileData(fileName);
 
 	ModelAnimation* animations = NULL;
 
 	// glTF data loading
 	cgltf_options options = { };
 	cgltf_data* data = NULL;
-	cgltf_result result = cgltf_parse(&options, fileData, dataSize, &data);
+	cgltf_result result = cgltf_parse(&options, fileData.Data(), fileData.Size(), &data);
 
 	if (result != cgltf_result_success)
 	{
@@ -772,55 +737,62 @@ ModelAnimation* LoadModelAnimationsGLTF(const std::string& fileName, unsigned in
 				animations[i].name[sizeof(animations[i].name) - 1] = '\0';
 
 				animations[i].frameCount = (int)(animDuration * 1000.0f / GLTF_ANIMDELAY);
-				animations[i].framePoses = (TempTransform**)malloc(animations[i].frameCount * sizeof(TempTransform*));
+				animations[i].framePoses = nullptr;
 
-				for (int j = 0; j < animations[i].frameCount; j++)
-				{
-					animations[i].framePoses[j] = (TempTransform*)malloc(animations[i].boneCount * sizeof(TempTransform));
-					float time = ((float)j * GLTF_ANIMDELAY) / 1000.0f;
+				// Keyframes are compressed per track instead of baking one pose per frame
+				AnimationClip* clip = new AnimationClip();
+				clip->Create(animations[i].boneCount, animDuration, GLTF_ANIMDELAY / 1000.0f);
 
-					for (int k = 0; k < animations[i].boneCount; k++)
+				std::vector<float> times;
+				std::vector<float> values;
+				std::vector<glm::vec3> vectors;
+				std::vector<glm::quat> rotations;
+				for (int k = 0; k < animations[i].boneCount; k++)
+				{
+					if (boneChannels[k].translate)
 					{
-						glm::vec3 translation = { 0, 0, 0 };
-						//glm::quat rotation = { 1, 0, 0, 0 };
-						glm::vec4 rotation = { 0, 0, 0, 1 }; // GetPoseAtTimeGLTF()   vec4   w  (   ).  
-						glm::vec3 scale = { 1, 1, 1 };
-
-						if (boneChannels[k].translate)
+						if (ReadChannelGLTF(boneChannels[k].translate, 3, times, values))
 						{
-							if (!GetPoseAtTimeGLTF(boneChannels[k].translate->sampler->input, boneChannels[k].translate->sampler->output, time, &translation))
-							{
-								LogPrint("MODEL: [" + std::string(fileName) + "] Failed to load translate pose data for bone " + std::string(animations[i].bones[k].name));
-							}
+							vectors.resize(times.size());
+							for (size_t n = 0; n < times.size(); n++)
+								vectors[n] = { values[n * 3 + 0], values[n * 3 + 1], values[n * 3 + 2] };
+							clip->SetTranslation(k, times, vectors);
 						}
+						else LogPrint("MODEL: [" + std::string(fileName) + "] Failed to load translate pose data for bone " + std::string(animations[i].bones[k].name));
+					}
 
-						if (boneChannels[k].rotate)
+					if (boneChannels[k].rotate)
+					{
+						if (ReadChannelGLTF(boneChannels[k].rotate, 4, times, values))
 						{
-							if (!GetPoseAtTimeGLTF(boneChannels[k].rotate->sampler->input, boneChannels[k].rotate->sampler->output, time, &rotation))
-							{
-								LogPrint("MODEL: [" + std::string(fileName) + "] Failed to load rotate pose data for bone " + std::string(animations[i].bones[k].name));
-							}
+							// glTF stores quaternions as xyzw
+							rotations.resize(times.size());
+							for (size_t n = 0; n < times.size(); n++)
+								rotations[n] = glm::quat(values[n * 4 + 3], values[n * 4 + 0], values[n * 4 + 1], values[n * 4 + 2]);
+							clip->SetRotation(k, times, rotations);
 						}
+						else LogPrint("MODEL: [" + std::string(fileName) + "] Failed to load rotate pose data for bone " + std::string(animations[i].bones[k].name));
+					}
 
-						if (boneChannels[k].scale)
+					if (boneChannels[k].scale)
+					{
+						if (ReadChannelGLTF(boneChannels[k].scale, 3, times, values))
 						{
-							if (!GetPoseAtTimeGLTF(boneChannels[k].scale->sampler->input, boneChannels[k].scale->sampler->output, time, &scale))
-							{
-								LogPrint("MODEL: [" + std::string(fileName) + "] Failed to load scale pose data for bone " + std::string(animations[i].bones[k].name));
-							}
+							vectors.resize(times.size());
+							for (size_t n = 0; n < times.size(); n++)
+								vectors[n] = { values[n * 3 + 0], values[n * 3 + 1], values[n * 3 + 2] };
+							clip->SetScale(k, times, vectors);
 						}
-
-						animations[i].framePoses[j][k] = TempTransform{
-							.translation = translation,
-							.rotation = {rotation.w, rotation.x, rotation.y, rotation.z},
-							.scale = scale
-						};
+						else LogPrint("MODEL: [" + std::string(fileName) + "] Failed to load scale pose data for bone " + std::string(animations[i].bones[k].name));
 					}
-
-					BuildPoseFromParentJoints(animations[i].bones, animations[i].boneCount, animations[i].framePoses[j]);
 				}
+				animations[i].clip = clip;
+				animations[i].cursor = new AnimationCursor();
 
-				LogPrint("MODEL: [" + std::string(fileName) + "] Loaded animation: " + std::string(animData.name) + " (" + std::to_string(animations[i].frameCount) + " frames, " + std::to_string(animDuration) + "s)");
+				const size_t bakedSize = (size_t)animations[i].frameCount * (sizeof(TempTransform*) + animations[i].boneCount * sizeof(TempTransform));
+				LogPrint("MODEL: [" + std::string(fileName) + "] Loaded animation: " + std::string(animData.name) + " (" + std::to_string(animations[i].frameCount) + " frames, " + std::to_string(animDuration) + "s, "
+					+ std::to_string(clip->GetMemorySize() / 1024) + " KB compressed instead of " + std::to_string(bakedSize / 1024) + " KB baked, "
+					+ std::to_string(clip->GetConstantTrackCount()) + " constant tracks)");
 				free(boneChannels);
 			}
 		}
@@ -828,7 +800,6 @@ ModelAnimation* LoadModelAnimationsGLTF(const std::string& fileName, unsigned in
 
 		cgltf_free(data);
 	}
-	free(fileData);
 	return animations;
 }
 //-----------------------------------------------------------------------------
\ No newline at end of file
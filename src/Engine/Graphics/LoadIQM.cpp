@@ -1,8 +1,7 @@
 #include "stdafx.h"
 #include "GraphicsResource.h"
+#include "Core/IO/MemoryMappedStream.h"
 
-void BuildPoseFromParentJoints(NewBoneInfo* bones, int boneCount, TempTransform* transforms); // LoadGLTF.cpp
-unsigned char* LoadFileData(const char* fileName, int* dataSize);
 NewMaterial LoadMaterialDefault();
 
 NewModel LoadIQM(const std::string& fileName)
@@ -14,9 +13,9 @@ NewModel LoadIQM(const std::string& fileName)
 #define MESH_NAME_LENGTH    32          // Mesh name string length
 #define MATERIAL_NAME_LENGTH 32         // Material name string length
 
-	int dataSize = 0;
-	unsigned char* fileData = LoadFileData(fileName.c_str(), &dataSize);
-	unsigned char* fileDataPtr = fileData;
+	// The file is read straight from the mapping, which is released when fileData goes out of scope
+	MemoryMappedStream fileData(fileName);
+	const unsigned char* fileDataPtr = fileData.Data();
 
 	// IQM file structs
 	//-----------------------------------------------------------------------------------
@@ -116,10 +115,10 @@ NewModel LoadIQM(const std::string& fileName)
 	unsigned char* color = NULL;
 
 	// In case file can not be read, return an empty model
-	if (fileDataPtr == NULL) return model;
+	if (fileDataPtr == NULL || fileData.Size() < sizeof(IQMHeader)) return model;
 
 	// Read IQM header
-	IQMHeader* iqmHeader = (IQMHeader*)fileDataPtr;
+	const IQMHeader* iqmHeader = (const IQMHeader*)fileDataPtr;
 
 	if (memcmp(iqmHeader->magic, IQM_MAGIC, sizeof(IQM_MAGIC)) != 0)
 	{
@@ -358,8 +357,6 @@ NewModel LoadIQM(const std::string& fileName)
 
 	BuildPoseFromParentJoints(model.bones, model.boneCount, model.bindPose);
 
-	free(fileData);
-
 	free(imesh);
 	free(tri);
 	free(va);
@@ -379,9 +376,9 @@ ModelAnimation* LoadModelAnimationsIQM(const std::string& fileName, unsigned int
 #define IQM_MAGIC       "INTERQUAKEMODEL"   // IQM file magic number
 #define IQM_VERSION     2                   // only IQM version 2 supported
 
-	int dataSize = 0;
-	unsigned char* fileData = LoadFileData(fileName.c_str(), &dataSize);
-	unsigned char* fileDataPtr = fileData;
+	// The file is read straight from the mapping, which is released when fileData goes out of scope
+	MemoryMappedStream fileData(fileName);
+	const unsigned char* fileDataPtr = fileData.Data();
 
 	typedef struct IQMHeader {
 		char magic[16];
@@ -421,10 +418,10 @@ ModelAnimation* LoadModelAnimationsIQM(const std::string& fileName, unsigned int
 	} IQMAnim;
 
 	// In case file can not be read, return an empty model
-	if (fileDataPtr == NULL) return NULL;
+	if (fileDataPtr == NULL || fileData.Size() < sizeof(IQMHeader)) return NULL;
 
 	// Read IQM header
-	IQMHeader* iqmHeader = (IQMHeader*)fileDataPtr;
+	const IQMHeader* iqmHeader = (const IQMHeader*)fileDataPtr;
 
 	if (memcmp(iqmHeader->magic, IQM_MAGIC, sizeof(IQM_MAGIC)) != 0)
 	{
@@ -469,6 +466,8 @@ ModelAnimation* LoadModelAnimationsIQM(const std::string& fileName, unsigned int
 		animations[a].boneCount = iqmHeader->num_poses;
 		animations[a].bones = (NewBoneInfo*)malloc(iqmHeader->num_poses * sizeof(NewBoneInfo));
 		animations[a].framePoses = (TempTransform**)malloc(anim[a].num_frames * sizeof(TempTransform*));
+		animations[a].clip = nullptr;
+		animations[a].cursor = nullptr;
 		// animations[a].framerate = anim.framerate;     // TODO: Use animation framerate data?
 
 		for (unsigned int j = 0; j < iqmHeader->num_poses; j++)
@@ -589,8 +588,6 @@ ModelAnimation* LoadModelAnimationsIQM(const std::string& fileName, unsigned int
 		}
 	}
 
-	free(fileData);
-
 	free(joints);
 	free(framedata);
 	free(poses);
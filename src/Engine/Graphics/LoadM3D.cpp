@@ -383,6 +383,8 @@ ModelAnimation* LoadModelAnimationsM3D(const std::string& fileName, unsigned int
 			animations[a].boneCount = m3d->numbone + 1;
 			animations[a].bones = (NewBoneInfo*)malloc((m3d->numbone + 1) * sizeof(NewBoneInfo));
 			animations[a].framePoses = (TempTransform**)malloc(animations[a].frameCount * sizeof(TempTransform*));
+			animations[a].clip = nullptr;
+			animations[a].cursor = nullptr;
 			// strncpy(animations[a].name, m3d->action[a].name, sizeof(animations[a].name));
 			LogPrint("MODEL: [" + fileName + "] animation #" + std::to_string(a) + ": " + std::to_string(m3d->action[a].durationmsec) + " msec, " + std::to_string(animations[a].frameCount) + " frames");
 
@@ -0,0 +1,452 @@
+#include "stdafx.h"
+#include "MeshOptimizer.h"
+#include "GraphicsResource.h"
+//-----------------------------------------------------------------------------
+static const uint32_t UNUSED_VERTEX = ~0u;
+//-----------------------------------------------------------------------------
+// Triangles using each vertex, stored in one array and addressed by per-vertex offsets
+struct TriangleAdjacency
+{
+	TriangleAdjacency(const uint32_t* indices, size_t indexCount, size_t vertexCount)
+		: counts(vertexCount, 0)
+		, offsets(vertexCount, 0)
+		, triangles(indexCount)
+	{
+		for (size_t i = 0; i < indexCount; i++)
+			counts[indices[i]]++;
+
+		uint32_t offset = 0;
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			offsets[i] = offset;
+			offset += counts[i];
+		}
+
+		std::vector<uint32_t> fill(offsets);
+		for (size_t i = 0; i < indexCount; i++)
+			triangles[fill[indices[i]]++] = (uint32_t)(i / 3);
+	}
+
+	std::vector<uint32_t> counts;
+	std::vector<uint32_t> offsets;
+	std::vector<uint32_t> triangles;
+};
+//-----------------------------------------------------------------------------
+// Simulated FIFO cache, a vertex is in the cache if it was added less than cacheSize misses ago
+class VertexCacheSimulator
+{
+public:
+	VertexCacheSimulator(size_t vertexCount, unsigned cacheSize)
+		: m_timestamps(vertexCount, 0)
+		, m_cacheSize(cacheSize)
+		, m_time(cacheSize + 1)
+	{
+	}
+
+	// Return the number of misses for a triangle.
+	unsigned AddTriangle(const uint32_t* triangle)
+	{
+		unsigned misses = 0;
+		for (int i = 0; i < 3; i++)
+		{
+			if (m_time - m_timestamps[triangle[i]] > m_cacheSize)
+			{
+				m_timestamps[triangle[i]] = m_time++;
+				misses++;
+			}
+		}
+		return misses;
+	}
+
+	// Forget the cache contents.
+	void Flush()
+	{
+		m_time += m_cacheSize + 1;
+	}
+
+private:
+	std::vector<unsigned> m_timestamps;
+	unsigned m_cacheSize;
+	unsigned m_time;
+};
+//-----------------------------------------------------------------------------
+VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, unsigned cacheSize)
+{
+	VertexCacheStatistics statistics;
+	if (indexCount < 3 || !vertexCount)
+		return statistics;
+
+	VertexCacheSimulator cache(vertexCount, cacheSize);
+	std::vector<bool> used(vertexCount, false);
+	size_t misses = 0;
+	size_t usedCount = 0;
+
+	for (size_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		misses += cache.AddTriangle(indices + i);
+		for (int j = 0; j < 3; j++)
+		{
+			if (!used[indices[i + j]])
+			{
+				used[indices[i + j]] = true;
+				usedCount++;
+			}
+		}
+	}
+
+	statistics.acmr = (float)misses / (float)(indexCount / 3);
+	statistics.atvr = (float)misses / (float)usedCount;
+	return statistics;
+}
+//-----------------------------------------------------------------------------
+// Tipsify, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw" (Sander, Nehab, Barczak 2007)
+void OptimizeVertexCache(uint32_t* destination, const uint32_t* indices, size_t indexCount, size_t vertexCount, unsigned cacheSize, std::vector<uint32_t>* clusters)
+{
+	if (clusters)
+		clusters->clear();
+
+	const size_t triangleCount = indexCount / 3;
+	if (!triangleCount)
+		return;
+
+	// The input is read while the output is written, so keep a copy when they are the same buffer
+	std::vector<uint32_t> input;
+	if (destination == indices)
+	{
+		input.assign(indices, indices + triangleCount * 3);
+		indices = input.data();
+	}
+
+	const TriangleAdjacency adjacency(indices, triangleCount * 3, vertexCount);
+	// Number of not yet emitted triangles using each vertex
+	std::vector<uint32_t> liveTriangles(adjacency.counts);
+	std::vector<unsigned> timestamps(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint32_t> deadEnds;
+	std::vector<uint32_t> candidates;
+	deadEnds.reserve(triangleCount * 3);
+
+	unsigned time = cacheSize + 1;
+	size_t nextVertex = 0;
+	size_t outputTriangle = 0;
+	uint32_t fanVertex = 0;
+	bool newCluster = true;
+
+	for (;;)
+	{
+		candidates.clear();
+
+		// Emit all remaining triangles around the fanning vertex
+		const uint32_t begin = adjacency.offsets[fanVertex];
+		const uint32_t end = begin + adjacency.counts[fanVertex];
+		for (uint32_t i = begin; i < end; i++)
+		{
+			const uint32_t triangle = adjacency.triangles[i];
+			if (emitted[triangle])
+				continue;
+
+			if (newCluster && clusters)
+				clusters->push_back((uint32_t)outputTriangle);
+			newCluster = false;
+
+			for (int j = 0; j < 3; j++)
+			{
+				const uint32_t vertex = indices[triangle * 3 + j];
+				destination[outputTriangle * 3 + j] = vertex;
+				deadEnds.push_back(vertex);
+				candidates.push_back(vertex);
+				liveTriangles[vertex]--;
+				if (time - timestamps[vertex] > cacheSize)
+					timestamps[vertex] = time++;
+			}
+			emitted[triangle] = true;
+			outputTriangle++;
+		}
+
+		// Continue with the candidate that is still in the cache after its remaining triangles are emitted, and that entered the cache earliest
+		int64_t bestVertex = -1;
+		int64_t bestPriority = -1;
+		for (size_t i = 0; i < candidates.size(); i++)
+		{
+			const uint32_t vertex = candidates[i];
+			if (!liveTriangles[vertex])
+				continue;
+
+			int64_t priority = 0;
+			if ((int64_t)(time - timestamps[vertex]) + 2 * (int64_t)liveTriangles[vertex] <= (int64_t)cacheSize)
+				priority = time - timestamps[vertex];
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				bestVertex = vertex;
+			}
+		}
+
+		if (bestVertex < 0)
+		{
+			// Dead end, fall back to a recently used vertex, then to the next vertex in input order
+			while (!deadEnds.empty() && bestVertex < 0)
+			{
+				const uint32_t vertex = deadEnds.back();
+				deadEnds.pop_back();
+				if (liveTriangles[vertex])
+					bestVertex = vertex;
+			}
+			while (nextVertex < vertexCount && bestVertex < 0)
+			{
+				if (liveTriangles[nextVertex])
+					bestVertex = (int64_t)nextVertex;
+				nextVertex++;
+			}
+			newCluster = true;
+		}
+
+		if (bestVertex < 0)
+			break;
+		fanVertex = (uint32_t)bestVertex;
+	}
+}
+//-----------------------------------------------------------------------------
+void OptimizeOverdraw(uint32_t* destination, const uint32_t* indices, size_t indexCount, const float* positions, size_t positionStride, size_t vertexCount, const std::vector<uint32_t>& clusters, unsigned cacheSize, float threshold)
+{
+	const size_t triangleCount = indexCount / 3;
+	if (!triangleCount)
+		return;
+
+	auto position = [&](uint32_t vertex) -> glm::vec3
+	{
+		const float* p = reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + vertex * positionStride);
+		return glm::vec3(p[0], p[1], p[2]);
+	};
+
+	// Split the hard clusters further wherever the cache is warm enough that starting over costs little
+	std::vector<uint32_t> hardClusters(clusters);
+	if (hardClusters.empty() || hardClusters[0] != 0)
+		hardClusters.insert(hardClusters.begin(), 0);
+
+	const float clusterThreshold = AnalyzeVertexCache(indices, triangleCount * 3, vertexCount, cacheSize).acmr * threshold;
+	std::vector<uint32_t> softClusters;
+	VertexCacheSimulator cache(vertexCount, cacheSize);
+
+	for (size_t i = 0; i < hardClusters.size(); i++)
+	{
+		const size_t end = i + 1 < hardClusters.size() ? hardClusters[i + 1] : triangleCount;
+		size_t start = hardClusters[i];
+		unsigned misses = 0;
+		cache.Flush();
+		softClusters.push_back((uint32_t)start);
+
+		for (size_t triangle = start; triangle < end; triangle++)
+		{
+			misses += cache.AddTriangle(indices + triangle * 3);
+			if (triangle + 1 < end && (float)misses / (float)(triangle + 1 - start) <= clusterThreshold)
+			{
+				start = triangle + 1;
+				misses = 0;
+				cache.Flush();
+				softClusters.push_back((uint32_t)start);
+			}
+		}
+	}
+
+	// Sort clusters by how much they face away from the mesh center, outside surfaces first
+	std::vector<float> sortKeys(softClusters.size());
+	std::vector<glm::vec3> centers(softClusters.size());
+	std::vector<glm::vec3> normals(softClusters.size());
+	glm::vec3 meshCenter(0.0f);
+	float meshArea = 0.0f;
+
+	for (size_t i = 0; i < softClusters.size(); i++)
+	{
+		const size_t end = i + 1 < softClusters.size() ? softClusters[i + 1] : triangleCount;
+		glm::vec3 center(0.0f);
+		glm::vec3 normal(0.0f);
+		float clusterArea = 0.0f;
+
+		for (size_t triangle = softClusters[i]; triangle < end; triangle++)
+		{
+			const glm::vec3 p0 = position(indices[triangle * 3 + 0]);
+			const glm::vec3 p1 = position(indices[triangle * 3 + 1]);
+			const glm::vec3 p2 = position(indices[triangle * 3 + 2]);
+			const glm::vec3 areaNormal = glm::cross(p1 - p0, p2 - p0);
+			const float area = glm::length(areaNormal);
+
+			center += (p0 + p1 + p2) * (area / 3.0f);
+			normal += areaNormal;
+			clusterArea += area;
+		}
+
+		meshCenter += center;
+		meshArea += clusterArea;
+		centers[i] = clusterArea > 0.0f ? center / clusterArea : center;
+		const float normalLength = glm::length(normal);
+		normals[i] = normalLength > 0.0f ? normal / normalLength : normal;
+	}
+
+	if (meshArea > 0.0f)
+		meshCenter /= meshArea;
+	for (size_t i = 0; i < softClusters.size(); i++)
+		sortKeys[i] = glm::dot(centers[i] - meshCenter, normals[i]);
+
+	std::vector<uint32_t> order(softClusters.size());
+	for (size_t i = 0; i < order.size(); i++)
+		order[i] = (uint32_t)i;
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	size_t outputTriangle = 0;
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		const size_t start = softClusters[order[i]];
+		const size_t end = order[i] + 1 < softClusters.size() ? softClusters[order[i] + 1] : triangleCount;
+		memcpy(destination + outputTriangle * 3, indices + start * 3, (end - start) * 3 * sizeof(uint32_t));
+		outputTriangle += end - start;
+	}
+}
+//-----------------------------------------------------------------------------
+size_t GenerateVertexFetchRemap(uint32_t* remap, const uint32_t* indices, size_t indexCount, size_t vertexCount)
+{
+	std::fill(remap, remap + vertexCount, UNUSED_VERTEX);
+
+	uint32_t nextVertex = 0;
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		if (remap[indices[i]] == UNUSED_VERTEX)
+			remap[indices[i]] = nextVertex++;
+	}
+	return nextVertex;
+}
+//-----------------------------------------------------------------------------
+void RemapIndexBuffer(uint32_t* destination, const uint32_t* indices, size_t indexCount, const uint32_t* remap)
+{
+	for (size_t i = 0; i < indexCount; i++)
+		destination[i] = remap[indices[i]];
+}
+//-----------------------------------------------------------------------------
+void RemapVertexBuffer(void* destination, const void* vertices, size_t vertexCount, size_t vertexSize, const uint32_t* remap)
+{
+	unsigned char* dest = static_cast<unsigned char*>(destination);
+	const unsigned char* src = static_cast<const unsigned char*>(vertices);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		if (remap[i] != UNUSED_VERTEX)
+			memcpy(dest + remap[i] * vertexSize, src + i * vertexSize, vertexSize);
+	}
+}
+//-----------------------------------------------------------------------------
+IndexFormat SelectIndexFormat(size_t vertexCount)
+{
+	return vertexCount <= 65536 ? IndexFormat::UInt16 : IndexFormat::UInt32;
+}
+//-----------------------------------------------------------------------------
+void ConvertIndices16(std::vector<uint16_t>& destination, const std::vector<uint32_t>& indices)
+{
+	destination.resize(indices.size());
+	for (size_t i = 0; i < indices.size(); i++)
+		destination[i] = (uint16_t)indices[i];
+}
+//-----------------------------------------------------------------------------
+// Reorder the indices for vertex cache and overdraw, then generate the vertex fetch remap. Return the number of used vertices
+static size_t OptimizeIndices(std::vector<uint32_t>& indices, std::vector<uint32_t>& remap, const float* positions, size_t positionStride, size_t vertexCount)
+{
+	std::vector<uint32_t> cacheOptimized(indices.size());
+	std::vector<uint32_t> clusters;
+	OptimizeVertexCache(cacheOptimized.data(), indices.data(), indices.size(), vertexCount, DEFAULT_VERTEX_CACHE_SIZE, &clusters);
+	OptimizeOverdraw(indices.data(), cacheOptimized.data(), indices.size(), positions, positionStride, vertexCount, clusters);
+
+	remap.resize(vertexCount);
+	const size_t usedCount = GenerateVertexFetchRemap(remap.data(), indices.data(), indices.size(), vertexCount);
+	RemapIndexBuffer(indices.data(), indices.data(), indices.size(), remap.data());
+	return usedCount;
+}
+//-----------------------------------------------------------------------------
+// Remap a malloc'd vertex attribute array of a NewMesh
+static void RemapMeshArrayBytes(void*& data, size_t vertexCount, size_t usedCount, size_t vertexSize, const uint32_t* remap)
+{
+	if (!data)
+		return;
+
+	void* remapped = malloc(usedCount * vertexSize);
+	RemapVertexBuffer(remapped, data, vertexCount, vertexSize, remap);
+	free(data);
+	data = remapped;
+}
+//-----------------------------------------------------------------------------
+template <class T> static void RemapMeshArray(T*& data, size_t vertexCount, size_t usedCount, size_t components, const uint32_t* remap)
+{
+	void* untyped = data;
+	RemapMeshArrayBytes(untyped, vertexCount, usedCount, components * sizeof(T), remap);
+	data = static_cast<T*>(untyped);
+}
+//-----------------------------------------------------------------------------
+static bool IsValidTriangleList(const std::vector<uint32_t>& indices, size_t vertexCount)
+{
+	if (indices.size() < 3 || indices.size() % 3)
+		return false;
+
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		if (indices[i] >= vertexCount)
+			return false;
+	}
+	return true;
+}
+//-----------------------------------------------------------------------------
+MeshOptimizationStatistics OptimizeMesh(StaticMesh& mesh)
+{
+	MeshOptimizationStatistics statistics;
+	if (!IsValidTriangleList(mesh.indices, mesh.vertices.size()))
+		return statistics;
+
+	statistics.before = AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+
+	std::vector<uint32_t> remap;
+	const size_t usedCount = OptimizeIndices(mesh.indices, remap, &mesh.vertices[0].positions.x, sizeof(StaticMeshVertex), mesh.vertices.size());
+	std::vector<StaticMeshVertex> vertices(usedCount);
+	RemapVertexBuffer(vertices.data(), mesh.vertices.data(), mesh.vertices.size(), sizeof(StaticMeshVertex), remap.data());
+	mesh.vertices.swap(vertices);
+
+	statistics.after = AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+	return statistics;
+}
+//-----------------------------------------------------------------------------
+MeshOptimizationStatistics OptimizeMesh(NewMesh& mesh)
+{
+	MeshOptimizationStatistics statistics;
+	if (!mesh.vertices || mesh.vertexCount <= 0 || !IsValidTriangleList(mesh.indices, (size_t)mesh.vertexCount))
+		return statistics;
+
+	const size_t vertexCount = (size_t)mesh.vertexCount;
+	statistics.before = AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), vertexCount);
+
+	std::vector<uint32_t> remap;
+	const size_t usedCount = OptimizeIndices(mesh.indices, remap, mesh.vertices, 3 * sizeof(float), vertexCount);
+
+	// Every per-vertex array must follow the same remap
+	RemapMeshArray(mesh.vertices, vertexCount, usedCount, 3, remap.data());
+	RemapMeshArray(mesh.texcoords, vertexCount, usedCount, 2, remap.data());
+	RemapMeshArray(mesh.texcoords2, vertexCount, usedCount, 2, remap.data());
+	RemapMeshArray(mesh.normals, vertexCount, usedCount, 3, remap.data());
+	RemapMeshArray(mesh.tangents, vertexCount, usedCount, 4, remap.data());
+	RemapMeshArray(mesh.colors, vertexCount, usedCount, 4, remap.data());
+	RemapMeshArray(mesh.animVertices, vertexCount, usedCount, 3, remap.data());
+	RemapMeshArray(mesh.animNormals, vertexCount, usedCount, 3, remap.data());
+	RemapMeshArray(mesh.boneIds, vertexCount, usedCount, 4, remap.data());
+	RemapMeshArray(mesh.boneWeights, vertexCount, usedCount, 4, remap.data());
+	if (mesh.vert.size() == vertexCount)
+	{
+		std::vector<NewMeshVertex> vert(usedCount);
+		RemapVertexBuffer(vert.data(), mesh.vert.data(), vertexCount, sizeof(NewMeshVertex), remap.data());
+		mesh.vert.swap(vert);
+	}
+	mesh.vertexCount = (int)usedCount;
+
+	statistics.after = AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), usedCount);
+	return statistics;
+}
+//-----------------------------------------------------------------------------
+void LogMeshOptimization(const std::string& name, const MeshOptimizationStatistics& statistics)
+{
+	LogPrint("MESH: [" + name + "] Vertex cache ACMR " + std::to_string(statistics.before.acmr) + " -> " + std::to_string(statistics.after.acmr) +
+		", ATVR " + std::to_string(statistics.before.atvr) + " -> " + std::to_string(statistics.after.atvr));
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "RenderAPI/RenderCore.h"
+
+class StaticMesh;
+class NewMesh;
+
+// Default size of the simulated FIFO post-transform vertex cache.
+static const unsigned DEFAULT_VERTEX_CACHE_SIZE = 16;
+// Default ACMR a cluster may reach, relative to the whole mesh, before it is split for overdraw sorting.
+static const float DEFAULT_OVERDRAW_THRESHOLD = 1.05f;
+
+// Vertex cache efficiency of an index buffer, measured with a simulated FIFO cache.
+struct VertexCacheStatistics
+{
+	// Average cache miss ratio: transformed vertices per triangle, from 3 at worst down to about 0.5 for a large regular grid.
+	float acmr = 0.0f;
+	// Average transformed to vertex ratio: transformed vertices per used vertex, 1 at best.
+	float atvr = 0.0f;
+};
+
+// Vertex cache efficiency of a mesh before and after OptimizeMesh().
+struct MeshOptimizationStatistics
+{
+	VertexCacheStatistics before;
+	VertexCacheStatistics after;
+};
+
+// Measure vertex cache efficiency of a triangle list.
+VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, unsigned cacheSize = DEFAULT_VERTEX_CACHE_SIZE);
+
+// Reorder triangles for the post-transform vertex cache with Tipsify. Destination may be the same as indices. Optionally return the first triangle of each cluster where the fan was broken, for OptimizeOverdraw().
+void OptimizeVertexCache(uint32_t* destination, const uint32_t* indices, size_t indexCount, size_t vertexCount, unsigned cacheSize = DEFAULT_VERTEX_CACHE_SIZE, std::vector<uint32_t>* clusters = nullptr);
+// Reorder the clusters of a cache-optimized triangle list so that outward facing clusters are drawn first. Clusters are additionally split where their ACMR stays within threshold of the whole mesh. Destination must not be the same as indices.
+void OptimizeOverdraw(uint32_t* destination, const uint32_t* indices, size_t indexCount, const float* positions, size_t positionStride, size_t vertexCount, const std::vector<uint32_t>& clusters, unsigned cacheSize = DEFAULT_VERTEX_CACHE_SIZE, float threshold = DEFAULT_OVERDRAW_THRESHOLD);
+
+// Generate a remap table that orders vertices by first use in the index buffer, and drops unused vertices (mapped to ~0u). Return the number of used vertices.
+size_t GenerateVertexFetchRemap(uint32_t* remap, const uint32_t* indices, size_t indexCount, size_t vertexCount);
+// Apply a vertex remap table to an index buffer. Destination may be the same as indices.
+void RemapIndexBuffer(uint32_t* destination, const uint32_t* indices, size_t indexCount, const uint32_t* remap);
+// Apply a vertex remap table to a vertex buffer. Destination must not be the same as vertices.
+void RemapVertexBuffer(void* destination, const void* vertices, size_t vertexCount, size_t vertexSize, const uint32_t* remap);
+
+// Return the smallest index format that can address vertexCount vertices.
+IndexFormat SelectIndexFormat(size_t vertexCount);
+// Convert indices to 16 bits for upload with IndexFormat::UInt16.
+void ConvertIndices16(std::vector<uint16_t>& destination, const std::vector<uint32_t>& indices);
+
+// Optimize a mesh for vertex cache, overdraw and vertex fetch. Deterministic: the same input always gives the same output.
+MeshOptimizationStatistics OptimizeMesh(StaticMesh& mesh);
+MeshOptimizationStatistics OptimizeMesh(NewMesh& mesh);
+// Log the statistics of an optimized mesh.
+void LogMeshOptimization(const std::string& name, const MeshOptimizationStatistics& statistics);
\ No newline at end of file
@@ -0,0 +1,300 @@
+#include "stdafx.h"
+#include "Skinning.h"
+#include "GraphicsResource.h"
+#include "Core/Threading/JobSystem.h"
+#include "Core/Object/FrameArena.h"
+#include "RenderAPI/RenderSystem.h"
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#	define USE_SKINNING_SSE 1
+#	include <xmmintrin.h>
+#else
+#	define USE_SKINNING_SSE 0
+#endif
+
+static_assert(SKINNING_PALETTE_BINDING < MaxBindingUniformBuffers, "Bone palette binding point is not tracked by RenderSystem");
+
+// Size of one bone in the GPU palette: the three rows of its position matrix, one std140 vec4 each.
+static const unsigned GPU_SKINNING_MATRIX_SIZE = 12 * sizeof(float);
+//-----------------------------------------------------------------------------
+bool SkinnedMeshData::Create(const NewMesh& mesh)
+{
+	if (mesh.vertexCount <= 0 || mesh.vertices == nullptr || mesh.boneIds == nullptr || mesh.boneWeights == nullptr)
+		return false;
+
+	vertexCount = static_cast<unsigned>(mesh.vertexCount);
+	// Padding vertices have zero weights and skin to the origin, they are never written out
+	const size_t paddedCount = (vertexCount + SKINNING_BLOCK_SIZE - 1) / SKINNING_BLOCK_SIZE * SKINNING_BLOCK_SIZE;
+	for (unsigned c = 0; c < 3; c++)
+	{
+		positions[c].assign(paddedCount, 0.0f);
+		normals[c].assign(paddedCount, 0.0f);
+	}
+	for (unsigned j = 0; j < SKINNING_MAX_INFLUENCES; j++)
+	{
+		boneIds[j].assign(paddedCount, 0);
+		boneWeights[j].assign(paddedCount, 0.0f);
+	}
+
+	for (unsigned i = 0; i < vertexCount; i++)
+	{
+		// Meshes without normals skin the normals they were uploaded with
+		const float* normal = mesh.normals ? &mesh.normals[i * 3] : &mesh.vert[i].normals.x;
+		for (unsigned c = 0; c < 3; c++)
+		{
+			positions[c][i] = mesh.vertices[i * 3 + c];
+			normals[c][i] = normal[c];
+		}
+		for (unsigned j = 0; j < SKINNING_MAX_INFLUENCES; j++)
+		{
+			boneIds[j][i] = mesh.boneIds[i * SKINNING_MAX_INFLUENCES + j];
+			boneWeights[j][i] = mesh.boneWeights[i * SKINNING_MAX_INFLUENCES + j];
+		}
+	}
+	return true;
+}
+//-----------------------------------------------------------------------------
+void BuildSkinningPalette(std::vector<SkinningMatrix>& palette, const TempTransform* bindPose, const TempTransform* framePose, int boneCount, bool normals)
+{
+	palette.resize(static_cast<size_t>(std::max(boneCount, 0)));
+	for (size_t b = 0; b < palette.size(); b++)
+	{
+		const TempTransform& bind = bindPose[b];
+		const TempTransform& pose = framePose[b];
+
+		// v' = R * ((v - bindTranslation) * scale) + poseTranslation, with R = poseRotation * inverse(bindRotation)
+		const glm::quat rotationQuat = pose.rotation * glm::inverse(bind.rotation);
+		const glm::mat3 rotation(rotationQuat * glm::vec3(1.0f, 0.0f, 0.0f), rotationQuat * glm::vec3(0.0f, 1.0f, 0.0f), rotationQuat * glm::vec3(0.0f, 0.0f, 1.0f));
+		glm::mat3 affine = rotation;
+		for (int c = 0; c < 3; c++)
+			affine[c] *= pose.scale[c];
+		const glm::vec3 translation = pose.translation - affine * bind.translation;
+
+		// glm matrices are column-major, the palette stores rows
+		SkinningMatrix& matrix = palette[b];
+		for (int r = 0; r < 3; r++)
+		{
+			for (int c = 0; c < 3; c++)
+				matrix.position[r * 4 + c] = affine[c][r];
+			matrix.position[r * 4 + 3] = translation[r];
+		}
+		if (!normals) continue;
+
+		for (int r = 0; r < 3; r++)
+		{
+			for (int c = 0; c < 3; c++)
+				matrix.normal[r * 4 + c] = rotation[c][r];
+			matrix.normal[r * 4 + 3] = 0.0f;
+		}
+	}
+}
+//-----------------------------------------------------------------------------
+void SkinVertices(NewMeshVertex* destination, const NewMeshVertex* source, const SkinnedMeshData& data, std::span<const SkinningMatrix> palette, unsigned begin, unsigned end)
+{
+	assert(begin % SKINNING_BLOCK_SIZE == 0);
+	end = std::min(end, data.vertexCount);
+
+#if USE_SKINNING_SSE
+	const __m128 zero = _mm_setzero_ps();
+	for (unsigned i = begin; i < end; i += SKINNING_BLOCK_SIZE)
+	{
+		// Blend the bone matrices of the four vertices, one register per matrix element across the vertices
+		__m128 position[12];
+		__m128 normal[12];
+		for (unsigned e = 0; e < 12; e++)
+			position[e] = normal[e] = zero;
+
+		for (unsigned j = 0; j < SKINNING_MAX_INFLUENCES; j++)
+		{
+			const __m128 weights = _mm_loadu_ps(&data.boneWeights[j][i]);
+			if (_mm_movemask_ps(_mm_cmpneq_ps(weights, zero)) == 0) continue;
+
+			const uint8_t* ids = &data.boneIds[j][i];
+			assert(ids[0] < palette.size() && ids[1] < palette.size() && ids[2] < palette.size() && ids[3] < palette.size());
+			const SkinningMatrix* bones[SKINNING_BLOCK_SIZE] = { &palette[ids[0]], &palette[ids[1]], &palette[ids[2]], &palette[ids[3]] };
+
+			for (unsigned r = 0; r < 3; r++)
+			{
+				// Transpose row r of the four bones into its four elements across the vertices
+				__m128 p0 = _mm_loadu_ps(&bones[0]->position[r * 4]);
+				__m128 p1 = _mm_loadu_ps(&bones[1]->position[r * 4]);
+				__m128 p2 = _mm_loadu_ps(&bones[2]->position[r * 4]);
+				__m128 p3 = _mm_loadu_ps(&bones[3]->position[r * 4]);
+				_MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+				position[r * 4 + 0] = _mm_add_ps(position[r * 4 + 0], _mm_mul_ps(weights, p0));
+				position[r * 4 + 1] = _mm_add_ps(position[r * 4 + 1], _mm_mul_ps(weights, p1));
+				position[r * 4 + 2] = _mm_add_ps(position[r * 4 + 2], _mm_mul_ps(weights, p2));
+				position[r * 4 + 3] = _mm_add_ps(position[r * 4 + 3], _mm_mul_ps(weights, p3));
+
+				__m128 n0 = _mm_loadu_ps(&bones[0]->normal[r * 4]);
+				__m128 n1 = _mm_loadu_ps(&bones[1]->normal[r * 4]);
+				__m128 n2 = _mm_loadu_ps(&bones[2]->normal[r * 4]);
+				__m128 n3 = _mm_loadu_ps(&bones[3]->normal[r * 4]);
+				_MM_TRANSPOSE4_PS(n0, n1, n2, n3);
+				normal[r * 4 + 0] = _mm_add_ps(normal[r * 4 + 0], _mm_mul_ps(weights, n0));
+				normal[r * 4 + 1] = _mm_add_ps(normal[r * 4 + 1], _mm_mul_ps(weights, n1));
+				normal[r * 4 + 2] = _mm_add_ps(normal[r * 4 + 2], _mm_mul_ps(weights, n2));
+			}
+		}
+
+		const __m128 px = _mm_loadu_ps(&data.positions[0][i]);
+		const __m128 py = _mm_loadu_ps(&data.positions[1][i]);
+		const __m128 pz = _mm_loadu_ps(&data.positions[2][i]);
+		const __m128 nx = _mm_loadu_ps(&data.normals[0][i]);
+		const __m128 ny = _mm_loadu_ps(&data.normals[1][i]);
+		const __m128 nz = _mm_loadu_ps(&data.normals[2][i]);
+
+		alignas(16) float skinned[6][SKINNING_BLOCK_SIZE];
+		for (unsigned r = 0; r < 3; r++)
+		{
+			const __m128* m = &position[r * 4];
+			_mm_store_ps(skinned[r], _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0], px), _mm_mul_ps(m[1], py)), _mm_add_ps(_mm_mul_ps(m[2], pz), m[3])));
+			const __m128* n = &normal[r * 4];
+			_mm_store_ps(skinned[3 + r], _mm_add_ps(_mm_add_ps(_mm_mul_ps(n[0], nx), _mm_mul_ps(n[1], ny)), _mm_mul_ps(n[2], nz)));
+		}
+
+		const unsigned count = std::min(SKINNING_BLOCK_SIZE, end - i);
+		for (unsigned k = 0; k < count; k++)
+		{
+			NewMeshVertex& vertex = destination[i + k - begin];
+			vertex = source[i + k];
+			vertex.positions = { skinned[0][k], skinned[1][k], skinned[2][k] };
+			vertex.normals = { skinned[3][k], skinned[4][k], skinned[5][k] };
+		}
+	}
+#else
+	for (unsigned i = begin; i < end; i++)
+	{
+		float position[12] = {};
+		float normal[12] = {};
+		for (unsigned j = 0; j < SKINNING_MAX_INFLUENCES; j++)
+		{
+			const float weight = data.boneWeights[j][i];
+			if (weight == 0.0f) continue;
+			assert(data.boneIds[j][i] < palette.size());
+			const SkinningMatrix& bone = palette[data.boneIds[j][i]];
+			for (unsigned e = 0; e < 12; e++)
+			{
+				position[e] += weight * bone.position[e];
+				normal[e] += weight * bone.normal[e];
+			}
+		}
+
+		const float px = data.positions[0][i], py = data.positions[1][i], pz = data.positions[2][i];
+		const float nx = data.normals[0][i], ny = data.normals[1][i], nz = data.normals[2][i];
+		NewMeshVertex& vertex = destination[i - begin];
+		vertex = source[i];
+		for (unsigned r = 0; r < 3; r++)
+		{
+			const float* m = &position[r * 4];
+			const float* n = &normal[r * 4];
+			vertex.positions[r] = m[0] * px + m[1] * py + m[2] * pz + m[3];
+			vertex.normals[r] = n[0] * nx + n[1] * ny + n[2] * nz;
+		}
+	}
+#endif
+}
+//-----------------------------------------------------------------------------
+void SkinMesh(NewMeshVertex* destination, const NewMeshVertex* source, const SkinnedMeshData& data, std::span<const SkinningMatrix> palette, unsigned batchSize)
+{
+	// Batches start on a block boundary, so that the SIMD loads of a block stay inside the padded streams
+	const size_t blockCount = (data.vertexCount + SKINNING_BLOCK_SIZE - 1) / SKINNING_BLOCK_SIZE;
+	const size_t minBlocks = std::max<size_t>(batchSize / SKINNING_BLOCK_SIZE, 1);
+	GetJobSystem().ParallelFor(blockCount, minBlocks, [&](size_t beginBlock, size_t endBlock)
+	{
+		const unsigned begin = static_cast<unsigned>(beginBlock * SKINNING_BLOCK_SIZE);
+		const unsigned end = static_cast<unsigned>(std::min<size_t>(endBlock * SKINNING_BLOCK_SIZE, data.vertexCount));
+		SkinVertices(destination + begin, source, data, palette, begin, end);
+	});
+}
+//-----------------------------------------------------------------------------
+unsigned GetSkinningPaletteBones(int boneCount)
+{
+	unsigned bones = MIN_GPU_SKINNING_BONES;
+	while (bones < MAX_GPU_SKINNING_BONES && bones < static_cast<unsigned>(std::max(boneCount, 0)))
+		bones *= 2;
+	return bones;
+}
+//-----------------------------------------------------------------------------
+SkinningPalette CreateSkinningPalette(int boneCount)
+{
+	const unsigned bones = GetSkinningPaletteBones(boneCount);
+	SkinningPalette palette;
+	palette.rows.assign(bones * 12, 0.0f);
+	for (unsigned b = 0; b < bones; b++)
+		palette.rows[b * 12 + 0] = palette.rows[b * 12 + 5] = palette.rows[b * 12 + 10] = 1.0f;
+	return palette;
+}
+//-----------------------------------------------------------------------------
+void UpdateSkinningPaletteRows(SkinningPalette& palette, std::span<const SkinningMatrix> matrices)
+{
+	const size_t boneCount = std::min<size_t>(matrices.size(), palette.rows.size() / 12);
+	for (size_t b = 0; b < boneCount; b++)
+		memcpy(&palette.rows[b * 12], matrices[b].position, GPU_SKINNING_MATRIX_SIZE);
+	palette.range = {};
+}
+//-----------------------------------------------------------------------------
+bool PushSkinningPalette(SkinningPalette& palette)
+{
+	UniformRingBuffer& frameUniforms = GetRenderSystem().GetFrameUniforms();
+	if (!frameUniforms.IsValid() || palette.rows.empty()) return false;
+
+	// Later meshes of the model in the same frame read the rows already in the ring
+	if (frameUniforms.BindRange(SKINNING_PALETTE_BINDING, palette.range))
+		return true;
+	return frameUniforms.Push(SKINNING_PALETTE_BINDING, palette.rows.data(), static_cast<unsigned>(palette.rows.size() * sizeof(float)), palette.range);
+}
+//-----------------------------------------------------------------------------
+void SetSkinningPaletteBinding(ShaderProgramRef program)
+{
+	auto& renderSystem = GetRenderSystem();
+	const UniformBlock block = renderSystem.GetUniformBlock(program, "BonePalette");
+	if (renderSystem.IsValid(block))
+		renderSystem.SetUniformBlockBinding(block, SKINNING_PALETTE_BINDING);
+}
+//-----------------------------------------------------------------------------
+const std::string& GetSkinningShaderSource(unsigned paletteBones)
+{
+	// one source per palette size, indexed by the power of two over MIN_GPU_SKINNING_BONES
+	static const std::vector<std::string> sources = []()
+	{
+		std::vector<std::string> result;
+		for (unsigned bones = MIN_GPU_SKINNING_BONES; bones <= MAX_GPU_SKINNING_BONES; bones *= 2)
+		{
+			result.push_back(R"(
+#ifdef SKINNING
+#define SKINNING_MAX_BONES )" + std::to_string(bones) + R"(
+layout(location = )" + std::to_string(SKINNING_BONE_IDS_LOCATION) + R"() in uvec4 boneIds;
+layout(location = )" + std::to_string(SKINNING_BONE_WEIGHTS_LOCATION) + R"() in vec4 boneWeights;
+
+layout(std140) uniform BonePalette
+{
+	vec4 bonePalette[SKINNING_MAX_BONES * 3];
+};
+
+mat3x4 GetSkinningMatrix()
+{
+	mat3x4 skin = mat3x4(0.0);
+	for (int i = 0; i < 4; i++)
+	{
+		int row = int(boneIds[i]) * 3;
+		skin += boneWeights[i] * mat3x4(bonePalette[row], bonePalette[row + 1], bonePalette[row + 2]);
+	}
+	return skin;
+}
+
+// the palette stores matrix rows, the vector multiplies from the left
+vec3 SkinPosition(mat3x4 skin, vec3 position) { return vec4(position, 1.0) * skin; }
+vec3 SkinNormal(mat3x4 skin, vec3 normal) { return vec4(normal, 0.0) * skin; }
+#endif
+)");
+		}
+		return result;
+	}();
+
+	const unsigned bones = GetSkinningPaletteBones(static_cast<int>(std::min(paletteBones, MAX_GPU_SKINNING_BONES)));
+	size_t index = 0;
+	while ((MIN_GPU_SKINNING_BONES << index) < bones)
+		index++;
+	return sources[index];
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "RenderAPI/RenderResource.h"
+#include "RenderAPI/UniformRingBuffer.h"
+
+class NewMesh;
+class NewMeshVertex;
+struct TempTransform;
+
+// Vertices skinned per SIMD iteration. Skinned vertex streams are padded to a multiple of it.
+static const unsigned SKINNING_BLOCK_SIZE = 4;
+// Bone influences per vertex.
+static const unsigned SKINNING_MAX_INFLUENCES = 4;
+// Smallest number of vertices skinned by one job.
+static const unsigned DEFAULT_SKINNING_BATCH_SIZE = 2048;
+
+// Bones in the largest GPU palette. Bone ids are bytes, so it covers every bone a mesh can reference; 256 3x4 matrices fit the 16 KB minimum uniform block size.
+static const unsigned MAX_GPU_SKINNING_BONES = 256;
+// Bones in the smallest GPU palette. Palettes grow in powers of two from it, so that a few program variants cover every skeleton.
+static const unsigned MIN_GPU_SKINNING_BONES = 32;
+// Vertex attribute locations of the bone ids (uvec4) and weights (vec4) of GPU skinned meshes, after the NewMeshVertex attributes.
+static const unsigned SKINNING_BONE_IDS_LOCATION = 6;
+static const unsigned SKINNING_BONE_WEIGHTS_LOCATION = 7;
+// Uniform block binding point of the bone palette. The last one tracked by RenderSystem, so that it stays clear of the blocks numbered from 0 by the application.
+static const unsigned SKINNING_PALETTE_BINDING = 15;
+// Shader keyword of the skinned variant, see GetSkinningShaderSource().
+static const char* const SKINNING_KEYWORD = "SKINNING";
+
+// Transform of one bone for a frame: the inverse bind pose followed by the frame pose.
+struct SkinningMatrix
+{
+	// Rows of the affine 3x4 matrix applied to positions.
+	float position[12];
+	// Rows of the 3x3 rotation applied to normals, padded to four floats like the position rows.
+	float normal[12];
+};
+
+// Bone palette of a GPU skinned model: three vec4 rows per bone and the frame uniform ring range they were last pushed to.
+struct SkinningPalette
+{
+	std::vector<float> rows;
+	UniformRingRange range;
+};
+
+// Skinning input of a mesh in SoA form: one stream per component, so that SKINNING_BLOCK_SIZE vertices load with one SIMD read per component.
+struct SkinnedMeshData
+{
+	// Build the streams from the AoS arrays of the mesh. Return false if the mesh has no bone data.
+	bool Create(const NewMesh& mesh);
+
+	unsigned vertexCount = 0;
+	std::vector<float> positions[3];
+	std::vector<float> normals[3];
+	std::vector<uint8_t> boneIds[SKINNING_MAX_INFLUENCES];
+	std::vector<float> boneWeights[SKINNING_MAX_INFLUENCES];
+};
+
+// Build the matrix palette of a frame, once per frame instead of once per vertex influence. Without normals SkinningMatrix::normal is left unset, for the GPU palette.
+void BuildSkinningPalette(std::vector<SkinningMatrix>& palette, const TempTransform* bindPose, const TempTransform* framePose, int boneCount, bool normals = true);
+// Skin vertices [begin, end) with linear blend skinning. Destination holds the vertices [begin, end); their positions and normals are skinned and the other attributes are copied from source, so that a mapped range with invalidated contents can be written.
+void SkinVertices(NewMeshVertex* destination, const NewMeshVertex* source, const SkinnedMeshData& data, std::span<const SkinningMatrix> palette, unsigned begin, unsigned end);
+// Skin all vertices of a mesh, split into batches of at least batchSize vertices across the JobSystem threads.
+void SkinMesh(NewMeshVertex* destination, const NewMeshVertex* source, const SkinnedMeshData& data, std::span<const SkinningMatrix> palette, unsigned batchSize = DEFAULT_SKINNING_BATCH_SIZE);
+
+// Bones in the GPU palette of a skeleton: the smallest power of two from MIN_GPU_SKINNING_BONES that covers boneCount, at most MAX_GPU_SKINNING_BONES.
+unsigned GetSkinningPaletteBones(int boneCount);
+// Create the palette of a skeleton with GetSkinningPaletteBones() bones, filled with identity matrices so that the bind pose is drawn until the first update.
+SkinningPalette CreateSkinningPalette(int boneCount);
+// Copy the position matrices into the rows, 48 bytes per bone instead of the whole vertex buffer of every mesh. The rows are pushed again on the next bind.
+void UpdateSkinningPaletteRows(SkinningPalette& palette, std::span<const SkinningMatrix> matrices);
+// Bind the rows to SKINNING_PALETTE_BINDING. They are pushed to the frame uniform ring on the first bind of a frame, so that a palette the GPU still reads is never overwritten,
+// and the meshes drawn after that bind the same range again. Return false if the ring is disabled or full.
+bool PushSkinningPalette(SkinningPalette& palette);
+// Bind the "BonePalette" uniform block of a program to SKINNING_PALETTE_BINDING. Programs without the block are ignored.
+void SetSkinningPaletteBinding(ShaderProgramRef program);
+// GLSL declarations of the skinned variant, to insert in a vertex shader after the #version line. With SKINNING defined (a ShaderLibrary keyword) it declares the bone inputs,
+// the palette block and GetSkinningMatrix(), SkinPosition(), SkinNormal(); without it, it is empty, so one source gives both the static and the skinned variant:
+//	#ifdef SKINNING
+//		mat3x4 skin = GetSkinningMatrix();
+//		position = SkinPosition(skin, position);
+//		normal = normalize(SkinNormal(skin, normal));
+//	#endif
+// The block holds paletteBones bones (SKINNING_MAX_BONES in GLSL) and must match the GetSkinningPaletteBones() of the models the program draws, a smaller palette leaves the shader reads undefined.
+// Unlike the CPU path, normals go through the scaled position matrix, which keeps the palette at one matrix per bone.
+const std::string& GetSkinningShaderSource(unsigned paletteBones = MAX_GPU_SKINNING_BONES);
\ No newline at end of file
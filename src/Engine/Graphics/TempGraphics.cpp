@@ -1,6 +1,9 @@
 #include "stdafx.h"
 #include "GraphicsResource.h"
 #include "GraphicsSystem.h"
+#include "MeshOptimizer.h"
+#include "Skinning.h"
+#include "AnimationClip.h"
 #include "Core/IO/FileSystem.h"
 #include "RenderAPI/RenderSystem.h"
 //-----------------------------------------------------------------------------
@@ -17,6 +20,18 @@ const std::vector<VertexAttribute> NewMeshVertex::GetAttribs()
 	};
 }
 //-----------------------------------------------------------------------------
+const std::vector<VertexAttribute> SkinnedMeshVertex::GetAttribs()
+{
+	// The NewMeshVertex attributes keep their offsets, the vertex is the first member
+	std::vector<VertexAttribute> attribs = NewMeshVertex::GetAttribs();
+	for (VertexAttribute& attrib : attribs)
+		attrib.stride = sizeof(SkinnedMeshVertex);
+
+	attribs.push_back({ .location = SKINNING_BONE_IDS_LOCATION, .size = 4, .normalized = GL_FALSE, .stride = sizeof(SkinnedMeshVertex), .offset = (void*)offsetof(SkinnedMeshVertex, boneIds), .type = GL_UNSIGNED_BYTE, .integer = true });
+	attribs.push_back({ .location = SKINNING_BONE_WEIGHTS_LOCATION, .size = 4, .normalized = GL_FALSE, .stride = sizeof(SkinnedMeshVertex), .offset = (void*)offsetof(SkinnedMeshVertex, boneWeights) });
+	return attribs;
+}
+//-----------------------------------------------------------------------------
 NewModel LoadOBJ(const std::string& fileName);
 NewModel LoadIQM(const std::string& fileName);
 ModelAnimation* LoadModelAnimationsIQM(const std::string& fileName, unsigned int& animCount);
@@ -28,7 +43,7 @@ ModelAnimation* LoadModelAnimationsM3D(const std::string& fileName, unsigned int
 NewMaterial LoadMaterialDefault();
 //-----------------------------------------------------------------------------
 // Upload vertex data into a VAO and VBO
-void UploadMesh(NewMesh& mesh, bool dynamic)
+void UploadMesh(NewMesh& mesh, bool dynamic, SkinningMode skinning = SkinningMode::CPU)
 {
 	if (mesh.geometry != nullptr)
 	{
@@ -79,10 +94,42 @@ void UploadMesh(NewMesh& mesh, bool dynamic)
 		tc2 += 2;
 	}
 
-	mesh.geometry = GetRenderSystem().CreateGeometryBuffer(dynamic ? BufferUsage::DynamicDraw : BufferUsage::StaticDraw, mesh.vert.size(), sizeof(NewMeshVertex), mesh.vert.data(), mesh.indices.size(), IndexFormat::UInt32, mesh.indices.data(), NewMeshVertex::GetAttribs());
+	// Upload 16-bit indices when they can address every vertex
+	const IndexFormat indexFormat = SelectIndexFormat(mesh.vert.size());
+	std::vector<uint16_t> shortIndices;
+	if (indexFormat == IndexFormat::UInt16)
+		ConvertIndices16(shortIndices, mesh.indices);
+
+	const void* indexData = indexFormat == IndexFormat::UInt16 ? (const void*)shortIndices.data() : mesh.indices.data();
+	if (mesh.boneIds != nullptr && mesh.boneWeights != nullptr && skinning == SkinningMode::GPU)
+	{
+		// The bone influences become vertex attributes over the bind pose, the vertex buffer is never rewritten
+		std::vector<SkinnedMeshVertex> skinnedVertices(mesh.vert.size());
+		for (size_t i = 0; i < skinnedVertices.size(); i++)
+		{
+			SkinnedMeshVertex& skinned = skinnedVertices[i];
+			skinned.vertex = mesh.vert[i];
+			skinned.vertex.positions = { mesh.vertices[i * 3 + 0], mesh.vertices[i * 3 + 1], mesh.vertices[i * 3 + 2] };
+			if (mesh.normals != nullptr)
+				skinned.vertex.normals = { mesh.normals[i * 3 + 0], mesh.normals[i * 3 + 1], mesh.normals[i * 3 + 2] };
+			memcpy(skinned.boneIds, &mesh.boneIds[i * 4], sizeof(skinned.boneIds));
+			skinned.boneWeights = { mesh.boneWeights[i * 4 + 0], mesh.boneWeights[i * 4 + 1], mesh.boneWeights[i * 4 + 2], mesh.boneWeights[i * 4 + 3] };
+		}
+		mesh.geometry = GetRenderSystem().CreateGeometryBuffer(BufferUsage::StaticDraw, skinnedVertices.size(), sizeof(SkinnedMeshVertex), skinnedVertices.data(), mesh.indices.size(), indexFormat, indexData, SkinnedMeshVertex::GetAttribs());
+		return;
+	}
+
+	// Skinning reads the bind pose in SoA form
+	if (mesh.boneIds != nullptr && mesh.boneWeights != nullptr)
+	{
+		auto skin = std::make_shared<SkinnedMeshData>();
+		if (skin->Create(mesh)) mesh.skin = skin;
+	}
+
+	mesh.geometry = GetRenderSystem().CreateGeometryBuffer(dynamic ? BufferUsage::DynamicDraw : BufferUsage::StaticDraw, mesh.vert.size(), sizeof(NewMeshVertex), mesh.vert.data(), mesh.indices.size(), indexFormat, indexData, NewMeshVertex::GetAttribs());
 }
 //-----------------------------------------------------------------------------
-NewModel LoadModel(const std::string& fileName)
+NewModel LoadModel(const std::string& fileName, SkinningMode skinning)
 {
 	NewModel model;
 
@@ -93,9 +140,26 @@ NewModel LoadModel(const std::string& fileName)
 
 	if (model.meshes.size() > 0)
 	{
-		// Upload vertex data to GPU (static meshes)
+		// Without bones there is no palette, and without the frame uniform ring there is nowhere to push it: the meshes are uploaded for CPU skinning
+		if (skinning == SkinningMode::GPU && (model.boneCount == 0 || !GetRenderSystem().GetFrameUniforms().IsValid()))
+		{
+			if (model.boneCount > 0)
+				LogWarning("MODEL: [" + fileName + "] GPU skinning needs the frame uniform ring, default to CPU skinning");
+			skinning = SkinningMode::CPU;
+		}
+
+		// Reorder for the vertex cache and overdraw, then upload vertex data to GPU (dynamic for CPU skinned meshes)
 		for (size_t i = 0; i < model.meshes.size(); i++)
-			UploadMesh(model.meshes[i], false);
+		{
+			LogMeshOptimization(fileName + " mesh " + std::to_string(i), OptimizeMesh(model.meshes[i]));
+			UploadMesh(model.meshes[i], skinning == SkinningMode::CPU && model.meshes[i].boneIds != nullptr, skinning);
+		}
+
+		if (skinning == SkinningMode::GPU)
+		{
+			model.skinning = SkinningMode::GPU;
+			model.bonePalette = std::make_shared<SkinningPalette>(CreateSkinningPalette(model.boneCount));
+		}
 	}
 	else LogWarning("MESH: [" + fileName + "] Failed to load model mesh(es) data");
 
@@ -145,110 +209,115 @@ ModelAnimation* LoadModelAnimations(const std::string& fileName, unsigned int& a
 	return animations;
 }
 //-----------------------------------------------------------------------------
-// Update model animated vertex data (positions and normals) for a given frame
+// Skin the meshes of a model with a model space pose of its bones
 // NOTE: Updated data is uploaded to GPU
-void UpdateModelAnimation(const NewModel& model, const ModelAnimation& anim, int frame)
+void UpdateModelPose(const NewModel& model, const TempTransform* pose, int boneCount)
 {
 	auto& render = GetRenderSystem();
 
-	if ((anim.frameCount > 0) && (anim.bones != nullptr) && (anim.framePoses != nullptr))
+	// Bone transforms are combined once per frame and shared by all meshes. Main thread only, like the buffer mapping
+	static std::vector<SkinningMatrix> palette;
+	if (model.skinning == SkinningMode::GPU)
+	{
+		// The shader transforms normals with the position matrix, so the normal matrices are not built. The rows reach the GPU in BindModelSkinning()
+		BuildSkinningPalette(palette, model.bindPose, pose, std::min(model.boneCount, boneCount), false);
+		UpdateSkinningPaletteRows(*model.bonePalette, palette);
+		return;
+	}
+	BuildSkinningPalette(palette, model.bindPose, pose, std::min(model.boneCount, boneCount));
+
+	for (int m = 0; m < model.meshes.size(); m++)
+	{
+		const NewMesh& mesh = model.meshes[m];
+
+		if (mesh.skin == nullptr)
+		{
+			LogWarning("MODEL: UpdateModelAnimation(): Mesh " + std::to_string(m) + " has no connection to bones");
+			continue;
+		}
+
+		// Upload new vertex data to GPU for model drawing
+		// NOTE: Every vertex is rewritten, so the previous contents are invalidated instead of waiting for the GPU to release them
+		auto vb = mesh.geometry->GetVBO();
+		const unsigned size = static_cast<unsigned>(mesh.vert.size() * sizeof(NewMeshVertex));
+		NewMeshVertex* data = (NewMeshVertex*)render.MapBuffer(vb, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		if (data == nullptr) continue;
+		SkinMesh(data, mesh.vert.data(), *mesh.skin, palette);
+		render.UnmapBuffer(vb);
+	}
+}
+//-----------------------------------------------------------------------------
+// Sample the model space pose of an animation with a clip
+static const TempTransform* SampleAnimationPose(const ModelAnimation& anim, AnimationCursor& cursor, float time)
+{
+	static std::vector<TempTransform> pose;
+	pose.resize(anim.boneCount);
+	anim.clip->Sample(time, cursor, pose.data());
+	BuildPoseFromParentJoints(anim.bones, anim.boneCount, pose.data());
+	return pose.data();
+}
+//-----------------------------------------------------------------------------
+// Update model animated vertex data (positions and normals) for a given frame
+void UpdateModelAnimation(const NewModel& model, const ModelAnimation& anim, int frame)
+{
+	PROFILE_SCOPE("UpdateModelAnimation");
+
+	if ((anim.frameCount > 0) && (anim.bones != nullptr))
 	{
 		if (frame >= anim.frameCount) frame = frame % anim.frameCount;
 
-		for (int m = 0; m < model.meshes.size(); m++)
+		if (anim.clip != nullptr)
+		{
+			// The cursor of the animation keeps the keys between frames, a hand-built animation without one searches every track
+			AnimationCursor localCursor;
+			AnimationCursor& cursor = (anim.cursor != nullptr) ? *anim.cursor : localCursor;
+			UpdateModelPose(model, SampleAnimationPose(anim, cursor, frame * anim.clip->GetFrameTime()), anim.boneCount);
+		}
+		else if (anim.framePoses != nullptr)
+			UpdateModelPose(model, anim.framePoses[frame], anim.boneCount);
+	}
+}
+//-----------------------------------------------------------------------------
+// Update model animated vertex data (positions and normals) for a given time
+void UpdateModelAnimation(const NewModel& model, const ModelAnimation& anim, AnimationCursor& cursor, float time)
+{
+	PROFILE_SCOPE("UpdateModelAnimation");
+
+	if ((anim.clip != nullptr) && (anim.bones != nullptr))
+		UpdateModelPose(model, SampleAnimationPose(anim, cursor, time), anim.boneCount);
+}
+//-----------------------------------------------------------------------------
+void UnloadModelAnimations(ModelAnimation* animations, unsigned int animCount)
+{
+	if (animations == nullptr) return;
+
+	for (unsigned int i = 0; i < animCount; i++)
+	{
+		if (animations[i].framePoses != nullptr)
 		{
-			const NewMesh& mesh = model.meshes[m];
-
-			if (mesh.boneIds == nullptr || mesh.boneWeights == nullptr)
-			{
-				LogWarning("MODEL: UpdateModelAnimation(): Mesh " + std::to_string(m) + " has no connection to bones");
-				continue;
-			}
-
-			bool updated = false; // Flag to check when anim vertex information is updated
-			glm::vec3 animVertex = glm::vec3{ 0 };
-			glm::vec3 animNormal = glm::vec3{ 0 };
-
-			glm::vec3 inTranslation = glm::vec3{ 0 };
-			glm::quat inRotation = glm::quat(1, 0, 0, 0);
-
-			glm::vec3 outTranslation = glm::vec3{ 0 };
-			glm::quat outRotation = glm::quat(1, 0, 0, 0);
-			glm::vec3 outScale = glm::vec3{ 0 };
-
-			int boneId = 0;
-			int boneCounter = 0;
-			float boneWeight = 0.0;
-
-			const int vValues = mesh.vertexCount * 3;
-			for (int vCounter = 0; vCounter < vValues; vCounter += 3)
-			{
-				mesh.animVertices[vCounter] = 0;
-				mesh.animVertices[vCounter + 1] = 0;
-				mesh.animVertices[vCounter + 2] = 0;
-				if (mesh.animNormals != nullptr)
-				{
-					mesh.animNormals[vCounter] = 0;
-					mesh.animNormals[vCounter + 1] = 0;
-					mesh.animNormals[vCounter + 2] = 0;
-				}
-
-				// Iterates over 4 bones per vertex
-				for (int j = 0; j < 4; j++, boneCounter++)
-				{
-					boneWeight = mesh.boneWeights[boneCounter];
-
-					// Early stop when no transformation will be applied
-					if (boneWeight == 0.0f) continue;
-
-					boneId = mesh.boneIds[boneCounter];
-					inTranslation = model.bindPose[boneId].translation;
-					inRotation = model.bindPose[boneId].rotation;
-					outTranslation = anim.framePoses[frame][boneId].translation;
-					outRotation = anim.framePoses[frame][boneId].rotation;
-					outScale = anim.framePoses[frame][boneId].scale;
-
-					// Vertices processing
-					// NOTE: We use meshes.vertices (default vertex position) to calculate meshes.animVertices (animated vertex position)
-					animVertex = { mesh.vertices[vCounter + 0], mesh.vertices[vCounter + 1], mesh.vertices[vCounter + 2] };
-					animVertex = animVertex - inTranslation;
-					animVertex = animVertex * outScale;
-					animVertex = (outRotation * glm::inverse(inRotation)) * animVertex; // Vector3RotateByQuaternion
-					animVertex = animVertex + outTranslation;
-					mesh.animVertices[vCounter + 0] += animVertex.x * boneWeight;
-					mesh.animVertices[vCounter + 1] += animVertex.y * boneWeight;
-					mesh.animVertices[vCounter + 2] += animVertex.z * boneWeight;
-					updated = true;
-
-					// Normals processing
-					// NOTE: We use meshes.baseNormals (default normal) to calculate meshes.normals (animated normals)
-					if (mesh.normals != nullptr)
-					{
-						animNormal = { mesh.normals[vCounter], mesh.normals[vCounter + 1], mesh.normals[vCounter + 2] };
-						animNormal = (outRotation * glm::inverse(inRotation)) * animNormal; // Vector3RotateByQuaternion
-						mesh.animNormals[vCounter + 0] += animNormal.x * boneWeight;
-						mesh.animNormals[vCounter + 1] += animNormal.y * boneWeight;
-						mesh.animNormals[vCounter + 2] += animNormal.z * boneWeight;
-					}
-				}
-			}
-
-			// Upload new vertex data to GPU for model drawing
-			// NOTE: Only update data when values changed
-			if (updated)
-			{
-				auto vb = mesh.geometry->GetVBO();
-
-				NewMeshVertex* data = (NewMeshVertex*)render.MapBuffer(vb);
-				for (size_t i = 0, v = 0; i < mesh.vert.size(); i++)
-				{
-					data[i].positions = { mesh.animVertices[v + 0], mesh.animVertices[v + 1], mesh.animVertices[v + 2] };
-					data[i].normals = { mesh.animNormals[v + 0], mesh.animNormals[v + 1], mesh.animNormals[v + 2] };
-					v += 3;
-				}
-				render.UnmapBuffer(vb);
-			}
+			for (int j = 0; j < animations[i].frameCount; j++) free(animations[i].framePoses[j]);
+			free(animations[i].framePoses);
 		}
+		free(animations[i].bones);
+		delete animations[i].clip;
+		delete animations[i].cursor;
+	}
+	free(animations);
+}
+//-----------------------------------------------------------------------------
+bool BindModelSkinning(const NewModel& model)
+{
+	if (model.bonePalette == nullptr) return true;
+	if (PushSkinningPalette(*model.bonePalette)) return true;
+
+	// Logged once per frame, the following draws of the frame fail the same way
+	static uint64_t loggedFrame = ~0ull;
+	const uint64_t frame = GetRenderSystem().GetFrameUniforms().GetFrameNumber();
+	if (frame != loggedFrame)
+	{
+		LogError("MODEL: Bone palette of " + std::to_string(model.bonePalette->rows.size() / 12) + " bones could not be pushed, the frame uniform ring is disabled or full");
+		loggedFrame = frame;
 	}
+	return false;
 }
 //-----------------------------------------------------------------------------
\ No newline at end of file
@@ -3,5 +3,9 @@
 //-----------------------------------------------------------------------------
 uint32_t Capabilities::maximumTextureDimension;
 uint32_t Capabilities::maximumTextureUnitCount;
+uint32_t Capabilities::maximumUniformBufferBindings;
+uint32_t Capabilities::uniformBufferOffsetAlignment;
 uint32_t Capabilities::maximumUniformBufferSize;
+uint32_t Capabilities::maximumShaderStorageBufferBindings;
+uint32_t Capabilities::shaderStorageBufferOffsetAlignment;
 //-----------------------------------------------------------------------------
\ No newline at end of file
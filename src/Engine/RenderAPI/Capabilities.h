@@ -4,5 +4,9 @@ namespace Capabilities
 {
 	extern uint32_t maximumTextureDimension;  // Maximum texture dimension (usually 2048, 4096, 8192 or 16384)
 	extern uint32_t maximumTextureUnitCount;
+	extern uint32_t maximumUniformBufferBindings; // Maximum number of uniform buffer binding points
+	extern uint32_t uniformBufferOffsetAlignment; // Required alignment of uniform buffer ranges (usually 16 to 256 bytes)
 	extern uint32_t maximumUniformBufferSize; // Maximum uniform buffer (UBO) size in bytes (usually at least 4096 *16 bytes, in case there's no support for uniform buffer it's 0)
+	extern uint32_t maximumShaderStorageBufferBindings; // Maximum number of shader storage buffer binding points (0 before OpenGL 4.3)
+	extern uint32_t shaderStorageBufferOffsetAlignment; // Required alignment of shader storage buffer ranges
 }
\ No newline at end of file
@@ -0,0 +1,159 @@
+#include "stdafx.h"
+#include "GPUProfiler.h"
+#include "RenderSystem.h"
+//-----------------------------------------------------------------------------
+// frame begin and end queries, then a begin and end query per scope
+constexpr unsigned GPUProfilerFrameQueries = 2 + MaxGPUProfilerScopes * 2;
+//-----------------------------------------------------------------------------
+bool GPUProfiler::Create()
+{
+	Destroy();
+#if PLATFORM_EMSCRIPTEN
+	// WebGL only exposes timer queries through the disjoint timer query extension
+	return false;
+#else
+	for (Frame& frame : m_frames)
+	{
+		frame.queries.resize(GPUProfilerFrameQueries);
+		glGenQueries(GPUProfilerFrameQueries, frame.queries.data());
+		frame.scopes.reserve(MaxGPUProfilerScopes);
+	}
+	m_currentFrame = 0;
+	m_valid = true;
+	beginFrame(m_frames[m_currentFrame]);
+	return true;
+#endif
+}
+//-----------------------------------------------------------------------------
+void GPUProfiler::Destroy()
+{
+	for (Frame& frame : m_frames)
+	{
+		if (!frame.queries.empty())
+			glDeleteQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+		frame = {};
+	}
+	m_events.clear();
+	m_frameTime = 0.0;
+	m_valid = false;
+}
+//-----------------------------------------------------------------------------
+void GPUProfiler::BeginScope(const char* name)
+{
+	if (!m_valid) return;
+	Frame& frame = m_frames[m_currentFrame];
+
+	if (!GetProfiler().IsEnabled() || frame.usedQueries + 2 > frame.queries.size())
+	{
+		frame.openScopes.push_back(InvalidScope);
+		return;
+	}
+
+#if !PLATFORM_EMSCRIPTEN
+	const unsigned beginQuery = frame.usedQueries;
+	frame.usedQueries += 2;
+	glQueryCounter(frame.queries[beginQuery], GL_TIMESTAMP);
+
+	frame.openScopes.push_back(static_cast<unsigned>(frame.scopes.size()));
+	frame.scopes.push_back({ name, beginQuery, 0, static_cast<uint32_t>(frame.openScopes.size()) });
+#endif
+}
+//-----------------------------------------------------------------------------
+void GPUProfiler::EndScope()
+{
+	if (!m_valid) return;
+	Frame& frame = m_frames[m_currentFrame];
+	assert(!frame.openScopes.empty());
+	if (frame.openScopes.empty()) return;
+
+	const unsigned index = frame.openScopes.back();
+	frame.openScopes.pop_back();
+	if (index == InvalidScope) return;
+
+#if !PLATFORM_EMSCRIPTEN
+	Scope& scope = frame.scopes[index];
+	scope.endQuery = scope.beginQuery + 1;
+	glQueryCounter(frame.queries[scope.endQuery], GL_TIMESTAMP);
+#endif
+}
+//-----------------------------------------------------------------------------
+void GPUProfiler::NextFrame()
+{
+	if (!m_valid) return;
+
+#if !PLATFORM_EMSCRIPTEN
+	Frame& frame = m_frames[m_currentFrame];
+	// scopes left open are closed by the end of the frame
+	while (!frame.openScopes.empty())
+		EndScope();
+	glQueryCounter(frame.queries[1], GL_TIMESTAMP);
+
+	m_currentFrame = (m_currentFrame + 1) % GPUProfilerFrames;
+	Frame& nextFrame = m_frames[m_currentFrame];
+	if (nextFrame.active)
+		resolveFrame(nextFrame);
+	beginFrame(nextFrame);
+#endif
+}
+//-----------------------------------------------------------------------------
+void GPUProfiler::beginFrame(Frame& frame)
+{
+#if !PLATFORM_EMSCRIPTEN
+	Profiler& profiler = GetProfiler();
+	frame.scopes.clear();
+	frame.openScopes.clear();
+	frame.usedQueries = 2;
+	frame.profilerFrame = profiler.GetFrameIndex();
+
+	// the GPU clock has its own origin, measure it against the profiler clock once per frame
+	GLint64 gpuTime = 0;
+	glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+	frame.timeOffset = profiler.GetTime() - static_cast<int64_t>(gpuTime);
+
+	glQueryCounter(frame.queries[0], GL_TIMESTAMP);
+	frame.active = true;
+#endif
+}
+//-----------------------------------------------------------------------------
+void GPUProfiler::resolveFrame(Frame& frame)
+{
+#if !PLATFORM_EMSCRIPTEN
+	frame.active = false;
+
+	// the frame end query is the last one issued, once it is available all the others are
+	GLint available = 0;
+	glGetQueryObjectiv(frame.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available) return;
+
+	GLuint64 frameBegin = 0;
+	GLuint64 frameEnd = 0;
+	glGetQueryObjectui64v(frame.queries[0], GL_QUERY_RESULT, &frameBegin);
+	glGetQueryObjectui64v(frame.queries[1], GL_QUERY_RESULT, &frameEnd);
+	m_frameTime = static_cast<double>(frameEnd - frameBegin) * 1.0e-6;
+
+	m_events.clear();
+	m_events.push_back({ "GPU Frame", static_cast<int64_t>(frameBegin) + frame.timeOffset, static_cast<int64_t>(frameEnd) + frame.timeOffset, PROFILER_GPU_THREAD_ID, 0 });
+	for (const Scope& scope : frame.scopes)
+	{
+		if (!scope.endQuery) continue;
+
+		GLuint64 begin = 0;
+		GLuint64 end = 0;
+		glGetQueryObjectui64v(frame.queries[scope.beginQuery], GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(frame.queries[scope.endQuery], GL_QUERY_RESULT, &end);
+		m_events.push_back({ scope.name, static_cast<int64_t>(begin) + frame.timeOffset, static_cast<int64_t>(end) + frame.timeOffset, PROFILER_GPU_THREAD_ID, scope.depth });
+	}
+	GetProfiler().AddFrameEvents(frame.profilerFrame, m_events);
+#endif
+}
+//-----------------------------------------------------------------------------
+GPUProfileScope::GPUProfileScope(const char* name)
+{
+	GetRenderSystem().GetGPUProfiler().BeginScope(name);
+}
+//-----------------------------------------------------------------------------
+GPUProfileScope::~GPUProfileScope()
+{
+	GetRenderSystem().GetGPUProfiler().EndScope();
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
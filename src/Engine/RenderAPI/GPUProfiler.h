@@ -0,0 +1,88 @@
+#pragma once
+
+#include "OpenGLCore.h"
+#include "Core/Debug/Profiler.h"
+
+constexpr unsigned GPUProfilerFrames = 2;
+constexpr unsigned MaxGPUProfilerScopes = 256;
+
+// GPU scope timing with GL_TIMESTAMP queries, so scopes can nest unlike GL_TIME_ELAPSED queries. The queries of a frame are double-buffered and read back one frame later without waiting; a frame whose results are not available yet is dropped instead of stalling.
+// Resolved scopes are added to the Profiler frame they were issued in. Not available on WebGL.
+class GPUProfiler final
+{
+public:
+	GPUProfiler() = default;
+	~GPUProfiler() { Destroy(); }
+
+	bool Create();
+	void Destroy();
+
+	// Open a scope of the current frame. The name must outlive the profiler, usually a string literal.
+	void BeginScope(const char* name);
+	void EndScope();
+
+	// Close the current frame, read back the previous one and start the next. Called by RenderSystem::EndFrame().
+	void NextFrame();
+
+	bool IsValid() const { return m_valid; }
+	// GPU time of the last resolved frame in milliseconds.
+	double GetFrameTime() const { return m_frameTime; }
+
+private:
+	GPUProfiler(GPUProfiler&&) = delete;
+	GPUProfiler(const GPUProfiler&) = delete;
+	GPUProfiler& operator=(GPUProfiler&&) = delete;
+	GPUProfiler& operator=(const GPUProfiler&) = delete;
+
+	struct Scope
+	{
+		const char* name;
+		unsigned beginQuery;
+		unsigned endQuery;
+		uint32_t depth;
+	};
+
+	struct Frame
+	{
+		// first two queries are the frame begin and end
+		std::vector<GLuint> queries;
+		std::vector<Scope> scopes;
+		// open scopes, InvalidScope for the scopes ignored when the profiler was disabled or full
+		std::vector<unsigned> openScopes;
+		unsigned usedQueries = 0;
+		uint64_t profilerFrame = 0;
+		// added to the GPU timestamps to move them to the Profiler timeline
+		int64_t timeOffset = 0;
+		bool active = false;
+	};
+
+	static constexpr unsigned InvalidScope = ~0u;
+
+	void beginFrame(Frame& frame);
+	void resolveFrame(Frame& frame);
+
+	Frame m_frames[GPUProfilerFrames];
+	unsigned m_currentFrame = 0;
+	std::vector<ProfilerEvent> m_events;
+	double m_frameTime = 0.0;
+	bool m_valid = false;
+};
+
+// Records the GPU time of the commands issued during the lifetime of the object.
+class GPUProfileScope final
+{
+public:
+	explicit GPUProfileScope(const char* name);
+	~GPUProfileScope();
+
+private:
+	GPUProfileScope(const GPUProfileScope&) = delete;
+	GPUProfileScope& operator=(const GPUProfileScope&) = delete;
+};
+
+#if USE_PROFILER
+// Profile the GPU commands of the enclosing scope. Main thread only, the name must be a string literal.
+#	define PROFILE_GPU_SCOPE(name) GPUProfileScope PROFILE_CONCAT(gpuProfileScope, __LINE__)(name)
+#else
+#	define PROFILE_GPU_SCOPE(name)
+#endif
\ No newline at end of file
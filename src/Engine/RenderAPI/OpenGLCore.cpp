@@ -4,4 +4,5 @@
 uint8_t OpenGLExtensions::version;
 bool OpenGLExtensions::coreDebug;
 bool OpenGLExtensions::coreDirectStateAccess;
+bool OpenGLExtensions::parallelShaderCompile;
 //-----------------------------------------------------------------------------
\ No newline at end of file
@@ -16,4 +16,5 @@ namespace OpenGLExtensions
 	extern uint8_t version;
 	extern bool coreDebug;
 	extern bool coreDirectStateAccess;
+	extern bool parallelShaderCompile; // GL_KHR_parallel_shader_compile or GL_ARB_parallel_shader_compile
 }
\ No newline at end of file
@@ -358,6 +358,43 @@
 	return 0;
 }
 //-----------------------------------------------------------------------------
+[[nodiscard]] inline constexpr unsigned SizeUniformType(UniformType type)
+{
+	switch (type)
+	{
+	case UniformType::Int:   return sizeof(int);
+	case UniformType::UInt:  return sizeof(unsigned);
+	case UniformType::Float: return sizeof(float);
+	case UniformType::Vec2:  return sizeof(float) * 2;
+	case UniformType::Vec3:  return sizeof(float) * 3;
+	case UniformType::Vec4:  return sizeof(float) * 4;
+	case UniformType::Mat3:  return sizeof(float) * 9;
+	case UniformType::Mat4:  return sizeof(float) * 16;
+	default: break;
+	}
+	assert(false && "Unknown UniformType");
+	return 0;
+}
+//-----------------------------------------------------------------------------
+[[nodiscard]] inline constexpr unsigned SizeTexelsFormat(TexelsFormat format)
+{
+	switch (format)
+	{
+	case TexelsFormat::R_U8:             return 1;
+	case TexelsFormat::RG_U8:            return 2;
+	case TexelsFormat::RGB_U8:           return 3;
+	case TexelsFormat::RGBA_U8:          return 4;
+	case TexelsFormat::R_F32:            return sizeof(float);
+	case TexelsFormat::RG_F32:           return sizeof(float) * 2;
+	case TexelsFormat::Depth_U16:        return sizeof(uint16_t);
+	case TexelsFormat::DepthStencil_U16: return sizeof(uint32_t);
+	case TexelsFormat::Depth_U24:        return sizeof(uint32_t);
+	case TexelsFormat::DepthStencil_U24: return sizeof(uint32_t);
+	default: break;
+	}
+	return 0;
+}
+//-----------------------------------------------------------------------------
 [[nodiscard]] inline constexpr unsigned SizeIndexType(unsigned size)
 {
 	switch (size)
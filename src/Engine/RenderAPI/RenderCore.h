@@ -15,6 +15,7 @@ enum class ResourceType : uint8_t
 	IndexBuffer,
 	VertexArray,
 	Texture2D,
+	Sampler,
 	Framebuffer
 };
 
@@ -177,6 +178,18 @@ enum class ShaderPipelineStage : uint8_t
 #endif // PLATFORM_EMSCRIPTEN
 };
 
+enum class UniformType : uint8_t
+{
+	Int,
+	UInt,
+	Float,
+	Vec2,
+	Vec3,
+	Vec4,
+	Mat3,
+	Mat4
+};
+
 //=============================================================================
 // GPUBuffer enum
 //=============================================================================
@@ -437,6 +450,8 @@ struct DepthState final
 	ComparisonFunction compareFunction = ComparisonFunction::Less;
 	bool enable = true;
 	bool depthWrite = true;
+
+	bool operator==(const DepthState&) const = default;
 };
 
 struct StencilState final
@@ -456,6 +471,8 @@ struct StencilState final
 	StencilOperation   backFaceStencilDepthFailureOperation = StencilOperation::Keep;
 
 	int stencilRef = 0;
+
+	bool operator==(const StencilState&) const = default;
 };
 
 struct DepthStencilState final
@@ -476,6 +493,17 @@ struct BlendState final
 
 	ColorMask colorMask = ColorMask::All;
 	bool enable = false;
+
+	bool operator==(const BlendState&) const = default;
+};
+
+// Alpha blending, the blend state the RenderSystem starts with.
+constexpr BlendState AlphaBlendState = {
+	.colorBlendSource = BlendFactor::SourceAlpha,
+	.colorBlendDest = BlendFactor::InverseSourceAlpha,
+	.alphaBlendSource = BlendFactor::SourceAlpha,
+	.alphaBlendDest = BlendFactor::InverseSourceAlpha,
+	.enable = true
 };
 
 
@@ -510,6 +538,8 @@ struct DepthBiasDescriptor
 	float slopeFactor = 0.0f;
 	// Specifies the maximum (or minimum) depth bias of a fragment. By default 0.0.	
 	float clamp = 0.0f;
+
+	bool operator==(const DepthBiasDescriptor&) const = default;
 };
 
 inline bool IsPolygonOffsetEnabled(const DepthBiasDescriptor& desc)
@@ -537,6 +567,8 @@ struct RasterizerState final
 	bool antiAliasedLineEnabled = false;
 	// Specifies the width of all generated line primitives. 
 	float lineWidth = 1.0f;
+
+	bool operator==(const RasterizerState&) const = default;
 };
 
 
@@ -581,12 +613,13 @@ public:
 			return;
 		}
 #endif
-		size_t macroEnd = m_sourceCode.find('\n', macroPos);
+		// only the value is formatted, the source is edited in place
+		const size_t valuePos = macroPos + strlen("#define ") + macroName.length();
+		const size_t macroEnd = m_sourceCode.find('\n', valuePos);
 
-		std::stringstream sstream;
-		sstream << m_sourceCode.substr(0, macroPos + strlen("#define ") + macroName.length());
-		sstream << ' ' << value << m_sourceCode.substr(macroEnd);
-		m_sourceCode = sstream.str();
+		std::ostringstream valueStream;
+		valueStream << ' ' << value;
+		m_sourceCode.replace(valuePos, macroEnd == std::string::npos ? std::string::npos : macroEnd - valuePos, valueStream.str());
 	}
 
 	static std::string GetHeaderVertexShader();
@@ -614,6 +647,62 @@ struct Uniform final
 	unsigned programId = 0;
 };
 
+// Uniform block of a shader program, bound to a uniform buffer binding point.
+struct UniformBlock final
+{
+	unsigned index = 0xFFFFFFFFu; // GL_INVALID_INDEX
+	unsigned programId = 0;
+	unsigned dataSize = 0;        // std140 size of the block in bytes
+};
+
+// Member of a uniform block as laid out by the driver (std140 for blocks declared with layout(std140)).
+struct UniformBlockMemberInfo final
+{
+	std::string name;
+	unsigned type;    // GL type, e.g. GL_FLOAT_VEC4
+	int offset;       // byte offset from the start of the block
+	int arraySize;    // 1 for non-arrays
+	int arrayStride;  // bytes between array elements, 0 for non-arrays
+	int matrixStride; // bytes between matrix columns, 0 for non-matrices
+};
+
+struct UniformBlockInfo final
+{
+	std::string name;
+	unsigned index;
+	unsigned dataSize;
+	std::vector<UniformBlockMemberInfo> members; // sorted by offset
+};
+
+// Uniform of the default block of a program, samplers included.
+struct ShaderUniformInfo final
+{
+	std::string name;         // arrays without the [0] suffix
+	unsigned type = 0;        // GL type, e.g. GL_FLOAT_VEC4
+	int location = -1;
+	int arraySize = 1;
+	bool sampler = false;
+	unsigned valueOffset = 0; // last written value in ShaderProgram::uniformValues
+	unsigned valueSize = 0;   // 0 if the value is not cached
+};
+
+template<typename T> struct UniformTypeOf;
+template<> struct UniformTypeOf<int> { static constexpr UniformType value = UniformType::Int; };
+template<> struct UniformTypeOf<unsigned> { static constexpr UniformType value = UniformType::UInt; };
+template<> struct UniformTypeOf<float> { static constexpr UniformType value = UniformType::Float; };
+template<> struct UniformTypeOf<glm::vec2> { static constexpr UniformType value = UniformType::Vec2; };
+template<> struct UniformTypeOf<glm::vec3> { static constexpr UniformType value = UniformType::Vec3; };
+template<> struct UniformTypeOf<glm::vec4> { static constexpr UniformType value = UniformType::Vec4; };
+template<> struct UniformTypeOf<glm::mat3> { static constexpr UniformType value = UniformType::Mat3; };
+template<> struct UniformTypeOf<glm::mat4> { static constexpr UniformType value = UniformType::Mat4; };
+
+// Uniform resolved once through the program reflection table, with the value type checked against the shader.
+template<typename T>
+struct ShaderParameter final
+{
+	Uniform uniform;
+};
+
 //=============================================================================
 // Buffer Core
 //=============================================================================
@@ -622,12 +711,35 @@ struct VertexAttribute final
 {
 	unsigned location/* = -1*/;  //  -1,     
 	int size;
-	//unsigned type;
 	bool normalized;
 	int stride;         // sizeof Vertex
 	const void* offset; // (void*)offsetof(Vertex, TexCoord)}
+	unsigned divisor = 0; // 0 - per vertex, N - advances once per N instances
+	unsigned type = GL_FLOAT; // component type in the buffer: GL_FLOAT, GL_UNSIGNED_BYTE...
+	bool integer = false; // integer components are read by int/uint shader inputs as is instead of being converted to float
 };
 
+#if !PLATFORM_EMSCRIPTEN
+// Layout of an indexed draw in a DrawIndirectBuffer, as read by glMultiDrawElementsIndirect.
+struct DrawElementsIndirectCommand final
+{
+	uint32_t count;
+	uint32_t instanceCount;
+	uint32_t firstIndex;
+	int32_t baseVertex;
+	uint32_t baseInstance;
+};
+
+// Layout of a non-indexed draw in a DrawIndirectBuffer, as read by glMultiDrawArraysIndirect.
+struct DrawArraysIndirectCommand final
+{
+	uint32_t count;
+	uint32_t instanceCount;
+	uint32_t first;
+	uint32_t baseInstance;
+};
+#endif
+
 //=============================================================================
 // Texture Core
 //=============================================================================
@@ -643,6 +755,23 @@ struct Texture2DInfo final
 	bool mipmap = true;
 };
 
+// Sampling parameters of a sampler object. A sampler bound to a texture slot overrides the parameters stored in the texture.
+struct SamplerState final
+{
+	TextureMinFilter minFilter = TextureMinFilter::Linear;
+	TextureMagFilter magFilter = TextureMagFilter::Linear;
+	TextureAddressMode wrapS = TextureAddressMode::Repeat;
+	TextureAddressMode wrapT = TextureAddressMode::Repeat;
+	TextureAddressMode wrapR = TextureAddressMode::Repeat;
+	float minLod = -1000.0f;
+	float maxLod = 1000.0f;
+	// depth comparison for shadow map lookups with sampler2DShadow
+	ComparisonFunction compareFunction = ComparisonFunction::LessEqual;
+	bool compareEnable = false;
+
+	bool operator==(const SamplerState&) const = default;
+};
+
 struct Texture2DCreateInfo final
 {
 	TexelsFormat format = TexelsFormat::RGBA_U8;
@@ -0,0 +1,258 @@
+#include "stdafx.h"
+#include "RenderQueue.h"
+#include "RenderSystem.h"
+#include "OpenGLTranslateToGL.h"
+#include "Core/Threading/JobSystem.h"
+//-----------------------------------------------------------------------------
+static const unsigned RADIX_BITS = 8;
+static const unsigned RADIX_BUCKETS = 1u << RADIX_BITS;
+static const unsigned RADIX_PASSES = 64 / RADIX_BITS;
+//-----------------------------------------------------------------------------
+uint64_t MakeRenderSortKey(unsigned layer, bool translucent, unsigned program, unsigned material, float depth)
+{
+	const uint64_t maxDepth = (1ull << RenderSortKeyDepthBits) - 1;
+	// NaN depth ends up in front
+	depth = depth > 0.0f ? std::min(depth, 1.0f) : 0.0f;
+	uint64_t depthBits = static_cast<uint64_t>(depth * static_cast<float>(maxDepth));
+
+	const uint64_t layerBits = layer & ((1u << RenderSortKeyLayerBits) - 1);
+	const uint64_t programBits = program & ((1u << RenderSortKeyProgramBits) - 1);
+	const uint64_t materialBits = material & ((1u << RenderSortKeyMaterialBits) - 1);
+
+	uint64_t key = layerBits << 60;
+	if (!translucent)
+	{
+		// opaque draws are grouped by state, front to back within a state
+		key |= programBits << (RenderSortKeyMaterialBits + RenderSortKeyDepthBits);
+		key |= materialBits << RenderSortKeyDepthBits;
+		key |= depthBits;
+	}
+	else
+	{
+		// translucent draws must blend back to front, state only breaks ties
+		depthBits = maxDepth - depthBits;
+		key |= 1ull << 59;
+		key |= depthBits << (RenderSortKeyProgramBits + RenderSortKeyMaterialBits);
+		key |= programBits << RenderSortKeyMaterialBits;
+		key |= materialBits;
+	}
+	return key;
+}
+//-----------------------------------------------------------------------------
+void CommandBuffer::Draw(uint64_t sortKey, const DrawCommand& command)
+{
+	const ShaderProgramRef& program = command.pipeline ? command.pipeline->info.program : command.program;
+	assert(command.vao && command.vao->IsValid());
+	assert(program && program->IsValid());
+	assert(command.textures.size() <= MaxBindingTextures);
+	if (!command.vao || !program) return;
+
+	if (!command.pipeline && command.state && !(*command.state == m_states.back()))
+		m_states.push_back(*command.state);
+
+	Packet packet;
+	packet.vao = command.vao;
+	packet.program = program;
+	packet.pipeline = command.pipeline;
+	packet.firstTexture = static_cast<uint32_t>(m_textures.size());
+	packet.numTextures = static_cast<uint32_t>(std::min(command.textures.size(), static_cast<size_t>(MaxBindingTextures)));
+	packet.firstUniform = static_cast<uint32_t>(m_uniforms.size());
+	packet.numUniforms = static_cast<uint32_t>(command.uniforms.size());
+	packet.state = !command.pipeline && command.state ? static_cast<uint32_t>(m_states.size() - 1) : 0u;
+	packet.instanceCount = command.instanceCount;
+	packet.primitive = command.primitive;
+
+	m_textures.insert(m_textures.end(), command.textures.begin(), command.textures.begin() + packet.numTextures);
+
+	for (const UniformValue& value : command.uniforms)
+	{
+		const size_t size = static_cast<size_t>(SizeUniformType(value.type)) * value.count;
+		const size_t offset = m_uniformData.size();
+		m_uniformData.resize(offset + size);
+		if (size)
+			memcpy(m_uniformData.data() + offset, value.GetData(), size);
+		m_uniforms.push_back({ value.uniform, value.type, value.count, offset });
+	}
+
+	m_keys.push_back(sortKey);
+	m_packets.push_back(std::move(packet));
+}
+//-----------------------------------------------------------------------------
+void CommandBuffer::Clear()
+{
+	m_keys.clear();
+	m_packets.clear();
+	m_textures.clear();
+	m_uniforms.clear();
+	m_uniformData.clear();
+	m_states.clear();
+	m_states.emplace_back();
+}
+//-----------------------------------------------------------------------------
+RenderQueue::RenderQueue(unsigned numCommandBuffers)
+{
+	if (!numCommandBuffers)
+		numCommandBuffers = GetJobSystem().GetNumThreads();
+
+	m_commandBuffers.resize(std::max(numCommandBuffers, 1u));
+	for (auto& commandBuffer : m_commandBuffers)
+		commandBuffer = std::make_unique<CommandBuffer>();
+}
+//-----------------------------------------------------------------------------
+CommandBuffer& RenderQueue::GetCommandBuffer()
+{
+	const unsigned index = GetJobSystem().GetThreadIndex();
+	// threads outside of the JobSystem have no command buffer of their own
+	assert(index < m_commandBuffers.size());
+	return *m_commandBuffers[index];
+}
+//-----------------------------------------------------------------------------
+void RenderQueue::Submit()
+{
+	PROFILE_SCOPE("RenderQueue::Submit");
+	PROFILE_GPU_SCOPE("RenderQueue::Submit");
+	sort();
+
+	RenderSystem& render = GetRenderSystem();
+	m_statistics = {};
+	m_statistics.draws = static_cast<unsigned>(m_entries.size());
+
+	// track the previous packet only for the statistics, the RenderSystem state cache filters the redundant GL calls
+	const RenderStateBlock* lastState = nullptr;
+	const PipelineState* lastPipeline = nullptr;
+	const ShaderProgram* lastProgram = nullptr;
+	const VertexArray* lastVao = nullptr;
+	const Texture2D* lastTextures[MaxBindingTextures] = {};
+
+	for (const SortEntry& entry : m_entries)
+	{
+		const CommandBuffer& commandBuffer = *m_commandBuffers[entry.commandBuffer];
+		const CommandBuffer::Packet& packet = commandBuffer.m_packets[entry.packet];
+
+		if (packet.pipeline)
+		{
+			if (packet.pipeline.get() != lastPipeline)
+			{
+				render.Bind(packet.pipeline);
+				m_statistics.stateChanges++;
+			}
+			lastPipeline = packet.pipeline.get();
+			lastState = nullptr;
+			// the pipeline binds its own program, binding it again would drop the current pipeline from the cache
+			if (packet.program.get() != lastProgram)
+			{
+				lastProgram = packet.program.get();
+				m_statistics.programChanges++;
+			}
+		}
+		else
+		{
+			const RenderStateBlock& state = commandBuffer.m_states[packet.state];
+			if (&state != lastState && (!lastState || !(state == *lastState)))
+			{
+				render.Bind(state.depthState);
+				render.Bind(state.stencilState);
+				render.Bind(state.rasterizerState);
+				render.Bind(state.blendState);
+				m_statistics.stateChanges++;
+			}
+			lastState = &state;
+			lastPipeline = nullptr;
+
+			if (packet.program.get() != lastProgram)
+			{
+				render.Bind(packet.program);
+				lastProgram = packet.program.get();
+				m_statistics.programChanges++;
+			}
+		}
+
+		for (uint32_t i = 0; i < packet.numTextures; i++)
+		{
+			const Texture2DRef& texture = commandBuffer.m_textures[packet.firstTexture + i];
+			if (texture.get() != lastTextures[i])
+			{
+				render.Bind(texture, i);
+				lastTextures[i] = texture.get();
+				m_statistics.textureChanges++;
+			}
+		}
+
+		for (uint32_t i = 0; i < packet.numUniforms; i++)
+		{
+			const CommandBuffer::RecordedUniform& uniform = commandBuffer.m_uniforms[packet.firstUniform + i];
+			render.SetUniform(uniform.uniform, uniform.type, uniform.count, commandBuffer.m_uniformData.data() + uniform.offset);
+		}
+
+		if (packet.vao.get() != lastVao)
+		{
+			lastVao = packet.vao.get();
+			m_statistics.vertexArrayChanges++;
+		}
+		if (packet.instanceCount == 1)
+			render.Draw(packet.vao, packet.primitive);
+		else
+			render.DrawInstanced(packet.vao, packet.instanceCount, packet.primitive);
+	}
+
+	Clear();
+}
+//-----------------------------------------------------------------------------
+void RenderQueue::Clear()
+{
+	for (auto& commandBuffer : m_commandBuffers)
+		commandBuffer->Clear();
+	m_entries.clear();
+}
+//-----------------------------------------------------------------------------
+void RenderQueue::sort()
+{
+	m_entries.clear();
+	for (size_t i = 0; i < m_commandBuffers.size(); i++)
+	{
+		const std::vector<uint64_t>& keys = m_commandBuffers[i]->m_keys;
+		for (size_t j = 0; j < keys.size(); j++)
+			m_entries.push_back({ keys[j], static_cast<uint32_t>(i), static_cast<uint32_t>(j) });
+	}
+
+	const size_t count = m_entries.size();
+	if (count < 2) return;
+
+	// LSD radix sort, stable, so draws with equal keys keep their recording order. All histograms are built in one pass
+	uint32_t histograms[RADIX_PASSES][RADIX_BUCKETS] = {};
+	for (const SortEntry& entry : m_entries)
+	{
+		for (unsigned pass = 0; pass < RADIX_PASSES; pass++)
+			histograms[pass][(entry.key >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1)]++;
+	}
+
+	m_sortBuffer.resize(count);
+	SortEntry* source = m_entries.data();
+	SortEntry* destination = m_sortBuffer.data();
+	for (unsigned pass = 0; pass < RADIX_PASSES; pass++)
+	{
+		uint32_t* histogram = histograms[pass];
+		const unsigned shift = pass * RADIX_BITS;
+
+		// skip the digits that all keys share, typically the unused layers and the translucency bit
+		if (histogram[(source[0].key >> shift) & (RADIX_BUCKETS - 1)] == count)
+			continue;
+
+		uint32_t offset = 0;
+		for (unsigned i = 0; i < RADIX_BUCKETS; i++)
+		{
+			const uint32_t bucketSize = histogram[i];
+			histogram[i] = offset;
+			offset += bucketSize;
+		}
+
+		for (size_t i = 0; i < count; i++)
+			destination[histogram[(source[i].key >> shift) & (RADIX_BUCKETS - 1)]++] = source[i];
+
+		std::swap(source, destination);
+	}
+
+	if (source != m_entries.data())
+		m_entries.swap(m_sortBuffer);
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,182 @@
+#pragma once
+
+#include "RenderResource.h"
+
+// Bit layout of a 64-bit draw sort key, from the most significant bit:
+//   opaque:      layer(4) | translucent=0(1) | program(16) | material(19) | depth(24) front to back
+//   translucent: layer(4) | translucent=1(1) | depth(24) back to front | program(16) | material(19)
+constexpr unsigned RenderSortKeyLayerBits = 4;
+constexpr unsigned RenderSortKeyProgramBits = 16;
+constexpr unsigned RenderSortKeyMaterialBits = 19;
+constexpr unsigned RenderSortKeyDepthBits = 24;
+
+// Build the sort key of a draw. Depth is the normalized view depth in [0, 1].
+uint64_t MakeRenderSortKey(unsigned layer, bool translucent, unsigned program, unsigned material, float depth);
+// Sort key of a draw with the program and material ids taken from the program handle and a user material id.
+inline uint64_t MakeRenderSortKey(unsigned layer, bool translucent, ShaderProgramRef program, unsigned material, float depth)
+{
+	return MakeRenderSortKey(layer, translucent, program ? program->Id() : 0u, material, depth);
+}
+// Sort key of a draw grouped by pipeline state, the pipeline id takes the program bits.
+inline uint64_t MakeRenderSortKey(unsigned layer, bool translucent, PipelineStateRef pipeline, unsigned material, float depth)
+{
+	return MakeRenderSortKey(layer, translucent, pipeline ? pipeline->id : 0u, material, depth);
+}
+
+// Fixed function state of a draw packet.
+struct RenderStateBlock final
+{
+	DepthState depthState;
+	StencilState stencilState;
+	RasterizerState rasterizerState;
+	BlendState blendState = AlphaBlendState;
+
+	bool operator==(const RenderStateBlock&) const = default;
+};
+
+// Largest single uniform value stored inline in a UniformValue, a mat4.
+constexpr size_t MaxInlineUniformSize = 64;
+
+// Uniform value of a draw packet, copied when the draw is recorded.
+// Single values are stored inline, so temporaries such as { uColor, glm::vec3(1.0f) } are safe. Arrays point to the caller's data, which must live until the draw is recorded.
+struct UniformValue final
+{
+	UniformValue(const Uniform& uniform_, UniformType type_, unsigned count_, const void* data_) : uniform(uniform_), type(type_), count(count_), data(data_) {}
+	UniformValue(const Uniform& uniform_, int value_) { setInline(uniform_, UniformType::Int, &value_, sizeof value_); }
+	UniformValue(const Uniform& uniform_, unsigned value_) { setInline(uniform_, UniformType::UInt, &value_, sizeof value_); }
+	UniformValue(const Uniform& uniform_, float value_) { setInline(uniform_, UniformType::Float, &value_, sizeof value_); }
+	UniformValue(const Uniform& uniform_, const glm::vec2& value_) { setInline(uniform_, UniformType::Vec2, &value_, sizeof value_); }
+	UniformValue(const Uniform& uniform_, const glm::vec3& value_) { setInline(uniform_, UniformType::Vec3, &value_, sizeof value_); }
+	UniformValue(const Uniform& uniform_, const glm::vec4& value_) { setInline(uniform_, UniformType::Vec4, &value_, sizeof value_); }
+	UniformValue(const Uniform& uniform_, const glm::mat3& value_) { setInline(uniform_, UniformType::Mat3, &value_, sizeof value_); }
+	UniformValue(const Uniform& uniform_, const glm::mat4& value_) { setInline(uniform_, UniformType::Mat4, &value_, sizeof value_); }
+
+	// The inline value, or the caller's array.
+	const void* GetData() const { return data ? data : value; }
+
+	Uniform uniform;
+	UniformType type = UniformType::Float;
+	unsigned count = 1;
+	// Caller's array, null for an inline value.
+	const void* data = nullptr;
+
+private:
+	void setInline(const Uniform& uniform_, UniformType type_, const void* source, size_t size)
+	{
+		static_assert(sizeof(glm::mat4) <= MaxInlineUniformSize);
+		uniform = uniform_;
+		type = type_;
+		memcpy(value, source, size);
+	}
+
+	alignas(16) unsigned char value[MaxInlineUniformSize];
+};
+
+// Description of a draw to record. Only used during the record call, the command buffer keeps copies.
+struct DrawCommand final
+{
+	// Geometry, GeometryBuffer::vao for geometry buffers.
+	VertexArrayRef vao;
+	ShaderProgramRef program;
+	// Textures bound to slots 0..size-1.
+	std::span<const Texture2DRef> textures;
+	// State of the draw, default state if null.
+	const RenderStateBlock* state = nullptr;
+	// Program and state of the draw in one object, replaces program and state if set.
+	PipelineStateRef pipeline;
+	std::span<const UniformValue> uniforms;
+	PrimitiveTopology primitive = PrimitiveTopology::Triangles;
+	// Instanced draw if greater than 1, the per-instance attributes come from the vertex array.
+	unsigned instanceCount = 1;
+};
+
+// Recorded draws of one thread. Not thread safe, each recording thread uses its own command buffer.
+class CommandBuffer final
+{
+	friend class RenderQueue;
+public:
+	CommandBuffer() { Clear(); }
+
+	// Record a draw.
+	void Draw(uint64_t sortKey, const DrawCommand& command);
+	// Remove all recorded draws. Keeps the allocated memory.
+	void Clear();
+
+	size_t GetNumDraws() const { return m_packets.size(); }
+
+private:
+	struct Packet final
+	{
+		VertexArrayRef vao;
+		ShaderProgramRef program;
+		PipelineStateRef pipeline;
+		uint32_t firstTexture;
+		uint32_t numTextures;
+		uint32_t firstUniform;
+		uint32_t numUniforms;
+		uint32_t state;
+		uint32_t instanceCount;
+		PrimitiveTopology primitive;
+	};
+
+	struct RecordedUniform final
+	{
+		Uniform uniform;
+		UniformType type;
+		unsigned count;
+		size_t offset;
+	};
+
+	std::vector<uint64_t> m_keys;
+	std::vector<Packet> m_packets;
+	std::vector<Texture2DRef> m_textures;
+	std::vector<RecordedUniform> m_uniforms;
+	std::vector<unsigned char> m_uniformData;
+	// Distinct consecutive states, the first one is the default state.
+	std::vector<RenderStateBlock> m_states;
+};
+
+// Number of draws and state switches of the last submitted queue.
+struct RenderQueueStatistics final
+{
+	unsigned draws = 0;
+	unsigned programChanges = 0;
+	unsigned textureChanges = 0;
+	unsigned vertexArrayChanges = 0;
+	unsigned stateChanges = 0;
+};
+
+// Deferred draw queue. Draws are recorded into per-thread command buffers, then sorted by key and replayed on the main thread through the RenderSystem state cache.
+class RenderQueue final
+{
+public:
+	// Create with one command buffer per JobSystem thread if numCommandBuffers is zero.
+	explicit RenderQueue(unsigned numCommandBuffers = 0);
+
+	// Return the command buffer of the calling JobSystem thread.
+	CommandBuffer& GetCommandBuffer();
+	CommandBuffer& GetCommandBuffer(unsigned index) { return *m_commandBuffers[index]; }
+	unsigned GetNumCommandBuffers() const { return static_cast<unsigned>(m_commandBuffers.size()); }
+
+	// Sort and execute all recorded draws, then clear the command buffers. Call on the main thread after recording has finished.
+	void Submit();
+	// Remove all recorded draws without executing them.
+	void Clear();
+
+	const RenderQueueStatistics& GetStatistics() const { return m_statistics; }
+
+private:
+	struct SortEntry final
+	{
+		uint64_t key;
+		uint32_t commandBuffer;
+		uint32_t packet;
+	};
+
+	void sort();
+
+	std::vector<std::unique_ptr<CommandBuffer>> m_commandBuffers;
+	std::vector<SortEntry> m_entries;
+	std::vector<SortEntry> m_sortBuffer;
+	RenderQueueStatistics m_statistics;
+};
\ No newline at end of file
@@ -277,6 +277,7 @@ Texture2DRef RenderSystem::CreateTexture2D(const Texture2DCreateInfo& createInfo
 	}
 
 	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, (GLsizei)resource->width, (GLsizei)resource->height, 0, format, oglType, createInfo.pixelData);
+	countUpload(createInfo.pixelData, static_cast<size_t>(resource->width) * resource->height * SizeTexelsFormat(createInfo.format));
 
 	if( textureInfo.mipmap )
 		glGenerateMipmap(GL_TEXTURE_2D);
@@ -3,6 +3,7 @@
 #include "OpenGLCore.h"
 #include "RenderCore.h"
 #include "Core/Logging/Log.h"
+#include "Core/IO/StringHash.h"
 
 // TODO: в деструкторах рендерресурсов при удалении ресурса снимать бинд если он забинден
 
@@ -60,9 +61,58 @@ public:
 	ShaderProgram& operator=(const ShaderProgram&) = delete;
 
 	bool operator==(const ShaderProgram& ref) noexcept { return m_handle == ref.m_handle; }
+
+	// reflection tables, filled once after a successful link
+	const ShaderUniformInfo* FindUniform(StringHash name) const
+	{
+		auto it = uniformIndices.find(name.Value());
+		return it != uniformIndices.end() ? &uniforms[it->second] : nullptr;
+	}
+	// StringHash is case-insensitive, the name is compared to tell apart uniforms that differ only in case
+	const ShaderUniformInfo* FindUniform(const char* name) const
+	{
+		const ShaderUniformInfo* uniform = FindUniform(StringHash(name));
+		return uniform && uniform->name == name ? uniform : nullptr;
+	}
+	const ShaderUniformInfo* FindUniformByLocation(int location) const
+	{
+		return location >= 0 && static_cast<size_t>(location) < uniformsByLocation.size() && uniformsByLocation[location] >= 0
+			? &uniforms[uniformsByLocation[location]] : nullptr;
+	}
+	const UniformBlockInfo* FindUniformBlock(StringHash name) const
+	{
+		auto it = uniformBlockIndices.find(name.Value());
+		return it != uniformBlockIndices.end() ? &uniformBlocks[it->second] : nullptr;
+	}
+
+	std::vector<ShaderAttributeInfo> attributes; // sorted by location
+	std::vector<ShaderUniformInfo> uniforms;
+	std::vector<UniformBlockInfo> uniformBlocks;
+	std::unordered_map<unsigned, unsigned> uniformIndices;
+	std::unordered_map<unsigned, unsigned> uniformBlockIndices;
+	std::vector<int> uniformsByLocation;
+	// last values written through the RenderSystem, used to skip redundant glUniform calls
+	std::vector<unsigned char> uniformValues;
+	std::vector<bool> uniformValuesValid;
 };
 using ShaderProgramRef = std::shared_ptr<ShaderProgram>;
 
+// Program whose compile and link are issued but not checked yet, see RenderSystem::BeginShaderProgram().
+struct PendingShaderProgram final
+{
+	ShaderProgramRef program;
+	ShaderRef vertexShader;
+	ShaderRef fragmentShader;
+	// final sources, kept for the error log
+	std::string vertexSource;
+	std::string fragmentSource;
+	uint64_t cacheKey = 0;
+	// loaded from the program binary cache, nothing left to check
+	bool cached = false;
+
+	bool IsValid() const { return program != nullptr; }
+};
+
 class VertexArray;
 
 class GPUBuffer : public glObject
@@ -117,6 +167,55 @@ public:
 };
 using IndexBufferRef = std::shared_ptr<IndexBuffer>;
 
+#if !PLATFORM_EMSCRIPTEN
+// GPU buffer of DrawElementsIndirectCommand or DrawArraysIndirectCommand for MultiDrawIndirect.
+class DrawIndirectBuffer final : public GPUBuffer
+{
+public:
+	DrawIndirectBuffer() = delete;
+	DrawIndirectBuffer(BufferUsage Usage, unsigned Count = 0, unsigned Size = 0) : GPUBuffer(BufferTarget::DrawIndirectBuffer, Usage, Count, Size) {}
+	DrawIndirectBuffer(DrawIndirectBuffer&&) noexcept = default;
+	DrawIndirectBuffer(const DrawIndirectBuffer&) = delete;
+	~DrawIndirectBuffer() { glDeleteBuffers(1, &m_handle); }
+	DrawIndirectBuffer& operator=(DrawIndirectBuffer&&) noexcept = default;
+	DrawIndirectBuffer& operator=(const DrawIndirectBuffer&) = delete;
+
+	// CPU copy of the commands, used instead of the GPU data when glMultiDraw*Indirect is not supported (before OpenGL 4.3).
+	std::vector<unsigned char> shadowData;
+};
+using DrawIndirectBufferRef = std::shared_ptr<DrawIndirectBuffer>;
+#endif
+
+// GPU buffer for uniform block data. count is the size in bytes.
+class UniformBuffer final : public GPUBuffer
+{
+public:
+	UniformBuffer() = delete;
+	UniformBuffer(BufferUsage Usage, unsigned Size = 0) : GPUBuffer(BufferTarget::UniformBuffer, Usage, Size, 1) {}
+	UniformBuffer(UniformBuffer&&) noexcept = default;
+	UniformBuffer(const UniformBuffer&) = delete;
+	~UniformBuffer() { glDeleteBuffers(1, &m_handle); }
+	UniformBuffer& operator=(UniformBuffer&&) noexcept = default;
+	UniformBuffer& operator=(const UniformBuffer&) = delete;
+};
+using UniformBufferRef = std::shared_ptr<UniformBuffer>;
+
+#if !PLATFORM_EMSCRIPTEN
+// GPU buffer for shader storage block data (OpenGL 4.3+). count is the size in bytes.
+class ShaderStorageBuffer final : public GPUBuffer
+{
+public:
+	ShaderStorageBuffer() = delete;
+	ShaderStorageBuffer(BufferUsage Usage, unsigned Size = 0) : GPUBuffer(BufferTarget::ShaderStorageBuffer, Usage, Size, 1) {}
+	ShaderStorageBuffer(ShaderStorageBuffer&&) noexcept = default;
+	ShaderStorageBuffer(const ShaderStorageBuffer&) = delete;
+	~ShaderStorageBuffer() { glDeleteBuffers(1, &m_handle); }
+	ShaderStorageBuffer& operator=(ShaderStorageBuffer&&) noexcept = default;
+	ShaderStorageBuffer& operator=(const ShaderStorageBuffer&) = delete;
+};
+using ShaderStorageBufferRef = std::shared_ptr<ShaderStorageBuffer>;
+#endif
+
 // TODO: buffer storage (OpenGl 4.4+) - ref http://steps3d.narod.ru/tutorials/buffer-storage-tutorial.html
 
 class VertexArray final : public glObject
@@ -134,6 +233,8 @@ public:
 
 	VertexBufferRef vbo = nullptr;
 	IndexBufferRef ibo = nullptr;
+	// Buffer of the per-instance attributes, if any.
+	VertexBufferRef instanceVbo = nullptr;
 	unsigned attribsCount = 0;
 };
 using VertexArrayRef = std::shared_ptr<VertexArray>;
@@ -186,6 +287,24 @@ public:
 
 using Texture2DRef = std::shared_ptr<Texture2D>;
 
+// GPU sampler object. Bound to a texture slot it replaces the sampling parameters of the texture. Created and shared by RenderSystem::CreateSampler().
+class Sampler final : public glObject
+{
+public:
+	Sampler() = delete;
+	Sampler(const SamplerState& State) : state(State) { glGenSamplers(1, &m_handle); }
+	Sampler(Sampler&&) noexcept = default;
+	Sampler(const Sampler&) = delete;
+	~Sampler() { glDeleteSamplers(1, &m_handle); }
+	Sampler& operator=(Sampler&&) noexcept = default;
+	Sampler& operator=(const Sampler&) = delete;
+
+	bool operator==(const Sampler& ref) noexcept { return m_handle == ref.m_handle && state == ref.state; }
+
+	const SamplerState state;
+};
+using SamplerRef = std::shared_ptr<Sampler>;
+
 // GPU renderbuffer object for rendering and blitting, that cannot be sampled as a texture.
 class Renderbuffer final : public glObject
 {
@@ -230,6 +349,36 @@ public:
 
 using FramebufferRef = std::shared_ptr<Framebuffer>;
 
+// Shader program and fixed function state of a draw.
+struct PipelineStateCreateInfo final
+{
+	ShaderProgramRef program = nullptr;
+	DepthState depthState;
+	StencilState stencilState;
+	RasterizerState rasterizerState;
+	BlendState blendState = AlphaBlendState;
+
+	bool operator==(const PipelineStateCreateInfo&) const = default;
+};
+
+// Immutable pipeline state, hashed once when it is created. RenderSystem::CreatePipelineState() returns the same object for equal descriptions, so a pipeline switch compares pointers first and then diffs only the states that differ.
+class PipelineState final
+{
+public:
+	PipelineState() = delete;
+	PipelineState(const PipelineStateCreateInfo& Info, uint64_t Hash, unsigned Id) : info(Info), hash(Hash), id(Id) {}
+	PipelineState(PipelineState&&) = delete;
+	PipelineState(const PipelineState&) = delete;
+	PipelineState& operator=(PipelineState&&) = delete;
+	PipelineState& operator=(const PipelineState&) = delete;
+
+	const PipelineStateCreateInfo info;
+	const uint64_t hash;
+	// sequential id in creation order, small enough for the program bits of a render sort key
+	const unsigned id;
+};
+using PipelineStateRef = std::shared_ptr<const PipelineState>;
+
 #if USE_OPENGL_VERSION >= OPENGL40
 class TransformFeedback final : public glObject
 {
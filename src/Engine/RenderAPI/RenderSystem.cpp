@@ -71,6 +71,12 @@ bool RenderSystem::Create(const RenderCreateInfo& createInfo)
 	initializeExtensions(true);
 	initializeCapabilities(true);
 
+	if (!createInfo.shaderCacheDirectory.empty())
+	{
+		const bool shaderCache = m_shaderCache.Create(createInfo.shaderCacheDirectory);
+		LogPrint(std::string("    > Shader Program Cache: ") + (shaderCache ? "enable" : "disable"));
+	}
+
 	// не использовать Bind(state) так как дефолтные значения из кеша могут не соответствовать установкам.
 
 	// set default depth state
@@ -84,10 +90,19 @@ bool RenderSystem::Create(const RenderCreateInfo& createInfo)
 	//glEnable(GL_CULL_FACE);
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	m_cache.CurrentBlendState = AlphaBlendState;
 	glClearColor(createInfo.clearColor.x, createInfo.clearColor.y, createInfo.clearColor.z, 1.0f);
 
 	setClearMask(true, true, false);
 
+	if (createInfo.frameUniformBufferSize > 0 && !m_frameUniforms.Create(createInfo.frameUniformBufferSize, createInfo.frameUniformBufferFrames))
+		LogWarning("Frame uniform buffer is not available");
+
+#if USE_PROFILER
+	if (createInfo.gpuProfiler)
+		LogPrint(std::string("    > GPU Profiler: ") + (m_gpuProfiler.Create() ? "enable" : "disable"));
+#endif
+
 	LogPrint("RenderSystem Create");
 
 	return true;
@@ -95,8 +110,13 @@ bool RenderSystem::Create(const RenderCreateInfo& createInfo)
 //-----------------------------------------------------------------------------
 void RenderSystem::Destroy()
 {
+	m_gpuProfiler.Destroy();
+	m_frameUniforms.Destroy();
+	m_shaderCache.Destroy();
 	ResetAllStates();
 	m_cacheFileTextures2D.clear();
+	m_cacheSamplers.clear();
+	m_cachePipelineStates.clear();
 }
 //-----------------------------------------------------------------------------
 void RenderSystem::SetClearColor(const glm::vec3& color)
@@ -122,20 +142,54 @@ void RenderSystem::SetViewport(int width, int height)
 //-----------------------------------------------------------------------------
 void RenderSystem::SetViewport(int x, int y, int width, int height)
 {
+	const glm::ivec4 viewport{ x, y, width, height };
+	if (m_cache.CurrentViewport == viewport)
+	{
+		m_statistics.redundantCalls++;
+		return;
+	}
+	m_cache.CurrentViewport = viewport;
+	m_statistics.stateCalls++;
 	glViewport(x, y, width, height);
 }
 //-----------------------------------------------------------------------------
+void RenderSystem::SetScissor(int x, int y, int width, int height)
+{
+	const glm::ivec4 scissor{ x, y, width, height };
+	if (m_cache.CurrentScissor == scissor)
+	{
+		m_statistics.redundantCalls++;
+		return;
+	}
+	m_cache.CurrentScissor = scissor;
+	m_statistics.stateCalls++;
+	glScissor(x, y, width, height);
+}
+//-----------------------------------------------------------------------------
 void RenderSystem::MainScreen()
 {
 	if( m_cache.CurrentFramebuffer > 0 )
 	{
 		m_cache.CurrentFramebuffer = 0;
+		m_statistics.framebufferBinds++;
 		glBindFramebuffer(GL_FRAMEBUFFER, 0);
 		// TODO: set current viewport and clear color?
 		ClearFrame();
 	}
 }
 //-----------------------------------------------------------------------------
+void RenderSystem::EndFrame()
+{
+	if (m_frameUniforms.IsValid())
+		m_frameUniforms.NextFrame();
+	if (m_gpuProfiler.IsValid())
+		m_gpuProfiler.NextFrame();
+	RemoveUnusedStates();
+
+	m_frameStatistics = m_statistics;
+	m_statistics = {};
+}
+//-----------------------------------------------------------------------------
 void RenderSystem::ResetAllStates()
 {
 	m_cache.Reset();
@@ -144,13 +198,28 @@ void RenderSystem::ResetAllStates()
 	glBindVertexArray(0);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+#if !PLATFORM_EMSCRIPTEN
+	if (OpenGLExtensions::version >= OPENGL43)
+	{
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+#endif
 	for (unsigned i = 0; i < MaxBindingTextures; i++)
 	{
 		glActiveTexture(GL_TEXTURE0 + i);
 		glBindTexture(GL_TEXTURE_2D, 0);
+		glBindSampler(i, 0);
 	}
 	glActiveTexture(GL_TEXTURE0);
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	// match the default blend state of the cache
+	glDisable(GL_BLEND);
+	glBlendEquation(GL_FUNC_ADD);
+	glBlendFunc(GL_ONE, GL_ZERO);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 }
 //-----------------------------------------------------------------------------
 void RenderSystem::ResetState(ResourceType type)
@@ -158,6 +227,7 @@ void RenderSystem::ResetState(ResourceType type)
 	if( type == ResourceType::ShaderProgram )
 	{
 		m_cache.CurrentShaderProgram = 0;
+		m_cache.CurrentShaderProgramRef.reset();
 		glUseProgram(0);
 	}
 	else if( type == ResourceType::VertexBuffer )
@@ -187,6 +257,14 @@ void RenderSystem::ResetState(ResourceType type)
 		}
 		glActiveTexture(GL_TEXTURE0);
 	}
+	else if( type == ResourceType::Sampler )
+	{
+		for( unsigned i = 0; i < MaxBindingTextures; i++ )
+		{
+			glBindSampler(i, 0);
+			m_cache.CurrentSampler[i] = 0;
+		}
+	}
 	else if( type == ResourceType::Framebuffer )
 	{
 		m_cache.CurrentFramebuffer = 0;
@@ -196,18 +274,32 @@ void RenderSystem::ResetState(ResourceType type)
 //-----------------------------------------------------------------------------
 void RenderSystem::Bind(DepthState state)
 {
+	if (m_cache.CurrentDepthState == state)
+	{
+		m_statistics.redundantCalls++;
+		return;
+	}
+	m_cache.CurrentPipelineState.reset();
+
 	if (m_cache.CurrentDepthState.enable != state.enable)
 	{
 		if (state.enable) glEnable(GL_DEPTH_TEST);
 		else glDisable(GL_DEPTH_TEST);
 		setClearMask(true, state.enable, m_cache.CurrentStencilState.enable);
+		m_statistics.stateCalls++;
 	}
 
 	if (m_cache.CurrentDepthState.compareFunction != state.compareFunction)
+	{
 		glDepthFunc(TranslateToGL(state.compareFunction));
+		m_statistics.stateCalls++;
+	}
 
 	if (m_cache.CurrentDepthState.depthWrite != state.depthWrite)
+	{
 		glDepthMask(static_cast<GLboolean>(state.depthWrite ? GL_TRUE : GL_FALSE));
+		m_statistics.stateCalls++;
+	}
 
 	m_cache.CurrentDepthState = state;
 }
@@ -215,12 +307,20 @@ void RenderSystem::Bind(DepthState state)
 void RenderSystem::Bind(StencilState state)
 {
 	StencilState& cache = m_cache.CurrentStencilState;
+	if (cache == state)
+	{
+		m_statistics.redundantCalls++;
+		return;
+	}
+	m_cache.CurrentPipelineState.reset();
+
 	if (cache.enable != state.enable)
 	{
 		if (state.enable) glEnable(GL_STENCIL_TEST);
 		else glDisable(GL_STENCIL_TEST);
 
 		setClearMask(true, m_cache.CurrentDepthState.enable, state.enable);
+		m_statistics.stateCalls++;
 	}
 
 	if (cache.stencilRef != state.stencilRef 
@@ -238,10 +338,14 @@ void RenderSystem::Bind(StencilState state)
 		glStencilOpSeparate(GL_FRONT, TranslateToGL(state.frontFaceStencilFailureOperation), TranslateToGL(state.frontFaceStencilDepthFailureOperation), TranslateToGL(state.frontFaceStencilPassOperation));
 		glStencilFuncSeparate(GL_BACK, TranslateToGL(state.backFaceStencilCompareFunction), state.stencilRef, state.readMask);
 		glStencilOpSeparate(GL_BACK, TranslateToGL(state.backFaceStencilFailureOperation), TranslateToGL(state.backFaceStencilDepthFailureOperation), TranslateToGL(state.backFaceStencilPassOperation));
+		m_statistics.stateCalls += 4;
 	}
 
 	if (cache.writeMask != state.writeMask)
+	{
 		glStencilMask(state.writeMask);
+		m_statistics.stateCalls++;
+	}
 
 	cache = state;
 }
@@ -251,8 +355,13 @@ void RenderSystem::Bind(VertexBufferRef buffer)
 	if( !buffer) return;
 	assert(IsValid(buffer));
 
-	if (m_cache.CurrentVBO == *buffer) return;
+	if (m_cache.CurrentVBO == *buffer)
+	{
+		m_statistics.redundantCalls++;
+		return;
+	}
 	m_cache.CurrentVBO = *buffer;
+	m_statistics.bufferBinds++;
 	glBindBuffer(GL_ARRAY_BUFFER, *buffer);
 }
 //-----------------------------------------------------------------------------
@@ -261,8 +370,13 @@ void RenderSystem::Bind(IndexBufferRef buffer)
 	if (!buffer) return;
 	assert(IsValid(buffer));
 
-	if (m_cache.CurrentIBO == *buffer) return;
+	if (m_cache.CurrentIBO == *buffer)
+	{
+		m_statistics.redundantCalls++;
+		return;
+	}
 	m_cache.CurrentIBO = *buffer;
+	m_statistics.bufferBinds++;
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *buffer);
 }
 //-----------------------------------------------------------------------------
@@ -273,8 +387,11 @@ void RenderSystem::Bind(VertexArrayRef vao)
 		m_cache.CurrentVAO = *vao;
 		m_cache.CurrentVBO = 0;
 		m_cache.CurrentIBO = 0;
+		m_statistics.vertexArrayBinds++;
 		glBindVertexArray(*vao);
 	}
+	else
+		m_statistics.redundantCalls++;
 	Bind(vao->vbo);
 	Bind(vao->ibo);
 }
@@ -283,21 +400,31 @@ void RenderSystem::Bind(const VertexAttribute& attribute)
 {
 	const GLuint oglLocation = static_cast<GLuint>(attribute.location);
 	glEnableVertexAttribArray(oglLocation);
-	glVertexAttribPointer(
-		oglLocation,
-		attribute.size,
-		GL_FLOAT,
-		(GLboolean)(attribute.normalized ? GL_TRUE : GL_FALSE),
-		attribute.stride,
-		attribute.offset);
+	if (attribute.integer)
+		glVertexAttribIPointer(oglLocation, attribute.size, attribute.type, attribute.stride, attribute.offset);
+	else
+		glVertexAttribPointer(
+			oglLocation,
+			attribute.size,
+			attribute.type,
+			(GLboolean)(attribute.normalized ? GL_TRUE : GL_FALSE),
+			attribute.stride,
+			attribute.offset);
+	if (attribute.divisor > 0)
+		glVertexAttribDivisor(oglLocation, attribute.divisor);
 }
 //-----------------------------------------------------------------------------
 void RenderSystem::Bind(Texture2DRef resource, unsigned slot)
 {
 	if( !resource ) return;
 	assert(IsValid(resource));
-	if( m_cache.CurrentTexture2D[slot] == *resource ) return;
+	if( m_cache.CurrentTexture2D[slot] == *resource )
+	{
+		m_statistics.redundantCalls++;
+		return;
+	}
 	m_cache.CurrentTexture2D[slot] = *resource;
+	m_statistics.textureBinds++;
 	glActiveTexture(GL_TEXTURE0 + slot);
 	glBindTexture(GL_TEXTURE_2D, *resource);
 }
@@ -306,16 +433,88 @@ void RenderSystem::Bind(FramebufferRef resource)
 {
 	if( !resource ) return;
 	assert(IsValid(resource));
-	if( m_cache.CurrentFramebuffer == *resource ) return;
+	if( m_cache.CurrentFramebuffer == *resource )
+	{
+		m_statistics.redundantCalls++;
+		return;
+	}
 	m_cache.CurrentFramebuffer = *resource;
+	m_statistics.framebufferBinds++;
 	glBindFramebuffer(GL_FRAMEBUFFER, *resource);
-	glViewport(0, 0, resource->size.x, resource->size.y);
+	SetViewport(0, 0, static_cast<int>(resource->size.x), static_cast<int>(resource->size.y));
 }
 //-----------------------------------------------------------------------------
+void RenderSystem::Bind(UniformBufferRef buffer, unsigned bindingPoint)
+{
+	assert(IsValid(buffer));
+	assert(bindingPoint < MaxBindingUniformBuffers);
+	auto& current = m_cache.CurrentUniformBuffers[bindingPoint];
+	if( current.id == *buffer && current.offset == 0 && current.size == buffer->count )
+	{
+		m_statistics.redundantCalls++;
+		return;
+	}
+	current = { *buffer, 0u, buffer->count };
+	m_statistics.bufferBinds++;
+	glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, *buffer);
+}
+//-----------------------------------------------------------------------------
+void RenderSystem::BindRange(UniformBufferRef buffer, unsigned bindingPoint, unsigned offset, unsigned size)
+{
+	assert(IsValid(buffer));
+	assert(bindingPoint < MaxBindingUniformBuffers);
+	assert(offset % std::max(Capabilities::uniformBufferOffsetAlignment, 1u) == 0);
+	auto& current = m_cache.CurrentUniformBuffers[bindingPoint];
+	if( current.id == *buffer && current.offset == offset && current.size == size )
+	{
+		m_statistics.redundantCalls++;
+		return;
+	}
+	current = { *buffer, offset, size };
+	m_statistics.bufferBinds++;
+	glBindBufferRange(GL_UNIFORM_BUFFER, bindingPoint, *buffer, offset, size);
+}
+//-----------------------------------------------------------------------------
+#if !PLATFORM_EMSCRIPTEN
+void RenderSystem::Bind(ShaderStorageBufferRef buffer, unsigned bindingPoint)
+{
+	assert(IsValid(buffer));
+	assert(bindingPoint < MaxBindingStorageBuffers && bindingPoint < Capabilities::maximumShaderStorageBufferBindings);
+	auto& current = m_cache.CurrentStorageBuffers[bindingPoint];
+	if( current.id == *buffer && current.offset == 0 && current.size == buffer->count )
+	{
+		m_statistics.redundantCalls++;
+		return;
+	}
+	current = { *buffer, 0u, buffer->count };
+	m_statistics.bufferBinds++;
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, bindingPoint, *buffer);
+}
+#endif
+//-----------------------------------------------------------------------------
+#if !PLATFORM_EMSCRIPTEN
+void RenderSystem::BindRange(ShaderStorageBufferRef buffer, unsigned bindingPoint, unsigned offset, unsigned size)
+{
+	assert(IsValid(buffer));
+	assert(bindingPoint < MaxBindingStorageBuffers && bindingPoint < Capabilities::maximumShaderStorageBufferBindings);
+	assert(offset % std::max(Capabilities::shaderStorageBufferOffsetAlignment, 1u) == 0);
+	auto& current = m_cache.CurrentStorageBuffers[bindingPoint];
+	if( current.id == *buffer && current.offset == offset && current.size == size )
+	{
+		m_statistics.redundantCalls++;
+		return;
+	}
+	current = { *buffer, offset, size };
+	m_statistics.bufferBinds++;
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, bindingPoint, *buffer, offset, size);
+}
+#endif
+//-----------------------------------------------------------------------------
 void RenderSystem::BindGLVertexBuffer(unsigned id)
 {
 	if( m_cache.CurrentVBO == id ) return;
 	m_cache.CurrentVBO = id;
+	m_statistics.bufferBinds++;
 	glBindBuffer(GL_ARRAY_BUFFER, id);
 }
 //-----------------------------------------------------------------------------
@@ -323,6 +522,7 @@ void RenderSystem::BindGLIndexBuffer(unsigned id)
 {
 	if( m_cache.CurrentIBO == id ) return;
 	m_cache.CurrentIBO = id;
+	m_statistics.bufferBinds++;
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, id);
 }
 //-----------------------------------------------------------------------------
@@ -332,6 +532,7 @@ void RenderSystem::BindGLVertexArray(unsigned id)
 	m_cache.CurrentVAO = id;
 	m_cache.CurrentVBO = 0;
 	m_cache.CurrentIBO = 0;
+	m_statistics.vertexArrayBinds++;
 	glBindVertexArray(id);
 }
 //-----------------------------------------------------------------------------
@@ -339,6 +540,7 @@ void RenderSystem::BindGLTexture2D(unsigned id, unsigned slot)
 {
 	if( m_cache.CurrentTexture2D[slot] == id ) return;
 	m_cache.CurrentTexture2D[slot] = id;
+	m_statistics.textureBinds++;
 	glActiveTexture(GL_TEXTURE0 + slot);
 	glBindTexture(GL_TEXTURE_2D, id);
 }
@@ -347,6 +549,7 @@ void RenderSystem::BindGLFramebuffer(unsigned id)
 {
 	if( m_cache.CurrentFramebuffer == id ) return;
 	m_cache.CurrentFramebuffer = id;
+	m_statistics.framebufferBinds++;
 	glBindFramebuffer(GL_FRAMEBUFFER, id);
 }
 //-----------------------------------------------------------------------------
@@ -355,6 +558,7 @@ void RenderSystem::Draw(VertexArrayRef vao, PrimitiveTopology primitive)
 	assert(IsValid(vao));
 
 	Bind(vao);
+	m_statistics.drawCalls++;
 	if( vao->ibo)
 	{
 		glDrawElements(TranslateToGL(primitive), (GLsizei)vao->ibo->count, SizeIndexType(vao->ibo->sizeInBytes), nullptr);
@@ -371,12 +575,123 @@ void RenderSystem::Draw(GeometryBufferRef geom, PrimitiveTopology primitive)
 	Draw(geom->vao, primitive);
 }
 //-----------------------------------------------------------------------------
+void RenderSystem::DrawInstanced(VertexArrayRef vao, unsigned instanceCount, PrimitiveTopology primitive)
+{
+	assert(IsValid(vao));
+	if (instanceCount == 0) return;
+
+	Bind(vao);
+	m_statistics.drawCalls++;
+	if (vao->ibo)
+	{
+		glDrawElementsInstanced(TranslateToGL(primitive), (GLsizei)vao->ibo->count, SizeIndexType(vao->ibo->sizeInBytes), nullptr, (GLsizei)instanceCount);
+	}
+	else
+	{
+		glDrawArraysInstanced(TranslateToGL(primitive), 0, (GLsizei)vao->vbo->count, (GLsizei)instanceCount);
+	}
+}
+//-----------------------------------------------------------------------------
+void RenderSystem::DrawInstanced(GeometryBufferRef geom, unsigned instanceCount, PrimitiveTopology primitive)
+{
+	if (!IsValid(geom)) return;
+	DrawInstanced(geom->vao, instanceCount, primitive);
+}
+//-----------------------------------------------------------------------------
+void RenderSystem::DrawRange(VertexArrayRef vao, unsigned first, unsigned count, PrimitiveTopology primitive)
+{
+	assert(IsValid(vao));
+	if (count == 0) return;
+
+	Bind(vao);
+	m_statistics.drawCalls++;
+	if (vao->ibo)
+	{
+		assert(first + count <= vao->ibo->count);
+		const void* indexOffset = (const void*)(uintptr_t)(first * vao->ibo->sizeInBytes);
+		glDrawElements(TranslateToGL(primitive), (GLsizei)count, SizeIndexType(vao->ibo->sizeInBytes), indexOffset);
+	}
+	else
+	{
+		assert(first + count <= vao->vbo->count);
+		glDrawArrays(TranslateToGL(primitive), (GLint)first, (GLsizei)count);
+	}
+}
+//-----------------------------------------------------------------------------
+#if !PLATFORM_EMSCRIPTEN
+void RenderSystem::DrawBaseVertex(VertexArrayRef vao, unsigned firstIndex, unsigned indexCount, int baseVertex, unsigned instanceCount, PrimitiveTopology primitive)
+{
+	assert(IsValid(vao) && vao->ibo);
+	if (!vao->ibo || indexCount == 0 || instanceCount == 0) return;
+	assert(firstIndex + indexCount <= vao->ibo->count);
+
+	Bind(vao);
+	m_statistics.drawCalls++;
+	const void* indexOffset = (const void*)(uintptr_t)(firstIndex * vao->ibo->sizeInBytes);
+	if (instanceCount == 1)
+		glDrawElementsBaseVertex(TranslateToGL(primitive), (GLsizei)indexCount, SizeIndexType(vao->ibo->sizeInBytes), indexOffset, baseVertex);
+	else
+		glDrawElementsInstancedBaseVertex(TranslateToGL(primitive), (GLsizei)indexCount, SizeIndexType(vao->ibo->sizeInBytes), indexOffset, (GLsizei)instanceCount, baseVertex);
+}
+#endif
+//-----------------------------------------------------------------------------
+#if !PLATFORM_EMSCRIPTEN
+void RenderSystem::MultiDrawIndirect(VertexArrayRef vao, DrawIndirectBufferRef commands, unsigned first, unsigned drawCount, PrimitiveTopology primitive)
+{
+	assert(IsValid(vao) && IsValid(commands));
+	if (!commands || drawCount == 0) return;
+	assert(first + drawCount <= commands->count);
+	assert(commands->sizeInBytes == (vao->ibo ? sizeof(DrawElementsIndirectCommand) : sizeof(DrawArraysIndirectCommand)));
+
+	Bind(vao);
+	const GLenum mode = TranslateToGL(primitive);
+	if (OpenGLExtensions::version >= OPENGL43)
+	{
+		bindDrawIndirectBuffer(*commands);
+		m_statistics.drawCalls++;
+		const void* commandOffset = (const void*)(uintptr_t)(first * commands->sizeInBytes);
+		if (vao->ibo)
+			glMultiDrawElementsIndirect(mode, SizeIndexType(vao->ibo->sizeInBytes), commandOffset, (GLsizei)drawCount, 0);
+		else
+			glMultiDrawArraysIndirect(mode, commandOffset, (GLsizei)drawCount, 0);
+		return;
+	}
+
+	// before OpenGL 4.3 the commands are issued one by one from the CPU copy. baseInstance needs OpenGL 4.2
+	const unsigned char* data = commands->shadowData.data() + first * commands->sizeInBytes;
+	m_statistics.drawCalls += drawCount;
+	for (unsigned i = 0; i < drawCount; i++)
+	{
+		if (vao->ibo)
+		{
+			DrawElementsIndirectCommand command;
+			memcpy(&command, data + i * sizeof(command), sizeof(command));
+			const void* indexOffset = (const void*)(uintptr_t)(command.firstIndex * vao->ibo->sizeInBytes);
+			if (OpenGLExtensions::version >= OPENGL42)
+				glDrawElementsInstancedBaseVertexBaseInstance(mode, (GLsizei)command.count, SizeIndexType(vao->ibo->sizeInBytes), indexOffset, (GLsizei)command.instanceCount, command.baseVertex, command.baseInstance);
+			else
+				glDrawElementsInstancedBaseVertex(mode, (GLsizei)command.count, SizeIndexType(vao->ibo->sizeInBytes), indexOffset, (GLsizei)command.instanceCount, command.baseVertex);
+		}
+		else
+		{
+			DrawArraysIndirectCommand command;
+			memcpy(&command, data + i * sizeof(command), sizeof(command));
+			if (OpenGLExtensions::version >= OPENGL42)
+				glDrawArraysInstancedBaseInstance(mode, (GLint)command.first, (GLsizei)command.count, (GLsizei)command.instanceCount, command.baseInstance);
+			else
+				glDrawArraysInstanced(mode, (GLint)command.first, (GLsizei)command.count, (GLsizei)command.instanceCount);
+		}
+	}
+}
+#endif
+//-----------------------------------------------------------------------------
 void RenderSystem::initializeExtensions(bool print)
 {
 	// reset extensions state
 	OpenGLExtensions::version = OPENGL33;
 	OpenGLExtensions::coreDebug = false;
 	OpenGLExtensions::coreDirectStateAccess = false;
+	OpenGLExtensions::parallelShaderCompile = false;
 
 #if PLATFORM_DESKTOP
 	if (!GLAD_GL_VERSION_3_3)
@@ -407,11 +722,32 @@ void RenderSystem::initializeExtensions(bool print)
 	if (OpenGLExtensions::version >= OPENGL45)
 		OpenGLExtensions::coreDirectStateAccess = true;
 
+#if PLATFORM_DESKTOP
+	// the extension is not part of the generated loader, its one entry point is loaded here
+	GLint numExtensions = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+	for (GLint i = 0; i < numExtensions && !OpenGLExtensions::parallelShaderCompile; i++)
+	{
+		const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+		if (extension && (strcmp(extension, "GL_KHR_parallel_shader_compile") == 0 || strcmp(extension, "GL_ARB_parallel_shader_compile") == 0))
+		{
+			typedef void (APIENTRY* MaxShaderCompilerThreadsFunc)(GLuint count);
+			auto maxShaderCompilerThreads = (MaxShaderCompilerThreadsFunc)glfwGetProcAddress(extension[3] == 'K' ? "glMaxShaderCompilerThreadsKHR" : "glMaxShaderCompilerThreadsARB");
+			if (maxShaderCompilerThreads)
+			{
+				maxShaderCompilerThreads(0xFFFFFFFF); // let the driver choose the number of threads
+				OpenGLExtensions::parallelShaderCompile = true;
+			}
+		}
+	}
+#endif
+
 	if (print)
 	{
 		LogPrint("OpenGL: Extensions information:");
 		LogPrint(std::string("    > OpenGL Debug: ") + (OpenGLExtensions::coreDebug ? "enable" : "disable"));
 		LogPrint(std::string("    > OpenGL Direct State Access: ") + (OpenGLExtensions::coreDirectStateAccess ? "enable" : "disable"));
+		LogPrint(std::string("    > OpenGL Parallel Shader Compile: ") + (OpenGLExtensions::parallelShaderCompile ? "enable" : "disable"));
 	}
 }
 //-----------------------------------------------------------------------------
@@ -432,6 +768,29 @@ void RenderSystem::initializeCapabilities(bool print)
 	glGetIntegerv(GL_MAX_UNIFORM_BLOCK_SIZE, &openGLValue);
 	Capabilities::maximumUniformBufferSize = static_cast<uint32_t>(openGLValue);
 	if( print ) LogPrint("    > Maximum Uniform Buffer Size = " + std::to_string(Capabilities::maximumUniformBufferSize));
+
+	glGetIntegerv(GL_MAX_UNIFORM_BUFFER_BINDINGS, &openGLValue);
+	Capabilities::maximumUniformBufferBindings = static_cast<uint32_t>(openGLValue);
+	if( print ) LogPrint("    > Maximum Uniform Buffer Bindings = " + std::to_string(Capabilities::maximumUniformBufferBindings));
+
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &openGLValue);
+	Capabilities::uniformBufferOffsetAlignment = static_cast<uint32_t>(openGLValue);
+	if( print ) LogPrint("    > Uniform Buffer Offset Alignment = " + std::to_string(Capabilities::uniformBufferOffsetAlignment));
+
+	Capabilities::maximumShaderStorageBufferBindings = 0;
+	Capabilities::shaderStorageBufferOffsetAlignment = 1;
+#if !PLATFORM_EMSCRIPTEN
+	if( OpenGLExtensions::version >= OPENGL43 )
+	{
+		glGetIntegerv(GL_MAX_SHADER_STORAGE_BUFFER_BINDINGS, &openGLValue);
+		Capabilities::maximumShaderStorageBufferBindings = static_cast<uint32_t>(openGLValue);
+		if( print ) LogPrint("    > Maximum Shader Storage Buffer Bindings = " + std::to_string(Capabilities::maximumShaderStorageBufferBindings));
+
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &openGLValue);
+		Capabilities::shaderStorageBufferOffsetAlignment = static_cast<uint32_t>(openGLValue);
+		if( print ) LogPrint("    > Shader Storage Buffer Offset Alignment = " + std::to_string(Capabilities::shaderStorageBufferOffsetAlignment));
+	}
+#endif
 }
 //-----------------------------------------------------------------------------
 bool RenderSystem::checkCurrentFrameBuffer() const
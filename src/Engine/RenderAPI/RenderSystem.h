@@ -3,18 +3,50 @@
 #include "OpenGLCore.h"
 #include "RenderResource.h"
 #include "Capabilities.h"
+#include "UniformRingBuffer.h"
+#include "ShaderCache.h"
+#include "GPUProfiler.h"
 #include "Core/IO/Image.h"
 
 constexpr int MaxBindingTextures = 16;
+constexpr int MaxBindingUniformBuffers = 16;
+constexpr int MaxBindingStorageBuffers = 8;
+
+// GL calls that reached the driver, and the binds and uniform writes the state cache filtered out
+struct RenderStatistics final
+{
+	unsigned drawCalls = 0;
+	unsigned programBinds = 0;
+	unsigned vertexArrayBinds = 0;
+	unsigned bufferBinds = 0;
+	unsigned textureBinds = 0;
+	unsigned samplerBinds = 0;
+	unsigned framebufferBinds = 0;
+	// fixed function state: depth, stencil, rasterizer, blend, viewport and scissor
+	unsigned stateCalls = 0;
+	unsigned uniformCalls = 0;
+	unsigned pipelineChanges = 0;
+	unsigned redundantCalls = 0;
+	// buffer, texture and frame uniform data sent to the driver, including buffer ranges mapped for writing
+	size_t bytesUploaded = 0;
+};
 
 struct RenderCreateInfo final
 {
 	glm::vec3 clearColor = glm::vec3{ 0.2f, 0.4f, 0.9f };
+	// bytes of uniform block data per frame in the frame uniform ring, 0 to disable it
+	unsigned frameUniformBufferSize = 1024 * 1024;
+	unsigned frameUniformBufferFrames = DefaultUniformRingFrames;
+	// directory of the program binary cache, such as a per-user application data path. Disabled by default, so that nothing is written to the working directory unless the application opts in
+	std::string shaderCacheDirectory;
+	// GPU timer queries for PROFILE_GPU_SCOPE, only created when USE_PROFILER is enabled
+	bool gpuProfiler = true;
 };
 
 class RenderSystem final
 {
 	friend class EngineDevice;
+	friend class UniformRingBuffer;
 public:
 	RenderSystem() = default;
 
@@ -32,12 +64,21 @@ public:
 	void ClearFrame(const glm::vec3& color);
 	void SetViewport(int width, int height);
 	void SetViewport(int x, int y, int width, int height);
+	// scissor rectangle, used when RasterizerState::scissorTestEnabled is set
+	void SetScissor(int x, int y, int width, int height);
 	void MainScreen();
+	// end of the frame, after present. Advances the frame uniform ring and the GPU profiler queries
+	void EndFrame();
 
 	//-------------------------------------------------------------------------
 	// Create Render Resource
 	//-------------------------------------------------------------------------
 	ShaderProgramRef CreateShaderProgram(const ShaderBytecode& vertexShaderSource, const ShaderBytecode& fragmentShaderSource);
+	// two phase program creation: BeginShaderProgram() issues compile and link without waiting for the driver, FinishShaderProgram() reads the result.
+	// With GL_KHR_parallel_shader_compile the driver compiles in the background in between, IsShaderProgramReady() tells whether Finish would block
+	PendingShaderProgram BeginShaderProgram(const ShaderBytecode& vertexShaderSource, const ShaderBytecode& fragmentShaderSource);
+	bool IsShaderProgramReady(const PendingShaderProgram& pending) const;
+	ShaderProgramRef FinishShaderProgram(PendingShaderProgram& pending);
 
 	VertexBufferRef CreateVertexBuffer(BufferUsage usage);
 	VertexBufferRef CreateVertexBuffer(BufferUsage usage, unsigned vertexCount, unsigned vertexSize, const void* data);
@@ -45,11 +86,22 @@ public:
 	IndexBufferRef CreateIndexBuffer(BufferUsage usage);
 	IndexBufferRef CreateIndexBuffer(BufferUsage usage, unsigned indexCount, IndexFormat indexFormat, const void* data);
 
+	UniformBufferRef CreateUniformBuffer(BufferUsage usage, unsigned size, const void* data = nullptr);
+
+#if !PLATFORM_EMSCRIPTEN
+	// needs OpenGL 4.3
+	ShaderStorageBufferRef CreateShaderStorageBuffer(BufferUsage usage, unsigned size, const void* data = nullptr);
+	DrawIndirectBufferRef CreateDrawIndirectBuffer(BufferUsage usage, std::span<const DrawElementsIndirectCommand> commands);
+	DrawIndirectBufferRef CreateDrawIndirectBuffer(BufferUsage usage, std::span<const DrawArraysIndirectCommand> commands);
+#endif
+
 	/*
 	* разница между attribs и shaders. при передаче шейдера, при создании вао движок пытается создать описание формата вершины из кода шейдера. Такой вариант удобнее, но если в шейдере не использовался какой-либо атрибут вершины (например нигде не используется тангенс), то при компиляции glsl кода шейдера этот атрибут будет выкинут из-за чего чтение данных из вершины будет совершенно некоректным. Подумать как решить эту проблему
 	*/
-	VertexArrayRef CreateVertexArray(VertexBufferRef vbo, IndexBufferRef ibo, const std::vector<VertexAttribute>& attribs);
+	VertexArrayRef CreateVertexArray(VertexBufferRef vbo, IndexBufferRef ibo, std::span<const VertexAttribute> attribs);
 	VertexArrayRef CreateVertexArray(VertexBufferRef vbo, IndexBufferRef ibo, ShaderProgramRef shaders);
+	// vertex array with a second buffer for per-instance attributes, which need a nonzero divisor
+	VertexArrayRef CreateVertexArray(VertexBufferRef vbo, IndexBufferRef ibo, std::span<const VertexAttribute> attribs, VertexBufferRef instanceVbo, std::span<const VertexAttribute> instanceAttribs);
 
 	GeometryBufferRef CreateGeometryBuffer(BufferUsage usage,
 		/*vertex*/unsigned vertexCount, unsigned vertexSize, const void* vertexData,
@@ -85,24 +137,45 @@ public:
 
 	FramebufferRef CreateFramebuffer(FramebufferAttachment attachment, Texture2DRef texture); // TODO: delete
 
+	// samplers and pipeline states are shared: equal descriptions return the same object
+	SamplerRef CreateSampler(const SamplerState& state);
+	PipelineStateRef CreatePipelineState(const PipelineStateCreateInfo& createInfo);
+	// drop the cached samplers and pipeline states nobody else references, called by EndFrame()
+	void RemoveUnusedStates();
+
 	//-------------------------------------------------------------------------
 	// Validation Resource
 	//-------------------------------------------------------------------------
 	inline bool IsValid(ShaderRef resource) const { return resource && resource->IsValid(); }
 	inline bool IsValid(ShaderProgramRef resource) const { return resource && resource->IsValid(); }
 	inline bool IsValid(const Uniform& uniform) const { return uniform.location >= 0; }
+	inline bool IsValid(const UniformBlock& block) const { return block.index != GL_INVALID_INDEX; }
 	inline bool IsValid(GPUBufferRef resource) const { return resource && resource->IsValid(); }
 	inline bool IsValid(VertexArrayRef resource) const { return resource && resource->IsValid(); }
 	inline bool IsValid(Texture2DRef resource) const { return resource && resource->IsValid(); }
 	inline bool IsValid(GeometryBufferRef resource) const { return resource && IsValid(resource->vao); }
 	inline bool IsValid(FramebufferRef resource) const { return resource && resource->IsValid(); }
+	inline bool IsValid(SamplerRef resource) const { return resource && resource->IsValid(); }
+	inline bool IsValid(PipelineStateRef resource) const { return resource && IsValid(resource->info.program); }
 	bool IsReadyUniform(const Uniform& uniform) const;
 
 	//-------------------------------------------------------------------------
 	// Shader Operations
 	//-------------------------------------------------------------------------
-	std::vector<ShaderAttributeInfo> GetAttributesInfo(ShaderProgramRef program) const;
+	// reflection tables of the program, built when it is linked
+	const std::vector<ShaderAttributeInfo>& GetAttributesInfo(ShaderProgramRef program) const;
+	const std::vector<ShaderUniformInfo>& GetUniformsInfo(ShaderProgramRef program) const;
+	// uniform blocks with their member layout, for filling std140 structures
+	const std::vector<UniformBlockInfo>& GetUniformBlocksInfo(ShaderProgramRef program) const;
 	Uniform GetUniform(ShaderProgramRef program, const char* uniformName) const;
+	// invalid if the uniform does not exist or its type in the shader does not match T
+	template<typename T>
+	ShaderParameter<T> GetShaderParameter(ShaderProgramRef program, const char* uniformName) const
+	{
+		return { getShaderParameter(program, uniformName, UniformTypeOf<T>::value) };
+	}
+	UniformBlock GetUniformBlock(ShaderProgramRef program, const char* blockName) const;
+	void SetUniformBlockBinding(const UniformBlock& block, unsigned bindingPoint);
 
 	void SetUniform(const Uniform& uniform, bool value);
 	void SetUniform(const Uniform& uniform, int value);
@@ -120,6 +193,10 @@ public:
 	void SetUniform(const Uniform& uniform, std::span<glm::vec2> values);
 	void SetUniform(const Uniform& uniform, std::span<glm::vec3> values);
 	void SetUniform(const Uniform& uniform, std::span<glm::vec4> values);
+	// raw data of count values of the given type, for replaying recorded uniforms
+	void SetUniform(const Uniform& uniform, UniformType type, unsigned count, const void* data);
+	template<typename T>
+	void SetUniform(const ShaderParameter<T>& parameter, const T& value) { SetUniform(parameter.uniform, value); }
 
 	// не рекомендуется - только для быстрого теста
 	void SetUniform(const std::string& uniformName, bool value);
@@ -138,6 +215,15 @@ public:
 	// TODO: отрефакторить убрав копипаст выделив его в приватную функцию
 	bool UpdateBuffer(VertexBufferRef buffer, unsigned offset, unsigned count, unsigned size, const void* data);
 	bool UpdateBuffer(IndexBufferRef buffer, unsigned offset, unsigned count, IndexFormat indexFormat, const void* data);
+	// offset and size in bytes
+	bool UpdateBuffer(UniformBufferRef buffer, unsigned offset, unsigned size, const void* data);
+#if !PLATFORM_EMSCRIPTEN
+	// offset and size in bytes
+	bool UpdateBuffer(ShaderStorageBufferRef buffer, unsigned offset, unsigned size, const void* data);
+	// offset and size in commands
+	bool UpdateBuffer(DrawIndirectBufferRef buffer, unsigned offset, std::span<const DrawElementsIndirectCommand> commands);
+	bool UpdateBuffer(DrawIndirectBufferRef buffer, unsigned offset, std::span<const DrawArraysIndirectCommand> commands);
+#endif
 
 	// TODO: нужно проверить как работает бинд перед мапингом с учетом текущего ВАО
 #if !PLATFORM_EMSCRIPTEN
@@ -157,6 +243,9 @@ public:
 	void Bind(DepthState state);
 	void Bind(StencilState state);
 	void Bind(RasterizerState state);
+	void Bind(BlendState state);
+	// bind the program and the states of the pipeline that differ from the current ones
+	void Bind(PipelineStateRef state);
 	void Bind(ShaderProgramRef resource);
 	void Bind(unsigned rawShader);
 	void Bind(VertexBufferRef buffer);
@@ -164,7 +253,17 @@ public:
 	void Bind(VertexArrayRef vao);
 	void Bind(const VertexAttribute& Attribute);
 	void Bind(Texture2DRef resource, unsigned slot = 0);
+	// null sampler returns the slot to the sampling parameters of the texture
+	void Bind(SamplerRef resource, unsigned slot = 0);
 	void Bind(FramebufferRef resource);
+	void Bind(UniformBufferRef buffer, unsigned bindingPoint);
+	// bind part of a uniform buffer, offset must be a multiple of Capabilities::uniformBufferOffsetAlignment
+	void BindRange(UniformBufferRef buffer, unsigned bindingPoint, unsigned offset, unsigned size);
+#if !PLATFORM_EMSCRIPTEN
+	void Bind(ShaderStorageBufferRef buffer, unsigned bindingPoint);
+	// offset must be a multiple of Capabilities::shaderStorageBufferOffsetAlignment
+	void BindRange(ShaderStorageBufferRef buffer, unsigned bindingPoint, unsigned offset, unsigned size);
+#endif
 
 	//-------------------------------------------------------------------------
 	// Raw GL State
@@ -180,60 +279,144 @@ public:
 	//-------------------------------------------------------------------------
 	void Draw(VertexArrayRef vao, PrimitiveTopology primitive = PrimitiveTopology::Triangles);
 	void Draw(GeometryBufferRef geom, PrimitiveTopology primitive = PrimitiveTopology::Triangles);
+	// draw instanceCount copies of the whole vertex array in one call
+	void DrawInstanced(VertexArrayRef vao, unsigned instanceCount, PrimitiveTopology primitive = PrimitiveTopology::Triangles);
+	void DrawInstanced(GeometryBufferRef geom, unsigned instanceCount, PrimitiveTopology primitive = PrimitiveTopology::Triangles);
+	// draw count indices starting from index first, or count vertices starting from vertex first without an index buffer
+	void DrawRange(VertexArrayRef vao, unsigned first, unsigned count, PrimitiveTopology primitive = PrimitiveTopology::Triangles);
+#if !PLATFORM_EMSCRIPTEN
+	// draw a range of the index buffer with baseVertex added to every index, for several meshes packed into one vertex array
+	void DrawBaseVertex(VertexArrayRef vao, unsigned firstIndex, unsigned indexCount, int baseVertex, unsigned instanceCount = 1, PrimitiveTopology primitive = PrimitiveTopology::Triangles);
+	// run drawCount commands of the indirect buffer starting from command first. Indexed vertex arrays read DrawElementsIndirectCommand, others DrawArraysIndirectCommand
+	void MultiDrawIndirect(VertexArrayRef vao, DrawIndirectBufferRef commands, unsigned first, unsigned drawCount, PrimitiveTopology primitive = PrimitiveTopology::Triangles);
+#endif
 
 	//-------------------------------------------------------------------------
 	// Binding state
 	//-------------------------------------------------------------------------
 	unsigned GetCurrentIBO() const { return m_cache.CurrentIBO; }
+	DepthState GetCurrentDepthState() const { return m_cache.CurrentDepthState; }
+
+	//-------------------------------------------------------------------------
+	// Statistics
+	//-------------------------------------------------------------------------
+	// counters of the current frame
+	const RenderStatistics& GetStatistics() const { return m_statistics; }
+	// counters of the last finished frame, updated by EndFrame()
+	const RenderStatistics& GetFrameStatistics() const { return m_frameStatistics; }
+	void ResetStatistics() { m_statistics = {}; }
+
+	//-------------------------------------------------------------------------
+	// Frame uniforms
+	//-------------------------------------------------------------------------
+	// per-frame ring for per-object and per-material uniform blocks: UniformRingBuffer::Push() is one copy plus one glBindBufferRange
+	UniformRingBuffer& GetFrameUniforms() { return m_frameUniforms; }
+
+	//-------------------------------------------------------------------------
+	// Profiling
+	//-------------------------------------------------------------------------
+	GPUProfiler& GetGPUProfiler() { return m_gpuProfiler; }
 private:
 	RenderSystem(RenderSystem&&) = delete;
 	RenderSystem(const RenderSystem&) = delete;
 	RenderSystem& operator=(RenderSystem&&) = delete;
 	RenderSystem& operator=(const RenderSystem&) = delete;
 
+	// add data sent to the driver to the statistics, null data only allocates
+	void countUpload(const void* data, size_t size) { if (data) m_statistics.bytesUploaded += size; }
+
 	void initializeExtensions(bool print);
 	void initializeCapabilities(bool print);
 
 	void validationShaderCode(std::string& vertexCode, std::string& fragmentCode);
 
 	ShaderRef compileShader(ShaderPipelineStage type, const std::string& source);
+	bool checkShader(const Shader& shader, const std::string& source) const;
+	void reflectShaderProgram(ShaderProgram& program);
+	Uniform getShaderParameter(ShaderProgramRef program, const char* uniformName, UniformType type) const;
+	Uniform getCurrentUniform(const std::string& uniformName) const;
+	// compare with the value cache of the current program and store the new value, true if the uniform must be written
+	bool uniformChanged(const Uniform& uniform, const void* data, size_t size);
+	bool updateUniformValue(const Uniform& uniform, const void* data, size_t size);
 	void attachmentFrameBufferColor(FramebufferRef fbo, RenderbufferRef colorBuffer);
 	void attachmentFrameBufferColor(FramebufferRef fbo, Texture2DRef colorTexture);
 	void attachmentFrameBufferColor(FramebufferRef fbo, const std::vector<Texture2DRef>& colorTextures);
 	void attachmentFrameBufferDepthStencil(FramebufferRef fbo, RenderbufferRef depthStencilBuffer);
 	void attachmentFrameBufferDepthStencil(FramebufferRef fbo, Texture2DRef depthStencilTexture);
 	bool checkCurrentFrameBuffer() const;
+#if !PLATFORM_EMSCRIPTEN
+	DrawIndirectBufferRef createDrawIndirectBuffer(BufferUsage usage, unsigned commandCount, unsigned commandSize, const void* data);
+	bool updateDrawIndirectBuffer(DrawIndirectBufferRef buffer, unsigned offset, unsigned commandCount, unsigned commandSize, const void* data);
+	void bindDrawIndirectBuffer(unsigned id);
+#endif
 
 	void setClearMask(bool color, bool depth, bool stensil);
 
 	struct
 	{
 		unsigned CurrentShaderProgram = 0;
+		// reflection and uniform value cache of the current program, null if bound by raw id
+		ShaderProgramRef CurrentShaderProgramRef;
 		unsigned CurrentVBO = 0;
 		unsigned CurrentIBO = 0;
 		unsigned CurrentVAO = 0;
 		unsigned CurrentTexture2D[MaxBindingTextures] = { 0 };
+		unsigned CurrentSampler[MaxBindingTextures] = { 0 };
 		unsigned CurrentFramebuffer = 0;
+		unsigned CurrentDrawIndirectBuffer = 0;
+		struct
+		{
+			unsigned id = 0;
+			unsigned offset = 0;
+			unsigned size = 0;
+		} CurrentUniformBuffers[MaxBindingUniformBuffers];
+		struct
+		{
+			unsigned id = 0;
+			unsigned offset = 0;
+			unsigned size = 0;
+		} CurrentStorageBuffers[MaxBindingStorageBuffers];
 
 		DepthState CurrentDepthState{};
 		StencilState CurrentStencilState{};
 		RasterizerState CurrentRasterizerState{};
+		BlendState CurrentBlendState{};
+		glm::ivec4 CurrentViewport = glm::ivec4(0);
+		glm::ivec4 CurrentScissor = glm::ivec4(0);
+		// last bound pipeline, reset by any bind of a single state or program
+		PipelineStateRef CurrentPipelineState;
 
 		GLbitfield CurrentClearMask = 0;
 
 		void Reset()
 		{
-			CurrentShaderProgram = CurrentVBO = CurrentIBO = CurrentVAO = CurrentFramebuffer = 0;
+			CurrentShaderProgram = CurrentVBO = CurrentIBO = CurrentVAO = CurrentFramebuffer = CurrentDrawIndirectBuffer = 0;
+			CurrentShaderProgramRef.reset();
 			for (size_t i = 0; i < MaxBindingTextures; i++)
-				CurrentTexture2D[i] = 0;
+				CurrentTexture2D[i] = CurrentSampler[i] = 0;
+			for (size_t i = 0; i < MaxBindingUniformBuffers; i++)
+				CurrentUniformBuffers[i] = {};
+			for (size_t i = 0; i < MaxBindingStorageBuffers; i++)
+				CurrentStorageBuffers[i] = {};
 			CurrentDepthState = {};
 			CurrentStencilState = {};
 			CurrentRasterizerState = {};
+			CurrentBlendState = {};
+			CurrentViewport = CurrentScissor = glm::ivec4(0);
+			CurrentPipelineState.reset();
 			CurrentClearMask = 0;
 		}
 	} m_cache;
 
 	std::unordered_map<std::string, Texture2DRef> m_cacheFileTextures2D;
+	std::unordered_map<uint64_t, SamplerRef> m_cacheSamplers;
+	std::unordered_map<uint64_t, PipelineStateRef> m_cachePipelineStates;
+	unsigned m_nextPipelineStateId = 1;
+	RenderStatistics m_statistics;
+	RenderStatistics m_frameStatistics;
+	UniformRingBuffer m_frameUniforms;
+	GPUProfiler m_gpuProfiler;
+	ShaderCache m_shaderCache;
 };
 
 RenderSystem& GetRenderSystem();
\ No newline at end of file
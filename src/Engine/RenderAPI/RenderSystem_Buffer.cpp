@@ -1,6 +1,7 @@
 #include "stdafx.h"
 #include "RenderSystem.h"
 #include "OpenGLTranslateToGL.h"
+#include "Core/Object/FrameArena.h"
 //-----------------------------------------------------------------------------
 VertexBufferRef RenderSystem::CreateVertexBuffer(BufferUsage usage)
 {
@@ -24,6 +25,7 @@ VertexBufferRef RenderSystem::CreateVertexBuffer(BufferUsage usage, unsigned ver
 	glBindBuffer(GL_ARRAY_BUFFER, *resource);
 	glBufferData(GL_ARRAY_BUFFER, vertexCount * vertexSize, data, TranslateToGL(usage));
 	glBindBuffer(GL_ARRAY_BUFFER, m_cache.CurrentVBO); // restore current vb
+	countUpload(data, vertexCount * vertexSize);
 	return resource;
 }
 //-----------------------------------------------------------------------------
@@ -56,10 +58,16 @@ IndexBufferRef RenderSystem::CreateIndexBuffer(BufferUsage usage, unsigned index
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *resource);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * indexSize, data, TranslateToGL(usage));
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_cache.CurrentIBO); // restore current ib
+	countUpload(data, indexCount * indexSize);
 	return resource;
 }
 //-----------------------------------------------------------------------------
-VertexArrayRef RenderSystem::CreateVertexArray(VertexBufferRef vbo, IndexBufferRef ibo, const std::vector<VertexAttribute>& attribs)
+VertexArrayRef RenderSystem::CreateVertexArray(VertexBufferRef vbo, IndexBufferRef ibo, std::span<const VertexAttribute> attribs)
+{
+	return CreateVertexArray(vbo, ibo, attribs, nullptr, {});
+}
+//-----------------------------------------------------------------------------
+VertexArrayRef RenderSystem::CreateVertexArray(VertexBufferRef vbo, IndexBufferRef ibo, std::span<const VertexAttribute> attribs, VertexBufferRef instanceVbo, std::span<const VertexAttribute> instanceAttribs)
 {
 	if (vbo == nullptr || !IsValid(vbo) || attribs.size() == 0)
 	{
@@ -76,8 +84,13 @@ VertexArrayRef RenderSystem::CreateVertexArray(VertexBufferRef vbo, IndexBufferR
 		LogError("ibo is not IndexBuffer valid!");
 		return {};
 	}
+	if (instanceAttribs.size() > 0 && (instanceVbo == nullptr || !IsValid(instanceVbo) || instanceVbo->type != BufferTarget::ArrayBuffer))
+	{
+		LogError("instanceVbo is not VertexBuffer valid!");
+		return {};
+	}
 
-	VertexArrayRef resource(new VertexArray(vbo, ibo, static_cast<unsigned>(attribs.size())));
+	VertexArrayRef resource(new VertexArray(vbo, ibo, static_cast<unsigned>(attribs.size() + instanceAttribs.size())));
 	if (!IsValid(resource))
 	{
 		LogError("VertexArray create failed!");
@@ -85,6 +98,8 @@ VertexArrayRef RenderSystem::CreateVertexArray(VertexBufferRef vbo, IndexBufferR
 	}
 	vbo->parentArray = resource;
 	if (ibo) ibo->parentArray = resource;
+	// the instance buffer may be shared by several vertex arrays, so it has no parent array
+	if (instanceAttribs.size() > 0) resource->instanceVbo = instanceVbo;
 
 	glBindVertexArray(*resource);
 	Bind(resource->vbo);
@@ -92,6 +107,15 @@ VertexArrayRef RenderSystem::CreateVertexArray(VertexBufferRef vbo, IndexBufferR
 	{
 		Bind(attribs[i]);
 	}
+	if (resource->instanceVbo)
+	{
+		Bind(resource->instanceVbo);
+		for (size_t i = 0; i < instanceAttribs.size(); i++)
+		{
+			assert(instanceAttribs[i].divisor > 0);
+			Bind(instanceAttribs[i]);
+		}
+	}
 	Bind(resource->ibo);
 
 	glBindVertexArray(m_cache.CurrentVAO); // restore VAO
@@ -103,11 +127,13 @@ VertexArrayRef RenderSystem::CreateVertexArray(VertexBufferRef vbo, IndexBufferR
 //-----------------------------------------------------------------------------
 VertexArrayRef RenderSystem::CreateVertexArray(VertexBufferRef vbo, IndexBufferRef ibo, ShaderProgramRef shaders)
 {
-	auto attribInfo = GetAttributesInfo(shaders);
+	const auto& attribInfo = GetAttributesInfo(shaders);
 	if (attribInfo.empty()) return {};
 
+	// attribute layout is only needed while the vertex array is created
+	FrameArenaScope frameScope;
 	size_t offset = 0;
-	std::vector<VertexAttribute> attribs(attribInfo.size());
+	FrameVector<VertexAttribute> attribs(attribInfo.size());
 	for (size_t i = 0; i < attribInfo.size(); i++)
 	{
 		// TODO: gl_VertexID  ,    - location    -1
@@ -180,6 +206,7 @@ bool RenderSystem::UpdateBuffer(VertexBufferRef buffer, unsigned offset, unsigne
 		if (m_cache.CurrentVBO != id) glBindBuffer(GL_ARRAY_BUFFER, m_cache.CurrentVBO);
 	}
 
+	countUpload(data, numberOfBytes);
 	return true;
 }
 //-----------------------------------------------------------------------------
@@ -222,8 +249,215 @@ bool RenderSystem::UpdateBuffer(IndexBufferRef buffer, unsigned offset, unsigned
 		if (m_cache.CurrentIBO != id) 
 			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_cache.CurrentIBO);
 	}
+	countUpload(data, numberOfBytes);
+}
+//-----------------------------------------------------------------------------
+UniformBufferRef RenderSystem::CreateUniformBuffer(BufferUsage usage, unsigned size, const void* data)
+{
+	if (!size)
+	{
+		LogError("Can not define uniform buffer with zero size");
+		return {};
+	}
+
+	UniformBufferRef resource(new UniformBuffer(usage, size));
+	if (!IsValid(resource))
+	{
+		LogError("UniformBuffer create failed!");
+		return {};
+	}
+	// the generic uniform buffer binding is not cached, the indexed binding points are not touched by it
+	glBindBuffer(GL_UNIFORM_BUFFER, *resource);
+	glBufferData(GL_UNIFORM_BUFFER, size, data, TranslateToGL(usage));
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	countUpload(data, size);
+	return resource;
 }
 //-----------------------------------------------------------------------------
+bool RenderSystem::UpdateBuffer(UniformBufferRef buffer, unsigned offset, unsigned size, const void* data)
+{
+	assert(IsValid(buffer));
+	if (!data)
+	{
+		LogError("Null source data for updating uniform buffer");
+		return false;
+	}
+	if (offset + size > buffer->count)
+	{
+		LogError("Uniform buffer update out of range");
+		return false;
+	}
+
+#if PLATFORM_DESKTOP
+	if (OpenGLExtensions::coreDirectStateAccess)
+		glNamedBufferSubData(*buffer, offset, size, data);
+	else
+#endif
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, *buffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+	countUpload(data, size);
+	return true;
+}
+//-----------------------------------------------------------------------------
+#if !PLATFORM_EMSCRIPTEN
+ShaderStorageBufferRef RenderSystem::CreateShaderStorageBuffer(BufferUsage usage, unsigned size, const void* data)
+{
+	if (OpenGLExtensions::version < OPENGL43)
+	{
+		LogError("ShaderStorageBuffer requires OpenGL 4.3");
+		return {};
+	}
+	if (!size)
+	{
+		LogError("Can not define shader storage buffer with zero size");
+		return {};
+	}
+
+	ShaderStorageBufferRef resource(new ShaderStorageBuffer(usage, size));
+	if (!IsValid(resource))
+	{
+		LogError("ShaderStorageBuffer create failed!");
+		return {};
+	}
+	// the generic shader storage buffer binding is not cached, the indexed binding points are not touched by it
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, *resource);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, size, data, TranslateToGL(usage));
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	countUpload(data, size);
+	return resource;
+}
+#endif
+//-----------------------------------------------------------------------------
+#if !PLATFORM_EMSCRIPTEN
+bool RenderSystem::UpdateBuffer(ShaderStorageBufferRef buffer, unsigned offset, unsigned size, const void* data)
+{
+	assert(IsValid(buffer));
+	if (!data)
+	{
+		LogError("Null source data for updating shader storage buffer");
+		return false;
+	}
+	if (offset + size > buffer->count)
+	{
+		LogError("Shader storage buffer update out of range");
+		return false;
+	}
+
+#if PLATFORM_DESKTOP
+	if (OpenGLExtensions::coreDirectStateAccess)
+		glNamedBufferSubData(*buffer, offset, size, data);
+	else
+#endif
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, *buffer);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, offset, size, data);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+	countUpload(data, size);
+	return true;
+}
+#endif
+//-----------------------------------------------------------------------------
+#if !PLATFORM_EMSCRIPTEN
+DrawIndirectBufferRef RenderSystem::CreateDrawIndirectBuffer(BufferUsage usage, std::span<const DrawElementsIndirectCommand> commands)
+{
+	return createDrawIndirectBuffer(usage, static_cast<unsigned>(commands.size()), sizeof(DrawElementsIndirectCommand), commands.data());
+}
+//-----------------------------------------------------------------------------
+DrawIndirectBufferRef RenderSystem::CreateDrawIndirectBuffer(BufferUsage usage, std::span<const DrawArraysIndirectCommand> commands)
+{
+	return createDrawIndirectBuffer(usage, static_cast<unsigned>(commands.size()), sizeof(DrawArraysIndirectCommand), commands.data());
+}
+//-----------------------------------------------------------------------------
+bool RenderSystem::UpdateBuffer(DrawIndirectBufferRef buffer, unsigned offset, std::span<const DrawElementsIndirectCommand> commands)
+{
+	return updateDrawIndirectBuffer(buffer, offset, static_cast<unsigned>(commands.size()), sizeof(DrawElementsIndirectCommand), commands.data());
+}
+//-----------------------------------------------------------------------------
+bool RenderSystem::UpdateBuffer(DrawIndirectBufferRef buffer, unsigned offset, std::span<const DrawArraysIndirectCommand> commands)
+{
+	return updateDrawIndirectBuffer(buffer, offset, static_cast<unsigned>(commands.size()), sizeof(DrawArraysIndirectCommand), commands.data());
+}
+//-----------------------------------------------------------------------------
+DrawIndirectBufferRef RenderSystem::createDrawIndirectBuffer(BufferUsage usage, unsigned commandCount, unsigned commandSize, const void* data)
+{
+	DrawIndirectBufferRef resource(new DrawIndirectBuffer(usage, commandCount, commandSize));
+	if (!IsValid(resource))
+	{
+		LogError("DrawIndirectBuffer create failed!");
+		return {};
+	}
+
+	const size_t numberOfBytes = static_cast<size_t>(commandCount) * commandSize;
+	if (OpenGLExtensions::version >= OPENGL43)
+	{
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, *resource);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, static_cast<GLsizeiptr>(numberOfBytes), data, TranslateToGL(usage));
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_cache.CurrentDrawIndirectBuffer); // restore current indirect buffer
+		countUpload(data, numberOfBytes);
+	}
+	else
+	{
+		resource->shadowData.resize(numberOfBytes);
+		if (data && numberOfBytes) memcpy(resource->shadowData.data(), data, numberOfBytes);
+	}
+	return resource;
+}
+//-----------------------------------------------------------------------------
+bool RenderSystem::updateDrawIndirectBuffer(DrawIndirectBufferRef buffer, unsigned offset, unsigned commandCount, unsigned commandSize, const void* data)
+{
+	assert(IsValid(buffer));
+	if (!data)
+	{
+		LogError("Null source data for updating draw indirect buffer");
+		return false;
+	}
+
+	const bool isNewBufferData = (offset == 0 && (buffer->count != commandCount || buffer->sizeInBytes != commandSize));
+	if (!isNewBufferData && (buffer->sizeInBytes != commandSize || offset + commandCount > buffer->count))
+	{
+		LogError("Draw indirect buffer update out of range");
+		return false;
+	}
+	if (isNewBufferData)
+	{
+		buffer->count = commandCount;
+		buffer->sizeInBytes = commandSize;
+	}
+
+	const size_t numberOfBytes = static_cast<size_t>(commandCount) * commandSize;
+	const size_t offsetInBytes = static_cast<size_t>(offset) * commandSize;
+	if (OpenGLExtensions::version >= OPENGL43)
+	{
+		const unsigned id = *buffer;
+		if (m_cache.CurrentDrawIndirectBuffer != id) glBindBuffer(GL_DRAW_INDIRECT_BUFFER, id);
+
+		if (isNewBufferData) glBufferData(GL_DRAW_INDIRECT_BUFFER, static_cast<GLsizeiptr>(numberOfBytes), data, TranslateToGL(buffer->usage));
+		else glBufferSubData(GL_DRAW_INDIRECT_BUFFER, static_cast<GLintptr>(offsetInBytes), static_cast<GLsizeiptr>(numberOfBytes), data);
+
+		if (m_cache.CurrentDrawIndirectBuffer != id) glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_cache.CurrentDrawIndirectBuffer);
+		countUpload(data, numberOfBytes);
+	}
+	else
+	{
+		if (isNewBufferData) buffer->shadowData.resize(numberOfBytes);
+		if (numberOfBytes) memcpy(buffer->shadowData.data() + offsetInBytes, data, numberOfBytes);
+	}
+	return true;
+}
+//-----------------------------------------------------------------------------
+void RenderSystem::bindDrawIndirectBuffer(unsigned id)
+{
+	if (m_cache.CurrentDrawIndirectBuffer == id) return;
+	m_cache.CurrentDrawIndirectBuffer = id;
+	m_statistics.bufferBinds++;
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, id);
+}
+#endif
+//-----------------------------------------------------------------------------
 #if !PLATFORM_EMSCRIPTEN
 inline void* mapBuffer(unsigned buffer, unsigned currentState, GLenum target, GLenum access)
 {
@@ -275,13 +509,18 @@ inline void* mapBuffer(unsigned buffer, unsigned currentState, GLenum target, un
 void* RenderSystem::MapBuffer(VertexBufferRef buffer, unsigned offset, unsigned size, GLbitfield access)
 {
 	assert(IsValid(buffer));
-	return mapBuffer(*buffer, m_cache.CurrentVBO, GL_ARRAY_BUFFER, offset, size, access);
+	void* data = mapBuffer(*buffer, m_cache.CurrentVBO, GL_ARRAY_BUFFER, offset, size, access);
+	// a range mapped for writing reaches the driver like a glBufferSubData of its size
+	if (access & GL_MAP_WRITE_BIT) countUpload(data, size);
+	return data;
 }
 //-----------------------------------------------------------------------------
 void* RenderSystem::MapBuffer(IndexBufferRef buffer, unsigned offset, unsigned size, GLbitfield access)
 {
 	assert(IsValid(buffer));
-	return mapBuffer(*buffer, m_cache.CurrentIBO, GL_ELEMENT_ARRAY_BUFFER, offset, size, access);
+	void* data = mapBuffer(*buffer, m_cache.CurrentIBO, GL_ELEMENT_ARRAY_BUFFER, offset, size, access);
+	if (access & GL_MAP_WRITE_BIT) countUpload(data, size);
+	return data;
 }
 //-----------------------------------------------------------------------------
 inline bool unmapBuffer(unsigned buffer, unsigned currentState, GLenum target)
@@ -2,6 +2,10 @@
 #include "RenderSystem.h"
 #include "OpenGLTranslateToGL.h"
 //-----------------------------------------------------------------------------
+#ifndef GL_COMPLETION_STATUS_KHR
+#	define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+//-----------------------------------------------------------------------------
 [[nodiscard]] inline GLenum getAttributeType(GLenum type)
 {
 	switch (type)
@@ -10,32 +14,48 @@
 	case GL_FLOAT_VEC2:
 	case GL_FLOAT_VEC3:
 	case GL_FLOAT_VEC4:
+	case GL_FLOAT_MAT2:
+	case GL_FLOAT_MAT3:
+	case GL_FLOAT_MAT4:
 		return GL_FLOAT;
 	case GL_INT:
 	case GL_INT_VEC2:
 	case GL_INT_VEC3:
 	case GL_INT_VEC4:
 		return GL_INT;
+	case GL_UNSIGNED_INT:
+	case GL_UNSIGNED_INT_VEC2:
+	case GL_UNSIGNED_INT_VEC3:
+	case GL_UNSIGNED_INT_VEC4:
+		return GL_UNSIGNED_INT;
 	}
 	assert(false && "Unknown active attribute type!");
 	return 0;
 }
 //-----------------------------------------------------------------------------
+// components per attribute location, matrices take one location per column
 [[nodiscard]] inline GLint getAttributeSize(GLenum type)
 {
 	switch (type)
 	{
 	case GL_FLOAT:
 	case GL_INT:
+	case GL_UNSIGNED_INT:
 		return 1;
 	case GL_FLOAT_VEC2:
 	case GL_INT_VEC2:
+	case GL_UNSIGNED_INT_VEC2:
+	case GL_FLOAT_MAT2:
 		return 2;
 	case GL_FLOAT_VEC3:
 	case GL_INT_VEC3:
+	case GL_UNSIGNED_INT_VEC3:
+	case GL_FLOAT_MAT3:
 		return 3;
 	case GL_FLOAT_VEC4:
 	case GL_INT_VEC4:
+	case GL_UNSIGNED_INT_VEC4:
+	case GL_FLOAT_MAT4:
 		return 4;
 	}
 
@@ -43,91 +63,100 @@
 	return 0;
 }
 //-----------------------------------------------------------------------------
-ShaderProgramRef RenderSystem::CreateShaderProgram(const ShaderBytecode& vertexShaderSource, const ShaderBytecode& fragmentShaderSource)
+[[nodiscard]] inline bool isSamplerType(GLenum type)
 {
-	if (!vertexShaderSource.IsValid())
-	{
-		LogError("You must provide vertex shader (source is blank).");
-		return nullptr;
-	}
-
-	if (!fragmentShaderSource.IsValid())
+	switch (type)
 	{
-		LogError("You must provide fragment shader (source is blank).");
-		return nullptr;
+	case GL_SAMPLER_2D:
+	case GL_SAMPLER_3D:
+	case GL_SAMPLER_CUBE:
+	case GL_SAMPLER_2D_SHADOW:
+	case GL_SAMPLER_2D_ARRAY:
+	case GL_SAMPLER_2D_ARRAY_SHADOW:
+	case GL_SAMPLER_CUBE_SHADOW:
+	case GL_INT_SAMPLER_2D:
+	case GL_INT_SAMPLER_3D:
+	case GL_INT_SAMPLER_CUBE:
+	case GL_INT_SAMPLER_2D_ARRAY:
+	case GL_UNSIGNED_INT_SAMPLER_2D:
+	case GL_UNSIGNED_INT_SAMPLER_3D:
+	case GL_UNSIGNED_INT_SAMPLER_CUBE:
+	case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
+		return true;
 	}
-
-	std::string vertexShaderSourceCode = vertexShaderSource.GetSource();
-	std::string fragmentShaderSourceCode = fragmentShaderSource.GetSource();
-	validationShaderCode(vertexShaderSourceCode, fragmentShaderSourceCode);
-
-	ShaderRef glShaderVertex = compileShader(ShaderPipelineStage::Vertex, vertexShaderSourceCode);
-	ShaderRef glShaderFragment = compileShader(ShaderPipelineStage::Fragment, fragmentShaderSourceCode);
-
-	ShaderProgramRef resource;
-	if (IsValid(glShaderVertex) && IsValid(glShaderFragment))
+	return false;
+}
+//-----------------------------------------------------------------------------
+// bytes of one value of a uniform as written by SetUniform, 0 for types that are not cached
+[[nodiscard]] inline unsigned getUniformValueSize(GLenum type)
+{
+	if (isSamplerType(type)) return sizeof(int);
+	switch (type)
 	{
-		resource.reset(new ShaderProgram());
-
-		glAttachShader(*resource, *glShaderVertex);
-		glAttachShader(*resource, *glShaderFragment);
-		glLinkProgram(*resource);
-		GLint linkStatus = 0;
-		glGetProgramiv(*resource, GL_LINK_STATUS, &linkStatus);
-		if (linkStatus == GL_FALSE)
-		{
-			GLint infoLogLength;
-			glGetProgramiv(*resource, GL_INFO_LOG_LENGTH, &infoLogLength);
-			std::unique_ptr<GLchar> errorInfoText{ new GLchar[static_cast<size_t>(infoLogLength + 1)] };
-			glGetProgramInfoLog(*resource, infoLogLength, nullptr, errorInfoText.get());
-			LogError("OPENGL: Shader program linking failed: " + std::string(errorInfoText.get()));
-			resource.reset();
-		}
-		glDetachShader(*resource, *glShaderVertex);
-		glDetachShader(*resource, *glShaderFragment);
+	case GL_BOOL:
+	case GL_INT:
+	case GL_UNSIGNED_INT:
+	case GL_FLOAT:
+		return 4;
+	case GL_FLOAT_VEC2:
+		return 4 * 2;
+	case GL_FLOAT_VEC3:
+		return 4 * 3;
+	case GL_FLOAT_VEC4:
+		return 4 * 4;
+	case GL_FLOAT_MAT3:
+		return 4 * 9;
+	case GL_FLOAT_MAT4:
+		return 4 * 16;
 	}
-	glShaderVertex.reset();
-	glShaderFragment.reset();
-
-	return resource;
+	return 0;
 }
 //-----------------------------------------------------------------------------
-bool RenderSystem::IsReadyUniform(const Uniform& uniform) const
+[[nodiscard]] inline bool isUniformTypeCompatible(GLenum glType, UniformType type)
 {
-	return IsValid(uniform) && uniform.programId == m_cache.CurrentShaderProgram;
+	switch (type)
+	{
+	case UniformType::Int:   return glType == GL_INT || glType == GL_BOOL || isSamplerType(glType);
+	case UniformType::UInt:  return glType == GL_UNSIGNED_INT;
+	case UniformType::Float: return glType == GL_FLOAT;
+	case UniformType::Vec2:  return glType == GL_FLOAT_VEC2;
+	case UniformType::Vec3:  return glType == GL_FLOAT_VEC3;
+	case UniformType::Vec4:  return glType == GL_FLOAT_VEC4;
+	case UniformType::Mat3:  return glType == GL_FLOAT_MAT3;
+	case UniformType::Mat4:  return glType == GL_FLOAT_MAT4;
+	}
+	return false;
 }
 //-----------------------------------------------------------------------------
-std::vector<ShaderAttributeInfo> RenderSystem::GetAttributesInfo(ShaderProgramRef program) const
+static std::vector<ShaderAttributeInfo> queryAttributesInfo(GLuint program)
 {
-	assert(IsValid(program));
-	if (!IsValid(program)) return {};
-
 	int activeAttribsCount = 0;
-	glGetProgramiv(*program, GL_ACTIVE_ATTRIBUTES, &activeAttribsCount);
+	glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &activeAttribsCount);
 	int maxNameLength = 0;
-	glGetProgramiv(*program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxNameLength);
+	glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxNameLength);
 
-	std::string name;
-	name.resize(static_cast<size_t>(maxNameLength));
+	std::vector<char> name(static_cast<size_t>(std::max(maxNameLength, 1)));
 
 	std::vector<ShaderAttributeInfo> attribs;
 	for (size_t i = 0; i < static_cast<size_t>(activeAttribsCount); i++)
 	{
 		GLint size;
 		GLenum type = 0;
-		glGetActiveAttrib(*program, (GLuint)i, maxNameLength, nullptr, &size, &type, name.data());
+		GLsizei length = 0;
+		glGetActiveAttrib(program, (GLuint)i, static_cast<GLsizei>(name.size()), &length, &size, &type, name.data());
+		const std::string attribName(name.data(), static_cast<size_t>(length));
 
-		std::size_t pos = name.find("gl_VertexID"); //      location = -1
-		if (pos != std::string::npos) continue;
+		// built-in inputs like gl_VertexID have no location
+		if (attribName.compare(0, 3, "gl_") == 0) continue;
 
-		int location = glGetAttribLocation(*program, name.c_str());
+		int location = glGetAttribLocation(program, attribName.c_str());
 		assert(location >= 0);
 
 		attribs.emplace_back(ShaderAttributeInfo{
 			.typeId = type,
 			.type = getAttributeType(type),
 			.numType = getAttributeSize(type),
-			.name = name,
+			.name = attribName,
 			.location = location
 		});
 	}
@@ -137,83 +166,436 @@ std::vector<ShaderAttributeInfo> RenderSystem::GetAttributesInfo(ShaderProgramRe
 	return attribs;
 }
 //-----------------------------------------------------------------------------
+static std::vector<ShaderUniformInfo> queryUniformsInfo(GLuint program)
+{
+	int activeUniformsCount = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &activeUniformsCount);
+	int maxNameLength = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+	std::vector<char> name(static_cast<size_t>(std::max(maxNameLength, 1)));
+
+	std::vector<ShaderUniformInfo> uniforms;
+	for (GLuint i = 0; i < static_cast<GLuint>(activeUniformsCount); i++)
+	{
+		// members of uniform blocks are reflected with their block
+		GLint blockIndex = -1;
+		glGetActiveUniformsiv(program, 1, &i, GL_UNIFORM_BLOCK_INDEX, &blockIndex);
+		if (blockIndex != -1) continue;
+
+		GLint size = 0;
+		GLenum type = 0;
+		GLsizei length = 0;
+		glGetActiveUniform(program, i, static_cast<GLsizei>(name.size()), &length, &size, &type, name.data());
+
+		ShaderUniformInfo uniform;
+		uniform.name.assign(name.data(), static_cast<size_t>(length));
+		uniform.location = glGetUniformLocation(program, uniform.name.c_str());
+		if (uniform.location < 0) continue;
+
+		if (uniform.name.size() > 3 && uniform.name.compare(uniform.name.size() - 3, 3, "[0]") == 0)
+			uniform.name.resize(uniform.name.size() - 3);
+		uniform.type = type;
+		uniform.arraySize = size;
+		uniform.sampler = isSamplerType(type);
+		uniform.valueSize = getUniformValueSize(type) * static_cast<unsigned>(size);
+		uniforms.emplace_back(std::move(uniform));
+	}
+
+	std::sort(uniforms.begin(), uniforms.end(), [](const ShaderUniformInfo& a, const ShaderUniformInfo& b) {return a.location < b.location; });
+
+	return uniforms;
+}
+//-----------------------------------------------------------------------------
+static std::vector<UniformBlockInfo> queryUniformBlocksInfo(GLuint program)
+{
+	int activeBlocksCount = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &activeBlocksCount);
+	int maxBlockNameLength = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxBlockNameLength);
+	int maxUniformNameLength = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxUniformNameLength);
+
+	std::vector<char> name(static_cast<size_t>(std::max(std::max(maxBlockNameLength, maxUniformNameLength), 1)));
+
+	std::vector<UniformBlockInfo> blocks;
+	for (GLuint i = 0; i < static_cast<GLuint>(activeBlocksCount); i++)
+	{
+		GLsizei length = 0;
+		glGetActiveUniformBlockName(program, i, static_cast<GLsizei>(name.size()), &length, name.data());
+
+		GLint dataSize = 0;
+		glGetActiveUniformBlockiv(program, i, GL_UNIFORM_BLOCK_DATA_SIZE, &dataSize);
+		GLint membersCount = 0;
+		glGetActiveUniformBlockiv(program, i, GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS, &membersCount);
+
+		UniformBlockInfo block;
+		block.name.assign(name.data(), static_cast<size_t>(length));
+		block.index = i;
+		block.dataSize = static_cast<unsigned>(dataSize);
+		if (membersCount > 0)
+		{
+			std::vector<GLint> indices(static_cast<size_t>(membersCount));
+			glGetActiveUniformBlockiv(program, i, GL_UNIFORM_BLOCK_ACTIVE_UNIFORM_INDICES, indices.data());
+
+			// all members are queried with one call per property
+			const GLuint* memberIndices = reinterpret_cast<const GLuint*>(indices.data());
+			std::vector<GLint> types(indices.size()), offsets(indices.size()), sizes(indices.size()), arrayStrides(indices.size()), matrixStrides(indices.size());
+			glGetActiveUniformsiv(program, membersCount, memberIndices, GL_UNIFORM_TYPE, types.data());
+			glGetActiveUniformsiv(program, membersCount, memberIndices, GL_UNIFORM_OFFSET, offsets.data());
+			glGetActiveUniformsiv(program, membersCount, memberIndices, GL_UNIFORM_SIZE, sizes.data());
+			glGetActiveUniformsiv(program, membersCount, memberIndices, GL_UNIFORM_ARRAY_STRIDE, arrayStrides.data());
+			glGetActiveUniformsiv(program, membersCount, memberIndices, GL_UNIFORM_MATRIX_STRIDE, matrixStrides.data());
+
+			block.members.reserve(indices.size());
+			for (size_t j = 0; j < indices.size(); j++)
+			{
+				glGetActiveUniformName(program, memberIndices[j], static_cast<GLsizei>(name.size()), &length, name.data());
+				block.members.emplace_back(UniformBlockMemberInfo{
+					.name = std::string(name.data(), static_cast<size_t>(length)),
+					.type = static_cast<unsigned>(types[j]),
+					.offset = offsets[j],
+					.arraySize = sizes[j],
+					.arrayStride = arrayStrides[j],
+					.matrixStride = matrixStrides[j]
+				});
+			}
+			std::sort(block.members.begin(), block.members.end(), [](const UniformBlockMemberInfo& a, const UniformBlockMemberInfo& b) {return a.offset < b.offset; });
+		}
+		blocks.emplace_back(std::move(block));
+	}
+
+	return blocks;
+}
+//-----------------------------------------------------------------------------
+ShaderProgramRef RenderSystem::CreateShaderProgram(const ShaderBytecode& vertexShaderSource, const ShaderBytecode& fragmentShaderSource)
+{
+	PendingShaderProgram pending = BeginShaderProgram(vertexShaderSource, fragmentShaderSource);
+	return FinishShaderProgram(pending);
+}
+//-----------------------------------------------------------------------------
+PendingShaderProgram RenderSystem::BeginShaderProgram(const ShaderBytecode& vertexShaderSource, const ShaderBytecode& fragmentShaderSource)
+{
+	if (!vertexShaderSource.IsValid())
+	{
+		LogError("You must provide vertex shader (source is blank).");
+		return {};
+	}
+
+	if (!fragmentShaderSource.IsValid())
+	{
+		LogError("You must provide fragment shader (source is blank).");
+		return {};
+	}
+
+	PendingShaderProgram pending;
+	pending.vertexSource = vertexShaderSource.GetSource();
+	pending.fragmentSource = fragmentShaderSource.GetSource();
+	validationShaderCode(pending.vertexSource, pending.fragmentSource);
+
+	// a cached binary skips compiling and linking, if it is missing or rejected the program is built from source and stored
+	if (m_shaderCache.IsEnabled())
+	{
+		pending.cacheKey = m_shaderCache.MakeKey(pending.vertexSource, pending.fragmentSource);
+		pending.program.reset(new ShaderProgram());
+		if (m_shaderCache.Load(pending.cacheKey, *pending.program))
+		{
+			pending.cached = true;
+			return pending;
+		}
+	}
+
+	// compile and link are only issued here, the status is read in FinishShaderProgram() so that the driver can work in the background
+	pending.vertexShader = compileShader(ShaderPipelineStage::Vertex, pending.vertexSource);
+	pending.fragmentShader = compileShader(ShaderPipelineStage::Fragment, pending.fragmentSource);
+	pending.program.reset(new ShaderProgram());
+
+	glAttachShader(*pending.program, *pending.vertexShader);
+	glAttachShader(*pending.program, *pending.fragmentShader);
+#if !PLATFORM_EMSCRIPTEN
+	if (m_shaderCache.IsEnabled())
+		glProgramParameteri(*pending.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#endif
+	glLinkProgram(*pending.program);
+	return pending;
+}
+//-----------------------------------------------------------------------------
+bool RenderSystem::IsShaderProgramReady(const PendingShaderProgram& pending) const
+{
+	if (!pending.program || pending.cached || !OpenGLExtensions::parallelShaderCompile) return true;
+
+	GLint completed = GL_TRUE;
+	glGetProgramiv(*pending.program, GL_COMPLETION_STATUS_KHR, &completed);
+	return completed == GL_TRUE;
+}
+//-----------------------------------------------------------------------------
+ShaderProgramRef RenderSystem::FinishShaderProgram(PendingShaderProgram& pending)
+{
+	ShaderProgramRef resource = std::move(pending.program);
+	if (!resource) return nullptr;
+
+	if (pending.cached)
+	{
+		reflectShaderProgram(*resource);
+		return resource;
+	}
+
+	const bool shadersCompiled = checkShader(*pending.vertexShader, pending.vertexSource) && checkShader(*pending.fragmentShader, pending.fragmentSource);
+
+	GLint linkStatus = 0;
+	glGetProgramiv(*resource, GL_LINK_STATUS, &linkStatus);
+	if (linkStatus == GL_FALSE && shadersCompiled)
+	{
+		GLint infoLogLength;
+		glGetProgramiv(*resource, GL_INFO_LOG_LENGTH, &infoLogLength);
+		std::unique_ptr<GLchar> errorInfoText{ new GLchar[static_cast<size_t>(infoLogLength + 1)] };
+		glGetProgramInfoLog(*resource, infoLogLength, nullptr, errorInfoText.get());
+		LogError("OPENGL: Shader program linking failed: " + std::string(errorInfoText.get()));
+	}
+	glDetachShader(*resource, *pending.vertexShader);
+	glDetachShader(*resource, *pending.fragmentShader);
+	pending.vertexShader.reset();
+	pending.fragmentShader.reset();
+
+	if (linkStatus == GL_FALSE || !shadersCompiled)
+		return nullptr;
+
+	reflectShaderProgram(*resource);
+	m_shaderCache.Store(pending.cacheKey, *resource);
+	return resource;
+}
+//-----------------------------------------------------------------------------
+bool RenderSystem::IsReadyUniform(const Uniform& uniform) const
+{
+	return IsValid(uniform) && uniform.programId == m_cache.CurrentShaderProgram;
+}
+//-----------------------------------------------------------------------------
+const std::vector<ShaderAttributeInfo>& RenderSystem::GetAttributesInfo(ShaderProgramRef program) const
+{
+	static const std::vector<ShaderAttributeInfo> empty;
+	assert(IsValid(program));
+	return IsValid(program) ? program->attributes : empty;
+}
+//-----------------------------------------------------------------------------
+const std::vector<ShaderUniformInfo>& RenderSystem::GetUniformsInfo(ShaderProgramRef program) const
+{
+	static const std::vector<ShaderUniformInfo> empty;
+	assert(IsValid(program));
+	return IsValid(program) ? program->uniforms : empty;
+}
+//-----------------------------------------------------------------------------
+const std::vector<UniformBlockInfo>& RenderSystem::GetUniformBlocksInfo(ShaderProgramRef program) const
+{
+	static const std::vector<UniformBlockInfo> empty;
+	assert(IsValid(program));
+	return IsValid(program) ? program->uniformBlocks : empty;
+}
+//-----------------------------------------------------------------------------
 Uniform RenderSystem::GetUniform(ShaderProgramRef program, const char* uniformName) const
 {
 	if (!IsValid(program) || uniformName == nullptr) return {};
 
-	if (m_cache.CurrentShaderProgram != *program) glUseProgram(*program);
+	const ShaderUniformInfo* info = program->FindUniform(uniformName);
+	// array elements and struct members that are not in the table are still resolved by the driver
 	Uniform uniform = {
-		.location = glGetUniformLocation(*program, uniformName),
+		.location = info ? info->location : glGetUniformLocation(*program, uniformName),
 		.programId = *program
 	};
-	// restore prev shader program
-	if (m_cache.CurrentShaderProgram != *program) glUseProgram(m_cache.CurrentShaderProgram);
 	return uniform;
 }
 //-----------------------------------------------------------------------------
+UniformBlock RenderSystem::GetUniformBlock(ShaderProgramRef program, const char* blockName) const
+{
+	if (!IsValid(program) || blockName == nullptr) return {};
+
+	UniformBlock block;
+	block.programId = *program;
+	const UniformBlockInfo* info = program->FindUniformBlock(StringHash(blockName));
+	if (info && info->name == blockName)
+	{
+		block.index = info->index;
+		block.dataSize = info->dataSize;
+	}
+	return block;
+}
+//-----------------------------------------------------------------------------
+void RenderSystem::SetUniformBlockBinding(const UniformBlock& block, unsigned bindingPoint)
+{
+	assert(IsValid(block));
+	assert(bindingPoint < MaxBindingUniformBuffers);
+	// the binding is program state, no need to bind the program
+	glUniformBlockBinding(block.programId, block.index, bindingPoint);
+}
+//-----------------------------------------------------------------------------
+Uniform RenderSystem::getShaderParameter(ShaderProgramRef program, const char* uniformName, UniformType type) const
+{
+	if (!IsValid(program) || uniformName == nullptr) return {};
+
+	const ShaderUniformInfo* info = program->FindUniform(uniformName);
+	if (!info) return {};
+	if (!isUniformTypeCompatible(info->type, type))
+	{
+		LogError("Shader parameter " + std::string(uniformName) + " does not match the uniform type in the shader");
+		return {};
+	}
+	return { .location = info->location, .programId = *program };
+}
+//-----------------------------------------------------------------------------
+Uniform RenderSystem::getCurrentUniform(const std::string& uniformName) const
+{
+	assert(m_cache.CurrentShaderProgram > 0);
+	const ShaderProgram* program = m_cache.CurrentShaderProgramRef.get();
+	if (program && program->Id() == m_cache.CurrentShaderProgram)
+	{
+		const ShaderUniformInfo* info = program->FindUniform(uniformName.c_str());
+		if (info) return { .location = info->location, .programId = m_cache.CurrentShaderProgram };
+	}
+	return { .location = glGetUniformLocation(m_cache.CurrentShaderProgram, uniformName.c_str()), .programId = m_cache.CurrentShaderProgram };
+}
+//-----------------------------------------------------------------------------
+void RenderSystem::reflectShaderProgram(ShaderProgram& program)
+{
+	program.attributes = queryAttributesInfo(program);
+	program.uniforms = queryUniformsInfo(program);
+	program.uniformBlocks = queryUniformBlocksInfo(program);
+
+	program.uniformIndices.clear();
+	program.uniformsByLocation.clear();
+	unsigned valuesSize = 0;
+	for (unsigned i = 0; i < program.uniforms.size(); i++)
+	{
+		ShaderUniformInfo& uniform = program.uniforms[i];
+		if (!program.uniformIndices.emplace(StringHash(uniform.name).Value(), i).second)
+			LogWarning("Uniform " + uniform.name + " has the same hash as another uniform, it is looked up by the driver");
+
+		uniform.valueOffset = valuesSize;
+		valuesSize += uniform.valueSize;
+
+		// every element of an array maps to the array, so writes to single elements invalidate its cached value
+		for (int element = 0; element < uniform.arraySize; element++)
+		{
+			const int location = element == 0 ? uniform.location : glGetUniformLocation(program, (uniform.name + "[" + std::to_string(element) + "]").c_str());
+			if (location < 0) continue;
+			if (static_cast<size_t>(location) >= program.uniformsByLocation.size())
+				program.uniformsByLocation.resize(static_cast<size_t>(location) + 1, -1);
+			program.uniformsByLocation[location] = static_cast<int>(i);
+		}
+	}
+	program.uniformValues.assign(valuesSize, 0);
+	program.uniformValuesValid.assign(program.uniforms.size(), false);
+
+	program.uniformBlockIndices.clear();
+	for (unsigned i = 0; i < program.uniformBlocks.size(); i++)
+		program.uniformBlockIndices.emplace(StringHash(program.uniformBlocks[i].name).Value(), i);
+}
+//-----------------------------------------------------------------------------
+bool RenderSystem::uniformChanged(const Uniform& uniform, const void* data, size_t size)
+{
+	if (!updateUniformValue(uniform, data, size))
+	{
+		m_statistics.redundantCalls++;
+		return false;
+	}
+	m_statistics.uniformCalls++;
+	return true;
+}
+//-----------------------------------------------------------------------------
+bool RenderSystem::updateUniformValue(const Uniform& uniform, const void* data, size_t size)
+{
+	ShaderProgram* program = m_cache.CurrentShaderProgramRef.get();
+	if (!program || program->Id() != uniform.programId) return true;
+
+	const ShaderUniformInfo* info = program->FindUniformByLocation(uniform.location);
+	if (!info || !info->valueSize) return true;
+
+	const size_t index = static_cast<size_t>(info - program->uniforms.data());
+	// only whole values are cached, a partial array write leaves the cached value unknown
+	if (uniform.location != info->location || size != info->valueSize)
+	{
+		program->uniformValuesValid[index] = false;
+		return true;
+	}
+
+	unsigned char* value = program->uniformValues.data() + info->valueOffset;
+	if (program->uniformValuesValid[index] && memcmp(value, data, size) == 0)
+		return false;
+	memcpy(value, data, size);
+	program->uniformValuesValid[index] = true;
+	return true;
+}
+//-----------------------------------------------------------------------------
 void RenderSystem::SetUniform(const Uniform& uniform, bool value)
 {
-	assert(IsReadyUniform(uniform));
-	glUniform1i(uniform.location, value);
+	SetUniform(uniform, static_cast<int>(value));
 }
 //-----------------------------------------------------------------------------
 void RenderSystem::SetUniform(const Uniform& uniform, int value)
 {
 	assert(IsReadyUniform(uniform));
+	if (!uniformChanged(uniform, &value, sizeof(value))) return;
 	glUniform1i(uniform.location, value);
 }
 //-----------------------------------------------------------------------------
 void RenderSystem::SetUniform(const Uniform& uniform, unsigned value)
 {
 	assert(IsReadyUniform(uniform));
+	if (!uniformChanged(uniform, &value, sizeof(value))) return;
 	glUniform1ui(uniform.location, value);
 }
 //-----------------------------------------------------------------------------
 void RenderSystem::SetUniform(const Uniform& uniform, float value)
 {
 	assert(IsReadyUniform(uniform));
+	if (!uniformChanged(uniform, &value, sizeof(value))) return;
 	glUniform1f(uniform.location, value);
 }
 //-----------------------------------------------------------------------------
 void RenderSystem::SetUniform(const Uniform& uniform, const glm::vec2& value)
 {
 	assert(IsReadyUniform(uniform));
+	if (!uniformChanged(uniform, &value, sizeof(value))) return;
 	glUniform2fv(uniform.location, 1, glm::value_ptr(value));
 }
 //-----------------------------------------------------------------------------
 void RenderSystem::SetUniform(const Uniform& uniform, const glm::vec3& value)
 {
 	assert(IsReadyUniform(uniform));
+	if (!uniformChanged(uniform, &value, sizeof(value))) return;
 	glUniform3fv(uniform.location, 1, glm::value_ptr(value));
 }
 //-----------------------------------------------------------------------------
 void RenderSystem::SetUniform(const Uniform& uniform, const glm::vec4& value)
 {
 	assert(IsReadyUniform(uniform));
+	if (!uniformChanged(uniform, &value, sizeof(value))) return;
 	glUniform4fv(uniform.location, 1, glm::value_ptr(value));
 }
 //-----------------------------------------------------------------------------
 void RenderSystem::SetUniform(const Uniform& uniform, const glm::mat3& value)
 {
 	assert(IsReadyUniform(uniform));
+	if (!uniformChanged(uniform, &value, sizeof(value))) return;
 	glUniformMatrix3fv(uniform.location, 1, GL_FALSE, glm::value_ptr(value));
 }
 //-----------------------------------------------------------------------------
 void RenderSystem::SetUniform(const Uniform& uniform, const glm::mat4& value)
 {
 	assert(IsReadyUniform(uniform));
+	if (!uniformChanged(uniform, &value, sizeof(value))) return;
 	glUniformMatrix4fv(uniform.location, 1, GL_FALSE, glm::value_ptr(value));
 }
 //-----------------------------------------------------------------------------
 void RenderSystem::SetUniform3(const Uniform& uniform, unsigned number, float* values)
 {
 	assert(IsReadyUniform(uniform));
+	if (!uniformChanged(uniform, values, sizeof(float) * 3 * number)) return;
 	glUniform3fv(uniform.location, static_cast<GLsizei>(number), values);
 }
 //-----------------------------------------------------------------------------
 void RenderSystem::SetUniform4(const Uniform& uniform, unsigned number, float* values)
 {
 	assert(IsReadyUniform(uniform));
+	if (!uniformChanged(uniform, values, sizeof(float) * 4 * number)) return;
 	glUniform4fv(uniform.location, static_cast<GLsizei>(number), values);
 }
 //-----------------------------------------------------------------------------
@@ -221,6 +603,7 @@ void RenderSystem::SetUniform(const Uniform& uniform, std::span<float> values)
 {
 	assert(IsReadyUniform(uniform));
 	if (values.size() == 0) return;
+	if (!uniformChanged(uniform, values.data(), values.size_bytes())) return;
 	glUniform1fv(uniform.location, static_cast<GLsizei>(values.size()), (GLfloat*)values.data());
 }
 //-----------------------------------------------------------------------------
@@ -228,6 +611,7 @@ void RenderSystem::SetUniform(const Uniform& uniform, std::span<glm::vec2> value
 {
 	assert(IsReadyUniform(uniform));
 	if (values.size() == 0) return;
+	if (!uniformChanged(uniform, values.data(), values.size_bytes())) return;
 	glUniform2fv(uniform.location, static_cast<GLsizei>(values.size()), (GLfloat*)values.data());
 }
 //-----------------------------------------------------------------------------
@@ -235,6 +619,7 @@ void RenderSystem::SetUniform(const Uniform& uniform, std::span<glm::vec3> value
 {
 	assert(IsReadyUniform(uniform));
 	if (values.size() == 0) return;
+	if (!uniformChanged(uniform, values.data(), values.size_bytes())) return;
 	glUniform3fv(uniform.location, static_cast<GLsizei>(values.size()), (GLfloat*)values.data());
 }
 //-----------------------------------------------------------------------------
@@ -242,75 +627,105 @@ void RenderSystem::SetUniform(const Uniform& uniform, std::span<glm::vec4> value
 {
 	assert(IsReadyUniform(uniform));
 	if (values.size() == 0) return;
+	if (!uniformChanged(uniform, values.data(), values.size_bytes())) return;
 	glUniform4fv(uniform.location, static_cast<GLsizei>(values.size()), (GLfloat*)values.data());
 }
 //-----------------------------------------------------------------------------
+void RenderSystem::SetUniform(const Uniform& uniform, UniformType type, unsigned count, const void* data)
+{
+	assert(IsReadyUniform(uniform));
+	if (count == 0) return;
+	if (!uniformChanged(uniform, data, static_cast<size_t>(SizeUniformType(type)) * count)) return;
+	const GLsizei size = static_cast<GLsizei>(count);
+	switch (type)
+	{
+	case UniformType::Int:  glUniform1iv(uniform.location, size, (const GLint*)data); break;
+	case UniformType::UInt: glUniform1uiv(uniform.location, size, (const GLuint*)data); break;
+	case UniformType::Float: glUniform1fv(uniform.location, size, (const GLfloat*)data); break;
+	case UniformType::Vec2: glUniform2fv(uniform.location, size, (const GLfloat*)data); break;
+	case UniformType::Vec3: glUniform3fv(uniform.location, size, (const GLfloat*)data); break;
+	case UniformType::Vec4: glUniform4fv(uniform.location, size, (const GLfloat*)data); break;
+	case UniformType::Mat3: glUniformMatrix3fv(uniform.location, size, GL_FALSE, (const GLfloat*)data); break;
+	case UniformType::Mat4: glUniformMatrix4fv(uniform.location, size, GL_FALSE, (const GLfloat*)data); break;
+	}
+}
+//-----------------------------------------------------------------------------
 void RenderSystem::SetUniform(const std::string& uniformName, bool value)
 {
-	assert(m_cache.CurrentShaderProgram > 0);
-	glUniform1i(glGetUniformLocation(m_cache.CurrentShaderProgram, uniformName.c_str()), value);
+	const Uniform uniform = getCurrentUniform(uniformName);
+	if (IsValid(uniform)) SetUniform(uniform, value);
 }
 //-----------------------------------------------------------------------------
 void RenderSystem::SetUniform(const std::string& uniformName, int value)
 {
-	assert(m_cache.CurrentShaderProgram > 0);
-	glUniform1i(glGetUniformLocation(m_cache.CurrentShaderProgram, uniformName.c_str()), value);
+	const Uniform uniform = getCurrentUniform(uniformName);
+	if (IsValid(uniform)) SetUniform(uniform, value);
 }
 //-----------------------------------------------------------------------------
 void RenderSystem::SetUniform(const std::string& uniformName, unsigned value)
 {
-	assert(m_cache.CurrentShaderProgram > 0);
-	glUniform1ui(glGetUniformLocation(m_cache.CurrentShaderProgram, uniformName.c_str()), value);
+	const Uniform uniform = getCurrentUniform(uniformName);
+	if (IsValid(uniform)) SetUniform(uniform, value);
 }
 //-----------------------------------------------------------------------------
 void RenderSystem::SetUniform(const std::string& uniformName, float value)
 {
-	assert(m_cache.CurrentShaderProgram > 0);
-	glUniform1f(glGetUniformLocation(m_cache.CurrentShaderProgram, uniformName.c_str()), value);
+	const Uniform uniform = getCurrentUniform(uniformName);
+	if (IsValid(uniform)) SetUniform(uniform, value);
 }
 //-----------------------------------------------------------------------------
 void RenderSystem::SetUniform(const std::string& uniformName, const glm::vec2& value)
 {
-	assert(m_cache.CurrentShaderProgram > 0);
-	glUniform2fv(glGetUniformLocation(m_cache.CurrentShaderProgram, uniformName.c_str()), 1, glm::value_ptr(value));
+	const Uniform uniform = getCurrentUniform(uniformName);
+	if (IsValid(uniform)) SetUniform(uniform, value);
 }
 //-----------------------------------------------------------------------------
 void RenderSystem::SetUniform(const std::string& uniformName, const glm::vec3& value)
 {
-	assert(m_cache.CurrentShaderProgram > 0);
-	glUniform3fv(glGetUniformLocation(m_cache.CurrentShaderProgram, uniformName.c_str()), 1, glm::value_ptr(value));
+	const Uniform uniform = getCurrentUniform(uniformName);
+	if (IsValid(uniform)) SetUniform(uniform, value);
 }
 //-----------------------------------------------------------------------------
 void RenderSystem::SetUniform(const std::string& uniformName, const glm::vec4& value)
 {
-	assert(m_cache.CurrentShaderProgram > 0);
-	glUniform4fv(glGetUniformLocation(m_cache.CurrentShaderProgram, uniformName.c_str()), 1, glm::value_ptr(value));
+	const Uniform uniform = getCurrentUniform(uniformName);
+	if (IsValid(uniform)) SetUniform(uniform, value);
 }
 //-----------------------------------------------------------------------------
 void RenderSystem::SetUniform(const std::string& uniformName, const glm::mat3& value)
 {
-	assert(m_cache.CurrentShaderProgram > 0);
-	glUniformMatrix3fv(glGetUniformLocation(m_cache.CurrentShaderProgram, uniformName.c_str()), 1, GL_FALSE, glm::value_ptr(value));
+	const Uniform uniform = getCurrentUniform(uniformName);
+	if (IsValid(uniform)) SetUniform(uniform, value);
 }
 //-----------------------------------------------------------------------------
 void RenderSystem::SetUniform(const std::string& uniformName, const glm::mat4& value)
 {
-	assert(m_cache.CurrentShaderProgram > 0);
-	glUniformMatrix4fv(glGetUniformLocation(m_cache.CurrentShaderProgram, uniformName.c_str()), 1, GL_FALSE, glm::value_ptr(value));
+	const Uniform uniform = getCurrentUniform(uniformName);
+	if (IsValid(uniform)) SetUniform(uniform, value);
 }
 //-----------------------------------------------------------------------------
 void RenderSystem::Bind(ShaderProgramRef resource)
 {
 	assert(IsValid(resource));
-	if (m_cache.CurrentShaderProgram == *resource) return;
+	if (m_cache.CurrentShaderProgram == *resource)
+	{
+		m_statistics.redundantCalls++;
+		return;
+	}
+	m_cache.CurrentPipelineState.reset();
 	m_cache.CurrentShaderProgram = *resource;
+	m_cache.CurrentShaderProgramRef = resource;
+	m_statistics.programBinds++;
 	glUseProgram(*resource);
 }
 //-----------------------------------------------------------------------------
 void RenderSystem::Bind(unsigned rawShader)
 {
 	if (m_cache.CurrentShaderProgram == rawShader) return;
+	m_cache.CurrentPipelineState.reset();
 	m_cache.CurrentShaderProgram = rawShader;
+	m_cache.CurrentShaderProgramRef.reset();
+	m_statistics.programBinds++;
 	glUseProgram(rawShader);
 }
 //-----------------------------------------------------------------------------
@@ -336,21 +751,25 @@ ShaderRef RenderSystem::compileShader(ShaderPipelineStage type, const std::strin
 	ShaderRef shader(new Shader(type));
 	glShaderSource(*shader, 1, &shaderText, &lenShaderText);
 	glCompileShader(*shader);
-
+	return shader;
+}
+//-----------------------------------------------------------------------------
+bool RenderSystem::checkShader(const Shader& shader, const std::string& source) const
+{
 	GLint compileStatus = GL_FALSE;
-	glGetShaderiv(*shader, GL_COMPILE_STATUS, &compileStatus);
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &compileStatus);
 	if (compileStatus == GL_FALSE)
 	{
 		GLint infoLogLength;
-		glGetShaderiv(*shader, GL_INFO_LOG_LENGTH, &infoLogLength);
+		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLogLength);
 		std::unique_ptr<GLchar> errorInfoText{ new GLchar[static_cast<size_t>(infoLogLength + 1)] };
-		glGetShaderInfoLog(*shader, infoLogLength, nullptr, errorInfoText.get());
+		glGetShaderInfoLog(shader, infoLogLength, nullptr, errorInfoText.get());
 
-		const std::string shaderName = ConvertToStr(type);
+		const std::string shaderName = ConvertToStr(shader.shaderStage);
 		LogError(shaderName + " Shader compilation failed : " + std::string(errorInfoText.get()) + ", Source: " + source);
-		return nullptr;
+		return false;
 	}
 
-	return shader;
+	return true;
 }
 //-----------------------------------------------------------------------------
\ No newline at end of file
@@ -2,52 +2,225 @@
 #include "RenderSystem.h"
 #include "OpenGLTranslateToGL.h"
 //-----------------------------------------------------------------------------
+// 64-bit FNV-1a over the bytes of one field, so the padding of the state structures is never hashed
+template<typename T>
+static void hashField(uint64_t& hash, const T& value)
+{
+	static_assert(std::is_trivially_copyable_v<T>);
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&value);
+	for (size_t i = 0; i < sizeof(T); i++)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+}
+//-----------------------------------------------------------------------------
+static uint64_t hashState(const SamplerState& state)
+{
+	uint64_t hash = 0xcbf29ce484222325ull;
+	hashField(hash, state.minFilter);
+	hashField(hash, state.magFilter);
+	hashField(hash, state.wrapS);
+	hashField(hash, state.wrapT);
+	hashField(hash, state.wrapR);
+	hashField(hash, state.minLod);
+	hashField(hash, state.maxLod);
+	hashField(hash, state.compareFunction);
+	hashField(hash, state.compareEnable);
+	return hash;
+}
+//-----------------------------------------------------------------------------
+static uint64_t hashState(const PipelineStateCreateInfo& info)
+{
+	uint64_t hash = 0xcbf29ce484222325ull;
+	hashField(hash, info.program->Id());
+
+	const DepthState& depth = info.depthState;
+	hashField(hash, depth.compareFunction);
+	hashField(hash, depth.enable);
+	hashField(hash, depth.depthWrite);
+
+	const StencilState& stencil = info.stencilState;
+	hashField(hash, stencil.enable);
+	hashField(hash, stencil.readMask);
+	hashField(hash, stencil.writeMask);
+	hashField(hash, stencil.frontFaceStencilCompareFunction);
+	hashField(hash, stencil.frontFaceStencilPassOperation);
+	hashField(hash, stencil.frontFaceStencilFailureOperation);
+	hashField(hash, stencil.frontFaceStencilDepthFailureOperation);
+	hashField(hash, stencil.backFaceStencilCompareFunction);
+	hashField(hash, stencil.backFaceStencilPassOperation);
+	hashField(hash, stencil.backFaceStencilFailureOperation);
+	hashField(hash, stencil.backFaceStencilDepthFailureOperation);
+	hashField(hash, stencil.stencilRef);
+
+	const RasterizerState& rasterizer = info.rasterizerState;
+	hashField(hash, rasterizer.polygonMode);
+	hashField(hash, rasterizer.cullMode);
+	hashField(hash, rasterizer.depthBias.constantFactor);
+	hashField(hash, rasterizer.depthBias.slopeFactor);
+	hashField(hash, rasterizer.depthBias.clamp);
+	hashField(hash, rasterizer.face);
+	hashField(hash, rasterizer.discardEnabled);
+	hashField(hash, rasterizer.depthClampEnabled);
+	hashField(hash, rasterizer.scissorTestEnabled);
+	hashField(hash, rasterizer.multiSampleEnabled);
+	hashField(hash, rasterizer.antiAliasedLineEnabled);
+	hashField(hash, rasterizer.lineWidth);
+
+	const BlendState& blend = info.blendState;
+	hashField(hash, blend.colorBlendSource);
+	hashField(hash, blend.colorBlendDest);
+	hashField(hash, blend.colorOperation);
+	hashField(hash, blend.alphaBlendSource);
+	hashField(hash, blend.alphaBlendDest);
+	hashField(hash, blend.alphaOperation);
+	hashField(hash, blend.colorMask);
+	hashField(hash, blend.enable);
+	return hash;
+}
+//-----------------------------------------------------------------------------
+static GLenum polygonOffsetCap(RasterizerFillMode polygonMode)
+{
+	if (polygonMode == RasterizerFillMode::Wireframe) return GL_POLYGON_OFFSET_LINE;
+	if (polygonMode == RasterizerFillMode::Point) return GL_POLYGON_OFFSET_POINT;
+	return GL_POLYGON_OFFSET_FILL;
+}
+//-----------------------------------------------------------------------------
+SamplerRef RenderSystem::CreateSampler(const SamplerState& state)
+{
+	const uint64_t hash = hashState(state);
+	auto it = m_cacheSamplers.find(hash);
+	if (it != m_cacheSamplers.end() && it->second->state == state)
+		return it->second;
+
+	SamplerRef resource(new Sampler(state));
+	if (!IsValid(resource))
+	{
+		LogError("Sampler create failed!");
+		return {};
+	}
+
+	glSamplerParameteri(*resource, GL_TEXTURE_MIN_FILTER, TranslateToGL(state.minFilter));
+	glSamplerParameteri(*resource, GL_TEXTURE_MAG_FILTER, TranslateToGL(state.magFilter));
+	glSamplerParameteri(*resource, GL_TEXTURE_WRAP_S, TranslateToGL(state.wrapS));
+	glSamplerParameteri(*resource, GL_TEXTURE_WRAP_T, TranslateToGL(state.wrapT));
+	glSamplerParameteri(*resource, GL_TEXTURE_WRAP_R, TranslateToGL(state.wrapR));
+	glSamplerParameterf(*resource, GL_TEXTURE_MIN_LOD, state.minLod);
+	glSamplerParameterf(*resource, GL_TEXTURE_MAX_LOD, state.maxLod);
+	glSamplerParameteri(*resource, GL_TEXTURE_COMPARE_MODE, state.compareEnable ? GL_COMPARE_REF_TO_TEXTURE : GL_NONE);
+	glSamplerParameteri(*resource, GL_TEXTURE_COMPARE_FUNC, TranslateToGL(state.compareFunction));
+
+	// on a hash collision the first sampler stays in the cache and this one is not shared
+	if (it == m_cacheSamplers.end())
+		m_cacheSamplers[hash] = resource;
+	return resource;
+}
+//-----------------------------------------------------------------------------
+PipelineStateRef RenderSystem::CreatePipelineState(const PipelineStateCreateInfo& createInfo)
+{
+	if (!IsValid(createInfo.program))
+	{
+		LogError("PipelineState create failed, the shader program is not valid");
+		return {};
+	}
+
+	const uint64_t hash = hashState(createInfo);
+	auto it = m_cachePipelineStates.find(hash);
+	if (it != m_cachePipelineStates.end() && it->second->info == createInfo)
+		return it->second;
+
+	PipelineStateRef resource = std::make_shared<const PipelineState>(createInfo, hash, m_nextPipelineStateId++);
+	// on a hash collision the first pipeline state stays in the cache and this one is not shared
+	if (it == m_cachePipelineStates.end())
+		m_cachePipelineStates[hash] = resource;
+	return resource;
+}
+//-----------------------------------------------------------------------------
+void RenderSystem::RemoveUnusedStates()
+{
+	// entries referenced only by the cache are not used anywhere, dropping them releases the programs the pipeline states hold
+	for (auto it = m_cacheSamplers.begin(); it != m_cacheSamplers.end();)
+	{
+		if (it->second.use_count() != 1)
+		{
+			++it;
+			continue;
+		}
+		// a deleted sampler is unbound by GL and its id may be reused, forget it in the state cache
+		for (unsigned i = 0; i < MaxBindingTextures; i++)
+		{
+			if (m_cache.CurrentSampler[i] == it->second->Id())
+				m_cache.CurrentSampler[i] = 0;
+		}
+		it = m_cacheSamplers.erase(it);
+	}
+	std::erase_if(m_cachePipelineStates, [](const auto& entry) { return entry.second.use_count() == 1; });
+}
+//-----------------------------------------------------------------------------
 void RenderSystem::Bind(RasterizerState state)
 {
+	if (m_cache.CurrentRasterizerState == state)
+	{
+		m_statistics.redundantCalls++;
+		return;
+	}
+	m_cache.CurrentPipelineState.reset();
+
+	// polygon offset is enabled per fill mode, so a fill mode change moves it as well
+	const RasterizerFillMode previousPolygonMode = m_cache.CurrentRasterizerState.polygonMode;
 	if (m_cache.CurrentRasterizerState.polygonMode != state.polygonMode)
 	{
 		m_cache.CurrentRasterizerState.polygonMode = state.polygonMode;
 		glPolygonMode(GL_FRONT_AND_BACK, TranslateToGL(state.polygonMode));
+		m_statistics.stateCalls++;
 	}
 	if (m_cache.CurrentRasterizerState.depthClampEnabled != state.depthClampEnabled)
 	{
 		m_cache.CurrentRasterizerState.depthClampEnabled = state.depthClampEnabled;
 		if (state.depthClampEnabled) glEnable(GL_DEPTH_CLAMP);
 		else glDisable(GL_DEPTH_CLAMP);
+		m_statistics.stateCalls++;
 	}
 	if (m_cache.CurrentRasterizerState.multiSampleEnabled != state.multiSampleEnabled)
 	{
 		m_cache.CurrentRasterizerState.multiSampleEnabled = state.multiSampleEnabled;
 		if (state.multiSampleEnabled) glEnable(GL_MULTISAMPLE);
 		else glDisable(GL_MULTISAMPLE);
+		m_statistics.stateCalls++;
 	}
 	if (m_cache.CurrentRasterizerState.antiAliasedLineEnabled != state.antiAliasedLineEnabled)
 	{
 		m_cache.CurrentRasterizerState.antiAliasedLineEnabled = state.antiAliasedLineEnabled;
 		if (state.antiAliasedLineEnabled) glEnable(GL_LINE_SMOOTH);
 		else glDisable(GL_LINE_SMOOTH);
+		m_statistics.stateCalls++;
 	}
 	if (m_cache.CurrentRasterizerState.face != state.face)
 	{
 		m_cache.CurrentRasterizerState.face = state.face;
 		glFrontFace(TranslateToGL(state.face));
+		m_statistics.stateCalls++;
 	}
 	if (m_cache.CurrentRasterizerState.lineWidth != state.lineWidth)
 	{
 		m_cache.CurrentRasterizerState.lineWidth = state.lineWidth;
 		glLineWidth(state.lineWidth);
+		m_statistics.stateCalls++;
 	}
 	if (m_cache.CurrentRasterizerState.discardEnabled != state.discardEnabled)
 	{
 		m_cache.CurrentRasterizerState.discardEnabled = state.discardEnabled;
 		if (state.discardEnabled) glEnable(GL_RASTERIZER_DISCARD);
 		else glDisable(GL_RASTERIZER_DISCARD);
+		m_statistics.stateCalls++;
 	}
 	if (m_cache.CurrentRasterizerState.scissorTestEnabled != state.scissorTestEnabled)
 	{
 		m_cache.CurrentRasterizerState.scissorTestEnabled = state.scissorTestEnabled;
 		if (state.scissorTestEnabled) glEnable(GL_SCISSOR_TEST);
 		else glDisable(GL_SCISSOR_TEST);
+		m_statistics.stateCalls++;
 	}
 	if (m_cache.CurrentRasterizerState.cullMode != state.cullMode)
 	{
@@ -59,31 +232,120 @@ void RenderSystem::Bind(RasterizerState state)
 		}
 		else
 			glDisable(GL_CULL_FACE);
+		m_statistics.stateCalls++;
 	}
-	if (m_cache.CurrentRasterizerState.depthBias.constantFactor != state.depthBias.constantFactor ||
-		m_cache.CurrentRasterizerState.depthBias.slopeFactor != state.depthBias.slopeFactor || 
-		m_cache.CurrentRasterizerState.depthBias.clamp != state.depthBias.clamp)
+
+	const bool depthBiasChanged = !(m_cache.CurrentRasterizerState.depthBias == state.depthBias);
+	if (depthBiasChanged || previousPolygonMode != state.polygonMode)
 	{
-		m_cache.CurrentRasterizerState.depthBias = state.depthBias;
-		
+		const bool wasPolygonOffsetEnabled = IsPolygonOffsetEnabled(m_cache.CurrentRasterizerState.depthBias);
 		const bool polygonOffsetEnabled = IsPolygonOffsetEnabled(state.depthBias);
-		if (polygonOffsetEnabled)
+		m_cache.CurrentRasterizerState.depthBias = state.depthBias;
+
+		if (wasPolygonOffsetEnabled && (!polygonOffsetEnabled || previousPolygonMode != state.polygonMode))
 		{
-			if (state.polygonMode == RasterizerFillMode::Solid) glEnable(GL_POLYGON_OFFSET_FILL);
-			else if (state.polygonMode == RasterizerFillMode::Wireframe) glEnable(GL_POLYGON_OFFSET_LINE);
-			else if (state.polygonMode == RasterizerFillMode::Point) glEnable(GL_POLYGON_OFFSET_POINT);
-
-			if (OpenGLExtensions::version >= OPENGL46)
-				glPolygonOffsetClamp(state.depthBias.slopeFactor, state.depthBias.constantFactor, state.depthBias.clamp);
-			else
-				glPolygonOffset(state.depthBias.slopeFactor, state.depthBias.constantFactor);
+			glDisable(polygonOffsetCap(previousPolygonMode));
+			m_statistics.stateCalls++;
 		}
-		else
+		if (polygonOffsetEnabled)
 		{
-			if (state.polygonMode == RasterizerFillMode::Solid) glDisable(GL_POLYGON_OFFSET_FILL);
-			else if (state.polygonMode == RasterizerFillMode::Wireframe) glDisable(GL_POLYGON_OFFSET_LINE);
-			else if (state.polygonMode == RasterizerFillMode::Point) glDisable(GL_POLYGON_OFFSET_POINT);
+			if (!wasPolygonOffsetEnabled || previousPolygonMode != state.polygonMode)
+			{
+				glEnable(polygonOffsetCap(state.polygonMode));
+				m_statistics.stateCalls++;
+			}
+			if (depthBiasChanged)
+			{
+				if (OpenGLExtensions::version >= OPENGL46)
+					glPolygonOffsetClamp(state.depthBias.slopeFactor, state.depthBias.constantFactor, state.depthBias.clamp);
+				else
+					glPolygonOffset(state.depthBias.slopeFactor, state.depthBias.constantFactor);
+				m_statistics.stateCalls++;
+			}
 		}
 	}
 }
+//-----------------------------------------------------------------------------
+void RenderSystem::Bind(BlendState state)
+{
+	BlendState& cache = m_cache.CurrentBlendState;
+	if (cache == state)
+	{
+		m_statistics.redundantCalls++;
+		return;
+	}
+	m_cache.CurrentPipelineState.reset();
+
+	if (cache.enable != state.enable)
+	{
+		if (state.enable) glEnable(GL_BLEND);
+		else glDisable(GL_BLEND);
+		m_statistics.stateCalls++;
+	}
+
+	// factors and operations are set even while blending is disabled, so the cache always matches the driver
+	if (cache.colorBlendSource != state.colorBlendSource
+		|| cache.colorBlendDest != state.colorBlendDest
+		|| cache.alphaBlendSource != state.alphaBlendSource
+		|| cache.alphaBlendDest != state.alphaBlendDest)
+	{
+		glBlendFuncSeparate(TranslateToGL(state.colorBlendSource), TranslateToGL(state.colorBlendDest), TranslateToGL(state.alphaBlendSource), TranslateToGL(state.alphaBlendDest));
+		m_statistics.stateCalls++;
+	}
+
+	if (cache.colorOperation != state.colorOperation || cache.alphaOperation != state.alphaOperation)
+	{
+		glBlendEquationSeparate(TranslateToGL(state.colorOperation), TranslateToGL(state.alphaOperation));
+		m_statistics.stateCalls++;
+	}
+
+	if (cache.colorMask != state.colorMask)
+	{
+		const uint8_t mask = static_cast<uint8_t>(state.colorMask);
+		glColorMask(
+			static_cast<GLboolean>((mask & static_cast<uint8_t>(ColorMask::Red)) ? GL_TRUE : GL_FALSE),
+			static_cast<GLboolean>((mask & static_cast<uint8_t>(ColorMask::Green)) ? GL_TRUE : GL_FALSE),
+			static_cast<GLboolean>((mask & static_cast<uint8_t>(ColorMask::Blue)) ? GL_TRUE : GL_FALSE),
+			static_cast<GLboolean>((mask & static_cast<uint8_t>(ColorMask::Alpha)) ? GL_TRUE : GL_FALSE));
+		m_statistics.stateCalls++;
+	}
+
+	cache = state;
+}
+//-----------------------------------------------------------------------------
+void RenderSystem::Bind(PipelineStateRef state)
+{
+	assert(IsValid(state));
+	if (m_cache.CurrentPipelineState == state)
+	{
+		m_statistics.redundantCalls++;
+		return;
+	}
+
+	// the single state binds diff field by field, here only the states that differ as a whole are passed on
+	const PipelineStateCreateInfo& info = state->info;
+	if (m_cache.CurrentShaderProgram != *info.program) Bind(info.program);
+	if (!(m_cache.CurrentDepthState == info.depthState)) Bind(info.depthState);
+	if (!(m_cache.CurrentStencilState == info.stencilState)) Bind(info.stencilState);
+	if (!(m_cache.CurrentRasterizerState == info.rasterizerState)) Bind(info.rasterizerState);
+	if (!(m_cache.CurrentBlendState == info.blendState)) Bind(info.blendState);
+
+	m_cache.CurrentPipelineState = state;
+	m_statistics.pipelineChanges++;
+}
+//-----------------------------------------------------------------------------
+void RenderSystem::Bind(SamplerRef resource, unsigned slot)
+{
+	assert(slot < MaxBindingTextures);
+	assert(!resource || IsValid(resource));
+	const unsigned id = resource ? resource->Id() : 0u;
+	if (m_cache.CurrentSampler[slot] == id)
+	{
+		m_statistics.redundantCalls++;
+		return;
+	}
+	m_cache.CurrentSampler[slot] = id;
+	m_statistics.samplerBinds++;
+	glBindSampler(slot, id);
+}
 //-----------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,566 @@
+#include "stdafx.h"
+#include "RenderTrace.h"
+#if PLATFORM_DESKTOP
+#include <bit>
+#include <regex>
+//-----------------------------------------------------------------------------
+RenderTrace gRenderTrace;
+//-----------------------------------------------------------------------------
+// traced functions and the kind of command they record
+#define RENDER_TRACE_FUNCTIONS(X) \
+	X(Enable, State) X(Disable, State) X(DepthFunc, State) X(DepthMask, State) \
+	X(StencilFuncSeparate, State) X(StencilOpSeparate, State) X(StencilMask, State) \
+	X(BlendFunc, State) X(BlendFuncSeparate, State) X(BlendEquation, State) X(BlendEquationSeparate, State) X(ColorMask, State) \
+	X(CullFace, State) X(FrontFace, State) X(PolygonMode, State) X(PolygonOffset, State) X(PolygonOffsetClamp, State) X(LineWidth, State) \
+	X(Viewport, State) X(Scissor, State) X(ClearColor, State) X(ActiveTexture, State) X(DrawBuffer, State) \
+	X(UseProgram, BindProgram) \
+	X(BindVertexArray, BindVertexArray) \
+	X(BindBuffer, BindBuffer) X(BindBufferBase, BindBuffer) X(BindBufferRange, BindBuffer) \
+	X(BindTexture, BindTexture) \
+	X(BindSampler, BindSampler) \
+	X(BindFramebuffer, BindFramebuffer) \
+	X(EnableVertexAttribArray, VertexFormat) X(VertexAttribPointer, VertexFormat) X(VertexAttribIPointer, VertexFormat) X(VertexAttribDivisor, VertexFormat) \
+	X(Uniform1i, Uniform) X(Uniform1ui, Uniform) X(Uniform1f, Uniform) \
+	X(Uniform1iv, Uniform) X(Uniform1uiv, Uniform) X(Uniform1fv, Uniform) X(Uniform2fv, Uniform) X(Uniform3fv, Uniform) X(Uniform4fv, Uniform) \
+	X(UniformMatrix3fv, Uniform) X(UniformMatrix4fv, Uniform) \
+	X(BufferData, Upload) X(BufferSubData, Upload) X(NamedBufferData, Upload) X(NamedBufferSubData, Upload) X(TexImage2D, Upload) \
+	X(DrawArrays, Draw) X(DrawElements, Draw) X(DrawArraysInstanced, Draw) X(DrawElementsInstanced, Draw) \
+	X(DrawElementsBaseVertex, Draw) X(DrawElementsInstancedBaseVertex, Draw) \
+	X(DrawArraysInstancedBaseInstance, Draw) X(DrawElementsInstancedBaseVertexBaseInstance, Draw) \
+	X(MultiDrawArraysIndirect, Draw) X(MultiDrawElementsIndirect, Draw) \
+	X(Clear, Clear)
+
+// functions the engine calls, answered by the null driver without a context
+#define RENDER_TRACE_NULL_FUNCTIONS(X) \
+	X(ActiveTexture) X(AttachShader) X(BindBuffer) X(BindBufferBase) X(BindBufferRange) X(BindFramebuffer) X(BindRenderbuffer) \
+	X(BindSampler) X(BindTexture) X(BindVertexArray) X(BlendEquation) X(BlendEquationSeparate) X(BlendFunc) X(BlendFuncSeparate) \
+	X(BufferData) X(BufferStorage) X(BufferSubData) X(CheckFramebufferStatus) X(Clear) X(ClearColor) X(ClientWaitSync) X(ColorMask) \
+	X(CompileShader) X(CreateBuffers) X(CreateProgram) X(CreateShader) X(CullFace) X(DebugMessageCallback) X(DeleteBuffers) \
+	X(DeleteFramebuffers) X(DeleteProgram) X(DeleteQueries) X(DeleteRenderbuffers) X(DeleteSamplers) X(DeleteShader) X(DeleteSync) \
+	X(DeleteTextures) X(DeleteTransformFeedbacks) X(DeleteVertexArrays) X(DepthFunc) X(DepthMask) X(DetachShader) X(Disable) \
+	X(DrawArrays) X(DrawArraysInstanced) X(DrawArraysInstancedBaseInstance) X(DrawBuffer) X(DrawBuffers) X(DrawElements) \
+	X(DrawElementsBaseVertex) X(DrawElementsInstanced) X(DrawElementsInstancedBaseVertex) X(DrawElementsInstancedBaseVertexBaseInstance) \
+	X(Enable) X(EnableVertexAttribArray) X(FenceSync) X(FramebufferRenderbuffer) X(FramebufferTexture2D) X(FrontFace) \
+	X(GenBuffers) X(GenFramebuffers) X(GenQueries) X(GenRenderbuffers) X(GenSamplers) X(GenTextures) X(GenTransformFeedbacks) \
+	X(GenVertexArrays) X(GenerateMipmap) X(GetActiveAttrib) X(GetActiveUniform) X(GetActiveUniformBlockName) X(GetActiveUniformBlockiv) \
+	X(GetActiveUniformName) X(GetActiveUniformsiv) X(GetAttribLocation) X(GetInteger64v) X(GetIntegerv) X(GetProgramBinary) \
+	X(GetProgramInfoLog) X(GetProgramiv) X(GetQueryObjectiv) X(GetQueryObjectui64v) X(GetShaderInfoLog) X(GetShaderiv) X(GetString) \
+	X(GetStringi) X(GetUniformLocation) X(LineWidth) X(LinkProgram) X(MapBuffer) X(MapBufferRange) X(MapNamedBuffer) \
+	X(MapNamedBufferRange) X(MultiDrawArraysIndirect) X(MultiDrawElementsIndirect) X(NamedBufferData) X(NamedBufferSubData) \
+	X(PolygonMode) X(PolygonOffset) X(PolygonOffsetClamp) X(ProgramBinary) X(ProgramParameteri) X(QueryCounter) \
+	X(RenderbufferStorage) X(RenderbufferStorageMultisample) X(SamplerParameterf) X(SamplerParameteri) X(Scissor) X(ShaderSource) \
+	X(StencilFuncSeparate) X(StencilMask) X(StencilOpSeparate) X(TexImage2D) X(TexParameteri) X(TexParameteriv) X(Uniform1f) \
+	X(Uniform1fv) X(Uniform1i) X(Uniform1iv) X(Uniform1ui) X(Uniform1uiv) X(Uniform2fv) X(Uniform3fv) X(Uniform4fv) \
+	X(UniformBlockBinding) X(UniformMatrix3fv) X(UniformMatrix4fv) X(UnmapBuffer) X(UnmapNamedBuffer) X(UseProgram) \
+	X(VertexAttribDivisor) X(VertexAttribIPointer) X(VertexAttribPointer) X(Viewport)
+//-----------------------------------------------------------------------------
+namespace
+{
+	enum class TraceFunction
+	{
+#define RENDER_TRACE_ENUM(name, type) name,
+		RENDER_TRACE_FUNCTIONS(RENDER_TRACE_ENUM)
+#undef RENDER_TRACE_ENUM
+	};
+
+	template<typename T>
+	uint64_t packArg(T value)
+	{
+		if constexpr (std::is_pointer_v<T>) return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(value));
+		else if constexpr (std::is_same_v<T, GLfloat>) return std::bit_cast<uint32_t>(value);
+		else return static_cast<uint64_t>(value);
+	}
+
+	// the payload replaces the data pointer of the call
+	template<typename T>
+	T unpackArg(uint64_t value, const uint8_t* payload)
+	{
+		if constexpr (std::is_pointer_v<T>) return payload ? reinterpret_cast<T>(payload) : reinterpret_cast<T>(static_cast<uintptr_t>(value));
+		else if constexpr (std::is_same_v<T, GLfloat>) return std::bit_cast<GLfloat>(static_cast<uint32_t>(value));
+		else return static_cast<T>(value);
+	}
+
+	size_t texImageSize(uint64_t width, uint64_t height, uint64_t format, uint64_t type)
+	{
+		size_t components = 4;
+		switch (format)
+		{
+		case GL_RED: case GL_DEPTH_COMPONENT: case GL_DEPTH_STENCIL: components = 1; break;
+		case GL_RG: components = 2; break;
+		case GL_RGB: components = 3; break;
+		default: break;
+		}
+		size_t componentSize = 1;
+		switch (type)
+		{
+		case GL_UNSIGNED_SHORT: case GL_HALF_FLOAT: componentSize = 2; break;
+		case GL_UNSIGNED_INT: case GL_UNSIGNED_INT_24_8: case GL_FLOAT: componentSize = 4; break;
+		default: break;
+		}
+		// rows are aligned to the default GL_UNPACK_ALIGNMENT of 4
+		const size_t rowSize = (width * components * componentSize + 3) / 4 * 4;
+		return rowSize * height;
+	}
+
+	// bytes read from the data pointer of the call
+	size_t payloadSize(TraceFunction function, const uint64_t* args)
+	{
+		switch (function)
+		{
+		case TraceFunction::BufferData:         return args[2] ? args[1] : 0; // target, size, data, usage
+		case TraceFunction::NamedBufferData:    return args[2] ? args[1] : 0;
+		case TraceFunction::BufferSubData:      return args[3] ? args[2] : 0; // target, offset, size, data
+		case TraceFunction::NamedBufferSubData: return args[3] ? args[2] : 0;
+		case TraceFunction::TexImage2D:         return args[8] ? texImageSize(args[3], args[4], args[6], args[7]) : 0;
+		case TraceFunction::Uniform1iv:
+		case TraceFunction::Uniform1uiv:
+		case TraceFunction::Uniform1fv:         return args[1] * 4; // location, count, value
+		case TraceFunction::Uniform2fv:         return args[1] * 8;
+		case TraceFunction::Uniform3fv:         return args[1] * 12;
+		case TraceFunction::Uniform4fv:         return args[1] * 16;
+		case TraceFunction::UniformMatrix3fv:   return args[1] * 36; // location, count, transpose, value
+		case TraceFunction::UniformMatrix4fv:   return args[1] * 64;
+		default: return 0;
+		}
+	}
+
+	// replaces one loader entry point: records the call, then forwards it to the driver or to the null driver
+	template<TraceFunction Function, RenderCommandType Type, typename Fn>
+	struct TraceEntry;
+
+	template<TraceFunction Function, RenderCommandType Type, typename R, typename... A>
+	struct TraceEntry<Function, Type, R(GLAD_API_PTR*)(A...)>
+	{
+		static inline R(GLAD_API_PTR* driver)(A...) = nullptr;
+		static inline const char* functionName = nullptr;
+
+		static R GLAD_API_PTR Call(A... args)
+		{
+			const uint64_t packed[] = { packArg(args)..., 0 };
+			constexpr bool isPointer[] = { std::is_pointer_v<A>..., false };
+			// the data pointer is the last pointer argument
+			const void* data = nullptr;
+			for (size_t i = 0; i < sizeof...(A); i++)
+			{
+				if (isPointer[i]) data = reinterpret_cast<const void*>(static_cast<uintptr_t>(packed[i]));
+			}
+			const size_t size = payloadSize(Function, packed);
+			gRenderTrace.Record(Type, functionName, std::span<const uint64_t>(packed, sizeof...(A)), size ? data : nullptr, size, &Replay);
+			return driver(args...);
+		}
+
+		static void Replay(const RenderCommand& command, const uint8_t* payload)
+		{
+			replay(command, payload, std::index_sequence_for<A...>{});
+		}
+
+		template<size_t... I>
+		static void replay(const RenderCommand& command, const uint8_t* payload, std::index_sequence<I...>)
+		{
+			driver(unpackArg<A>(command.args[I], payload)...);
+		}
+	};
+
+	//-------------------------------------------------------------------------
+	// Null driver
+	//-------------------------------------------------------------------------
+	// uniform of the default block declared in the shader source, reflected like a driver would
+	struct NullUniform
+	{
+		std::string name;
+		GLenum type;
+		GLint size;
+	};
+
+	GLenum nullUniformType(const std::string& typeName)
+	{
+		static const std::unordered_map<std::string, GLenum> types =
+		{
+			{ "bool", GL_BOOL }, { "int", GL_INT }, { "uint", GL_UNSIGNED_INT }, { "float", GL_FLOAT },
+			{ "vec2", GL_FLOAT_VEC2 }, { "vec3", GL_FLOAT_VEC3 }, { "vec4", GL_FLOAT_VEC4 }, { "mat3", GL_FLOAT_MAT3 }, { "mat4", GL_FLOAT_MAT4 },
+			{ "sampler2D", GL_SAMPLER_2D }, { "sampler3D", GL_SAMPLER_3D }, { "samplerCube", GL_SAMPLER_CUBE }, { "sampler2DShadow", GL_SAMPLER_2D_SHADOW },
+			{ "sampler2DArray", GL_SAMPLER_2D_ARRAY }, { "isampler2D", GL_INT_SAMPLER_2D }, { "usampler2D", GL_UNSIGNED_INT_SAMPLER_2D },
+		};
+		const auto it = types.find(typeName);
+		return it != types.end() ? it->second : GL_NONE;
+	}
+
+	struct NullDriver
+	{
+		GLuint nextName = 0;
+		std::unordered_map<GLenum, GLuint> boundBuffers;
+		// buffer storage, so that mapped buffers can be written
+		std::unordered_map<GLuint, std::vector<uint8_t>> buffers;
+		// uniform locations of each program by name, numbered in the order of the first query
+		std::unordered_map<GLuint, std::unordered_map<std::string, GLint>> uniformLocations;
+		// shader sources and attached shaders, parsed on link for the default block uniforms
+		std::unordered_map<GLuint, std::string> shaderSources;
+		std::unordered_map<GLuint, std::vector<GLuint>> programShaders;
+		std::unordered_map<GLuint, std::vector<NullUniform>> programUniforms;
+	} nullDriver;
+
+	template<typename R, typename... A>
+	R GLAD_API_PTR nullFunction(A...)
+	{
+		if constexpr (!std::is_void_v<R>) return R{};
+	}
+
+	template<typename R, typename... A>
+	void setNull(R(GLAD_API_PTR*& entry)(A...))
+	{
+		entry = &nullFunction<R, A...>;
+	}
+
+	void GLAD_API_PTR nullGenNames(GLsizei n, GLuint* names)
+	{
+		for (GLsizei i = 0; i < n; i++)
+			names[i] = ++nullDriver.nextName;
+	}
+
+	GLuint GLAD_API_PTR nullCreateProgram()
+	{
+		return ++nullDriver.nextName;
+	}
+
+	GLuint GLAD_API_PTR nullCreateShader(GLenum)
+	{
+		return ++nullDriver.nextName;
+	}
+
+	void GLAD_API_PTR nullGetShaderiv(GLuint, GLenum pname, GLint* params)
+	{
+		*params = pname == GL_COMPILE_STATUS ? GL_TRUE : 0;
+	}
+
+	void GLAD_API_PTR nullShaderSource(GLuint shader, GLsizei count, const GLchar* const* strings, const GLint* lengths)
+	{
+		std::string& source = nullDriver.shaderSources[shader];
+		source.clear();
+		for (GLsizei i = 0; i < count; i++)
+			source.append(strings[i], lengths && lengths[i] >= 0 ? static_cast<size_t>(lengths[i]) : strlen(strings[i]));
+	}
+
+	void GLAD_API_PTR nullAttachShader(GLuint program, GLuint shader)
+	{
+		nullDriver.programShaders[program].push_back(shader);
+	}
+
+	// declarations like "uniform mat4 World;" or "uniform vec4 Lights[4];", blocks are not matched because a brace follows their name
+	void GLAD_API_PTR nullLinkProgram(GLuint program)
+	{
+		static const std::regex declaration(R"(\buniform\s+(?:(?:lowp|mediump|highp)\s+)?(\w+)\s+(\w+)\s*(?:\[\s*(\d+)\s*\])?\s*;)");
+		std::vector<NullUniform>& uniforms = nullDriver.programUniforms[program];
+		uniforms.clear();
+		for (GLuint shader : nullDriver.programShaders[program])
+		{
+			const std::string& source = nullDriver.shaderSources[shader];
+			for (auto it = std::sregex_iterator(source.begin(), source.end(), declaration); it != std::sregex_iterator(); ++it)
+			{
+				const GLenum type = nullUniformType((*it)[1].str());
+				const std::string name = (*it)[2].str();
+				const bool declared = std::any_of(uniforms.begin(), uniforms.end(), [&](const NullUniform& uniform) { return uniform.name == name; });
+				if (type == GL_NONE || declared) continue;
+				uniforms.push_back({ name, type, (*it)[3].matched ? std::stoi((*it)[3].str()) : 1 });
+			}
+		}
+	}
+
+	void GLAD_API_PTR nullGetProgramiv(GLuint program, GLenum pname, GLint* params)
+	{
+		const std::vector<NullUniform>& uniforms = nullDriver.programUniforms[program];
+		switch (pname)
+		{
+		case GL_LINK_STATUS:
+			*params = GL_TRUE;
+			break;
+		case GL_ACTIVE_UNIFORMS:
+			*params = static_cast<GLint>(uniforms.size());
+			break;
+		case GL_ACTIVE_UNIFORM_MAX_LENGTH:
+			*params = 0;
+			for (const NullUniform& uniform : uniforms)
+				*params = std::max(*params, static_cast<GLint>(uniform.name.size() + 4)); // "[0]" and the terminator
+			break;
+		default:
+			*params = 0;
+			break;
+		}
+	}
+
+	// arrays are named with "[0]" like real drivers report them
+	void GLAD_API_PTR nullGetActiveUniform(GLuint program, GLuint index, GLsizei bufSize, GLsizei* length, GLint* size, GLenum* type, GLchar* name)
+	{
+		const std::vector<NullUniform>& uniforms = nullDriver.programUniforms[program];
+		if (index >= uniforms.size() || bufSize <= 0)
+		{
+			if (length) *length = 0;
+			return;
+		}
+		const NullUniform& uniform = uniforms[index];
+		const std::string reportedName = uniform.size > 1 ? uniform.name + "[0]" : uniform.name;
+		const size_t copied = std::min(reportedName.size(), static_cast<size_t>(bufSize - 1));
+		memcpy(name, reportedName.data(), copied);
+		name[copied] = 0;
+		if (length) *length = static_cast<GLsizei>(copied);
+		*size = uniform.size;
+		*type = uniform.type;
+	}
+
+	// the reflected uniforms are all in the default block
+	void GLAD_API_PTR nullGetActiveUniformsiv(GLuint, GLsizei count, const GLuint*, GLenum pname, GLint* params)
+	{
+		for (GLsizei i = 0; i < count; i++)
+			params[i] = pname == GL_UNIFORM_BLOCK_INDEX ? -1 : 0;
+	}
+
+	void GLAD_API_PTR nullGetIntegerv(GLenum pname, GLint* data)
+	{
+		switch (pname)
+		{
+		case GL_MAX_TEXTURE_SIZE:                 *data = 16384; break;
+		case GL_MAX_TEXTURE_IMAGE_UNITS:          *data = 16; break;
+		case GL_MAX_UNIFORM_BLOCK_SIZE:           *data = 65536; break;
+		case GL_MAX_UNIFORM_BUFFER_BINDINGS:      *data = 36; break;
+		case GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT:  *data = 256; break;
+		default:                                  *data = 0; break;
+		}
+	}
+
+	const GLubyte* GLAD_API_PTR nullGetString(GLenum)
+	{
+		return reinterpret_cast<const GLubyte*>("Null");
+	}
+
+	const GLubyte* GLAD_API_PTR nullGetStringi(GLenum, GLuint)
+	{
+		return reinterpret_cast<const GLubyte*>("");
+	}
+
+	// every queried uniform exists, so that the SetUniform calls reach the trace
+	GLint GLAD_API_PTR nullGetUniformLocation(GLuint program, const GLchar* name)
+	{
+		std::unordered_map<std::string, GLint>& locations = nullDriver.uniformLocations[program];
+		return locations.try_emplace(name, static_cast<GLint>(locations.size())).first->second;
+	}
+
+	GLint GLAD_API_PTR nullGetAttribLocation(GLuint, const GLchar*)
+	{
+		return -1;
+	}
+
+	GLenum GLAD_API_PTR nullCheckFramebufferStatus(GLenum)
+	{
+		return GL_FRAMEBUFFER_COMPLETE;
+	}
+
+	GLsync GLAD_API_PTR nullFenceSync(GLenum, GLbitfield)
+	{
+		return reinterpret_cast<GLsync>(static_cast<uintptr_t>(++nullDriver.nextName));
+	}
+
+	GLenum GLAD_API_PTR nullClientWaitSync(GLsync, GLbitfield, GLuint64)
+	{
+		return GL_ALREADY_SIGNALED;
+	}
+
+	void GLAD_API_PTR nullBindBuffer(GLenum target, GLuint buffer)
+	{
+		nullDriver.boundBuffers[target] = buffer;
+	}
+
+	void GLAD_API_PTR nullBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum)
+	{
+		std::vector<uint8_t>& storage = nullDriver.buffers[nullDriver.boundBuffers[target]];
+		storage.assign(static_cast<size_t>(size), 0);
+		if (data && size) memcpy(storage.data(), data, static_cast<size_t>(size));
+	}
+
+	void GLAD_API_PTR nullBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+	{
+		std::vector<uint8_t>& storage = nullDriver.buffers[nullDriver.boundBuffers[target]];
+		if (storage.size() < static_cast<size_t>(offset + size)) storage.resize(static_cast<size_t>(offset + size));
+		if (data && size) memcpy(storage.data() + offset, data, static_cast<size_t>(size));
+	}
+
+	void* GLAD_API_PTR nullMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield)
+	{
+		std::vector<uint8_t>& storage = nullDriver.buffers[nullDriver.boundBuffers[target]];
+		if (storage.size() < static_cast<size_t>(offset + length)) storage.resize(static_cast<size_t>(offset + length));
+		return storage.data() + offset;
+	}
+
+	void* GLAD_API_PTR nullMapBuffer(GLenum target, GLenum)
+	{
+		std::vector<uint8_t>& storage = nullDriver.buffers[nullDriver.boundBuffers[target]];
+		return storage.data();
+	}
+
+	GLboolean GLAD_API_PTR nullUnmapBuffer(GLenum)
+	{
+		return GL_TRUE;
+	}
+
+	void GLAD_API_PTR nullDeleteBuffers(GLsizei n, const GLuint* buffers)
+	{
+		for (GLsizei i = 0; i < n; i++)
+			nullDriver.buffers.erase(buffers[i]);
+	}
+}
+//-----------------------------------------------------------------------------
+bool RenderTrace::Install(RenderTraceMode mode)
+{
+	Uninstall();
+	m_mode = mode;
+
+	// save an entry point or loader flag, so that Uninstall() can restore it
+	auto save = [this](auto& value)
+	{
+		m_restore.push_back([&value, original = value]() { value = original; });
+	};
+
+	if (mode == RenderTraceMode::Null)
+	{
+#define RENDER_TRACE_SET_NULL(name) save(glad_gl##name); setNull(glad_gl##name);
+		RENDER_TRACE_NULL_FUNCTIONS(RENDER_TRACE_SET_NULL)
+#undef RENDER_TRACE_SET_NULL
+
+		glad_glGenBuffers = glad_glGenFramebuffers = glad_glGenQueries = glad_glGenRenderbuffers = &nullGenNames;
+		glad_glGenSamplers = glad_glGenTextures = glad_glGenTransformFeedbacks = glad_glGenVertexArrays = glad_glCreateBuffers = &nullGenNames;
+		glad_glCreateProgram = &nullCreateProgram;
+		glad_glCreateShader = &nullCreateShader;
+		glad_glGetShaderiv = &nullGetShaderiv;
+		glad_glShaderSource = &nullShaderSource;
+		glad_glAttachShader = &nullAttachShader;
+		glad_glLinkProgram = &nullLinkProgram;
+		glad_glGetProgramiv = &nullGetProgramiv;
+		glad_glGetActiveUniform = &nullGetActiveUniform;
+		glad_glGetActiveUniformsiv = &nullGetActiveUniformsiv;
+		glad_glGetIntegerv = &nullGetIntegerv;
+		glad_glGetString = &nullGetString;
+		glad_glGetStringi = &nullGetStringi;
+		glad_glGetUniformLocation = &nullGetUniformLocation;
+		glad_glGetAttribLocation = &nullGetAttribLocation;
+		glad_glCheckFramebufferStatus = &nullCheckFramebufferStatus;
+		glad_glFenceSync = &nullFenceSync;
+		glad_glClientWaitSync = &nullClientWaitSync;
+		glad_glBindBuffer = &nullBindBuffer;
+		glad_glBufferData = &nullBufferData;
+		glad_glBufferSubData = &nullBufferSubData;
+		glad_glMapBufferRange = &nullMapBufferRange;
+		glad_glMapBuffer = &nullMapBuffer;
+		glad_glUnmapBuffer = &nullUnmapBuffer;
+		glad_glDeleteBuffers = &nullDeleteBuffers;
+
+		// the null device is OpenGL 3.3: no direct state access, persistent mapping or storage buffers
+		int* versions[] = { &GLAD_GL_VERSION_3_3, &GLAD_GL_VERSION_4_0, &GLAD_GL_VERSION_4_1, &GLAD_GL_VERSION_4_2, &GLAD_GL_VERSION_4_3, &GLAD_GL_VERSION_4_4, &GLAD_GL_VERSION_4_5, &GLAD_GL_VERSION_4_6 };
+		for (int* version : versions)
+		{
+			save(*version);
+			*version = version == versions[0] ? 1 : 0;
+		}
+		nullDriver = {};
+	}
+
+	// a driver that lacks a traced function keeps it null
+#define RENDER_TRACE_HOOK(name, type) \
+	if (glad_gl##name) \
+	{ \
+		using Entry = TraceEntry<TraceFunction::name, RenderCommandType::type, decltype(glad_gl##name)>; \
+		save(glad_gl##name); \
+		Entry::driver = glad_gl##name; \
+		Entry::functionName = "gl" #name; \
+		glad_gl##name = &Entry::Call; \
+	}
+	RENDER_TRACE_FUNCTIONS(RENDER_TRACE_HOOK)
+#undef RENDER_TRACE_HOOK
+
+	m_installed = true;
+	Clear();
+	return true;
+}
+//-----------------------------------------------------------------------------
+void RenderTrace::Uninstall()
+{
+	// restore in reverse order, the traced entry points were saved after the null ones
+	for (auto it = m_restore.rbegin(); it != m_restore.rend(); ++it)
+		(*it)();
+	m_restore.clear();
+	m_installed = false;
+}
+//-----------------------------------------------------------------------------
+void RenderTrace::Clear()
+{
+	m_commands.clear();
+	m_payload.clear();
+	for (unsigned& count : m_counts)
+		count = 0;
+	m_uploadedBytes = 0;
+}
+//-----------------------------------------------------------------------------
+void RenderTrace::Record(RenderCommandType type, const char* function, std::span<const uint64_t> args, const void* payload, size_t payloadSize, void (*replay)(const RenderCommand&, const uint8_t*))
+{
+	if (!m_recording) return;
+
+	RenderCommand command = {};
+	command.type = type;
+	command.function = function;
+	command.numArgs = static_cast<unsigned>(std::min(args.size(), static_cast<size_t>(MaxRenderCommandArgs)));
+	std::copy_n(args.begin(), command.numArgs, command.args);
+	command.replay = replay;
+	if (payload && payloadSize)
+	{
+		command.payloadOffset = m_payload.size();
+		command.payloadSize = payloadSize;
+		const uint8_t* data = static_cast<const uint8_t*>(payload);
+		m_payload.insert(m_payload.end(), data, data + payloadSize);
+	}
+
+	m_counts[static_cast<size_t>(type)]++;
+	if (type == RenderCommandType::Upload)
+		m_uploadedBytes += command.payloadSize;
+	m_commands.push_back(command);
+}
+//-----------------------------------------------------------------------------
+void RenderTrace::Replay() const
+{
+	for (const RenderCommand& command : m_commands)
+		command.replay(command, command.payloadSize ? m_payload.data() + command.payloadOffset : nullptr);
+}
+//-----------------------------------------------------------------------------
+unsigned RenderTrace::Count(std::string_view function) const
+{
+	unsigned count = 0;
+	for (const RenderCommand& command : m_commands)
+	{
+		if (function == command.function)
+			count++;
+	}
+	return count;
+}
+//-----------------------------------------------------------------------------
+std::string RenderTrace::ToString() const
+{
+	std::string result;
+	for (const RenderCommand& command : m_commands)
+	{
+		result += command.function;
+		result += '(';
+		for (unsigned i = 0; i < command.numArgs; i++)
+		{
+			if (i) result += ", ";
+			result += std::to_string(command.args[i]);
+		}
+		result += ')';
+		if (command.payloadSize)
+			result += " [" + std::to_string(command.payloadSize) + " bytes]";
+		result += '\n';
+	}
+	return result;
+}
+//-----------------------------------------------------------------------------
+RenderTrace& GetRenderTrace()
+{
+	return gRenderTrace;
+}
+//-----------------------------------------------------------------------------
+#endif // PLATFORM_DESKTOP
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "OpenGLCore.h"
+#include <functional>
+
+#if PLATFORM_DESKTOP
+
+constexpr unsigned MaxRenderCommandArgs = 9;
+
+enum class RenderCommandType : uint8_t
+{
+	// fixed function state: enable, depth, stencil, blend, rasterizer, viewport, scissor, clear color, active texture unit
+	State,
+	BindProgram,
+	BindVertexArray,
+	BindBuffer,
+	BindTexture,
+	BindSampler,
+	BindFramebuffer,
+	// vertex attribute layout of a vertex array
+	VertexFormat,
+	Uniform,
+	// buffer and texture data
+	Upload,
+	Draw,
+	Clear,
+
+	Count
+};
+
+// GL call recorded by the RenderTrace
+struct RenderCommand final
+{
+	RenderCommandType type;
+	// name of the GL function, such as "glDrawElements"
+	const char* function;
+	// arguments of the call: integers and pointers as is, floats as their bits
+	uint64_t args[MaxRenderCommandArgs];
+	unsigned numArgs;
+	// copy of the data read by the call, for uploads and uniform arrays. The offset is in RenderTrace::GetPayload()
+	size_t payloadOffset;
+	size_t payloadSize;
+	// reissue the call with the recorded arguments and payload
+	void (*replay)(const RenderCommand& command, const uint8_t* payload);
+};
+
+enum class RenderTraceMode : uint8_t
+{
+	// record the traced calls and forward every call to the driver
+	Record,
+	// no driver: object names and uniform locations are generated, queries describe an OpenGL 3.3 device without extensions and nothing is drawn. No context is needed, install before RenderSystem::Create()
+	Null
+};
+
+// Records the GL calls of the render code into an inspectable trace by replacing the loader entry points of the traced functions.
+// Lets the RenderAPI run headless in CI: benchmark the CPU submission cost, count uploads and draws, assert that the state cache filters redundant binds.
+// Main thread only, like all GL calls.
+class RenderTrace final
+{
+public:
+	RenderTrace() = default;
+	~RenderTrace() { Uninstall(); }
+
+	bool Install(RenderTraceMode mode);
+	// restore the loader entry points
+	void Uninstall();
+
+	// pause or resume recording, the calls are still forwarded
+	void SetRecording(bool recording) { m_recording = recording; }
+	void Clear();
+
+	// reissue the recorded calls in order. The objects they refer to must still exist
+	void Replay() const;
+
+	std::span<const RenderCommand> GetCommands() const { return m_commands; }
+	const std::vector<uint8_t>& GetPayload() const { return m_payload; }
+	unsigned Count(RenderCommandType type) const { return m_counts[static_cast<size_t>(type)]; }
+	// number of calls of one GL function, such as "glUseProgram"
+	unsigned Count(std::string_view function) const;
+	// bytes of data sent by Upload commands
+	size_t GetUploadedBytes() const { return m_uploadedBytes; }
+	// one line per command, "glDrawElements(4, 36, 5125, 0)"
+	std::string ToString() const;
+
+	bool IsInstalled() const { return m_installed; }
+	RenderTraceMode GetMode() const { return m_mode; }
+
+	// called by the entry points that replace the traced functions
+	void Record(RenderCommandType type, const char* function, std::span<const uint64_t> args, const void* payload, size_t payloadSize, void (*replay)(const RenderCommand&, const uint8_t*));
+
+private:
+	RenderTrace(RenderTrace&&) = delete;
+	RenderTrace(const RenderTrace&) = delete;
+	RenderTrace& operator=(RenderTrace&&) = delete;
+	RenderTrace& operator=(const RenderTrace&) = delete;
+
+	std::vector<RenderCommand> m_commands;
+	std::vector<uint8_t> m_payload;
+	unsigned m_counts[static_cast<size_t>(RenderCommandType::Count)] = {};
+	size_t m_uploadedBytes = 0;
+	// restore the entry points and loader flags replaced by Install()
+	std::vector<std::function<void()>> m_restore;
+	RenderTraceMode m_mode = RenderTraceMode::Record;
+	bool m_installed = false;
+	bool m_recording = true;
+};
+
+RenderTrace& GetRenderTrace();
+
+#endif // PLATFORM_DESKTOP
\ No newline at end of file
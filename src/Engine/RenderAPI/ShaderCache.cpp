@@ -0,0 +1,173 @@
+#include "stdafx.h"
+#include "ShaderCache.h"
+#include "OpenGLCore.h"
+#include "Core/Logging/Log.h"
+#include "Core/IO/File.h"
+#include "Core/IO/FileSystem.h"
+#include "Core/IO/MemoryMappedStream.h"
+//-----------------------------------------------------------------------------
+static const char SHADER_CACHE_ID[4] = { 'T', 'S', 'P', 'B' };
+static const uint32_t SHADER_CACHE_VERSION = 1;
+static const char* const SHADER_CACHE_EXTENSION = ".bin";
+//-----------------------------------------------------------------------------
+struct ShaderCacheHeader
+{
+	// File ID "TSPB", left zero until the whole entry is written.
+	char id[4];
+	uint32_t version;
+	uint64_t key;
+	uint64_t driverHash;
+	uint32_t binaryFormat;
+	uint32_t binarySize;
+};
+//-----------------------------------------------------------------------------
+// 64-bit FNV-1a
+static uint64_t HashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+//-----------------------------------------------------------------------------
+static uint64_t HashString(const std::string& str, uint64_t hash)
+{
+	// the length separates consecutive strings, so that "ab" + "c" and "a" + "bc" differ
+	const uint64_t length = str.length();
+	hash = HashBytes(&length, sizeof length, hash);
+	return HashBytes(str.data(), str.length(), hash);
+}
+//-----------------------------------------------------------------------------
+static std::string GetGLString(GLenum name)
+{
+	const char* str = (const char*)glGetString(name);
+	return str ? str : "";
+}
+//-----------------------------------------------------------------------------
+bool ShaderCache::Create(const std::string& directory)
+{
+	Destroy();
+
+#if PLATFORM_EMSCRIPTEN
+	(void)directory;
+	return false;
+#else
+	if (OpenGLExtensions::version < OPENGL41)
+		return false;
+
+	GLint numFormats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+	if (numFormats <= 0)
+		return false;
+
+	m_directory = FileSystem::AddTrailingSlash(directory);
+	if (!FileSystem::IsDirectory(m_directory) && !FileSystem::CreateDir(m_directory))
+	{
+		LogWarning("Could not create shader cache directory " + m_directory);
+		return false;
+	}
+
+	m_driverHash = HashString(GetGLString(GL_VENDOR), 14695981039346656037ull);
+	m_driverHash = HashString(GetGLString(GL_RENDERER), m_driverHash);
+	m_driverHash = HashString(GetGLString(GL_VERSION), m_driverHash);
+	m_enabled = true;
+	return true;
+#endif
+}
+//-----------------------------------------------------------------------------
+void ShaderCache::Destroy()
+{
+	m_directory.clear();
+	m_driverHash = 0;
+	m_enabled = false;
+}
+//-----------------------------------------------------------------------------
+uint64_t ShaderCache::MakeKey(const std::string& vertexSource, const std::string& fragmentSource) const
+{
+	uint64_t key = HashString(vertexSource, m_driverHash);
+	return HashString(fragmentSource, key);
+}
+//-----------------------------------------------------------------------------
+bool ShaderCache::Load(uint64_t key, GLuint program)
+{
+#if !PLATFORM_EMSCRIPTEN
+	if (!m_enabled) return false;
+
+	const std::string fileName = getFileName(key);
+	if (!FileSystem::Exists(fileName)) return false;
+
+	bool loaded = false;
+	{
+		MemoryMappedStream file(fileName);
+		const ShaderCacheHeader* header = file.IsOpen() && file.Size() >= sizeof(ShaderCacheHeader) ? reinterpret_cast<const ShaderCacheHeader*>(file.Data()) : nullptr;
+		if (header && memcmp(header->id, SHADER_CACHE_ID, sizeof SHADER_CACHE_ID) == 0 && header->version == SHADER_CACHE_VERSION &&
+			header->key == key && header->driverHash == m_driverHash && header->binarySize == file.Size() - sizeof(ShaderCacheHeader))
+		{
+			glProgramBinary(program, header->binaryFormat, file.Data() + sizeof(ShaderCacheHeader), static_cast<GLsizei>(header->binarySize));
+			GLint linkStatus = GL_FALSE;
+			glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+			loaded = linkStatus == GL_TRUE;
+		}
+	}
+
+	// a stale or corrupt entry is removed, the program is then compiled and stored again
+	if (!loaded && !FileSystem::DeleteFile(fileName))
+		LogWarning("Could not delete invalid shader cache entry " + fileName);
+	return loaded;
+#else
+	(void)key; (void)program;
+	return false;
+#endif
+}
+//-----------------------------------------------------------------------------
+void ShaderCache::Store(uint64_t key, GLuint program)
+{
+#if !PLATFORM_EMSCRIPTEN
+	if (!m_enabled) return;
+
+	GLint binarySize = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+	if (binarySize <= 0) return;
+
+	std::vector<unsigned char> binary(static_cast<size_t>(binarySize));
+	GLenum binaryFormat = 0;
+	GLsizei length = 0;
+	glGetProgramBinary(program, binarySize, &length, &binaryFormat, binary.data());
+	if (length <= 0) return;
+
+	const std::string fileName = getFileName(key);
+	File file(fileName, FILE_WRITE);
+	if (!file.IsOpen())
+	{
+		LogWarning("Could not open shader cache entry " + fileName + " for writing");
+		return;
+	}
+
+	ShaderCacheHeader header = {};
+	header.version = SHADER_CACHE_VERSION;
+	header.key = key;
+	header.driverHash = m_driverHash;
+	header.binaryFormat = binaryFormat;
+	header.binarySize = static_cast<uint32_t>(length);
+
+	// the ID is written last, so that a partially written entry is never loaded
+	file.Write(&header, sizeof header);
+	file.Write(binary.data(), static_cast<size_t>(length));
+	memcpy(header.id, SHADER_CACHE_ID, sizeof SHADER_CACHE_ID);
+	file.Seek(0);
+	file.Write(&header, sizeof header);
+#else
+	(void)key; (void)program;
+#endif
+}
+//-----------------------------------------------------------------------------
+std::string ShaderCache::getFileName(uint64_t key) const
+{
+	char name[17];
+	snprintf(name, sizeof name, "%016llx", static_cast<unsigned long long>(key));
+	return m_directory + name + SHADER_CACHE_EXTENSION;
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
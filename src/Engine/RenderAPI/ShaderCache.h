@@ -0,0 +1,35 @@
+#pragma once
+
+// On-disk cache of linked program binaries (glGetProgramBinary, OpenGL 4.1+). An entry is keyed by a hash of the final vertex and fragment sources,
+// so the values set with ShaderBytecode::InsertMacroValue select their own entry, and is only valid for the driver vendor, renderer and version that wrote it.
+class ShaderCache final
+{
+public:
+	ShaderCache() = default;
+
+	// Enable the cache with entries in the directory. Return false if the driver can not return program binaries.
+	bool Create(const std::string& directory);
+	void Destroy();
+
+	bool IsEnabled() const { return m_enabled; }
+
+	// Key of a program built from the final vertex and fragment sources.
+	uint64_t MakeKey(const std::string& vertexSource, const std::string& fragmentSource) const;
+	// Load a cached binary into the program. Return false if there is no entry, an entry the driver rejects is deleted.
+	bool Load(uint64_t key, GLuint program);
+	// Store the binary of a linked program. The program must be linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT.
+	void Store(uint64_t key, GLuint program);
+
+private:
+	ShaderCache(ShaderCache&&) = delete;
+	ShaderCache(const ShaderCache&) = delete;
+	ShaderCache& operator=(ShaderCache&&) = delete;
+	ShaderCache& operator=(const ShaderCache&) = delete;
+
+	std::string getFileName(uint64_t key) const;
+
+	std::string m_directory;
+	// Hash of the driver strings, stored in each entry.
+	uint64_t m_driverHash = 0;
+	bool m_enabled = false;
+};
\ No newline at end of file
@@ -0,0 +1,263 @@
+#include "stdafx.h"
+#include "ShaderLibrary.h"
+#include "RenderSystem.h"
+//-----------------------------------------------------------------------------
+static inline size_t VariantSlot(ShaderVariantKey key, size_t mask)
+{
+	// Fibonacci hashing, the keys are small bit masks that would cluster with the identity
+	return (static_cast<size_t>(key) * 2654435769u) & mask;
+}
+//-----------------------------------------------------------------------------
+static inline bool IsIdentifierChar(char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+//-----------------------------------------------------------------------------
+// Return the keywords that a source refers to as whole identifiers in #if, #ifdef, #ifndef, #elif or #define lines, outside comments.
+// Only those change the preprocessed source: a keyword that merely appears in a longer name (NORMAL in NORMAL_MAP) or in a comment does not.
+static ShaderVariantKey FindUsedKeywords(const std::string& source, const std::vector<std::string>& keywords)
+{
+	ShaderVariantKey used = 0;
+	bool blockComment = false;
+	std::string line;
+	for (size_t lineStart = 0; lineStart < source.size(); )
+	{
+		size_t lineEnd = source.find('\n', lineStart);
+		if (lineEnd == std::string::npos) lineEnd = source.size();
+
+		// strip the comments, block comments can span lines
+		line.clear();
+		for (size_t i = lineStart; i < lineEnd; i++)
+		{
+			if (blockComment)
+			{
+				if (source.compare(i, 2, "*/") == 0) { blockComment = false; i++; }
+				continue;
+			}
+			if (source.compare(i, 2, "/*") == 0) { blockComment = true; i++; line += ' '; continue; }
+			if (source.compare(i, 2, "//") == 0) break;
+			line += source[i];
+		}
+		lineStart = lineEnd + 1;
+
+		size_t pos = line.find_first_not_of(" \t\r");
+		if (pos == std::string::npos || line[pos] != '#') continue;
+		pos = line.find_first_not_of(" \t", pos + 1);
+		if (pos == std::string::npos) continue;
+		size_t end = pos;
+		while (end < line.size() && IsIdentifierChar(line[end])) end++;
+		const std::string_view directive(line.data() + pos, end - pos);
+		if (directive != "if" && directive != "ifdef" && directive != "ifndef" && directive != "elif" && directive != "define")
+			continue;
+
+		for (size_t i = end; i < line.size(); )
+		{
+			if (!IsIdentifierChar(line[i])) { i++; continue; }
+			size_t j = i;
+			while (j < line.size() && IsIdentifierChar(line[j])) j++;
+			// numbers are not identifiers
+			if (line[i] < '0' || line[i] > '9')
+			{
+				const std::string_view identifier(line.data() + i, j - i);
+				for (size_t k = 0; k < keywords.size(); k++)
+				{
+					if (keywords[k] == identifier)
+						used |= 1u << k;
+				}
+			}
+			i = j;
+		}
+	}
+	return used;
+}
+//-----------------------------------------------------------------------------
+bool ShaderLibrary::Create(const ShaderBytecode& vertexShader, const ShaderBytecode& fragmentShader, std::span<const std::string> keywords)
+{
+	Destroy();
+
+	if (!vertexShader.IsValid() || !fragmentShader.IsValid())
+	{
+		LogError("ShaderLibrary needs a vertex and a fragment shader");
+		return false;
+	}
+	if (keywords.size() > MaxShaderKeywords)
+	{
+		LogError("ShaderLibrary supports at most " + std::to_string(MaxShaderKeywords) + " keywords");
+		return false;
+	}
+
+	m_vertexShader = vertexShader;
+	m_fragmentShader = fragmentShader;
+	m_keywords.assign(keywords.begin(), keywords.end());
+	m_usedKeywords = FindUsedKeywords(m_vertexShader.GetSource(), m_keywords) | FindUsedKeywords(m_fragmentShader.GetSource(), m_keywords);
+	m_slots.resize(16);
+	return true;
+}
+//-----------------------------------------------------------------------------
+void ShaderLibrary::Destroy()
+{
+	m_vertexShader = ShaderBytecode();
+	m_fragmentShader = ShaderBytecode();
+	m_keywords.clear();
+	m_usedKeywords = 0;
+	m_variants.clear();
+	m_slots.clear();
+	m_numPending = 0;
+	m_statistics = {};
+}
+//-----------------------------------------------------------------------------
+ShaderVariantKey ShaderLibrary::GetKeywordBit(std::string_view keyword) const
+{
+	for (size_t i = 0; i < m_keywords.size(); i++)
+	{
+		if (m_keywords[i] == keyword)
+			return 1u << i;
+	}
+	return 0;
+}
+//-----------------------------------------------------------------------------
+ShaderVariantKey ShaderLibrary::GetKey(std::initializer_list<std::string_view> keywords) const
+{
+	ShaderVariantKey key = 0;
+	for (std::string_view keyword : keywords)
+		key |= GetKeywordBit(keyword);
+	return key;
+}
+//-----------------------------------------------------------------------------
+ShaderProgramRef ShaderLibrary::GetVariant(ShaderVariantKey key)
+{
+	assert(IsValid());
+	if (!IsValid()) return nullptr;
+
+	key &= m_usedKeywords;
+	uint32_t index = findVariant(key);
+	if (index == EmptySlot)
+	{
+		index = beginVariant(key);
+		m_statistics.misses++;
+	}
+	else if (m_variants[index].pending.IsValid())
+		m_statistics.waits++;
+	else
+		m_statistics.hits++;
+
+	Variant& variant = m_variants[index];
+	if (variant.pending.IsValid())
+		finishVariant(variant);
+	return variant.program;
+}
+//-----------------------------------------------------------------------------
+void ShaderLibrary::Prewarm(std::span<const ShaderVariantKey> keys)
+{
+	assert(IsValid());
+	if (!IsValid()) return;
+
+	for (ShaderVariantKey key : keys)
+	{
+		key &= m_usedKeywords;
+		if (findVariant(key) == EmptySlot)
+			beginVariant(key);
+	}
+
+	// without parallel compile the driver compiles on the calling thread anyway, the variants are finished right away
+	if (!OpenGLExtensions::parallelShaderCompile)
+		Update();
+}
+//-----------------------------------------------------------------------------
+unsigned ShaderLibrary::Update()
+{
+	if (!m_numPending) return 0;
+
+	RenderSystem& renderSystem = GetRenderSystem();
+	for (Variant& variant : m_variants)
+	{
+		if (variant.pending.IsValid() && renderSystem.IsShaderProgramReady(variant.pending))
+			finishVariant(variant);
+	}
+	return m_numPending;
+}
+//-----------------------------------------------------------------------------
+uint32_t ShaderLibrary::findVariant(ShaderVariantKey key) const
+{
+	const size_t mask = m_slots.size() - 1;
+	for (size_t i = VariantSlot(key, mask); ; i = (i + 1) & mask)
+	{
+		const Slot& slot = m_slots[i];
+		if (slot.variant == EmptySlot || slot.key == key)
+			return slot.variant;
+	}
+}
+//-----------------------------------------------------------------------------
+uint32_t ShaderLibrary::beginVariant(ShaderVariantKey key)
+{
+	if ((m_variants.size() + 1) * 2 > m_slots.size())
+	{
+		m_slots.assign(m_slots.size() * 2, Slot());
+		const size_t mask = m_slots.size() - 1;
+		for (uint32_t v = 0; v < m_variants.size(); v++)
+		{
+			size_t i = VariantSlot(m_variants[v].key, mask);
+			while (m_slots[i].variant != EmptySlot)
+				i = (i + 1) & mask;
+			m_slots[i] = { m_variants[v].key, v };
+		}
+	}
+
+	const uint32_t index = static_cast<uint32_t>(m_variants.size());
+	const size_t mask = m_slots.size() - 1;
+	size_t i = VariantSlot(key, mask);
+	while (m_slots[i].variant != EmptySlot)
+		i = (i + 1) & mask;
+	m_slots[i] = { key, index };
+
+	Variant& variant = m_variants.emplace_back();
+	variant.key = key;
+	variant.pending = GetRenderSystem().BeginShaderProgram(makeSource(m_vertexShader.GetSource(), key, true), makeSource(m_fragmentShader.GetSource(), key, false));
+	if (variant.pending.IsValid())
+		m_numPending++;
+	return index;
+}
+//-----------------------------------------------------------------------------
+void ShaderLibrary::finishVariant(Variant& variant)
+{
+	variant.program = GetRenderSystem().FinishShaderProgram(variant.pending);
+	variant.pending = {};
+	m_numPending--;
+
+	if (!variant.program)
+	{
+		std::string keywords;
+		for (size_t i = 0; i < m_keywords.size(); i++)
+		{
+			if (variant.key & (1u << i))
+				keywords += " " + m_keywords[i];
+		}
+		LogError("ShaderLibrary variant failed to compile, keywords:" + (keywords.empty() ? std::string(" none") : keywords));
+	}
+}
+//-----------------------------------------------------------------------------
+std::string ShaderLibrary::makeSource(const std::string& source, ShaderVariantKey key, bool vertexShader) const
+{
+	std::string defines;
+	for (size_t i = 0; i < m_keywords.size(); i++)
+	{
+		if (key & (1u << i))
+			defines += "#define " + m_keywords[i] + " 1\n";
+	}
+
+	// defines must follow the #version line, sources without one get the default header that RenderSystem would add
+	std::string result = source;
+	if (result.find("#version") == std::string::npos)
+		result = (vertexShader ? ShaderBytecode::GetHeaderVertexShader() : ShaderBytecode::GetHeaderFragmentShader()) + "\n" + result;
+	if (defines.empty())
+		return result;
+
+	const size_t versionPos = result.find("#version");
+	const size_t lineEnd = result.find('\n', versionPos);
+	if (lineEnd == std::string::npos)
+		result += "\n" + defines;
+	else
+		result.insert(lineEnd + 1, defines);
+	return result;
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "RenderResource.h"
+
+// Bit mask of the enabled keywords of a ShaderLibrary, bit i is keyword i.
+using ShaderVariantKey = uint32_t;
+constexpr unsigned MaxShaderKeywords = 32;
+
+// Outcome of the GetVariant() calls since the last ResetStatistics().
+struct ShaderVariantStatistics final
+{
+	// the program was already finished, e.g. pre-warmed and picked up by Update()
+	unsigned hits = 0;
+	// a pre-warmed program was still compiling, GetVariant() blocked until the driver finished it
+	unsigned waits = 0;
+	// the variant was not pre-warmed and was compiled on the calling thread
+	unsigned misses = 0;
+};
+
+// Shader source with feature keywords, compiled into one program per keyword combination on first use.
+// A variant gets "#define KEYWORD 1" after the #version line for each of its keywords. Keywords that no #if, #ifdef, #ifndef, #elif or #define line of either source refers to are dropped from the key,
+// so variants that only differ in them have the same preprocessed source and share one program.
+class ShaderLibrary final
+{
+public:
+	ShaderLibrary() = default;
+	ShaderLibrary(const ShaderBytecode& vertexShader, const ShaderBytecode& fragmentShader, std::span<const std::string> keywords) { Create(vertexShader, fragmentShader, keywords); }
+
+	bool Create(const ShaderBytecode& vertexShader, const ShaderBytecode& fragmentShader, std::span<const std::string> keywords);
+	void Destroy();
+
+	bool IsValid() const { return m_vertexShader.IsValid() && m_fragmentShader.IsValid(); }
+
+	// Return the bit of a keyword, 0 if the library has no such keyword.
+	ShaderVariantKey GetKeywordBit(std::string_view keyword) const;
+	ShaderVariantKey GetKey(std::initializer_list<std::string_view> keywords) const;
+	const std::vector<std::string>& GetKeywords() const { return m_keywords; }
+
+	// Return the program of a variant, compiled on first use. Null if the variant fails to compile.
+	ShaderProgramRef GetVariant(ShaderVariantKey key);
+	// Start compiling variants, e.g. the material combinations of a level at load time. With parallel shader compile the driver works in the background until Update() or GetVariant() picks the programs up.
+	void Prewarm(std::span<const ShaderVariantKey> keys);
+	// Finish the pre-warmed variants the driver has completed without blocking. Return the number of variants still compiling.
+	unsigned Update();
+
+	size_t GetNumVariants() const { return m_variants.size(); }
+	const ShaderVariantStatistics& GetStatistics() const { return m_statistics; }
+	void ResetStatistics() { m_statistics = {}; }
+
+private:
+	ShaderLibrary(ShaderLibrary&&) = delete;
+	ShaderLibrary(const ShaderLibrary&) = delete;
+	ShaderLibrary& operator=(ShaderLibrary&&) = delete;
+	ShaderLibrary& operator=(const ShaderLibrary&) = delete;
+
+	struct Variant final
+	{
+		ShaderVariantKey key = 0;
+		ShaderProgramRef program;
+		// valid while the variant is compiling
+		PendingShaderProgram pending;
+	};
+
+	// Open addressing slot of the variant table. Keys can be zero, so empty slots are marked by the variant index.
+	struct Slot final
+	{
+		ShaderVariantKey key = 0;
+		uint32_t variant = EmptySlot;
+	};
+	static constexpr uint32_t EmptySlot = 0xFFFFFFFFu;
+
+	uint32_t findVariant(ShaderVariantKey key) const;
+	uint32_t beginVariant(ShaderVariantKey key);
+	void finishVariant(Variant& variant);
+	std::string makeSource(const std::string& source, ShaderVariantKey key, bool vertexShader) const;
+
+	ShaderBytecode m_vertexShader;
+	ShaderBytecode m_fragmentShader;
+	std::vector<std::string> m_keywords;
+	// keywords that the preprocessor lines of the sources refer to
+	ShaderVariantKey m_usedKeywords = 0;
+	std::vector<Variant> m_variants;
+	// capacity is a power of two, at most half full
+	std::vector<Slot> m_slots;
+	unsigned m_numPending = 0;
+	ShaderVariantStatistics m_statistics;
+};
\ No newline at end of file
@@ -0,0 +1,166 @@
+#include "stdafx.h"
+#include "UniformRingBuffer.h"
+#include "RenderSystem.h"
+#include "Capabilities.h"
+//-----------------------------------------------------------------------------
+// Longest wait for the GPU to release a frame region before it is overwritten anyway
+static const GLuint64 FenceWaitTimeout = 1000000000ull; // 1 second in nanoseconds
+//-----------------------------------------------------------------------------
+bool UniformRingBuffer::Create(unsigned frameSize, unsigned framesInFlight)
+{
+	Destroy();
+
+	m_alignment = std::max(Capabilities::uniformBufferOffsetAlignment, 1u);
+	m_frameSize = (frameSize + m_alignment - 1) / m_alignment * m_alignment;
+	if (!m_frameSize)
+	{
+		LogError("UniformRingBuffer frame size is zero");
+		return false;
+	}
+
+	auto& renderSystem = GetRenderSystem();
+#if !PLATFORM_EMSCRIPTEN
+	if (OpenGLExtensions::version >= OPENGL44)
+	{
+		framesInFlight = std::max(framesInFlight, 1u);
+		const GLsizeiptr size = static_cast<GLsizeiptr>(m_frameSize) * framesInFlight;
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+		m_buffer.reset(new UniformBuffer(BufferUsage::StreamDraw, static_cast<unsigned>(size)));
+		if (!renderSystem.IsValid(m_buffer))
+		{
+			LogError("UniformRingBuffer create failed!");
+			m_buffer.reset();
+			return false;
+		}
+
+		glBindBuffer(GL_UNIFORM_BUFFER, *m_buffer);
+		glBufferStorage(GL_UNIFORM_BUFFER, size, nullptr, flags);
+		m_mappedData = static_cast<unsigned char*>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, size, flags));
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		if (!m_mappedData)
+		{
+			LogError("UniformRingBuffer persistent mapping failed!");
+			m_buffer.reset();
+			return false;
+		}
+
+		m_fences.resize(framesInFlight, nullptr);
+		return true;
+	}
+#endif
+
+	// fallback: one region, orphaned every frame so the driver can hand out fresh memory while the GPU reads the old one
+	m_buffer = renderSystem.CreateUniformBuffer(BufferUsage::StreamDraw, m_frameSize);
+	if (!renderSystem.IsValid(m_buffer))
+	{
+		LogError("UniformRingBuffer create failed!");
+		m_buffer.reset();
+		return false;
+	}
+	m_fences.clear();
+	return true;
+}
+//-----------------------------------------------------------------------------
+void UniformRingBuffer::Destroy()
+{
+	for (GLsync fence : m_fences)
+	{
+		if (fence) glDeleteSync(fence);
+	}
+	m_fences.clear();
+
+	if (m_mappedData)
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, *m_buffer);
+		glUnmapBuffer(GL_UNIFORM_BUFFER);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		m_mappedData = nullptr;
+	}
+	m_buffer.reset();
+	m_frameSize = 0;
+	m_frame = 0;
+	m_offset = 0;
+	m_frameNumber++;
+	m_overflowLogged = false;
+}
+//-----------------------------------------------------------------------------
+bool UniformRingBuffer::Push(unsigned bindingPoint, const void* data, unsigned size)
+{
+	UniformRingRange range;
+	return Push(bindingPoint, data, size, range);
+}
+//-----------------------------------------------------------------------------
+bool UniformRingBuffer::Push(unsigned bindingPoint, const void* data, unsigned size, UniformRingRange& range)
+{
+	assert(IsValid());
+	if (!m_buffer || !size) return false;
+
+	if (m_offset + size > m_frameSize)
+	{
+		if (!m_overflowLogged)
+		{
+			LogError("UniformRingBuffer frame region of " + std::to_string(m_frameSize) + " bytes is full");
+			m_overflowLogged = true;
+		}
+		return false;
+	}
+
+	const unsigned offset = m_frame * m_frameSize + m_offset;
+	if (m_mappedData)
+	{
+		memcpy(m_mappedData + offset, data, size);
+	}
+	else
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, *m_buffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+	}
+	RenderSystem& renderSystem = GetRenderSystem();
+	renderSystem.BindRange(m_buffer, bindingPoint, offset, size);
+	renderSystem.countUpload(data, size);
+
+	range = { m_frameNumber, offset, size };
+	m_offset += (size + m_alignment - 1) / m_alignment * m_alignment;
+	return true;
+}
+//-----------------------------------------------------------------------------
+bool UniformRingBuffer::BindRange(unsigned bindingPoint, const UniformRingRange& range)
+{
+	if (!IsCurrent(range)) return false;
+
+	GetRenderSystem().BindRange(m_buffer, bindingPoint, range.offset, range.size);
+	return true;
+}
+//-----------------------------------------------------------------------------
+void UniformRingBuffer::NextFrame()
+{
+	if (!m_buffer) return;
+
+	m_offset = 0;
+	m_frameNumber++;
+	m_overflowLogged = false;
+
+	if (!m_mappedData)
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, *m_buffer);
+		glBufferData(GL_UNIFORM_BUFFER, m_frameSize, nullptr, GL_STREAM_DRAW);
+		return;
+	}
+
+#if !PLATFORM_EMSCRIPTEN
+	m_fences[m_frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_frame = (m_frame + 1) % static_cast<unsigned>(m_fences.size());
+
+	GLsync& fence = m_fences[m_frame];
+	if (fence)
+	{
+		const GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FenceWaitTimeout);
+		if (result == GL_TIMEOUT_EXPIRED || result == GL_WAIT_FAILED)
+			LogWarning("UniformRingBuffer fence wait failed, frame region is overwritten while in use");
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+#endif
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
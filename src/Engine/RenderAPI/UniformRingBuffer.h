@@ -0,0 +1,65 @@
+#pragma once
+
+#include "RenderResource.h"
+
+constexpr unsigned DefaultUniformRingFrames = 3;
+
+// Range of the ring written by Push(). It stays valid until the end of the frame, so that data shared by several draws is written once and bound again with BindRange().
+struct UniformRingRange final
+{
+	uint64_t frame = ~0ull;
+	unsigned offset = 0;
+	unsigned size = 0;
+};
+
+// Per-frame ring of uniform block data in one uniform buffer. Each frame in flight writes its own region, a fence per region keeps the CPU from overwriting data the GPU still reads.
+// Uses a persistent coherent mapping on OpenGL 4.4+, otherwise a single region that is orphaned every frame and filled with glBufferSubData.
+class UniformRingBuffer final
+{
+public:
+	UniformRingBuffer() = default;
+	~UniformRingBuffer() { Destroy(); }
+
+	// Create with frameSize bytes for each of framesInFlight frames.
+	bool Create(unsigned frameSize, unsigned framesInFlight = DefaultUniformRingFrames);
+	void Destroy();
+
+	// Copy a uniform block into the current frame region and bind that range to the uniform block binding point. Return false if the frame region is full.
+	bool Push(unsigned bindingPoint, const void* data, unsigned size);
+	template<typename T>
+	bool Push(unsigned bindingPoint, const T& block) { return Push(bindingPoint, &block, sizeof(T)); }
+	// Push and return the written range.
+	bool Push(unsigned bindingPoint, const void* data, unsigned size, UniformRingRange& range);
+	// Bind a range pushed in the current frame again. Return false if the range is from an earlier frame, its data may be overwritten.
+	bool BindRange(unsigned bindingPoint, const UniformRingRange& range);
+	bool IsCurrent(const UniformRingRange& range) const { return m_buffer != nullptr && range.frame == m_frameNumber; }
+
+	// Fence the current frame region and move to the next one, waiting for the GPU if it still reads it. Called by RenderSystem::EndFrame().
+	void NextFrame();
+
+	bool IsValid() const { return m_buffer != nullptr; }
+	bool IsPersistent() const { return m_mappedData != nullptr; }
+	unsigned GetFrameSize() const { return m_frameSize; }
+	// Bytes used by the current frame.
+	unsigned GetUsedSize() const { return m_offset; }
+	// Number of the current frame, advanced by NextFrame() and Destroy().
+	uint64_t GetFrameNumber() const { return m_frameNumber; }
+
+private:
+	UniformRingBuffer(UniformRingBuffer&&) = delete;
+	UniformRingBuffer(const UniformRingBuffer&) = delete;
+	UniformRingBuffer& operator=(UniformRingBuffer&&) = delete;
+	UniformRingBuffer& operator=(const UniformRingBuffer&) = delete;
+
+	UniformBufferRef m_buffer;
+	unsigned char* m_mappedData = nullptr;
+	std::vector<GLsync> m_fences;
+	unsigned m_frameSize = 0;
+	unsigned m_alignment = 256;
+	unsigned m_frame = 0;
+	// Offset in the current frame region.
+	unsigned m_offset = 0;
+	// Frames since creation of the first ring, never reset, so that a range of a destroyed ring is not current.
+	uint64_t m_frameNumber = 0;
+	bool m_overflowLogged = false;
+};
\ No newline at end of file
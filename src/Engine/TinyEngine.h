@@ -75,6 +75,10 @@
 //-----------------------------------------------------------------------------
 #include "Core/Logging/Log.h"
 //-----------------------------------------------------------------------------
+// Debug
+//-----------------------------------------------------------------------------
+#include "Core/Debug/Profiler.h"
+//-----------------------------------------------------------------------------
 // Math
 //-----------------------------------------------------------------------------
 #include "Core/Math/MathLib.h"
@@ -112,6 +116,9 @@
 
 #include "RenderAPI/RenderResource.h"
 #include "RenderAPI/RenderSystem.h"
+#include "RenderAPI/RenderQueue.h"
+#include "RenderAPI/ShaderLibrary.h"
+#include "RenderAPI/RenderTrace.h"
 
 //=============================================================================
 // Graphics
@@ -120,12 +127,16 @@
 #include "Graphics/GraphicsResource.h"
 #include "Graphics/GraphicsSystem.h"
 #include "Graphics/DebugDraw.h"
+#include "Graphics/Skinning.h"
+#include "Graphics/AnimationClip.h"
+#include "Graphics/AnimationGraph.h"
 
 //=============================================================================
 // World
 //=============================================================================
 
 #include "World/Camera.h"
+#include "World/Scene.h"
 
 //=============================================================================
 // EngineApp
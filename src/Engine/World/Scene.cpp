@@ -0,0 +1,523 @@
+#include "stdafx.h"
+#include "Scene.h"
+#include "Core/Debug/Profiler.h"
+#include "Core/Logging/Log.h"
+#include "Core/IO/JSONValue.h"
+#include "Core/Threading/JobSystem.h"
+//-----------------------------------------------------------------------------
+// Local transform matrix: translation, then rotation, then scale.
+static glm::mat4 ComposeTransform(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+	return glm::mat4(
+		glm::vec4(rotation * glm::vec3(scale.x, 0.0f, 0.0f), 0.0f),
+		glm::vec4(rotation * glm::vec3(0.0f, scale.y, 0.0f), 0.0f),
+		glm::vec4(rotation * glm::vec3(0.0f, 0.0f, scale.z), 0.0f),
+		glm::vec4(position, 1.0f));
+}
+//-----------------------------------------------------------------------------
+void SceneNode::RegisterObject()
+{
+	RegisterRefAttribute("Name", &SceneNode::GetName, &SceneNode::SetName);
+	RegisterAttribute("Parent", &SceneNode::GetParentIndex, &SceneNode::SetParentIndex, INVALID_SCENE_NODE);
+	RegisterRefAttribute("Position", &SceneNode::GetPosition, &SceneNode::SetPosition, glm::vec3(0.0f));
+	RegisterRefAttribute("Rotation", &SceneNode::GetRotation, &SceneNode::SetRotation, glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+	RegisterRefAttribute("Scale", &SceneNode::GetScale, &SceneNode::SetScale, glm::vec3(1.0f));
+}
+//-----------------------------------------------------------------------------
+void SceneNode::SetNode(Scene* scene, unsigned node)
+{
+	m_scene = scene;
+	m_node = node;
+}
+//-----------------------------------------------------------------------------
+void SceneNode::SetName(const std::string& name)
+{
+	m_scene->SetName(m_node, name);
+}
+//-----------------------------------------------------------------------------
+void SceneNode::SetParentIndex(unsigned index)
+{
+	// Scene::Load() creates the nodes in the saved order in an empty scene, so the saved index is also the node id.
+	// Parents are saved before their children: any other index comes from damaged data and would allow a cycle
+	if (index != INVALID_SCENE_NODE && (index >= m_node || !m_scene->IsValid(index)))
+	{
+		LogError("SceneNode: Invalid parent index " + std::to_string(index) + " of node " + std::to_string(m_node) + ", loaded as a root node");
+		index = INVALID_SCENE_NODE;
+	}
+	m_scene->SetParent(m_node, index);
+}
+//-----------------------------------------------------------------------------
+void SceneNode::SetPosition(const glm::vec3& position)
+{
+	m_scene->SetPosition(m_node, position);
+}
+//-----------------------------------------------------------------------------
+void SceneNode::SetRotation(const glm::quat& rotation)
+{
+	m_scene->SetRotation(m_node, rotation);
+}
+//-----------------------------------------------------------------------------
+void SceneNode::SetScale(const glm::vec3& scale)
+{
+	m_scene->SetScale(m_node, scale);
+}
+//-----------------------------------------------------------------------------
+const std::string& SceneNode::GetName() const
+{
+	return m_scene->GetName(m_node);
+}
+//-----------------------------------------------------------------------------
+unsigned SceneNode::GetParentIndex() const
+{
+	// Scene::Save() writes the nodes in index order
+	return m_scene->m_parents[m_scene->index(m_node)];
+}
+//-----------------------------------------------------------------------------
+const glm::vec3& SceneNode::GetPosition() const
+{
+	return m_scene->GetPosition(m_node);
+}
+//-----------------------------------------------------------------------------
+const glm::quat& SceneNode::GetRotation() const
+{
+	return m_scene->GetRotation(m_node);
+}
+//-----------------------------------------------------------------------------
+const glm::vec3& SceneNode::GetScale() const
+{
+	return m_scene->GetScale(m_node);
+}
+//-----------------------------------------------------------------------------
+Scene::Scene()
+{
+	RegisterSceneLibrary();
+}
+//-----------------------------------------------------------------------------
+void Scene::RegisterObject()
+{
+	RegisterFactory<Scene>();
+}
+//-----------------------------------------------------------------------------
+void Scene::Load(Stream& source, ObjectResolver& resolver)
+{
+	Serializable::Load(source, resolver);
+
+	Clear();
+	const size_t count = source.ReadVLE();
+	Reserve(count);
+	SceneNode node;
+	for (size_t i = 0; i < count; i++)
+	{
+		node.SetNode(this, CreateNode());
+		node.Load(source, resolver);
+	}
+}
+//-----------------------------------------------------------------------------
+void Scene::Save(Stream& dest)
+{
+	Serializable::Save(dest);
+
+	if (m_orderDirty) sortNodes();
+	dest.WriteVLE(m_ids.size());
+	SceneNode node;
+	for (unsigned id : m_ids)
+	{
+		node.SetNode(this, id);
+		node.Save(dest);
+	}
+}
+//-----------------------------------------------------------------------------
+void Scene::LoadJSON(const JSONValue& source, ObjectResolver& resolver)
+{
+	Serializable::LoadJSON(source, resolver);
+
+	Clear();
+	const JSONValue& nodes = source["nodes"];
+	if (!nodes.IsArray()) return;
+
+	Reserve(nodes.Size());
+	SceneNode node;
+	for (size_t i = 0; i < nodes.Size(); i++)
+	{
+		node.SetNode(this, CreateNode());
+		node.LoadJSON(nodes[i], resolver);
+	}
+}
+//-----------------------------------------------------------------------------
+void Scene::SaveJSON(JSONValue& dest)
+{
+	Serializable::SaveJSON(dest);
+
+	if (m_orderDirty) sortNodes();
+	JSONValue& nodes = dest["nodes"];
+	nodes.SetEmptyArray();
+	SceneNode node;
+	for (unsigned id : m_ids)
+	{
+		JSONValue value;
+		node.SetNode(this, id);
+		node.SaveJSON(value);
+		nodes.Push(value);
+	}
+}
+//-----------------------------------------------------------------------------
+unsigned Scene::CreateNode(unsigned parent, const std::string& name)
+{
+	unsigned id;
+	if (!m_freeIds.empty())
+	{
+		id = m_freeIds.back();
+		m_freeIds.pop_back();
+	}
+	else
+	{
+		id = static_cast<unsigned>(m_indices.size());
+		m_indices.push_back(INVALID_SCENE_NODE);
+	}
+
+	const unsigned i = static_cast<unsigned>(m_ids.size());
+	const unsigned parentIndex = parent != INVALID_SCENE_NODE ? index(parent) : INVALID_SCENE_NODE;
+	const unsigned depth = parentIndex != INVALID_SCENE_NODE ? m_depths[parentIndex] + 1 : 0;
+	m_indices[id] = i;
+	m_ids.push_back(id);
+	m_parents.push_back(parentIndex);
+	m_depths.push_back(depth);
+	m_names.push_back(name);
+	m_positions.push_back(glm::vec3(0.0f));
+	m_rotations.push_back(glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+	m_scales.push_back(glm::vec3(1.0f));
+	m_worldTransforms.push_back(glm::mat4(1.0f));
+	m_dirty.push_back(1);
+
+	// Nodes created under their parent level by level stay sorted: append them to the last level or start a new one.
+	// Anything else, e.g. Load() creating root nodes and then setting their parents, sorts once in the next Update()
+	const unsigned levelCount = GetLevelCount();
+	if (!m_orderDirty && depth + 1 >= levelCount && depth <= levelCount)
+	{
+		if (depth == levelCount)
+		{
+			if (m_levels.empty()) m_levels.push_back(0);
+			m_levels.push_back(i + 1);
+		}
+		else
+			m_levels.back() = i + 1;
+		m_firstDirtyLevel = std::min(m_firstDirtyLevel, depth);
+	}
+	else
+		m_orderDirty = true;
+
+	return id;
+}
+//-----------------------------------------------------------------------------
+void Scene::RemoveNode(unsigned node)
+{
+	if (!IsValid(node)) return;
+	if (m_orderDirty) sortNodes();
+
+	// Descendants come after the node in depth order
+	const unsigned target = index(node);
+	const unsigned count = static_cast<unsigned>(m_ids.size());
+	m_removed.assign(count, 0);
+	m_removed[target] = 1;
+	for (unsigned i = target + 1; i < count; i++)
+	{
+		const unsigned parent = m_parents[i];
+		m_removed[i] = parent != INVALID_SCENE_NODE && m_removed[parent];
+	}
+	compactNodes();
+}
+//-----------------------------------------------------------------------------
+void Scene::Clear()
+{
+	m_ids.clear();
+	m_indices.clear();
+	m_freeIds.clear();
+	m_parents.clear();
+	m_depths.clear();
+	m_names.clear();
+	m_positions.clear();
+	m_rotations.clear();
+	m_scales.clear();
+	m_worldTransforms.clear();
+	m_dirty.clear();
+	m_levels.clear();
+	m_firstDirtyLevel = 0;
+	m_orderDirty = false;
+}
+//-----------------------------------------------------------------------------
+void Scene::Reserve(size_t count)
+{
+	m_ids.reserve(count);
+	m_indices.reserve(count);
+	m_parents.reserve(count);
+	m_depths.reserve(count);
+	m_names.reserve(count);
+	m_positions.reserve(count);
+	m_rotations.reserve(count);
+	m_scales.reserve(count);
+	m_worldTransforms.reserve(count);
+	m_dirty.reserve(count);
+}
+//-----------------------------------------------------------------------------
+void Scene::SetParent(unsigned node, unsigned parent)
+{
+	const unsigned i = index(node);
+	const unsigned parentIndex = parent != INVALID_SCENE_NODE ? index(parent) : INVALID_SCENE_NODE;
+	if (m_parents[i] == parentIndex) return;
+
+	if (parentIndex != INVALID_SCENE_NODE && isDescendant(parentIndex, i))
+	{
+		assert(false && "Scene::SetParent() would create a cycle");
+		return;
+	}
+
+	m_parents[i] = parentIndex;
+	m_dirty[i] = 1;
+	m_orderDirty = true;
+}
+//-----------------------------------------------------------------------------
+void Scene::SetPosition(unsigned node, const glm::vec3& position)
+{
+	const unsigned i = index(node);
+	m_positions[i] = position;
+	markDirty(i);
+}
+//-----------------------------------------------------------------------------
+void Scene::SetRotation(unsigned node, const glm::quat& rotation)
+{
+	const unsigned i = index(node);
+	m_rotations[i] = rotation;
+	markDirty(i);
+}
+//-----------------------------------------------------------------------------
+void Scene::SetScale(unsigned node, const glm::vec3& scale)
+{
+	const unsigned i = index(node);
+	m_scales[i] = scale;
+	markDirty(i);
+}
+//-----------------------------------------------------------------------------
+void Scene::SetTransform(unsigned node, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+	const unsigned i = index(node);
+	m_positions[i] = position;
+	m_rotations[i] = rotation;
+	m_scales[i] = scale;
+	markDirty(i);
+}
+//-----------------------------------------------------------------------------
+void Scene::Update(unsigned batchSize)
+{
+	PROFILE_SCOPE("Scene::Update");
+
+	if (m_orderDirty) sortNodes();
+	const unsigned levelCount = GetLevelCount();
+	if (m_firstDirtyLevel >= levelCount) return;
+
+	// Levels above the first dirty node are up to date. Below it, a node is recomputed if it or its parent is dirty,
+	// and stays flagged so that its own children see it: the parent level is complete before the next one starts
+	JobSystem& jobSystem = GetJobSystem();
+	for (unsigned level = m_firstDirtyLevel; level < levelCount; level++)
+	{
+		const unsigned begin = m_levels[level];
+		jobSystem.ParallelFor(m_levels[level + 1] - begin, std::max(batchSize, 1u), [this, begin](size_t first, size_t last)
+		{
+			for (size_t n = begin + first; n < begin + last; n++)
+			{
+				const unsigned parent = m_parents[n];
+				if (!m_dirty[n] && (parent == INVALID_SCENE_NODE || !m_dirty[parent])) continue;
+
+				m_dirty[n] = 1;
+				const glm::mat4 local = ComposeTransform(m_positions[n], m_rotations[n], m_scales[n]);
+				m_worldTransforms[n] = parent != INVALID_SCENE_NODE ? m_worldTransforms[parent] * local : local;
+			}
+		});
+	}
+
+	std::fill(m_dirty.begin() + m_levels[m_firstDirtyLevel], m_dirty.end(), static_cast<uint8_t>(0));
+	m_firstDirtyLevel = levelCount;
+}
+//-----------------------------------------------------------------------------
+unsigned Scene::GetParent(unsigned node) const
+{
+	const unsigned parent = m_parents[index(node)];
+	return parent != INVALID_SCENE_NODE ? m_ids[parent] : INVALID_SCENE_NODE;
+}
+//-----------------------------------------------------------------------------
+void Scene::markDirty(unsigned index)
+{
+	m_dirty[index] = 1;
+	// A pending sort recomputes the first dirty level from the flags
+	if (!m_orderDirty)
+		m_firstDirtyLevel = std::min(m_firstDirtyLevel, m_depths[index]);
+}
+//-----------------------------------------------------------------------------
+template <class T> void Scene::permute(std::vector<T>& values, const std::vector<unsigned>& order)
+{
+	std::vector<T> sorted;
+	sorted.reserve(values.size());
+	for (unsigned i : order)
+		sorted.push_back(std::move(values[i]));
+	values.swap(sorted);
+}
+//-----------------------------------------------------------------------------
+void Scene::sortNodes()
+{
+	PROFILE_SCOPE("Scene::sortNodes");
+
+	computeDepths();
+	const unsigned count = static_cast<unsigned>(m_ids.size());
+	unsigned levelCount = 0;
+	for (unsigned depth : m_depths)
+		levelCount = std::max(levelCount, depth + 1);
+
+	// Counting sort by depth, stable so that siblings keep their creation order
+	m_levels.assign(levelCount + 1, 0);
+	for (unsigned depth : m_depths)
+		m_levels[depth + 1]++;
+	for (unsigned level = 0; level < levelCount; level++)
+		m_levels[level + 1] += m_levels[level];
+
+	m_order.resize(count);
+	m_remap.resize(count);
+	for (unsigned i = 0; i < count; i++)
+	{
+		const unsigned sorted = m_levels[m_depths[i]]++;
+		m_order[sorted] = i;
+		m_remap[i] = sorted;
+	}
+	// The counters now hold the end of each level: shift them back to the starts
+	for (unsigned level = levelCount; level > 0; level--)
+		m_levels[level] = m_levels[level - 1];
+	m_levels[0] = 0;
+	if (!count) m_levels.clear();
+
+	permute(m_ids, m_order);
+	permute(m_parents, m_order);
+	permute(m_depths, m_order);
+	permute(m_names, m_order);
+	permute(m_positions, m_order);
+	permute(m_rotations, m_order);
+	permute(m_scales, m_order);
+	permute(m_worldTransforms, m_order);
+	permute(m_dirty, m_order);
+
+	m_firstDirtyLevel = levelCount;
+	for (unsigned i = 0; i < count; i++)
+	{
+		if (m_parents[i] != INVALID_SCENE_NODE)
+			m_parents[i] = m_remap[m_parents[i]];
+		m_indices[m_ids[i]] = i;
+		if (m_dirty[i])
+			m_firstDirtyLevel = std::min(m_firstDirtyLevel, m_depths[i]);
+	}
+	m_orderDirty = false;
+}
+//-----------------------------------------------------------------------------
+void Scene::computeDepths()
+{
+	const unsigned count = static_cast<unsigned>(m_ids.size());
+	m_depths.assign(count, INVALID_SCENE_NODE);
+
+	// Walk up to the first ancestor with a known depth, then assign the depths on the way back down. m_order is the walk stack
+	for (unsigned i = 0; i < count; i++)
+	{
+		m_order.clear();
+		unsigned node = i;
+		while (node != INVALID_SCENE_NODE && m_depths[node] == INVALID_SCENE_NODE)
+		{
+			m_order.push_back(node);
+			node = m_parents[node];
+		}
+
+		unsigned depth = node != INVALID_SCENE_NODE ? m_depths[node] + 1 : 0;
+		while (!m_order.empty())
+		{
+			m_depths[m_order.back()] = depth++;
+			m_order.pop_back();
+		}
+	}
+}
+//-----------------------------------------------------------------------------
+void Scene::compactNodes()
+{
+	const unsigned count = static_cast<unsigned>(m_ids.size());
+	m_remap.resize(count);
+
+	unsigned kept = 0;
+	for (unsigned i = 0; i < count; i++)
+	{
+		if (m_removed[i])
+		{
+			m_indices[m_ids[i]] = INVALID_SCENE_NODE;
+			m_freeIds.push_back(m_ids[i]);
+			m_remap[i] = INVALID_SCENE_NODE;
+			continue;
+		}
+
+		if (kept != i)
+		{
+			m_ids[kept] = m_ids[i];
+			m_parents[kept] = m_parents[i];
+			m_depths[kept] = m_depths[i];
+			m_names[kept] = std::move(m_names[i]);
+			m_positions[kept] = m_positions[i];
+			m_rotations[kept] = m_rotations[i];
+			m_scales[kept] = m_scales[i];
+			m_worldTransforms[kept] = m_worldTransforms[i];
+			m_dirty[kept] = m_dirty[i];
+		}
+		// Parents come first and are kept, or the node would have been removed with them
+		if (m_parents[kept] != INVALID_SCENE_NODE)
+			m_parents[kept] = m_remap[m_parents[kept]];
+		m_indices[m_ids[kept]] = kept;
+		m_remap[i] = kept++;
+	}
+
+	m_ids.resize(kept);
+	m_parents.resize(kept);
+	m_depths.resize(kept);
+	m_names.resize(kept);
+	m_positions.resize(kept);
+	m_rotations.resize(kept);
+	m_scales.resize(kept);
+	m_worldTransforms.resize(kept);
+	m_dirty.resize(kept);
+	buildLevels();
+}
+//-----------------------------------------------------------------------------
+void Scene::buildLevels()
+{
+	m_levels.clear();
+	for (unsigned i = 0; i < m_depths.size(); i++)
+	{
+		if (i == 0 || m_depths[i] != m_depths[i - 1])
+			m_levels.push_back(i);
+	}
+	if (!m_levels.empty())
+		m_levels.push_back(static_cast<unsigned>(m_depths.size()));
+	m_firstDirtyLevel = std::min(m_firstDirtyLevel, GetLevelCount());
+}
+//-----------------------------------------------------------------------------
+bool Scene::isDescendant(unsigned index, unsigned ancestorIndex) const
+{
+	for (unsigned node = index; node != INVALID_SCENE_NODE; node = m_parents[node])
+	{
+		if (node == ancestorIndex)
+			return true;
+	}
+	return false;
+}
+//-----------------------------------------------------------------------------
+void RegisterSceneLibrary()
+{
+	static bool registered = false;
+	if (registered)
+		return;
+
+	SceneNode::RegisterObject();
+	Scene::RegisterObject();
+
+	registered = true;
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
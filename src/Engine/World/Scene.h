@@ -0,0 +1,146 @@
+#pragma once
+
+#include "Core/Object/Serializable.h"
+
+class Scene;
+
+// Id of a node that is not in the scene, and the parent of root nodes.
+static const unsigned INVALID_SCENE_NODE = 0xFFFFFFFF;
+// Smallest number of nodes updated by one job.
+static const unsigned DEFAULT_SCENE_UPDATE_BATCH_SIZE = 1024;
+
+// Serialization view of one scene node. The node data stays in the arrays of the scene; the attributes "Name", "Parent", "Position", "Rotation" and "Scale" read and write it there.
+// The parent is stored as the index of the parent node in the saved order, which lists parents before their children.
+class SceneNode : public Serializable
+{
+	OBJECT(SceneNode);
+
+public:
+	// Register attributes.
+	static void RegisterObject();
+
+	// Point the view to a node of a scene.
+	void SetNode(Scene* scene, unsigned node);
+
+	void SetName(const std::string& name);
+	void SetParentIndex(unsigned index);
+	void SetPosition(const glm::vec3& position);
+	void SetRotation(const glm::quat& rotation);
+	void SetScale(const glm::vec3& scale);
+
+	const std::string& GetName() const;
+	unsigned GetParentIndex() const;
+	const glm::vec3& GetPosition() const;
+	const glm::quat& GetRotation() const;
+	const glm::vec3& GetScale() const;
+
+private:
+	Scene* m_scene = nullptr;
+	unsigned m_node = INVALID_SCENE_NODE;
+};
+
+// Transform hierarchy of many nodes in SoA form: every node attribute lives in its own array, sorted by depth in the hierarchy so that parents come before their children.
+// Nodes are referred to by stable ids. Changing a local transform marks the node dirty; Update() recomputes the world transforms of dirty nodes and their descendants only, one depth level at a time, each level split across the JobSystem threads.
+class Scene : public Serializable
+{
+	OBJECT(Scene);
+
+public:
+	Scene();
+
+	// Register factory.
+	static void RegisterObject();
+
+	// Load the nodes from a binary stream, replacing the current ones.
+	void Load(Stream& source, ObjectResolver& resolver) override;
+	// Save the nodes to a binary stream.
+	void Save(Stream& dest) override;
+	// Load the nodes from JSON data, replacing the current ones.
+	void LoadJSON(const JSONValue& source, ObjectResolver& resolver) override;
+	// Save the nodes as JSON data.
+	void SaveJSON(JSONValue& dest) override;
+
+	// Create a node with the identity transform under a parent, or as a root node. Return the node id.
+	unsigned CreateNode(unsigned parent = INVALID_SCENE_NODE, const std::string& name = "");
+	// Remove a node and all its descendants.
+	void RemoveNode(unsigned node);
+	// Remove all nodes.
+	void Clear();
+	// Reserve memory for a number of nodes.
+	void Reserve(size_t count);
+	// Move a node under a new parent, or make it a root node. The local transform is kept. The parent must not be the node or one of its descendants.
+	void SetParent(unsigned node, unsigned parent);
+
+	void SetName(unsigned node, const std::string& name) { m_names[index(node)] = name; }
+	void SetPosition(unsigned node, const glm::vec3& position);
+	void SetRotation(unsigned node, const glm::quat& rotation);
+	void SetScale(unsigned node, const glm::vec3& scale);
+	void SetTransform(unsigned node, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+
+	// Recompute the world transforms of the dirty nodes and their descendants, split into batches of at least batchSize nodes per depth level. Call from the main thread.
+	void Update(unsigned batchSize = DEFAULT_SCENE_UPDATE_BATCH_SIZE);
+
+	bool IsValid(unsigned node) const { return node < m_indices.size() && m_indices[node] != INVALID_SCENE_NODE; }
+	unsigned GetParent(unsigned node) const;
+	const std::string& GetName(unsigned node) const { return m_names[index(node)]; }
+	const glm::vec3& GetPosition(unsigned node) const { return m_positions[index(node)]; }
+	const glm::quat& GetRotation(unsigned node) const { return m_rotations[index(node)]; }
+	const glm::vec3& GetScale(unsigned node) const { return m_scales[index(node)]; }
+	// Return the world transform computed by the last Update().
+	const glm::mat4& GetWorldTransform(unsigned node) const { return m_worldTransforms[index(node)]; }
+	glm::vec3 GetWorldPosition(unsigned node) const { return glm::vec3(GetWorldTransform(node)[3]); }
+
+	size_t GetNodeCount() const { return m_ids.size(); }
+	// Return the number of depth levels, valid after Update().
+	unsigned GetLevelCount() const { return m_levels.empty() ? 0 : static_cast<unsigned>(m_levels.size() - 1); }
+	// Return the world transforms of all nodes in depth order, valid after Update().
+	std::span<const glm::mat4> GetWorldTransforms() const { return m_worldTransforms; }
+
+private:
+	friend class SceneNode;
+
+	unsigned index(unsigned node) const { assert(IsValid(node)); return m_indices[node]; }
+	void markDirty(unsigned index);
+	// Restore the depth order after nodes were added, removed or moved.
+	void sortNodes();
+	// Compute the depth of every node, whatever the current order.
+	void computeDepths();
+	// Drop the nodes flagged in m_removed, preserving the order of the others.
+	void compactNodes();
+	// Rebuild m_levels from the depths of sorted nodes.
+	void buildLevels();
+	// Return whether the node at an index is the node at ancestorIndex or one of its descendants.
+	bool isDescendant(unsigned index, unsigned ancestorIndex) const;
+	template <class T> void permute(std::vector<T>& values, const std::vector<unsigned>& order);
+
+	// Node id of each index, and index of each node id (INVALID_SCENE_NODE for free ids).
+	std::vector<unsigned> m_ids;
+	std::vector<unsigned> m_indices;
+	std::vector<unsigned> m_freeIds;
+
+	// Node attributes by index. Parents are indices.
+	std::vector<unsigned> m_parents;
+	std::vector<unsigned> m_depths;
+	std::vector<std::string> m_names;
+	std::vector<glm::vec3> m_positions;
+	std::vector<glm::quat> m_rotations;
+	std::vector<glm::vec3> m_scales;
+	std::vector<glm::mat4> m_worldTransforms;
+	// Nonzero for nodes whose world transform is out of date. During Update() also set for the descendants of dirty nodes.
+	std::vector<uint8_t> m_dirty;
+
+	// First index of each depth level, followed by the node count.
+	std::vector<unsigned> m_levels;
+	// First level containing a dirty node, or the level count if none.
+	unsigned m_firstDirtyLevel = 0;
+	// Whether the nodes are no longer sorted by depth.
+	bool m_orderDirty = false;
+
+	// Scratch arrays of the structural changes.
+	std::vector<unsigned> m_order;
+	std::vector<unsigned> m_remap;
+	std::vector<uint8_t> m_removed;
+};
+
+// Register Scene related object factories and attributes.
+void RegisterSceneLibrary();
\ No newline at end of file
@@ -25,6 +25,7 @@
 #endif
 
 #include <memory>
+#include <atomic>
 #include <algorithm>
 #include <filesystem>
 #include <sstream>
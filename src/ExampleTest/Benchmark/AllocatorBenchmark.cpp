@@ -0,0 +1,117 @@
+﻿#include "stdafx.h"
+#include "AllocatorBenchmark.h"
+#include "BenchmarkCommon.h"
+#include "Engine/Core/Object/Allocator.h"
+#include "Engine/Core/Object/PoolAllocator.h"
+//-----------------------------------------------------------------------------
+namespace
+{
+	constexpr size_t AllocationCount = 100000;
+	constexpr unsigned Runs = 5;
+	// в многопоточном замере каждый поток держит столько блоков одновременно
+	constexpr size_t ThreadBatchSize = 64;
+
+	struct PoolFunctions
+	{
+		explicit PoolFunctions(size_t) {}
+		void* Allocate(size_t size) { return PoolAllocate(size); }
+		void Free(void* ptr, size_t size) { PoolFree(ptr, size); }
+	};
+
+	// Allocator не потокобезопасен, поэтому у каждого потока свой экземпляр
+	struct FixedFunctions
+	{
+		explicit FixedFunctions(size_t size) : block(AllocatorInitialize(size)) {}
+		~FixedFunctions() { AllocatorUninitialize(block); }
+		FixedFunctions(const FixedFunctions&) = delete;
+		FixedFunctions& operator=(const FixedFunctions&) = delete;
+		void* Allocate(size_t) { return AllocatorGet(block); }
+		void Free(void* ptr, size_t) { AllocatorFree(block, ptr); }
+
+		AllocatorBlock* block;
+	};
+
+	struct SystemFunctions
+	{
+		explicit SystemFunctions(size_t) {}
+		void* Allocate(size_t size) { return malloc(size); }
+		void Free(void* ptr, size_t) { free(ptr); }
+	};
+
+	// выделить все блоки, затем освободить все
+	template<typename Functions>
+	double allocateThenFree(std::vector<void*>& pointers, size_t size)
+	{
+		Functions functions(size);
+		return BenchmarkMilliseconds(Runs, [&]()
+		{
+			for (void*& ptr : pointers)
+				ptr = functions.Allocate(size);
+			for (void* ptr : pointers)
+				functions.Free(ptr, size);
+		});
+	}
+
+	// каждый поток выделяет и освобождает пачки блоков
+	template<typename Functions>
+	double threadChurn(unsigned numThreads, size_t size)
+	{
+		std::vector<std::unique_ptr<Functions>> functions;
+		for (unsigned i = 0; i < numThreads; i++)
+			functions.push_back(std::make_unique<Functions>(size));
+
+		return BenchmarkMilliseconds(Runs, [&]()
+		{
+			BenchmarkRunThreads(numThreads, [&](unsigned threadIndex)
+			{
+				Functions& threadFunctions = *functions[threadIndex];
+				void* pointers[ThreadBatchSize];
+				for (size_t i = 0; i < AllocationCount; i += ThreadBatchSize)
+				{
+					for (void*& ptr : pointers)
+						ptr = threadFunctions.Allocate(size);
+					for (void* ptr : pointers)
+						threadFunctions.Free(ptr, size);
+				}
+			});
+		});
+	}
+
+	void printRow(const std::string& name, double poolMs, double fixedMs, double systemMs, size_t operations)
+	{
+		std::cout << "    " << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(1)
+			<< std::setw(8) << poolMs * 1000000.0 / static_cast<double>(operations) << " ns"
+			<< std::setw(8) << fixedMs * 1000000.0 / static_cast<double>(operations) << " ns"
+			<< std::setw(8) << systemMs * 1000000.0 / static_cast<double>(operations) << " ns"
+			<< std::setw(8) << std::setprecision(2) << systemMs / poolMs << "x" << std::endl;
+	}
+}
+//-----------------------------------------------------------------------------
+void AllocatorBenchmark()
+{
+	std::cout << "Pool allocator, time per allocation and free, best of " << Runs << " runs:" << std::endl;
+	std::cout << "    " << std::left << std::setw(24) << "" << std::right << std::setw(11) << "pool" << std::setw(11) << "Allocator" << std::setw(11) << "malloc" << std::setw(9) << "speedup" << std::endl;
+
+	std::vector<void*> pointers(AllocationCount);
+	const size_t sizes[] = { 16, 64, 256, 1024 };
+	for (size_t size : sizes)
+	{
+		const double pool = allocateThenFree<PoolFunctions>(pointers, size);
+		const double fixed = allocateThenFree<FixedFunctions>(pointers, size);
+		const double system = allocateThenFree<SystemFunctions>(pointers, size);
+		printRow(std::to_string(size) + " bytes", pool, fixed, system, AllocationCount);
+	}
+
+	const unsigned numThreads = std::max(2u, std::thread::hardware_concurrency());
+	for (size_t size : { size_t(32), size_t(256) })
+	{
+		const double pool = threadChurn<PoolFunctions>(numThreads, size);
+		const double fixed = threadChurn<FixedFunctions>(numThreads, size);
+		const double system = threadChurn<SystemFunctions>(numThreads, size);
+		printRow(std::to_string(size) + " bytes, " + std::to_string(numThreads) + " threads", pool, fixed, system, AllocationCount * numThreads);
+	}
+
+	const PoolAllocatorStats stats = PoolGetStats();
+	std::cout << "    pool blocks: " << stats.blocks << ", reserved: " << stats.reservedBytes / 1024 << " KB, released: " << PoolReleaseEmptyBlocks() / 1024 << " KB" << std::endl;
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,8 @@
+﻿#pragma once
+
+/*
+Замер пулового аллокатора (PoolAllocate/PoolFree) в сравнении с однопоточным Allocator (AllocatorGet/AllocatorFree) и системным malloc/free.
+Замеряется выделение и освобождение серии блоков разного размера в одном потоке и выделение вперемешку с освобождением в нескольких потоках.
+*/
+
+void AllocatorBenchmark();
\ No newline at end of file
@@ -0,0 +1,175 @@
+﻿#include "stdafx.h"
+#include "AnimationClipBenchmark.h"
+#include "BenchmarkCommon.h"
+#include "Engine/Graphics/AnimationGraph.h"
+//-----------------------------------------------------------------------------
+namespace
+{
+	constexpr unsigned Runs = 5;
+	constexpr int BoneCount = 64;
+	constexpr float KeyRate = 30.0f;
+	const float FrameRate = DEFAULT_BAKED_ANIMATION_FRAME_RATE;
+	constexpr unsigned RandomSampleCount = 4096;
+	constexpr float Durations[] = { 1.0f, 10.0f, 60.0f };
+
+	// локальная поза сгенерированной анимации: корень двигается, каждая вторая кость вращается, остальные дорожки постоянные
+	TempTransform localTransform(int bone, float time)
+	{
+		TempTransform transform = { glm::vec3(0.0f, 0.1f, 0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f) };
+		if (bone == 0)
+			transform.translation = glm::vec3(time, 0.0f, std::sin(time));
+		if (bone % 2 == 0)
+		{
+			const float halfAngle = 0.3f * std::sin(time * 2.0f + bone * 0.1f);
+			transform.rotation = glm::quat(std::cos(halfAngle), std::sin(halfAngle), 0.0f, 0.0f);
+		}
+		return transform;
+	}
+
+	struct GeneratedAnimation
+	{
+		std::vector<NewBoneInfo> bones;
+		std::vector<std::vector<TempTransform>> framePoseData;
+		std::vector<TempTransform*> framePoses;
+		AnimationClip clip;
+		ModelAnimation baked = {};
+		ModelAnimation compressed = {};
+	};
+
+	void generateAnimation(GeneratedAnimation& animation, float duration)
+	{
+		animation.bones.resize(BoneCount);
+		for (int b = 0; b < BoneCount; b++)
+		{
+			snprintf(animation.bones[b].name, sizeof(animation.bones[b].name), "bone%d", b);
+			animation.bones[b].parent = b - 1;
+		}
+
+		// запеченные позы в пространстве модели, как их хранит загрузчик IQM
+		const int frameCount = static_cast<int>(duration * FrameRate) + 1;
+		animation.framePoseData.resize(frameCount);
+		animation.framePoses.resize(frameCount);
+		for (int f = 0; f < frameCount; f++)
+		{
+			std::vector<TempTransform>& pose = animation.framePoseData[f];
+			pose.resize(BoneCount);
+			for (int b = 0; b < BoneCount; b++)
+				pose[b] = localTransform(b, f / FrameRate);
+			BuildPoseFromParentJoints(animation.bones.data(), BoneCount, pose.data());
+			animation.framePoses[f] = pose.data();
+		}
+
+		// ключи клипа с частотой KeyRate, постоянные дорожки сжимаются до одного ключа
+		const int keyCount = static_cast<int>(duration * KeyRate) + 1;
+		std::vector<float> times(keyCount);
+		std::vector<glm::vec3> translations(keyCount), scales(keyCount);
+		std::vector<glm::quat> rotations(keyCount);
+		animation.clip.Create(BoneCount, duration, 1.0f / FrameRate);
+		for (int b = 0; b < BoneCount; b++)
+		{
+			for (int k = 0; k < keyCount; k++)
+			{
+				times[k] = std::min(k / KeyRate, duration);
+				const TempTransform transform = localTransform(b, times[k]);
+				translations[k] = transform.translation;
+				rotations[k] = transform.rotation;
+				scales[k] = transform.scale;
+			}
+			animation.clip.SetTranslation(b, times, translations);
+			animation.clip.SetRotation(b, times, rotations);
+			animation.clip.SetScale(b, times, scales);
+		}
+
+		animation.baked.boneCount = BoneCount;
+		animation.baked.frameCount = frameCount;
+		animation.baked.bones = animation.bones.data();
+		animation.baked.framePoses = animation.framePoses.data();
+		animation.compressed.boneCount = BoneCount;
+		animation.compressed.bones = animation.bones.data();
+		animation.compressed.clip = &animation.clip;
+	}
+
+	// выборок позы за миллисекунду при проигрывании с частотой кадров
+	double playbackRate(const ModelAnimation& animation, float duration)
+	{
+		AnimationPose pose;
+		AnimationCursor cursor;
+		const int sampleCount = static_cast<int>(duration * FrameRate) + 1;
+		const double ms = BenchmarkMilliseconds(Runs, [&]()
+			{
+				cursor.Reset();
+				for (int i = 0; i < sampleCount; i++)
+					SampleAnimation(pose, animation, cursor, i / FrameRate, FrameRate);
+				BenchmarkKeep(pose.rotations[BoneCount - 1]);
+			});
+		return sampleCount / ms;
+	}
+
+	// выборок позы за миллисекунду при переходах в случайное время
+	double randomRate(const ModelAnimation& animation, const std::vector<float>& times)
+	{
+		AnimationPose pose;
+		AnimationCursor cursor;
+		const double ms = BenchmarkMilliseconds(Runs, [&]()
+			{
+				for (float time : times)
+					SampleAnimation(pose, animation, cursor, time, FrameRate);
+				BenchmarkKeep(pose.rotations[BoneCount - 1]);
+			});
+		return times.size() / ms;
+	}
+
+	// наибольшая ошибка поворота клипа относительно запеченных кадров, в градусах
+	float maxRotationError(const GeneratedAnimation& animation)
+	{
+		AnimationPose bakedPose, clipPose;
+		AnimationCursor bakedCursor, clipCursor;
+		float maxError = 0.0f;
+		for (int f = 0; f < animation.baked.frameCount; f++)
+		{
+			const float time = f / FrameRate;
+			SampleAnimation(bakedPose, animation.baked, bakedCursor, time, FrameRate);
+			SampleAnimation(clipPose, animation.compressed, clipCursor, time, FrameRate);
+			for (int b = 0; b < BoneCount; b++)
+			{
+				const float cosHalfAngle = std::min(std::abs(glm::dot(bakedPose.rotations[b], clipPose.rotations[b])), 1.0f);
+				maxError = std::max(maxError, 2.0f * std::acos(cosHalfAngle) * 57.2957795f);
+			}
+		}
+		return maxError;
+	}
+}
+//-----------------------------------------------------------------------------
+void AnimationClipBenchmark()
+{
+	std::cout << "Animation clip vs baked poses, " << BoneCount << " bones, keys at " << KeyRate << " Hz, frames at " << FrameRate << " Hz, best of " << Runs << " runs:" << std::endl;
+	std::cout << "    " << std::setw(8) << "length" << std::setw(12) << "baked KB" << std::setw(12) << "clip KB" << std::setw(10) << "const"
+		<< std::setw(14) << "baked play" << std::setw(14) << "clip play" << std::setw(14) << "baked seek" << std::setw(14) << "clip seek" << std::setw(14) << "max error" << std::endl;
+
+	for (float duration : Durations)
+	{
+		GeneratedAnimation animation;
+		generateAnimation(animation, duration);
+
+		std::vector<float> times(RandomSampleCount);
+		uint32_t seed = 12345;
+		for (float& time : times)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			time = (seed >> 8) * (duration / 16777216.0f);
+		}
+
+		const size_t bakedBytes = animation.framePoseData.size() * (BoneCount * sizeof(TempTransform) + sizeof(TempTransform*));
+		const size_t clipBytes = animation.clip.GetMemorySize();
+		const unsigned trackCount = BoneCount * 3;
+
+		std::cout << "    " << std::fixed << std::setprecision(0) << std::setw(6) << duration << " s"
+			<< std::setw(12) << bakedBytes / 1024.0 << std::setw(12) << std::setprecision(1) << clipBytes / 1024.0
+			<< std::setw(6) << animation.clip.GetConstantTrackCount() << "/" << std::left << std::setw(3) << trackCount << std::right << std::setprecision(0)
+			<< std::setw(14) << playbackRate(animation.baked, duration) << std::setw(14) << playbackRate(animation.compressed, duration)
+			<< std::setw(14) << randomRate(animation.baked, times) << std::setw(14) << randomRate(animation.compressed, times)
+			<< std::setw(10) << std::setprecision(3) << maxRotationError(animation) << " deg" << std::endl;
+	}
+	std::cout << "    play and seek are samples/ms" << std::endl;
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,8 @@
+﻿#pragma once
+
+/*
+Сравнение AnimationClip с запеченными позами (ModelAnimation::framePoses) на сгенерированном скелете.
+Для клипов разной длины печатается занимаемая память и число выборок позы за миллисекунду: при последовательном проигрывании (курсор) и при случайных переходах по времени.
+*/
+
+void AnimationClipBenchmark();
\ No newline at end of file
@@ -0,0 +1,46 @@
+﻿#pragma once
+
+/*
+Общие функции для замеров производительности.
+Замеры запускаются из консоли, без окна, и печатают результат в std::cout.
+*/
+
+#include <chrono>
+#include <iomanip>
+#include <thread>
+
+// лучшее время из нескольких запусков в миллисекундах, перед замером функция запускается один раз для прогрева
+template<typename Func>
+double BenchmarkMilliseconds(unsigned runs, Func&& func)
+{
+	func();
+	double best = std::numeric_limits<double>::max();
+	for (unsigned i = 0; i < runs; i++)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		func();
+		const std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+		best = std::min(best, time.count());
+	}
+	return best;
+}
+
+// запустить func(threadIndex) на нескольких потоках одновременно и дождаться завершения всех
+template<typename Func>
+void BenchmarkRunThreads(unsigned numThreads, Func&& func)
+{
+	std::vector<std::thread> threads;
+	threads.reserve(numThreads);
+	for (unsigned i = 0; i < numThreads; i++)
+		threads.emplace_back([&func, i]() { func(i); });
+	for (std::thread& thread : threads)
+		thread.join();
+}
+
+// не дать компилятору выбросить вычисления, результат которых не используется
+template<typename T>
+void BenchmarkKeep(const T& value)
+{
+	static volatile unsigned char sink;
+	sink = *reinterpret_cast<const volatile unsigned char*>(&value);
+}
\ No newline at end of file
@@ -0,0 +1,115 @@
+﻿#include "stdafx.h"
+#include "CookedModelBenchmark.h"
+#include "BenchmarkCommon.h"
+#include "Engine/Graphics/CookedModel.h"
+#include <filesystem>
+#include <fstream>
+//-----------------------------------------------------------------------------
+namespace
+{
+	constexpr unsigned Runs = 5;
+	constexpr int GeneratedRings = 256;
+	constexpr int GeneratedSegments = 512;
+	const std::string GeneratedFileName = "CookedModelBenchmark.obj";
+
+	// сфера из GeneratedRings x GeneratedSegments четырехугольников, у каждой вершины позиция, нормаль и текстурная координата
+	void writeGeneratedObj()
+	{
+		std::ofstream file(GeneratedFileName);
+		file << std::fixed << std::setprecision(6);
+		for (int r = 0; r <= GeneratedRings; r++)
+		{
+			const float theta = 3.14159265f * r / GeneratedRings;
+			for (int s = 0; s <= GeneratedSegments; s++)
+			{
+				const float phi = 6.28318531f * s / GeneratedSegments;
+				const float x = std::sin(theta) * std::cos(phi), y = std::cos(theta), z = std::sin(theta) * std::sin(phi);
+				file << "v " << x << " " << y << " " << z << "\n";
+				file << "vn " << x << " " << y << " " << z << "\n";
+				file << "vt " << static_cast<float>(s) / GeneratedSegments << " " << static_cast<float>(r) / GeneratedRings << "\n";
+			}
+		}
+		for (int r = 0; r < GeneratedRings; r++)
+		{
+			for (int s = 0; s < GeneratedSegments; s++)
+			{
+				const int a = r * (GeneratedSegments + 1) + s + 1;
+				const int b = a + GeneratedSegments + 1;
+				file << "f " << a << "/" << a << "/" << a << " " << b << "/" << b << "/" << b << " " << a + 1 << "/" << a + 1 << "/" << a + 1 << "\n";
+				file << "f " << a + 1 << "/" << a + 1 << "/" << a + 1 << " " << b << "/" << b << "/" << b << " " << b + 1 << "/" << b + 1 << "/" << b + 1 << "\n";
+			}
+		}
+	}
+
+	void compareLoads(const std::string& fileName)
+	{
+		auto& graphicsSystem = GetGraphicsSystem();
+		auto& trace = GetRenderTrace();
+		const std::string cookedFileName = FileSystem::PathAndFileName(fileName) + COOKED_MODEL_EXTENSION;
+		const std::string pathMaterialFiles = FileSystem::Path(fileName);
+
+		// без кэша: разбор OBJ в tinyobj, удаление дубликатов вершин, загрузка в буферы и запись .tmesh
+		size_t objUploadedBytes = 0;
+		size_t subMeshCount = 0;
+		const double objMs = BenchmarkMilliseconds(Runs, [&]()
+			{
+				std::filesystem::remove(cookedFileName);
+				trace.Clear();
+				StaticModelRef model = graphicsSystem.CreateModel(fileName.c_str(), pathMaterialFiles.c_str(), false);
+				objUploadedBytes = trace.GetUploadedBytes();
+				subMeshCount = model ? model->subMeshes.size() : 0;
+			});
+		if (subMeshCount == 0 || !std::filesystem::exists(cookedFileName))
+		{
+			std::cout << "    could not load or cook " << fileName << std::endl;
+			return;
+		}
+
+		// с кэшем: .tmesh отображается в память и данные передаются в буферы без разбора
+		size_t cookedUploadedBytes = 0;
+		const double cookedMs = BenchmarkMilliseconds(Runs, [&]()
+			{
+				trace.Clear();
+				StaticModelRef model = graphicsSystem.CreateModel(fileName.c_str(), pathMaterialFiles.c_str(), false);
+				cookedUploadedBytes = trace.GetUploadedBytes();
+			});
+
+		std::cout << "Model load, " << fileName << ", " << subMeshCount << " submeshes, Null GL, best of " << Runs << " runs:" << std::endl;
+		std::cout << "    " << std::left << std::setw(10) << "source" << std::right << std::setw(12) << "file KB" << std::setw(14) << "uploaded KB" << std::setw(14) << "load ms" << std::endl;
+		std::cout << "    " << std::left << std::setw(10) << "OBJ" << std::right << std::setw(12) << std::filesystem::file_size(fileName) / 1024
+			<< std::setw(14) << objUploadedBytes / 1024 << std::setw(14) << std::fixed << std::setprecision(2) << objMs << std::endl;
+		std::cout << "    " << std::left << std::setw(10) << "tmesh" << std::right << std::setw(12) << std::filesystem::file_size(cookedFileName) / 1024
+			<< std::setw(14) << cookedUploadedBytes / 1024 << std::setw(14) << cookedMs << std::endl;
+		std::cout << "    speedup " << std::setprecision(1) << objMs / cookedMs << "x, OBJ load includes writing the .tmesh" << std::endl;
+	}
+}
+//-----------------------------------------------------------------------------
+void CookedModelBenchmark()
+{
+	std::cout << "OBJ model file (g - generated sphere): ";
+	std::string fileName;
+	std::cin >> fileName;
+
+	const bool generated = fileName == "g";
+	if (generated)
+	{
+		fileName = GeneratedFileName;
+		writeGeneratedObj();
+	}
+
+	auto& trace = GetRenderTrace();
+	auto& renderSystem = GetRenderSystem();
+	if (trace.Install(RenderTraceMode::Null) && renderSystem.Create({}))
+	{
+		compareLoads(fileName);
+		renderSystem.Destroy();
+	}
+	trace.Uninstall();
+
+	if (generated)
+	{
+		std::filesystem::remove(GeneratedFileName);
+		std::filesystem::remove(FileSystem::PathAndFileName(GeneratedFileName) + COOKED_MODEL_EXTENSION);
+	}
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
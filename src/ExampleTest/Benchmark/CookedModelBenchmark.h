@@ -0,0 +1,8 @@
+﻿#pragma once
+
+/*
+Загрузка OBJ модели через GraphicsSystem::CreateModel() без кэша и из готового файла .tmesh, под Null GL.
+Печатается размер файлов, объем загруженных в буферы данных и время загрузки.
+*/
+
+void CookedModelBenchmark();
\ No newline at end of file
@@ -0,0 +1,164 @@
+﻿#include "stdafx.h"
+#include "InstancingBenchmark.h"
+#include "BenchmarkCommon.h"
+//-----------------------------------------------------------------------------
+#if PLATFORM_DESKTOP
+namespace
+{
+	constexpr unsigned Runs = 10;
+	constexpr unsigned ObjectCounts[] = { 100, 1000, 10000 };
+
+	const char* perDrawVertexShaderText = R"(
+layout(location = 0) in vec3 aPosition;
+
+uniform mat4 ViewProjection;
+uniform mat4 World;
+
+void main()
+{
+	gl_Position = ViewProjection * World * vec4(aPosition, 1.0);
+}
+)";
+
+	const char* instancedVertexShaderText = R"(
+layout(location = 0) in vec3 aPosition;
+layout(location = 4) in mat4 aWorld;
+
+uniform mat4 ViewProjection;
+
+void main()
+{
+	gl_Position = ViewProjection * aWorld * vec4(aPosition, 1.0);
+}
+)";
+
+	const char* fragmentShaderText = R"(
+out vec4 FragmentColor;
+
+void main()
+{
+	FragmentColor = vec4(1.0);
+}
+)";
+
+	// куб из 24 вершин и 12 треугольников
+	StaticModelRef createCube()
+	{
+		StaticMesh mesh;
+		const glm::vec3 normals[] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+		for (const glm::vec3& normal : normals)
+		{
+			const glm::vec3 u = glm::vec3(normal.y, normal.z, normal.x);
+			const glm::vec3 v = glm::cross(normal, u);
+			const uint32_t first = static_cast<uint32_t>(mesh.vertices.size());
+			for (int i = 0; i < 4; i++)
+			{
+				const float su = (i == 1 || i == 2) ? 1.0f : -1.0f;
+				const float sv = i >= 2 ? 1.0f : -1.0f;
+				mesh.vertices.push_back({ normal + u * su + v * sv, normal, glm::vec3(1.0f), glm::vec2(su, sv) * 0.5f + 0.5f });
+			}
+			mesh.indices.insert(mesh.indices.end(), { first, first + 1, first + 2, first, first + 2, first + 3 });
+		}
+		std::vector<StaticMesh> meshes;
+		meshes.push_back(std::move(mesh));
+		return GetGraphicsSystem().CreateModel(std::move(meshes));
+	}
+
+	struct FrameResult
+	{
+		RenderStatistics statistics;
+		unsigned glCalls = 0;
+		double microseconds = 0.0;
+	};
+
+	// выполнить кадр несколько раз, вернуть счетчики последнего кадра и лучшее время
+	template<typename Func>
+	FrameResult measureFrame(Func&& frame)
+	{
+		auto& renderSystem = GetRenderSystem();
+		auto& trace = GetRenderTrace();
+		FrameResult result;
+		result.microseconds = BenchmarkMilliseconds(Runs, [&]()
+			{
+				renderSystem.ResetStatistics();
+				trace.Clear();
+				frame();
+			}) * 1000.0;
+		result.statistics = renderSystem.GetStatistics();
+		for (size_t type = 0; type < static_cast<size_t>(RenderCommandType::Count); type++)
+			result.glCalls += trace.Count(static_cast<RenderCommandType>(type));
+		return result;
+	}
+
+	void printRow(const char* name, unsigned objectCount, const FrameResult& result)
+	{
+		std::cout << "    " << std::left << std::setw(12) << name << std::right << std::setw(8) << objectCount
+			<< std::setw(8) << result.statistics.drawCalls << std::setw(10) << result.statistics.uniformCalls << std::setw(10) << result.glCalls
+			<< std::setw(12) << result.statistics.bytesUploaded / 1024 << std::fixed << std::setprecision(1) << std::setw(12) << result.microseconds << std::endl;
+	}
+}
+#endif
+//-----------------------------------------------------------------------------
+void InstancingBenchmark()
+{
+#if PLATFORM_DESKTOP
+	auto& trace = GetRenderTrace();
+	auto& renderSystem = GetRenderSystem();
+	auto& graphicsSystem = GetGraphicsSystem();
+	if (!trace.Install(RenderTraceMode::Null) || !renderSystem.Create({}))
+	{
+		trace.Uninstall();
+		return;
+	}
+
+	{
+		StaticModelRef model = createCube();
+		ShaderProgramRef perDrawShader = renderSystem.CreateShaderProgram({ perDrawVertexShaderText }, { fragmentShaderText });
+		ShaderProgramRef instancedShader = renderSystem.CreateShaderProgram({ instancedVertexShaderText }, { fragmentShaderText });
+		const Uniform perDrawViewProjection = renderSystem.GetUniform(perDrawShader, "ViewProjection");
+		const Uniform perDrawWorld = renderSystem.GetUniform(perDrawShader, "World");
+		const Uniform instancedViewProjection = renderSystem.GetUniform(instancedShader, "ViewProjection");
+		const glm::mat4 viewProjection(1.0f);
+
+		std::cout << "Per-draw vs instanced submission, one cube model, Null GL, best of " << Runs << " runs:" << std::endl;
+		std::cout << "    " << std::left << std::setw(12) << "path" << std::right << std::setw(8) << "objects" << std::setw(8) << "draws"
+			<< std::setw(10) << "uniforms" << std::setw(10) << "GL calls" << std::setw(12) << "upload KB" << std::setw(12) << "CPU us" << std::endl;
+
+		for (unsigned objectCount : ObjectCounts)
+		{
+			std::vector<glm::mat4> transforms(objectCount);
+			for (unsigned i = 0; i < objectCount; i++)
+			{
+				transforms[i] = glm::mat4(1.0f);
+				transforms[i][3] = glm::vec4(static_cast<float>(i % 100) * 3.0f, 0.0f, static_cast<float>(i / 100) * 3.0f, 1.0f);
+			}
+
+			// одна отрисовка и одна матрица uniform на объект
+			const FrameResult perDraw = measureFrame([&]()
+				{
+					renderSystem.Bind(perDrawShader);
+					renderSystem.SetUniform(perDrawViewProjection, viewProjection);
+					for (const glm::mat4& transform : transforms)
+					{
+						renderSystem.SetUniform(perDrawWorld, transform);
+						graphicsSystem.Draw(model);
+					}
+				});
+			// матрицы уходят одним обновлением буфера экземпляров, одна отрисовка на подсетку
+			const FrameResult instanced = measureFrame([&]()
+				{
+					renderSystem.Bind(instancedShader);
+					renderSystem.SetUniform(instancedViewProjection, viewProjection);
+					graphicsSystem.DrawInstanced(model, transforms);
+				});
+
+			printRow("per draw", objectCount, perDraw);
+			printRow("instanced", objectCount, instanced);
+		}
+	}
+
+	renderSystem.Destroy();
+	trace.Uninstall();
+#endif
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,8 @@
+﻿#pragma once
+
+/*
+Отрисовка множества копий модели под Null GL: GraphicsSystem::Draw() с матрицей в uniform на каждый объект против GraphicsSystem::DrawInstanced().
+Печатается число отрисовок, вызовов uniform и всех вызовов GL за кадр по RenderStatistics и RenderTrace, объем загруженных данных и время кадра на процессоре.
+*/
+
+void InstancingBenchmark();
\ No newline at end of file
@@ -0,0 +1,60 @@
+﻿#include "stdafx.h"
+#include "JobSystemBenchmark.h"
+#include "BenchmarkCommon.h"
+#include "Engine/Core/Threading/JobSystem.h"
+//-----------------------------------------------------------------------------
+namespace
+{
+	constexpr size_t ElementCount = 1 << 22;
+	constexpr size_t MinBatchSize = 4096;
+	constexpr unsigned SmallJobCount = 10000;
+	constexpr unsigned Runs = 5;
+
+	void computeRange(std::vector<float>& values, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			const float x = static_cast<float>(i) * 0.001f;
+			values[i] = std::sqrt(x) * std::sin(x) + std::cos(x * 0.5f);
+		}
+	}
+}
+//-----------------------------------------------------------------------------
+void JobSystemBenchmark()
+{
+	std::vector<float> values(ElementCount);
+	const double serial = BenchmarkMilliseconds(Runs, [&]() { computeRange(values, 0, values.size()); });
+	BenchmarkKeep(values[ElementCount / 2]);
+
+	std::cout << "JobSystem scaling, best of " << Runs << " runs:" << std::endl;
+	std::cout << "    plain loop over " << ElementCount << " elements: " << std::fixed << std::setprecision(2) << serial << " ms" << std::endl;
+	std::cout << "    " << std::setw(8) << "workers" << std::setw(15) << "ParallelFor" << std::setw(10) << "speedup" << std::setw(14) << "small job" << std::endl;
+
+	const unsigned maxWorkers = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+	for (unsigned workers = 1; workers <= maxWorkers; workers = workers < 4 ? workers + 1 : workers * 2)
+	{
+		JobSystem jobSystem;
+		jobSystem.Create({ .numThreads = workers });
+
+		const double parallel = BenchmarkMilliseconds(Runs, [&]()
+		{
+			jobSystem.ParallelFor(values.size(), MinBatchSize, [&](size_t begin, size_t end) { computeRange(values, begin, end); });
+		});
+		BenchmarkKeep(values[ElementCount / 2]);
+
+		// накладные расходы на задачу: запуск и ожидание задач без работы
+		std::atomic<unsigned> executed = 0;
+		const double smallJobs = BenchmarkMilliseconds(Runs, [&]()
+		{
+			JobCounter counter;
+			for (unsigned i = 0; i < SmallJobCount; i++)
+				jobSystem.Run([&executed]() { executed.fetch_add(1, std::memory_order_relaxed); }, &counter);
+			jobSystem.Wait(counter);
+		});
+
+		std::cout << "    " << std::setw(8) << workers << std::setw(12) << parallel << " ms" << std::setw(9) << serial / parallel << "x"
+			<< std::setw(11) << smallJobs * 1000000.0 / SmallJobCount << " ns" << std::endl;
+		jobSystem.Destroy();
+	}
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
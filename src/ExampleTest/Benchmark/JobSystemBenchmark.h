@@ -0,0 +1,8 @@
+﻿#pragma once
+
+/*
+Замер масштабирования JobSystem по числу рабочих потоков.
+Для каждого числа потоков замеряется ParallelFor над большим массивом (в сравнении с обычным циклом) и накладные расходы на запуск множества мелких задач.
+*/
+
+void JobSystemBenchmark();
\ No newline at end of file
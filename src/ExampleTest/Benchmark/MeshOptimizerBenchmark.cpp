@@ -0,0 +1,128 @@
+﻿#include "stdafx.h"
+#include "MeshOptimizerBenchmark.h"
+#include "BenchmarkCommon.h"
+#include "Engine/Graphics/MeshOptimizer.h"
+//-----------------------------------------------------------------------------
+namespace
+{
+	constexpr unsigned Runs = 5;
+	constexpr uint32_t GridSize = 256;
+
+	struct GeneratedMesh
+	{
+		std::string name;
+		std::vector<float> positions;
+		std::vector<uint32_t> indices;
+		size_t vertexCount() const { return positions.size() / 3; }
+	};
+
+	// сетка GridSize x GridSize четырехугольников, треугольники идут по строкам
+	GeneratedMesh gridMesh()
+	{
+		GeneratedMesh mesh;
+		mesh.name = "grid rows";
+		for (uint32_t y = 0; y <= GridSize; y++)
+		{
+			for (uint32_t x = 0; x <= GridSize; x++)
+				mesh.positions.insert(mesh.positions.end(), { static_cast<float>(x), 0.0f, static_cast<float>(y) });
+		}
+		for (uint32_t y = 0; y < GridSize; y++)
+		{
+			for (uint32_t x = 0; x < GridSize; x++)
+			{
+				const uint32_t a = y * (GridSize + 1) + x;
+				const uint32_t b = a + GridSize + 1;
+				mesh.indices.insert(mesh.indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+			}
+		}
+		return mesh;
+	}
+
+	// та же сетка с треугольниками в случайном порядке, как после экспорта без оптимизации
+	GeneratedMesh shuffledGridMesh()
+	{
+		GeneratedMesh mesh = gridMesh();
+		mesh.name = "grid shuffled";
+		const size_t triangleCount = mesh.indices.size() / 3;
+		uint32_t seed = 12345;
+		for (size_t i = triangleCount - 1; i > 0; i--)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			const size_t j = (seed >> 8) % (i + 1);
+			for (size_t k = 0; k < 3; k++)
+				std::swap(mesh.indices[i * 3 + k], mesh.indices[j * 3 + k]);
+		}
+		return mesh;
+	}
+
+	// сфера, вершины по кольцам, треугольники идут полосами вдоль меридианов
+	GeneratedMesh sphereMesh()
+	{
+		constexpr uint32_t Rings = 128, Segments = 256;
+		GeneratedMesh mesh;
+		mesh.name = "sphere columns";
+		for (uint32_t r = 0; r <= Rings; r++)
+		{
+			const float theta = 3.14159265f * r / Rings;
+			for (uint32_t s = 0; s <= Segments; s++)
+			{
+				const float phi = 6.28318531f * s / Segments;
+				mesh.positions.insert(mesh.positions.end(), { std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi) });
+			}
+		}
+		for (uint32_t s = 0; s < Segments; s++)
+		{
+			for (uint32_t r = 0; r < Rings; r++)
+			{
+				const uint32_t a = r * (Segments + 1) + s;
+				const uint32_t b = a + Segments + 1;
+				mesh.indices.insert(mesh.indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+			}
+		}
+		return mesh;
+	}
+
+	void printStatistics(const VertexCacheStatistics& statistics)
+	{
+		std::cout << std::setw(8) << statistics.acmr << std::setw(7) << statistics.atvr;
+	}
+
+	void optimizeMesh(const GeneratedMesh& mesh)
+	{
+		const size_t indexCount = mesh.indices.size();
+		const size_t vertexCount = mesh.vertexCount();
+		std::vector<uint32_t> cacheOptimized(indexCount), overdrawOptimized(indexCount);
+		std::vector<uint32_t> clusters;
+
+		// порядок шагов как в OptimizeMesh(): сначала кэш вершин, затем порядок кластеров для перерисовки
+		const double cacheMs = BenchmarkMilliseconds(Runs, [&]()
+			{
+				clusters.clear();
+				OptimizeVertexCache(cacheOptimized.data(), mesh.indices.data(), indexCount, vertexCount, DEFAULT_VERTEX_CACHE_SIZE, &clusters);
+			});
+		const double overdrawMs = BenchmarkMilliseconds(Runs, [&]()
+			{
+				OptimizeOverdraw(overdrawOptimized.data(), cacheOptimized.data(), indexCount, mesh.positions.data(), 3 * sizeof(float), vertexCount, clusters);
+			});
+
+		std::cout << "    " << std::left << std::setw(16) << mesh.name << std::right << std::setw(8) << indexCount / 3 << std::fixed << std::setprecision(3);
+		printStatistics(AnalyzeVertexCache(mesh.indices.data(), indexCount, vertexCount));
+		printStatistics(AnalyzeVertexCache(cacheOptimized.data(), indexCount, vertexCount));
+		printStatistics(AnalyzeVertexCache(overdrawOptimized.data(), indexCount, vertexCount));
+		std::cout << std::setprecision(2) << std::setw(10) << cacheMs << std::setw(10) << overdrawMs << std::endl;
+	}
+}
+//-----------------------------------------------------------------------------
+void MeshOptimizerBenchmark()
+{
+	std::cout << "Mesh optimizer, FIFO cache of " << DEFAULT_VERTEX_CACHE_SIZE << " vertices, best of " << Runs << " runs:" << std::endl;
+	std::cout << "    " << std::left << std::setw(16) << "mesh" << std::right << std::setw(8) << "tris"
+		<< std::setw(15) << "source" << std::setw(15) << "vertex cache" << std::setw(15) << "overdraw"
+		<< std::setw(10) << "cache ms" << std::setw(10) << "over ms" << std::endl;
+	std::cout << "    " << std::setw(24) << "" << std::setw(8) << "ACMR" << std::setw(7) << "ATVR" << std::setw(8) << "ACMR" << std::setw(7) << "ATVR" << std::setw(8) << "ACMR" << std::setw(7) << "ATVR" << std::endl;
+
+	optimizeMesh(gridMesh());
+	optimizeMesh(shuffledGridMesh());
+	optimizeMesh(sphereMesh());
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
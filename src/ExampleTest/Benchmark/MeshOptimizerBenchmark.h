@@ -0,0 +1,8 @@
+﻿#pragma once
+
+/*
+Эффективность кэша вершин (ACMR и ATVR) на сгенерированных сетках до оптимизации, после OptimizeVertexCache() и после OptimizeOverdraw(), и время каждого шага.
+Сетки строятся в памяти, окно и контекст OpenGL не нужны.
+*/
+
+void MeshOptimizerBenchmark();
\ No newline at end of file
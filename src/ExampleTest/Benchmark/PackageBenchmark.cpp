@@ -0,0 +1,181 @@
+﻿#include "stdafx.h"
+#include "PackageBenchmark.h"
+#include "BenchmarkCommon.h"
+#include "Engine/Core/IO/File.h"
+#include "Engine/Core/IO/MemoryMappedStream.h"
+#include "Engine/Core/Resource/ResourceCache.h"
+#include <filesystem>
+//-----------------------------------------------------------------------------
+namespace
+{
+	constexpr unsigned Runs = 5;
+	constexpr unsigned FileCount = 2000;
+	constexpr unsigned DirectoryCount = 4;
+	const std::string WorkDirectory = "PackageBenchmark";
+
+	// файлы от 256 байт до 16 КБ с повторяющимся содержимым, чтобы LZ4 было что сжимать
+	std::vector<PackageSource> createFiles()
+	{
+		std::vector<PackageSource> sources;
+		std::vector<unsigned char> data;
+		uint32_t seed = 12345;
+		for (unsigned i = 0; i < FileCount; i++)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			data.resize(256 + (seed >> 8) % (16 * 1024 - 256));
+			for (size_t j = 0; j < data.size(); j++)
+				data[j] = static_cast<unsigned char>((j / 16 + i) % 64);
+
+			const std::string name = "Dir" + std::to_string(i % DirectoryCount) + "/File" + std::to_string(i) + ".bin";
+			const std::string fileName = WorkDirectory + "/Loose/" + name;
+			std::filesystem::create_directories(std::filesystem::path(fileName).parent_path());
+			File file(fileName, FILE_WRITE);
+			file.Write(data.data(), data.size());
+			sources.push_back({ name, fileName });
+		}
+		return sources;
+	}
+
+	// открыть и прочитать все файлы через ResourceCache, вернуть время в миллисекундах
+	double readAll(ResourceCache& cache, const std::vector<PackageSource>& sources, size_t& totalBytes)
+	{
+		std::vector<unsigned char> buffer;
+		return BenchmarkMilliseconds(Runs, [&]()
+			{
+				totalBytes = 0;
+				for (const PackageSource& source : sources)
+				{
+					AutoPtr<Stream> stream = cache.OpenResource(source.name);
+					buffer.resize(stream->Size());
+					totalBytes += stream->Read(buffer.data(), buffer.size());
+				}
+				BenchmarkKeep(buffer[0]);
+			});
+	}
+
+	// проверить наличие всех файлов, вернуть время в миллисекундах
+	double existsAll(ResourceCache& cache, const std::vector<PackageSource>& sources)
+	{
+		return BenchmarkMilliseconds(Runs, [&]()
+			{
+				unsigned found = 0;
+				for (const PackageSource& source : sources)
+					found += cache.Exists(source.name) ? 1 : 0;
+				BenchmarkKeep(found);
+			});
+	}
+
+	// сумма каждого 64-го байта, загрузчик так или иначе проходит по всем данным файла
+	unsigned touchData(const unsigned char* data, size_t size)
+	{
+		unsigned sum = 0;
+		for (size_t i = 0; i < size; i += 64)
+			sum += data[i];
+		return sum;
+	}
+
+	// загрузка целого файла: копия через File, как в прежнем LoadFileData(), копия из отображения, как у ResourceCache, и разбор прямо в отображении, как у загрузчиков моделей
+	void mappedVsCopied()
+	{
+		constexpr size_t Sizes[] = { 64 * 1024, 1024 * 1024, 32 * 1024 * 1024 };
+		std::cout << "Whole file load, warm file cache, best of " << Runs << " runs:" << std::endl;
+		std::cout << "    " << std::setw(10) << "size KB" << std::setw(14) << "File copy" << std::setw(14) << "mapped copy" << std::setw(14) << "mapped view" << std::endl;
+
+		std::vector<unsigned char> data;
+		for (size_t size : Sizes)
+		{
+			const std::string fileName = WorkDirectory + "/Whole" + std::to_string(size) + ".bin";
+			data.resize(size);
+			for (size_t i = 0; i < size; i++)
+				data[i] = static_cast<unsigned char>(i * 7 + i / 4096);
+			{
+				File file(fileName, FILE_WRITE);
+				file.Write(data.data(), data.size());
+			}
+
+			std::vector<unsigned char> buffer;
+			const double fileMs = BenchmarkMilliseconds(Runs, [&]()
+				{
+					File file(fileName);
+					buffer.resize(file.Size());
+					file.Read(buffer.data(), buffer.size());
+					BenchmarkKeep(touchData(buffer.data(), buffer.size()));
+				});
+			const double mappedCopyMs = BenchmarkMilliseconds(Runs, [&]()
+				{
+					MemoryMappedStream stream(fileName);
+					buffer.resize(stream.Size());
+					stream.Read(buffer.data(), buffer.size());
+					BenchmarkKeep(touchData(buffer.data(), buffer.size()));
+				});
+			const double mappedViewMs = BenchmarkMilliseconds(Runs, [&]()
+				{
+					MemoryMappedStream stream(fileName);
+					BenchmarkKeep(touchData(stream.Data(), stream.Size()));
+				});
+
+			std::cout << "    " << std::setw(10) << size / 1024 << std::fixed << std::setprecision(3)
+				<< std::setw(11) << fileMs << " ms" << std::setw(11) << mappedCopyMs << " ms" << std::setw(11) << mappedViewMs << " ms" << std::endl;
+		}
+	}
+
+	void printRow(const char* name, unsigned fileOpens, double existsMs, double readMs, size_t totalBytes)
+	{
+		std::cout << "    " << std::left << std::setw(18) << name << std::right << std::setw(12) << fileOpens
+			<< std::fixed << std::setprecision(2) << std::setw(14) << existsMs * 1000000.0 / FileCount << std::setw(14) << readMs * 1000000.0 / FileCount
+			<< std::setw(12) << std::setprecision(0) << totalBytes / 1024.0 / (readMs / 1000.0) / 1024.0 << std::endl;
+	}
+}
+//-----------------------------------------------------------------------------
+void PackageBenchmark()
+{
+	std::filesystem::remove_all(WorkDirectory);
+	const std::vector<PackageSource> sources = createFiles();
+	const std::string packageName = WorkDirectory + "/Data.tpak";
+	const std::string compressedName = WorkDirectory + "/DataLZ4.tpak";
+	if (!PackageFile::Write(packageName, sources, false) || !PackageFile::Write(compressedName, sources, true))
+	{
+		std::cout << "    could not write packages to " << WorkDirectory << std::endl;
+		std::filesystem::remove_all(WorkDirectory);
+		return;
+	}
+
+	std::cout << "Resource packages, " << FileCount << " files in " << DirectoryCount << " directories, warm file cache, best of " << Runs << " runs:" << std::endl;
+	std::cout << "    " << std::left << std::setw(18) << "source" << std::right << std::setw(12) << "file opens"
+		<< std::setw(14) << "exists ns" << std::setw(14) << "open+read ns" << std::setw(12) << "MB/s" << std::endl;
+
+	{
+		ResourceCache cache;
+		size_t totalBytes = 0;
+
+		// каждый каталог ресурсов - отдельный путь поиска, файлы последнего каталога проверяются во всех
+		for (unsigned d = 0; d < DirectoryCount; d++)
+			cache.AddResourceDir(WorkDirectory + "/Loose/Dir" + std::to_string(d));
+		std::vector<PackageSource> looseSources = sources;
+		for (PackageSource& source : looseSources)
+			source.name = FileSystem::FileNameAndExtension(source.name);
+		const double looseExistsMs = existsAll(cache, looseSources);
+		const double looseReadMs = readAll(cache, looseSources, totalBytes);
+		printRow("loose files", FileCount, looseExistsMs, looseReadMs, totalBytes);
+
+		// пакет один раз отображается в память при подключении, поиск идет по оглавлению внутри отображения
+		cache.AddPackageFile(packageName);
+		const double packageExistsMs = existsAll(cache, sources);
+		const double packageReadMs = readAll(cache, sources, totalBytes);
+		printRow("package", 1, packageExistsMs, packageReadMs, totalBytes);
+		cache.RemovePackageFile(packageName);
+
+		cache.AddPackageFile(compressedName);
+		const double compressedExistsMs = existsAll(cache, sources);
+		const double compressedReadMs = readAll(cache, sources, totalBytes);
+		printRow("package LZ4", 1, compressedExistsMs, compressedReadMs, totalBytes);
+		cache.RemovePackageFile(compressedName);
+	}
+
+	std::cout << "    package size " << std::filesystem::file_size(packageName) / 1024 << " KB, LZ4 " << std::filesystem::file_size(compressedName) / 1024 << " KB" << std::endl;
+	std::cout << "    file opens: mappings created to read all files; exists and open+read are per file" << std::endl;
+
+	mappedVsCopied();
+	std::filesystem::remove_all(WorkDirectory);
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
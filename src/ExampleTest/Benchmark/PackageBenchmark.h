@@ -0,0 +1,9 @@
+﻿#pragma once
+
+/*
+Чтение ресурсов через ResourceCache: отдельные файлы в нескольких каталогах против пакета TPAK без сжатия и с LZ4.
+Печатается число созданных отображений файлов, время проверки наличия и время открытия с чтением на один файл.
+Затем загрузка целого файла разного размера: копия через File, копия из отображения и чтение прямо из отображения.
+*/
+
+void PackageBenchmark();
\ No newline at end of file
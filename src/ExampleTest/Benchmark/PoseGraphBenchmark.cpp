@@ -0,0 +1,149 @@
+﻿#include "stdafx.h"
+#include "PoseGraphBenchmark.h"
+#include "BenchmarkCommon.h"
+#include "Engine/Graphics/AnimationGraph.h"
+//-----------------------------------------------------------------------------
+namespace
+{
+	constexpr unsigned Runs = 10;
+	constexpr int BoneCount = 64;
+	constexpr float Duration = 2.0f;
+	constexpr float KeyRate = 30.0f;
+	constexpr float FrameTime = 1.0f / 60.0f;
+	constexpr unsigned InstanceCounts[] = { 256, 1024, 4096 };
+
+	// клип на цепочке костей: каждая кость качается вокруг оси X с амплитудой amplitude и своей фазой
+	void generateClip(AnimationClip& clip, float amplitude, float phase)
+	{
+		const int keyCount = static_cast<int>(Duration * KeyRate) + 1;
+		std::vector<float> times(keyCount);
+		std::vector<glm::vec3> translations(keyCount, glm::vec3(0.0f, 0.1f, 0.0f));
+		std::vector<glm::quat> rotations(keyCount);
+		clip.Create(BoneCount, Duration, FrameTime);
+		for (int b = 0; b < BoneCount; b++)
+		{
+			for (int k = 0; k < keyCount; k++)
+			{
+				times[k] = std::min(k / KeyRate, Duration);
+				const float halfAngle = amplitude * std::sin(times[k] * 3.0f + b * 0.1f + phase);
+				rotations[k] = glm::quat(std::cos(halfAngle), std::sin(halfAngle), 0.0f, 0.0f);
+			}
+			clip.SetTranslation(b, times, translations);
+			clip.SetRotation(b, times, rotations);
+		}
+	}
+
+	struct GeneratedAnimations
+	{
+		std::vector<NewBoneInfo> bones;
+		AnimationClip clips[3];
+		ModelAnimation animations[3] = {};
+	};
+
+	// ходьба и бег смешиваются, поверх добавляется наклон относительно его первого кадра
+	void generateAnimations(GeneratedAnimations& generated)
+	{
+		generated.bones.resize(BoneCount);
+		for (int b = 0; b < BoneCount; b++)
+		{
+			snprintf(generated.bones[b].name, sizeof(generated.bones[b].name), "bone%d", b);
+			generated.bones[b].parent = b - 1;
+		}
+		generateClip(generated.clips[0], 0.2f, 0.0f);
+		generateClip(generated.clips[1], 0.4f, 1.0f);
+		generateClip(generated.clips[2], 0.1f, 2.0f);
+		for (int i = 0; i < 3; i++)
+		{
+			generated.animations[i].boneCount = BoneCount;
+			generated.animations[i].bones = generated.bones.data();
+			generated.animations[i].clip = &generated.clips[i];
+		}
+	}
+
+	struct GraphNodes
+	{
+		unsigned walk, run, blend, lean, leanReference, additive;
+	};
+
+	GraphNodes createGraph(PoseGraph& graph, const GeneratedAnimations& generated)
+	{
+		GraphNodes nodes;
+		graph.Create(generated.bones.data(), BoneCount);
+		nodes.walk = graph.AddSample(&generated.animations[0]);
+		nodes.run = graph.AddSample(&generated.animations[1]);
+		nodes.blend = graph.AddBlend(nodes.walk, nodes.run);
+		nodes.lean = graph.AddSample(&generated.animations[2]);
+		nodes.leanReference = graph.AddSample(&generated.animations[2]);
+		nodes.additive = graph.AddAdditive(nodes.blend, nodes.lean, nodes.leanReference);
+		return nodes;
+	}
+
+	// время и веса экземпляра в кадре, у каждого экземпляра своя фаза
+	void setParameters(PoseGraphInstance& instance, const GraphNodes& nodes, unsigned index, unsigned frame)
+	{
+		const float time = std::fmod(frame * FrameTime + index * 0.01f, Duration);
+		instance.SetParameter(nodes.walk, time);
+		instance.SetParameter(nodes.run, time);
+		instance.SetParameter(nodes.blend, static_cast<float>(index % 8) / 7.0f);
+		instance.SetParameter(nodes.lean, time);
+		instance.SetParameter(nodes.leanReference, 0.0f);
+		instance.SetParameter(nodes.additive, 0.5f);
+	}
+}
+//-----------------------------------------------------------------------------
+void PoseGraphBenchmark()
+{
+	GeneratedAnimations generated;
+	generateAnimations(generated);
+
+	JobSystem& jobSystem = GetJobSystem();
+	jobSystem.Create({});
+
+	{
+		PoseGraph graph;
+		const GraphNodes nodes = createGraph(graph, generated);
+		// пул поз по потокам создается один раз, после построения графа и запуска JobSystem
+		graph.Prepare();
+
+		std::cout << "Pose graph, " << graph.GetNodeCount() << " nodes, " << BoneCount << " bones, " << jobSystem.GetNumThreads() << " job threads, best of " << Runs << " runs:" << std::endl;
+		std::cout << "    " << std::setw(10) << "instances" << std::setw(14) << "1 thread ms" << std::setw(12) << "jobs ms" << std::setw(10) << "speedup"
+			<< std::setw(16) << "1 thread inst/ms" << std::setw(14) << "jobs inst/ms" << std::endl;
+
+		for (unsigned instanceCount : InstanceCounts)
+		{
+			std::vector<PoseGraphInstance> instances(instanceCount);
+			std::vector<PoseGraphInstance*> instancePointers(instanceCount);
+			for (unsigned i = 0; i < instanceCount; i++)
+			{
+				instances[i].Create(graph);
+				instancePointers[i] = &instances[i];
+			}
+
+			// каждый запуск - следующий кадр, курсоры экземпляров идут вперед как при проигрывании
+			unsigned frame = 0;
+			const double singleMs = BenchmarkMilliseconds(Runs, [&]()
+				{
+					frame++;
+					for (unsigned i = 0; i < instanceCount; i++)
+					{
+						setParameters(instances[i], nodes, i, frame);
+						graph.Evaluate(instances[i]);
+					}
+				});
+			const double jobsMs = BenchmarkMilliseconds(Runs, [&]()
+				{
+					frame++;
+					for (unsigned i = 0; i < instanceCount; i++)
+						setParameters(instances[i], nodes, i, frame);
+					graph.Evaluate(instancePointers);
+				});
+			BenchmarkKeep(instances[instanceCount / 2].GetModelPose()[BoneCount - 1]);
+
+			std::cout << "    " << std::setw(10) << instanceCount << std::fixed << std::setprecision(3) << std::setw(14) << singleMs << std::setw(12) << jobsMs
+				<< std::setprecision(2) << std::setw(9) << singleMs / jobsMs << "x" << std::setprecision(0) << std::setw(16) << instanceCount / singleMs << std::setw(14) << instanceCount / jobsMs << std::endl;
+		}
+	}
+
+	jobSystem.Destroy();
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,8 @@
+﻿#pragma once
+
+/*
+Замер PoseGraph на сгенерированном скелете: N экземпляров с одним графом смешивания вычисляются в одном потоке (Evaluate() каждого экземпляра) и пакетами на потоках JobSystem.
+Печатается время кадра, экземпляров за миллисекунду и ускорение.
+*/
+
+void PoseGraphBenchmark();
\ No newline at end of file
@@ -0,0 +1,127 @@
+﻿#include "stdafx.h"
+#include "RefCountBenchmark.h"
+#include "BenchmarkCommon.h"
+#include "Engine/Core/Object/Ptr.h"
+//-----------------------------------------------------------------------------
+namespace
+{
+	constexpr size_t CopyCount = 1000000;
+	constexpr unsigned Runs = 5;
+
+	class BenchmarkObject final : public RefCounted
+	{
+	public:
+		int value = 0;
+	};
+
+	// объект со встроенным счетчиком заданной политики, чтобы обе политики замерялись в одной сборке
+	template<typename Policy>
+	struct PolicyObject
+	{
+		typename Policy::Counter refs{ 0 };
+		int value = 0;
+	};
+
+	// минимальный интрузивный указатель на PolicyObject, копирование и уничтожение как у SharedPtr
+	template<typename Policy>
+	class PolicyPtr
+	{
+	public:
+		explicit PolicyPtr(PolicyObject<Policy>* object) : m_object(object) { Policy::Increment(m_object->refs); }
+		PolicyPtr(const PolicyPtr& other) : m_object(other.m_object) { Policy::Increment(m_object->refs); }
+		~PolicyPtr()
+		{
+			if (Policy::Decrement(m_object->refs) == 0)
+				delete m_object;
+		}
+		PolicyPtr& operator=(const PolicyPtr&) = delete;
+
+	private:
+		PolicyObject<Policy>* m_object;
+	};
+
+	// скопировать и уничтожить указатель CopyCount раз
+	template<typename Pointer>
+	void copyPointer(const Pointer& source)
+	{
+		for (size_t i = 0; i < CopyCount; i++)
+		{
+			Pointer copy(source);
+			BenchmarkKeep(copy);
+		}
+	}
+
+	template<typename Pointer>
+	double singleThread(const Pointer& source)
+	{
+		return BenchmarkMilliseconds(Runs, [&]() { copyPointer(source); });
+	}
+
+	// каждый поток копирует указатель на свой объект
+	template<typename Pointer>
+	double ownObjects(const std::vector<Pointer>& sources)
+	{
+		return BenchmarkMilliseconds(Runs, [&]()
+		{
+			BenchmarkRunThreads(static_cast<unsigned>(sources.size()), [&](unsigned thread) { copyPointer(sources[thread]); });
+		});
+	}
+
+	// все потоки копируют указатель на один объект
+	template<typename Pointer>
+	double sharedObject(unsigned numThreads, const Pointer& source)
+	{
+		return BenchmarkMilliseconds(Runs, [&]()
+		{
+			BenchmarkRunThreads(numThreads, [&](unsigned) { copyPointer(source); });
+		});
+	}
+
+	// отрицательное время - вариант не замерялся, обычный счетчик нельзя разделять между потоками
+	void printColumn(double ms, size_t copies)
+	{
+		if (ms < 0.0)
+			std::cout << std::setw(11) << "-";
+		else
+			std::cout << std::setw(8) << ms * 1000000.0 / static_cast<double>(copies) << " ns";
+	}
+
+	void printRow(const std::string& name, double sharedPtrMs, double atomicMs, double plainMs, double stdMs, size_t copies)
+	{
+		std::cout << "    " << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(1);
+		printColumn(sharedPtrMs, copies);
+		printColumn(atomicMs, copies);
+		printColumn(plainMs, copies);
+		printColumn(stdMs, copies);
+		std::cout << std::endl;
+	}
+}
+//-----------------------------------------------------------------------------
+void RefCountBenchmark()
+{
+	std::cout << "Reference counting, time per pointer copy and release, best of " << Runs << " runs, USE_THREADSAFE_REFCOUNT = " << USE_THREADSAFE_REFCOUNT << ":" << std::endl;
+	std::cout << "    " << std::left << std::setw(28) << "" << std::right << std::setw(11) << "SharedPtr" << std::setw(11) << "atomic" << std::setw(11) << "plain" << std::setw(11) << "shared_ptr" << std::endl;
+
+	const unsigned numThreads = std::max(2u, std::thread::hardware_concurrency());
+	const SharedPtr<BenchmarkObject> object(new BenchmarkObject());
+	const PolicyPtr<AtomicRefPolicy> atomicObject(new PolicyObject<AtomicRefPolicy>());
+	const PolicyPtr<PlainRefPolicy> plainObject(new PolicyObject<PlainRefPolicy>());
+	const auto stdObject = std::make_shared<BenchmarkObject>();
+
+	printRow("1 thread", singleThread(object), singleThread(atomicObject), singleThread(plainObject), singleThread(stdObject), CopyCount);
+
+	std::vector<SharedPtr<BenchmarkObject>> objects;
+	std::vector<PolicyPtr<AtomicRefPolicy>> atomicObjects;
+	std::vector<std::shared_ptr<BenchmarkObject>> stdObjects;
+	for (unsigned i = 0; i < numThreads; i++)
+	{
+		objects.emplace_back(new BenchmarkObject());
+		atomicObjects.emplace_back(new PolicyObject<AtomicRefPolicy>());
+		stdObjects.push_back(std::make_shared<BenchmarkObject>());
+	}
+	// SharedPtr с обычным счетчиком в нескольких потоках - гонка данных, такие строки не замеряются
+	const bool threadSafeSharedPtr = USE_THREADSAFE_REFCOUNT != 0;
+	printRow(std::to_string(numThreads) + " threads, own objects", threadSafeSharedPtr ? ownObjects(objects) : -1.0, ownObjects(atomicObjects), -1.0, ownObjects(stdObjects), CopyCount * numThreads);
+	printRow(std::to_string(numThreads) + " threads, one object", threadSafeSharedPtr ? sharedObject(numThreads, object) : -1.0, sharedObject(numThreads, atomicObject), -1.0, sharedObject(numThreads, stdObject), CopyCount * numThreads);
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
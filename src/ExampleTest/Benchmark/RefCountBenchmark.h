@@ -0,0 +1,10 @@
+﻿#pragma once
+
+/*
+Замер подсчета ссылок RefCounted/SharedPtr в сравнении с std::shared_ptr.
+Замеряется копирование и уничтожение указателя в одном потоке, в нескольких потоках на своих объектах и в нескольких потоках на одном общем объекте.
+Атомарный (AtomicRefPolicy) и обычный (PlainRefPolicy) счетчики замеряются в одной сборке, обычный только в одном потоке.
+SharedPtr использует политику, выбранную USE_THREADSAFE_REFCOUNT, и без нее тоже замеряется только в одном потоке.
+*/
+
+void RefCountBenchmark();
\ No newline at end of file
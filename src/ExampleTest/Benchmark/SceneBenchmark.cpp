@@ -0,0 +1,90 @@
+﻿#include "stdafx.h"
+#include "SceneBenchmark.h"
+#include "BenchmarkCommon.h"
+//-----------------------------------------------------------------------------
+namespace
+{
+	constexpr unsigned Runs = 10;
+	constexpr unsigned RootCounts[] = { 16, 64 };
+	constexpr unsigned Branching = 8;
+	constexpr unsigned Depth = 3;
+
+	// дерево под каждым корнем: Depth уровней потомков по Branching детей у узла. Узлы создаются по уровням, порядок по глубине сохраняется без сортировки
+	void createHierarchy(Scene& scene, unsigned rootCount, std::vector<unsigned>& roots, std::vector<unsigned>& leaves)
+	{
+		std::vector<unsigned> level, next;
+		for (unsigned r = 0; r < rootCount; r++)
+		{
+			const unsigned root = scene.CreateNode();
+			scene.SetPosition(root, glm::vec3(static_cast<float>(r) * 10.0f, 0.0f, 0.0f));
+			roots.push_back(root);
+		}
+		level = roots;
+		for (unsigned d = 0; d < Depth; d++)
+		{
+			next.clear();
+			for (unsigned parent : level)
+			{
+				for (unsigned c = 0; c < Branching; c++)
+				{
+					const unsigned node = scene.CreateNode(parent);
+					const float angle = static_cast<float>(c) * 0.1f;
+					scene.SetTransform(node, glm::vec3(1.0f, static_cast<float>(c), 0.0f), glm::quat(std::cos(angle), 0.0f, std::sin(angle), 0.0f), glm::vec3(0.9f));
+					next.push_back(node);
+				}
+			}
+			level.swap(next);
+		}
+		leaves = level;
+	}
+}
+//-----------------------------------------------------------------------------
+void SceneBenchmark()
+{
+	JobSystem& jobSystem = GetJobSystem();
+	jobSystem.Create({});
+
+	unsigned subtreeSize = 1;
+	for (unsigned d = 0, levelSize = 1; d < Depth; d++)
+		subtreeSize += levelSize *= Branching;
+
+	std::cout << "Scene update, " << Branching << " children per node, " << Depth + 1 << " levels, " << jobSystem.GetNumThreads() << " job threads, best of " << Runs << " runs:" << std::endl;
+	std::cout << "    " << std::setw(8) << "nodes" << std::left << std::setw(2) << "" << std::setw(14) << "changed" << std::right << std::setw(10) << "updated" << std::setw(12) << "us" << std::setw(12) << "ns/node" << std::endl;
+
+	for (unsigned rootCount : RootCounts)
+	{
+		Scene scene;
+		std::vector<unsigned> roots, leaves;
+		createHierarchy(scene, rootCount, roots, leaves);
+		scene.Update();
+		const unsigned nodeCount = static_cast<unsigned>(scene.GetNodeCount());
+
+		auto measure = [&](const char* name, unsigned updated, auto&& change)
+		{
+			unsigned frame = 0;
+			const double ms = BenchmarkMilliseconds(Runs, [&]()
+				{
+					change(static_cast<float>(++frame) * 0.01f);
+					scene.Update();
+				});
+			BenchmarkKeep(scene.GetWorldTransforms()[nodeCount - 1]);
+			std::cout << "    " << std::setw(8) << nodeCount << std::left << std::setw(2) << "" << std::setw(14) << name << std::right << std::setw(10) << updated
+				<< std::fixed << std::setprecision(1) << std::setw(12) << ms * 1000.0 << std::setw(12) << ms * 1000000.0 / std::max(updated, 1u) << std::endl;
+		};
+
+		// все корни сдвинуты: пересчитывается вся иерархия
+		measure("all roots", nodeCount, [&](float offset)
+			{
+				for (unsigned root : roots)
+					scene.SetPosition(root, glm::vec3(offset, 0.0f, 0.0f));
+			});
+		// сдвинут один корень: пересчитывается его поддерево, уровни выше первого измененного пропускаются
+		measure("one subtree", subtreeSize, [&](float offset) { scene.SetPosition(roots[rootCount / 2], glm::vec3(offset, 0.0f, 0.0f)); });
+		measure("one leaf", 1, [&](float offset) { scene.SetPosition(leaves[leaves.size() / 2], glm::vec3(offset, 0.0f, 0.0f)); });
+		measure("nothing", 0, [](float) {});
+	}
+	std::cout << "    ns/node: time per updated node, the unchanged levels below a change are still scanned" << std::endl;
+
+	jobSystem.Destroy();
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
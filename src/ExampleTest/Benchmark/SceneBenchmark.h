@@ -0,0 +1,8 @@
+﻿#pragma once
+
+/*
+Замер Scene::Update() на сгенерированной иерархии: пересчет всех узлов против пересчета одного поддерева, одного листа и кадра без изменений.
+Узлы каждого уровня распределяются по потокам JobSystem.
+*/
+
+void SceneBenchmark();
\ No newline at end of file
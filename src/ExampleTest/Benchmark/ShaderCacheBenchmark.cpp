@@ -0,0 +1,182 @@
+﻿#include "stdafx.h"
+#include "ShaderCacheBenchmark.h"
+#include "BenchmarkCommon.h"
+#include <filesystem>
+//-----------------------------------------------------------------------------
+#if PLATFORM_DESKTOP
+namespace
+{
+	constexpr unsigned Runs = 3;
+	constexpr unsigned ProgramCount = 64;
+	const std::string CacheDirectory = "ShaderCacheBenchmark";
+
+	const char* vertexShaderText = R"(
+#define VARIANT_SCALE 1.0
+
+layout(location = 0) in vec3 aPosition;
+layout(location = 1) in vec3 aNormal;
+layout(location = 2) in vec2 aTexCoord;
+
+uniform mat4 World;
+uniform mat4 ViewProjection;
+
+out vec3 vWorldPosition;
+out vec3 vNormal;
+out vec2 vTexCoord;
+
+void main()
+{
+	vec4 worldPosition = World * vec4(aPosition, 1.0);
+	vWorldPosition = worldPosition.xyz;
+	vNormal = mat3(World) * aNormal;
+	vTexCoord = aTexCoord * VARIANT_SCALE;
+	gl_Position = ViewProjection * worldPosition;
+}
+)";
+
+	const char* fragmentShaderText = R"(
+#define VARIANT_SHININESS 8.0
+
+in vec3 vWorldPosition;
+in vec3 vNormal;
+in vec2 vTexCoord;
+
+uniform sampler2D DiffuseTexture;
+uniform vec3 LightPositions[8];
+uniform vec3 LightColors[8];
+uniform vec3 CameraPosition;
+
+out vec4 FragmentColor;
+
+void main()
+{
+	vec3 normal = normalize(vNormal);
+	vec3 viewDirection = normalize(CameraPosition - vWorldPosition);
+	vec3 albedo = texture(DiffuseTexture, vTexCoord).rgb;
+	vec3 color = albedo * 0.1;
+	for (int i = 0; i < 8; i++)
+	{
+		vec3 toLight = LightPositions[i] - vWorldPosition;
+		vec3 lightDirection = normalize(toLight);
+		vec3 halfway = normalize(lightDirection + viewDirection);
+		float attenuation = 1.0 / (1.0 + dot(toLight, toLight));
+		color += (albedo * max(dot(normal, lightDirection), 0.0) + pow(max(dot(normal, halfway), 0.0), VARIANT_SHININESS)) * LightColors[i] * attenuation;
+	}
+	FragmentColor = vec4(color, 1.0);
+}
+)";
+
+	using ProgramSources = std::vector<std::pair<ShaderBytecode, ShaderBytecode>>;
+
+	// программы отличаются значениями макросов, как варианты одного материала, поэтому у каждой своя запись в кеше
+	ProgramSources createSources()
+	{
+		ProgramSources sources(ProgramCount);
+		for (unsigned i = 0; i < ProgramCount; i++)
+		{
+			sources[i].first = ShaderBytecode(vertexShaderText);
+			sources[i].first.InsertMacroValue("VARIANT_SCALE", std::to_string(i + 1) + ".0");
+			sources[i].second = ShaderBytecode(fragmentShaderText);
+			sources[i].second.InsertMacroValue("VARIANT_SHININESS", std::to_string(8 + i) + ".0");
+		}
+		return sources;
+	}
+
+	// запуск: создать систему рендера и все программы, затем уничтожить систему. Вернуть время создания программ в миллисекундах
+	double startup(const RenderCreateInfo& createInfo, const ProgramSources& sources, unsigned& programs)
+	{
+		auto& renderSystem = GetRenderSystem();
+		if (!renderSystem.Create(createInfo))
+			return 0.0;
+
+		std::vector<ShaderProgramRef> created;
+		created.reserve(sources.size());
+		const auto start = std::chrono::steady_clock::now();
+		for (const auto& [vertexSource, fragmentSource] : sources)
+		{
+			ShaderProgramRef program = renderSystem.CreateShaderProgram(vertexSource, fragmentSource);
+			if (program) created.push_back(std::move(program));
+		}
+		const std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+		programs = static_cast<unsigned>(created.size());
+
+		created.clear();
+		renderSystem.Destroy();
+		return time.count();
+	}
+
+	unsigned countEntries()
+	{
+		unsigned entries = 0;
+		if (std::filesystem::is_directory(CacheDirectory))
+		{
+			for (const auto& entry : std::filesystem::directory_iterator(CacheDirectory))
+				entries += entry.is_regular_file() ? 1 : 0;
+		}
+		return entries;
+	}
+
+	void printRow(const char* name, double ms)
+	{
+		std::cout << "    " << std::left << std::setw(12) << name << std::right << std::fixed << std::setprecision(2) << std::setw(12) << ms << std::setw(16) << ms / ProgramCount << std::endl;
+	}
+}
+#endif
+//-----------------------------------------------------------------------------
+void ShaderCacheBenchmark()
+{
+#if PLATFORM_DESKTOP
+	// кешу нужен настоящий драйвер, Null GL не отдает бинарники программ
+	auto& windowSystem = GetWindowSystem();
+	WindowCreateInfo windowCreateInfo;
+	windowCreateInfo.width = 320;
+	windowCreateInfo.height = 240;
+	windowCreateInfo.title = "Shader Cache Benchmark";
+	windowCreateInfo.resizable = false;
+	windowCreateInfo.maximized = false;
+	if (!windowSystem.Create(windowCreateInfo))
+		return;
+
+	{
+		const ProgramSources sources = createSources();
+		RenderCreateInfo noCacheCreateInfo;
+		RenderCreateInfo cacheCreateInfo;
+		cacheCreateInfo.shaderCacheDirectory = CacheDirectory;
+		unsigned programs = 0;
+
+		// без кеша: компиляция и компоновка всех программ при каждом запуске
+		const double noCacheMs = BenchmarkMilliseconds(Runs, [&]() { startup(noCacheCreateInfo, sources, programs); });
+		// холодный запуск: кеш пуст, программы компилируются и их бинарники записываются на диск
+		double coldMs = std::numeric_limits<double>::max();
+		for (unsigned run = 0; run < Runs; run++)
+		{
+			std::filesystem::remove_all(CacheDirectory);
+			coldMs = std::min(coldMs, startup(cacheCreateInfo, sources, programs));
+		}
+		const unsigned entries = countEntries();
+		// теплый запуск: все программы загружаются из бинарников, записанных холодным запуском
+		const double warmMs = BenchmarkMilliseconds(Runs, [&]() { startup(cacheCreateInfo, sources, programs); });
+
+		std::cout << "Shader program creation at startup, " << ProgramCount << " programs, best of " << Runs << " runs:" << std::endl;
+		// кеш не пишет записей, если драйвер не отдает бинарники программ
+		if (entries == 0)
+		{
+			std::cout << "    program binary cache is not supported by this driver (OpenGL 4.1 and a binary format are required)" << std::endl;
+			printRow("no cache", noCacheMs);
+		}
+		else
+		{
+			std::cout << "    " << std::left << std::setw(12) << "startup" << std::right << std::setw(12) << "total ms" << std::setw(16) << "per program ms" << std::endl;
+			printRow("no cache", noCacheMs);
+			printRow("cold cache", coldMs);
+			printRow("warm cache", warmMs);
+			std::cout << "    " << programs << " programs created, " << entries << " cache entries, warm speedup " << std::setprecision(1) << noCacheMs / warmMs << "x" << std::endl;
+			std::cout << "    no cache can be close to warm if the driver keeps its own shader cache" << std::endl;
+		}
+		std::filesystem::remove_all(CacheDirectory);
+	}
+
+	windowSystem.Destroy();
+#endif
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,8 @@
+﻿#pragma once
+
+/*
+Время создания программ шейдеров при запуске с кешем бинарников программ (RenderCreateInfo::shaderCacheDirectory) и без него.
+Нужен настоящий драйвер OpenGL 4.1+, поэтому создается небольшое окно. Печатается время без кеша, с пустым кешем (компиляция и запись) и с заполненным кешем (загрузка бинарников).
+*/
+
+void ShaderCacheBenchmark();
\ No newline at end of file
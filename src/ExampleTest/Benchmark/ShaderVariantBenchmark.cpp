@@ -0,0 +1,178 @@
+﻿#include "stdafx.h"
+#include "ShaderVariantBenchmark.h"
+#include "BenchmarkCommon.h"
+//-----------------------------------------------------------------------------
+#if PLATFORM_DESKTOP
+namespace
+{
+	constexpr unsigned MaterialCount = 256;
+	// каждый восьмой материал появляется только во время игры и не попадает в список уровня
+	constexpr unsigned SpawnedEvery = 8;
+
+	// SHADOWS упоминается только в комментарии, варианты с ним и без него дают один исходник и одну программу
+	const std::string keywords[] = { "NORMAL_MAP", "SPECULAR_MAP", "ALPHA_TEST", "FOG", "VERTEX_COLOR", "SHADOWS" };
+
+	const char* vertexShaderText = R"(
+layout(location = 0) in vec3 aPosition;
+layout(location = 1) in vec3 aNormal;
+layout(location = 2) in vec2 aTexCoord;
+#ifdef VERTEX_COLOR
+layout(location = 3) in vec3 aColor;
+out vec3 vColor;
+#endif
+
+uniform mat4 WorldViewProjection;
+
+out vec3 vNormal;
+out vec2 vTexCoord;
+
+void main()
+{
+	gl_Position = WorldViewProjection * vec4(aPosition, 1.0);
+	vNormal = aNormal;
+	vTexCoord = aTexCoord;
+#ifdef VERTEX_COLOR
+	vColor = aColor;
+#endif
+}
+)";
+
+	const char* fragmentShaderText = R"(
+in vec3 vNormal;
+in vec2 vTexCoord;
+#ifdef VERTEX_COLOR
+in vec3 vColor;
+#endif
+
+uniform sampler2D DiffuseTexture;
+#ifdef NORMAL_MAP
+uniform sampler2D NormalTexture;
+#endif
+#ifdef SPECULAR_MAP
+uniform sampler2D SpecularTexture;
+#endif
+
+out vec4 FragmentColor;
+
+void main()
+{
+	vec4 color = texture(DiffuseTexture, vTexCoord);
+#ifdef ALPHA_TEST
+	if (color.a < 0.5) discard;
+#endif
+	vec3 normal = normalize(vNormal);
+#ifdef NORMAL_MAP
+	normal = normalize(normal + texture(NormalTexture, vTexCoord).xyz * 2.0 - 1.0);
+#endif
+	float light = max(dot(normal, vec3(0.0, 1.0, 0.0)), 0.0);
+#ifdef SPECULAR_MAP
+	light += texture(SpecularTexture, vTexCoord).r * pow(light, 16.0);
+#endif
+#ifdef VERTEX_COLOR
+	color.rgb *= vColor;
+#endif
+	// SHADOWS: тени пока не реализованы
+	FragmentColor = vec4(color.rgb * light, color.a);
+#ifdef FOG
+	FragmentColor.rgb = mix(FragmentColor.rgb, vec3(0.5), 0.25);
+#endif
+}
+)";
+
+	// наборы ключевых слов материалов уровня, часть наборов повторяется
+	std::vector<ShaderVariantKey> createMaterials()
+	{
+		std::vector<ShaderVariantKey> materials(MaterialCount);
+		uint32_t seed = 12345;
+		for (ShaderVariantKey& key : materials)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			key = (seed >> 16) & ((1u << std::size(keywords)) - 1);
+		}
+		return materials;
+	}
+
+	struct PrewarmResult
+	{
+		unsigned loadLinks = 0;
+		unsigned frameLinks = 0;
+		size_t variants = 0;
+		ShaderVariantStatistics statistics;
+	};
+
+	// загрузка уровня с предварительной компиляцией вариантов prewarmKeys, затем первый кадр, который запрашивает вариант каждого материала
+	PrewarmResult loadAndDraw(std::span<const ShaderVariantKey> prewarmKeys, const std::vector<ShaderVariantKey>& materials)
+	{
+		auto& trace = GetRenderTrace();
+		ShaderLibrary library({ vertexShaderText }, { fragmentShaderText }, keywords);
+		PrewarmResult result;
+
+		trace.Clear();
+		library.Prewarm(prewarmKeys);
+		while (library.Update() > 0)
+			std::this_thread::yield();
+		result.loadLinks = trace.Count("glLinkProgram");
+
+		trace.Clear();
+		library.ResetStatistics();
+		for (ShaderVariantKey key : materials)
+			BenchmarkKeep(library.GetVariant(key));
+		result.frameLinks = trace.Count("glLinkProgram");
+		result.statistics = library.GetStatistics();
+		result.variants = library.GetNumVariants();
+		return result;
+	}
+
+	void printRow(const char* name, const PrewarmResult& result)
+	{
+		const unsigned requests = result.statistics.hits + result.statistics.waits + result.statistics.misses;
+		std::cout << "    " << std::left << std::setw(14) << name << std::right << std::setw(10) << result.loadLinks << std::setw(12) << result.frameLinks
+			<< std::setw(8) << result.statistics.hits << std::setw(8) << result.statistics.waits << std::setw(8) << result.statistics.misses
+			<< std::fixed << std::setprecision(1) << std::setw(10) << 100.0 * result.statistics.hits / requests << "%" << std::setw(10) << result.variants << std::endl;
+	}
+}
+#endif
+//-----------------------------------------------------------------------------
+void ShaderVariantBenchmark()
+{
+#if PLATFORM_DESKTOP
+	auto& trace = GetRenderTrace();
+	auto& renderSystem = GetRenderSystem();
+	if (!trace.Install(RenderTraceMode::Null) || !renderSystem.Create({}))
+	{
+		trace.Uninstall();
+		return;
+	}
+
+	{
+		const std::vector<ShaderVariantKey> materials = createMaterials();
+		// список уровня знает только материалы, размещенные в редакторе
+		std::vector<ShaderVariantKey> levelKeys;
+		for (unsigned i = 0; i < MaterialCount; i++)
+		{
+			if (i % SpawnedEvery != 0)
+				levelKeys.push_back(materials[i]);
+		}
+		std::vector<ShaderVariantKey> allKeys(size_t(1) << std::size(keywords));
+		for (size_t key = 0; key < allKeys.size(); key++)
+			allKeys[key] = static_cast<ShaderVariantKey>(key);
+
+		const PrewarmResult none = loadAndDraw({}, materials);
+		const PrewarmResult level = loadAndDraw(levelKeys, materials);
+		const PrewarmResult all = loadAndDraw(allKeys, materials);
+
+		std::cout << "Shader variant pre-warm, " << MaterialCount << " materials, " << std::size(keywords) << " keywords, every " << SpawnedEvery << "th material spawned at run time, Null GL:" << std::endl;
+		std::cout << "    " << std::left << std::setw(14) << "pre-warm" << std::right << std::setw(10) << "load links" << std::setw(12) << "frame links"
+			<< std::setw(8) << "hits" << std::setw(8) << "waits" << std::setw(8) << "misses" << std::setw(11) << "hit rate" << std::setw(10) << "variants" << std::endl;
+		printRow("none", none);
+		printRow("level list", level);
+		printRow("all keys", all);
+		std::cout << "    links: programs compiled and linked, a frame link is a compile stall on the draw path" << std::endl;
+		std::cout << "    all keys: " << allKeys.size() << " keyword sets share " << all.variants << " programs, unused keywords are dropped from the key" << std::endl;
+	}
+
+	renderSystem.Destroy();
+	trace.Uninstall();
+#endif
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,9 @@
+﻿#pragma once
+
+/*
+Доля вариантов шейдера, готовых к первому кадру (ShaderLibrary::Prewarm()), под Null GL.
+Уровень из материалов с разными наборами ключевых слов: без предварительной компиляции, с компиляцией вариантов материалов уровня при загрузке и с компиляцией всех сочетаний.
+Печатается число программ, скомпонованных при загрузке и в первом кадре, и попадания, ожидания и промахи GetVariant() в первом кадре.
+*/
+
+void ShaderVariantBenchmark();
\ No newline at end of file
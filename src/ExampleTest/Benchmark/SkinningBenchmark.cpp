@@ -0,0 +1,156 @@
+﻿#include "stdafx.h"
+#include "SkinningBenchmark.h"
+#include "BenchmarkCommon.h"
+//-----------------------------------------------------------------------------
+namespace
+{
+	constexpr unsigned Runs = 10;
+	constexpr int GeneratedVertexCount = 100000;
+	constexpr int GeneratedBoneCount = 64;
+
+	struct SkinningInput
+	{
+		std::string name;
+		const NewMeshVertex* vertices;
+		const SkinnedMeshData* skin;
+	};
+
+	void skinMeshes(const std::vector<SkinningInput>& meshes, const std::vector<SkinningMatrix>& palette, int boneCount, const TempTransform* bindPose, const TempTransform* framePose)
+	{
+		std::vector<SkinningMatrix> framePalette;
+		const double paletteMs = BenchmarkMilliseconds(Runs, [&]() { BuildSkinningPalette(framePalette, bindPose, framePose, boneCount); });
+		std::cout << "    palette of " << boneCount << " bones: " << std::fixed << std::setprecision(2) << paletteMs * 1000.0 << " us" << std::endl;
+		std::cout << "    " << std::left << std::setw(24) << "mesh" << std::right << std::setw(10) << "vertices" << std::setw(16) << "1 thread" << std::setw(16) << "jobs" << std::endl;
+
+		std::vector<NewMeshVertex> destination;
+		for (const SkinningInput& mesh : meshes)
+		{
+			const unsigned vertexCount = mesh.skin->vertexCount;
+			destination.resize(vertexCount);
+			const double singleMs = BenchmarkMilliseconds(Runs, [&]() { SkinVertices(destination.data(), mesh.vertices, *mesh.skin, palette, 0, vertexCount); });
+			const double jobsMs = BenchmarkMilliseconds(Runs, [&]() { SkinMesh(destination.data(), mesh.vertices, *mesh.skin, palette); });
+			BenchmarkKeep(destination[vertexCount / 2]);
+
+			std::cout << "    " << std::left << std::setw(24) << mesh.name << std::right << std::setw(10) << vertexCount << std::setprecision(0)
+				<< std::setw(8) << vertexCount / singleMs << " vert/ms" << std::setw(8) << vertexCount / jobsMs << " vert/ms" << std::endl;
+		}
+	}
+
+	// модель с равномерно распределенными по костям вершинами, по четыре влияния на вершину
+	void generatedRig()
+	{
+		std::vector<glm::vec3> positions(GeneratedVertexCount), normals(GeneratedVertexCount);
+		std::vector<unsigned char> boneIds(GeneratedVertexCount * SKINNING_MAX_INFLUENCES);
+		std::vector<float> boneWeights(GeneratedVertexCount * SKINNING_MAX_INFLUENCES);
+		NewMesh mesh = {};
+		mesh.vertexCount = GeneratedVertexCount;
+		mesh.vert.resize(GeneratedVertexCount);
+		for (int i = 0; i < GeneratedVertexCount; i++)
+		{
+			const float t = static_cast<float>(i) / GeneratedVertexCount;
+			positions[i] = glm::vec3(std::sin(t * 100.0f), t * 2.0f, std::cos(t * 100.0f));
+			normals[i] = glm::normalize(glm::vec3(positions[i].x, 0.0f, positions[i].z));
+			mesh.vert[i].positions = positions[i];
+			mesh.vert[i].normals = normals[i];
+			for (unsigned j = 0; j < SKINNING_MAX_INFLUENCES; j++)
+			{
+				boneIds[i * SKINNING_MAX_INFLUENCES + j] = static_cast<unsigned char>((i / 64 + j) % GeneratedBoneCount);
+				boneWeights[i * SKINNING_MAX_INFLUENCES + j] = j == 0 ? 0.4f : 0.2f;
+			}
+		}
+		mesh.vertices = &positions[0].x;
+		mesh.normals = &normals[0].x;
+		mesh.boneIds = boneIds.data();
+		mesh.boneWeights = boneWeights.data();
+
+		SkinnedMeshData skin;
+		skin.Create(mesh);
+
+		std::vector<TempTransform> bindPose(GeneratedBoneCount), framePose(GeneratedBoneCount);
+		for (int b = 0; b < GeneratedBoneCount; b++)
+		{
+			// поворот вокруг оси Z, угол растет к концу цепочки костей
+			const float halfAngle = b * 0.025f;
+			bindPose[b] = { glm::vec3(0.0f, b * 2.0f / GeneratedBoneCount, 0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f) };
+			framePose[b] = { bindPose[b].translation, glm::quat(std::cos(halfAngle), 0.0f, 0.0f, std::sin(halfAngle)), glm::vec3(1.0f) };
+		}
+		std::vector<SkinningMatrix> palette;
+		BuildSkinningPalette(palette, bindPose.data(), framePose.data(), GeneratedBoneCount);
+
+		std::cout << "Skinning, generated rig, best of " << Runs << " runs:" << std::endl;
+		skinMeshes({ { "generated", mesh.vert.data(), &skin } }, palette, GeneratedBoneCount, bindPose.data(), framePose.data());
+	}
+
+	// модель из файла, поза берется из середины первой анимации
+	void modelRig(const std::string& fileName)
+	{
+		auto& trace = GetRenderTrace();
+		auto& renderSystem = GetRenderSystem();
+		if (!trace.Install(RenderTraceMode::Null) || !renderSystem.Create({}))
+		{
+			trace.Uninstall();
+			return;
+		}
+
+		{
+			NewModel model = LoadModel(fileName, SkinningMode::CPU);
+			unsigned animCount = 0;
+			ModelAnimation* animations = LoadModelAnimations(fileName, animCount);
+
+			std::vector<TempTransform> framePose(model.bindPose, model.bindPose + model.boneCount);
+			if (animCount > 0 && animations[0].boneCount == model.boneCount)
+			{
+				const ModelAnimation& anim = animations[0];
+				if (anim.clip != nullptr)
+				{
+					AnimationCursor cursor;
+					anim.clip->Sample(anim.clip->GetDuration() * 0.5f, cursor, framePose.data());
+					BuildPoseFromParentJoints(anim.bones, anim.boneCount, framePose.data());
+				}
+				else if (anim.framePoses != nullptr && anim.frameCount > 0)
+					framePose.assign(anim.framePoses[anim.frameCount / 2], anim.framePoses[anim.frameCount / 2] + anim.boneCount);
+			}
+
+			std::vector<SkinningInput> meshes;
+			for (size_t m = 0; m < model.meshes.size(); m++)
+			{
+				if (model.meshes[m].skin != nullptr)
+					meshes.push_back({ "mesh " + std::to_string(m), model.meshes[m].vert.data(), model.meshes[m].skin.get() });
+			}
+
+			if (meshes.empty())
+				std::cout << "    " << fileName << " has no skinned meshes" << std::endl;
+			else
+			{
+				std::vector<SkinningMatrix> palette;
+				BuildSkinningPalette(palette, model.bindPose, framePose.data(), model.boneCount);
+				std::cout << "Skinning, " << fileName << ", best of " << Runs << " runs:" << std::endl;
+				skinMeshes(meshes, palette, model.boneCount, model.bindPose, framePose.data());
+			}
+			UnloadModelAnimations(animations, animCount);
+		}
+
+		renderSystem.Destroy();
+		trace.Uninstall();
+	}
+}
+//-----------------------------------------------------------------------------
+void SkinningBenchmark()
+{
+	std::cout << "IQM or glTF model file (g - generated rig): ";
+	std::string fileName;
+	std::cin >> fileName;
+
+	// SkinMesh распределяет вершины по потокам JobSystem
+	JobSystem& jobSystem = GetJobSystem();
+	jobSystem.Create({});
+	std::cout << "    job threads: " << jobSystem.GetNumThreads() << std::endl;
+
+	if (fileName == "g")
+		generatedRig();
+	else
+		modelRig(fileName);
+
+	jobSystem.Destroy();
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,8 @@
+﻿#pragma once
+
+/*
+Замер CPU скиннинга в вершинах за миллисекунду: в одном потоке (SkinVertices) и на потоках JobSystem (SkinMesh).
+Модель IQM/glTF загружается без окна, через RenderTrace в режиме Null. Вместо файла можно выбрать сгенерированную модель.
+*/
+
+void SkinningBenchmark();
\ No newline at end of file
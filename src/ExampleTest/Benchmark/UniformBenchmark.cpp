@@ -0,0 +1,258 @@
+﻿#include "stdafx.h"
+#include "UniformBenchmark.h"
+#include "BenchmarkCommon.h"
+//-----------------------------------------------------------------------------
+#if PLATFORM_DESKTOP
+namespace
+{
+	constexpr unsigned Runs = 10;
+	constexpr unsigned ObjectCounts[] = { 1000, 10000 };
+	constexpr unsigned ObjectBindingPoint = 1;
+	constexpr unsigned MaterialCount = 16;
+
+	const char* uniformVertexShaderText = R"(
+layout(location = 0) in vec3 aPosition;
+
+uniform mat4 World;
+uniform vec4 Color;
+uniform vec4 Params;
+
+out vec4 vColor;
+
+void main()
+{
+	gl_Position = World * vec4(aPosition * Params.x, 1.0);
+	vColor = Color;
+}
+)";
+
+	const char* blockVertexShaderText = R"(
+layout(location = 0) in vec3 aPosition;
+
+layout(std140) uniform Object
+{
+	mat4 World;
+	vec4 Color;
+	vec4 Params;
+};
+
+out vec4 vColor;
+
+void main()
+{
+	gl_Position = World * vec4(aPosition * Params.x, 1.0);
+	vColor = Color;
+}
+)";
+
+	const char* fragmentShaderText = R"(
+in vec4 vColor;
+out vec4 FragmentColor;
+
+void main()
+{
+	FragmentColor = vColor;
+}
+)";
+
+	// данные объекта в раскладке std140 блока Object
+	struct ObjectBlock
+	{
+		glm::mat4 world;
+		glm::vec4 color;
+		glm::vec4 params;
+	};
+
+	const glm::vec3 triangle[] = { { 0.0f, 0.5f, 0.0f }, { 0.5f, -0.5f, 0.0f }, { -0.5f, -0.5f, 0.0f } };
+
+	struct FrameResult
+	{
+		RenderStatistics statistics;
+		unsigned glCalls = 0;
+		unsigned glUniformCalls = 0;
+		double microseconds = 0.0;
+	};
+
+	// выполнить кадр несколько раз, вернуть счетчики последнего кадра и лучшее время
+	template<typename Func>
+	FrameResult measureFrame(Func&& frame)
+	{
+		auto& renderSystem = GetRenderSystem();
+		auto& trace = GetRenderTrace();
+		FrameResult result;
+		result.microseconds = BenchmarkMilliseconds(Runs, [&]()
+			{
+				trace.Clear();
+				frame();
+				renderSystem.EndFrame();
+			}) * 1000.0;
+		result.statistics = renderSystem.GetFrameStatistics();
+		for (size_t type = 0; type < static_cast<size_t>(RenderCommandType::Count); type++)
+			result.glCalls += trace.Count(static_cast<RenderCommandType>(type));
+		result.glUniformCalls = trace.Count(RenderCommandType::Uniform);
+		return result;
+	}
+
+	void printHeader()
+	{
+		std::cout << "    " << std::left << std::setw(14) << "path" << std::right << std::setw(8) << "objects" << std::setw(10) << "uniforms"
+			<< std::setw(12) << "buf binds" << std::setw(10) << "GL calls" << std::setw(12) << "upload KB" << std::setw(12) << "CPU us" << std::endl;
+	}
+
+	void printRow(const char* name, unsigned objectCount, const FrameResult& result)
+	{
+		std::cout << "    " << std::left << std::setw(14) << name << std::right << std::setw(8) << objectCount
+			<< std::setw(10) << result.statistics.uniformCalls << std::setw(12) << result.statistics.bufferBinds << std::setw(10) << result.glCalls
+			<< std::setw(12) << result.statistics.bytesUploaded / 1024 << std::fixed << std::setprecision(1) << std::setw(12) << result.microseconds << std::endl;
+	}
+
+	std::vector<ObjectBlock> createObjects(unsigned objectCount)
+	{
+		std::vector<ObjectBlock> objects(objectCount);
+		for (unsigned i = 0; i < objectCount; i++)
+		{
+			objects[i].world = glm::mat4(1.0f);
+			objects[i].world[3] = glm::vec4(static_cast<float>(i % 100), static_cast<float>(i / 100), 0.0f, 1.0f);
+			objects[i].color = glm::vec4(static_cast<float>(i % 7) / 7.0f, 0.5f, 1.0f, 1.0f);
+			objects[i].params = glm::vec4(1.0f);
+		}
+		return objects;
+	}
+
+	// данные объекта через glUniform* против одного Push() в кольцевой буфер кадра на объект
+	void uniformsVsFrameRing(VertexArrayRef vao)
+	{
+		auto& renderSystem = GetRenderSystem();
+		auto& frameUniforms = renderSystem.GetFrameUniforms();
+		ShaderProgramRef uniformShader = renderSystem.CreateShaderProgram({ uniformVertexShaderText }, { fragmentShaderText });
+		ShaderProgramRef blockShader = renderSystem.CreateShaderProgram({ blockVertexShaderText }, { fragmentShaderText });
+		const Uniform world = renderSystem.GetUniform(uniformShader, "World");
+		const Uniform color = renderSystem.GetUniform(uniformShader, "Color");
+		const Uniform params = renderSystem.GetUniform(uniformShader, "Params");
+		const UniformBlock objectBlock = renderSystem.GetUniformBlock(blockShader, "Object");
+		if (renderSystem.IsValid(objectBlock))
+			renderSystem.SetUniformBlockBinding(objectBlock, ObjectBindingPoint);
+
+		std::cout << "Per-object uniforms, " << sizeof(ObjectBlock) << " bytes per object, Null GL, best of " << Runs << " runs:" << std::endl;
+		if (!frameUniforms.IsValid())
+		{
+			std::cout << "    frame uniform ring is not available" << std::endl;
+			return;
+		}
+		printHeader();
+
+		for (unsigned objectCount : ObjectCounts)
+		{
+			const std::vector<ObjectBlock> objects = createObjects(objectCount);
+			const FrameResult uniformResult = measureFrame([&]()
+				{
+					renderSystem.Bind(uniformShader);
+					for (const ObjectBlock& object : objects)
+					{
+						renderSystem.SetUniform(world, object.world);
+						renderSystem.SetUniform(color, object.color);
+						renderSystem.SetUniform(params, object.params);
+						renderSystem.Draw(vao);
+					}
+				});
+			const FrameResult ringResult = measureFrame([&]()
+				{
+					renderSystem.Bind(blockShader);
+					for (const ObjectBlock& object : objects)
+					{
+						frameUniforms.Push(ObjectBindingPoint, object);
+						renderSystem.Draw(vao);
+					}
+				});
+
+			printRow("glUniform", objectCount, uniformResult);
+			printRow("frame ring", objectCount, ringResult);
+		}
+		std::cout << "    frame ring of " << frameUniforms.GetFrameSize() / 1024 << " KB per frame, " << (frameUniforms.IsPersistent() ? "persistent mapping" : "orphaned glBufferSubData") << std::endl;
+	}
+
+	// материалы задают Color и Params, у объекта свой World: кеш значений uniform пропускает повторы значений материала
+	void redundantUniforms(VertexArrayRef vao)
+	{
+		auto& renderSystem = GetRenderSystem();
+		ShaderProgramRef shader = renderSystem.CreateShaderProgram({ uniformVertexShaderText }, { fragmentShaderText });
+		const Uniform world = renderSystem.GetUniform(shader, "World");
+		const Uniform color = renderSystem.GetUniform(shader, "Color");
+		const Uniform params = renderSystem.GetUniform(shader, "Params");
+
+		// программа привязывается один раз, чтобы в пропущенные вызовы попали только значения uniform
+		renderSystem.Bind(shader);
+		std::cout << "Redundant uniform values, " << MaterialCount << " materials, Null GL, best of " << Runs << " runs:" << std::endl;
+		std::cout << "    " << std::left << std::setw(14) << "order" << std::right << std::setw(8) << "objects" << std::setw(10) << "set" << std::setw(10) << "skipped"
+			<< std::setw(12) << "glUniform" << std::setw(12) << "CPU us" << std::endl;
+
+		for (unsigned objectCount : ObjectCounts)
+		{
+			const std::vector<ObjectBlock> objects = createObjects(objectCount);
+			std::vector<ObjectBlock> materials(MaterialCount);
+			for (unsigned m = 0; m < MaterialCount; m++)
+			{
+				materials[m].color = glm::vec4(static_cast<float>(m) / MaterialCount, 0.5f, 1.0f, 1.0f);
+				materials[m].params = glm::vec4(1.0f + static_cast<float>(m));
+			}
+
+			auto frame = [&](bool sorted)
+			{
+				return measureFrame([&]()
+					{
+						for (unsigned i = 0; i < objectCount; i++)
+						{
+							// по материалам: объекты одного материала идут подряд, вперемешку: материал меняется на каждом объекте
+							const ObjectBlock& material = materials[sorted ? i * MaterialCount / objectCount : i % MaterialCount];
+							renderSystem.SetUniform(color, material.color);
+							renderSystem.SetUniform(params, material.params);
+							renderSystem.SetUniform(world, objects[i].world);
+							renderSystem.Draw(vao);
+						}
+					});
+			};
+			const FrameResult sortedResult = frame(true);
+			const FrameResult interleavedResult = frame(false);
+
+			auto printOrder = [&](const char* name, const FrameResult& result)
+			{
+				std::cout << "    " << std::left << std::setw(14) << name << std::right << std::setw(8) << objectCount
+					<< std::setw(10) << result.statistics.uniformCalls + result.statistics.redundantCalls << std::setw(10) << result.statistics.redundantCalls
+					<< std::setw(12) << result.glUniformCalls << std::fixed << std::setprecision(1) << std::setw(12) << result.microseconds << std::endl;
+			};
+			printOrder("by material", sortedResult);
+			printOrder("interleaved", interleavedResult);
+		}
+		std::cout << "    set: SetUniform calls, skipped: values equal to the cached ones, glUniform: calls that reached GL" << std::endl;
+	}
+}
+#endif
+//-----------------------------------------------------------------------------
+void UniformBenchmark()
+{
+#if PLATFORM_DESKTOP
+	auto& trace = GetRenderTrace();
+	auto& renderSystem = GetRenderSystem();
+	// кольцо должно вместить все объекты кадра
+	RenderCreateInfo createInfo;
+	createInfo.frameUniformBufferSize = ObjectCounts[std::size(ObjectCounts) - 1] * 256;
+	if (!trace.Install(RenderTraceMode::Null) || !renderSystem.Create(createInfo))
+	{
+		trace.Uninstall();
+		return;
+	}
+
+	{
+		VertexBufferRef vb = renderSystem.CreateVertexBuffer(BufferUsage::StaticDraw, static_cast<unsigned>(Countof(triangle)), static_cast<unsigned>(sizeof(glm::vec3)), triangle);
+		const std::vector<VertexAttribute> format = { {.location = 0, .size = 3, .normalized = false, .stride = sizeof(glm::vec3), .offset = (void*)0} };
+		VertexArrayRef vao = renderSystem.CreateVertexArray(vb, nullptr, format);
+
+		uniformsVsFrameRing(vao);
+		redundantUniforms(vao);
+	}
+
+	renderSystem.Destroy();
+	trace.Uninstall();
+#endif
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
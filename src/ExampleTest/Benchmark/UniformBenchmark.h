@@ -0,0 +1,9 @@
+﻿#pragma once
+
+/*
+Передача данных объектов в шейдер под Null GL: отдельные вызовы glUniform* против блока в кольцевом буфере кадра (RenderSystem::GetFrameUniforms()).
+Печатается число вызовов uniform, привязок буферов и всех вызовов GL за кадр, объем загруженных данных и время кадра на процессоре.
+Затем значения материалов при отрисовке по материалам и вперемешку: сколько вызовов SetUniform пропущено кешем значений и сколько дошло до GL.
+*/
+
+void UniformBenchmark();
\ No newline at end of file
@@ -0,0 +1,214 @@
+﻿#include "stdafx.h"
+#include "GpuSkinning.h"
+#include "Engine/Graphics/Skinning.h"
+#include <filesystem>
+#include <fstream>
+//-----------------------------------------------------------------------------
+#if PLATFORM_DESKTOP
+namespace
+{
+	const std::string FileName = "GpuSkinningTest.iqm";
+	constexpr unsigned MeshCount = 2;
+	constexpr unsigned BoneCount = 3;
+	// сетка GridSize x GridSize четырехугольников в каждой сетке модели
+	constexpr unsigned GridSize = 15;
+	constexpr unsigned GridVertices = (GridSize + 1) * (GridSize + 1);
+	constexpr unsigned GridTriangles = GridSize * GridSize * 2;
+
+	// структуры формата IQM 2, в том виде, в каком их читает LoadIQM()
+	struct IqmHeader
+	{
+		char magic[16];
+		uint32_t version, dataSize, flags;
+		uint32_t numText, ofsText;
+		uint32_t numMeshes, ofsMeshes;
+		uint32_t numVertexArrays, numVertexes, ofsVertexArrays;
+		uint32_t numTriangles, ofsTriangles, ofsAdjacency;
+		uint32_t numJoints, ofsJoints;
+		uint32_t numPoses, ofsPoses;
+		uint32_t numAnims, ofsAnims;
+		uint32_t numFrames, numFrameChannels, ofsFrames, ofsBounds;
+		uint32_t numComment, ofsComment;
+		uint32_t numExtensions, ofsExtensions;
+	};
+	struct IqmMesh { uint32_t name, material, firstVertex, numVertexes, firstTriangle, numTriangles; };
+	struct IqmVertexArray { uint32_t type, flags, format, size, offset; };
+	struct IqmJoint { uint32_t name; int32_t parent; float translate[3], rotate[4], scale[3]; };
+
+	template<typename T>
+	void append(std::vector<char>& data, const T* items, size_t count)
+	{
+		const char* bytes = reinterpret_cast<const char*>(items);
+		data.insert(data.end(), bytes, bytes + sizeof(T) * count);
+	}
+
+	// модель из MeshCount сеток-решеток, строки решетки привязаны к цепочке из BoneCount костей
+	void writeModel()
+	{
+		std::vector<float> positions, normals, texcoords;
+		std::vector<uint8_t> boneIds, boneWeights;
+		std::vector<uint32_t> triangles;
+		IqmMesh meshes[MeshCount] = {};
+		for (uint32_t m = 0; m < MeshCount; m++)
+		{
+			meshes[m] = { 0, 0, m * GridVertices, GridVertices, m * GridTriangles, GridTriangles };
+			for (uint32_t y = 0; y <= GridSize; y++)
+			{
+				for (uint32_t x = 0; x <= GridSize; x++)
+				{
+					positions.insert(positions.end(), { static_cast<float>(x), static_cast<float>(y), static_cast<float>(m) });
+					normals.insert(normals.end(), { 0.0f, 0.0f, 1.0f });
+					texcoords.insert(texcoords.end(), { static_cast<float>(x) / GridSize, static_cast<float>(y) / GridSize });
+					boneIds.insert(boneIds.end(), { static_cast<uint8_t>(y * BoneCount / (GridSize + 1)), 0, 0, 0 });
+					boneWeights.insert(boneWeights.end(), { 255, 0, 0, 0 });
+				}
+			}
+			for (uint32_t y = 0; y < GridSize; y++)
+			{
+				for (uint32_t x = 0; x < GridSize; x++)
+				{
+					const uint32_t a = m * GridVertices + y * (GridSize + 1) + x;
+					const uint32_t b = a + GridSize + 1;
+					triangles.insert(triangles.end(), { a, b, a + 1, a + 1, b, b + 1 });
+				}
+			}
+		}
+		IqmJoint joints[BoneCount] = {};
+		for (int32_t j = 0; j < static_cast<int32_t>(BoneCount); j++)
+			joints[j] = { 0, j - 1, { 0.0f, j ? 5.0f : 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 1.0f } };
+
+		// имена сеток, материалов и костей пустые, LoadIQM() читает по 32 байта текста
+		const char text[64] = {};
+		std::vector<char> data(sizeof(IqmHeader));
+		IqmHeader header = {};
+		memcpy(header.magic, "INTERQUAKEMODEL", 16);
+		header.version = 2;
+		header.numText = sizeof(text);
+		header.ofsText = static_cast<uint32_t>(data.size());
+		append(data, text, sizeof(text));
+		header.numMeshes = MeshCount;
+		header.ofsMeshes = static_cast<uint32_t>(data.size());
+		append(data, meshes, MeshCount);
+
+		header.numVertexes = MeshCount * GridVertices;
+		IqmVertexArray arrays[5] = {};
+		arrays[0] = { 0, 0, 7, 3, 0 }; // позиции, float
+		arrays[1] = { 1, 0, 7, 2, 0 }; // текстурные координаты
+		arrays[2] = { 2, 0, 7, 3, 0 }; // нормали
+		arrays[3] = { 4, 0, 1, 4, 0 }; // индексы костей, unsigned byte
+		arrays[4] = { 5, 0, 1, 4, 0 }; // веса костей
+		arrays[0].offset = static_cast<uint32_t>(data.size()); append(data, positions.data(), positions.size());
+		arrays[1].offset = static_cast<uint32_t>(data.size()); append(data, texcoords.data(), texcoords.size());
+		arrays[2].offset = static_cast<uint32_t>(data.size()); append(data, normals.data(), normals.size());
+		arrays[3].offset = static_cast<uint32_t>(data.size()); append(data, boneIds.data(), boneIds.size());
+		arrays[4].offset = static_cast<uint32_t>(data.size()); append(data, boneWeights.data(), boneWeights.size());
+		header.numVertexArrays = 5;
+		header.ofsVertexArrays = static_cast<uint32_t>(data.size());
+		append(data, arrays, 5);
+
+		header.numTriangles = static_cast<uint32_t>(triangles.size() / 3);
+		header.ofsTriangles = static_cast<uint32_t>(data.size());
+		append(data, triangles.data(), triangles.size());
+		header.numJoints = BoneCount;
+		header.ofsJoints = static_cast<uint32_t>(data.size());
+		append(data, joints, BoneCount);
+
+		header.dataSize = static_cast<uint32_t>(data.size());
+		memcpy(data.data(), &header, sizeof(header));
+		std::ofstream(FileName, std::ios::binary).write(data.data(), static_cast<std::streamsize>(data.size()));
+	}
+
+	// кадр: поза привязки, палитра перед отрисовкой каждой сетки. Вернуть статистику кадра
+	RenderStatistics drawFrame(const NewModel& model, bool& bound)
+	{
+		auto& renderSystem = GetRenderSystem();
+		renderSystem.EndFrame();
+		renderSystem.ResetStatistics();
+		GetRenderTrace().Clear();
+
+		UpdateModelPose(model, model.bindPose, model.boneCount);
+		bound = true;
+		for (const NewMesh& mesh : model.meshes)
+		{
+			bound &= BindModelSkinning(model);
+			renderSystem.Draw(mesh.geometry);
+		}
+		return renderSystem.GetStatistics();
+	}
+
+	bool check(bool condition, const char* text)
+	{
+		std::cout << (condition ? "    ok: " : "    FAILED: ") << text << std::endl;
+		return condition;
+	}
+}
+#endif
+//-----------------------------------------------------------------------------
+bool GpuSkinningTest()
+{
+#if PLATFORM_DESKTOP
+	auto& trace = GetRenderTrace();
+	auto& renderSystem = GetRenderSystem();
+	if (!trace.Install(RenderTraceMode::Null) || !renderSystem.Create({}))
+	{
+		trace.Uninstall();
+		return false;
+	}
+
+	bool result = true;
+	writeModel();
+	{
+		trace.Clear();
+		NewModel gpuModel = LoadModel(FileName, SkinningMode::GPU);
+		const size_t paletteBytes = MIN_GPU_SKINNING_BONES * 12 * sizeof(float);
+		result &= check(gpuModel.meshes.size() == MeshCount && gpuModel.boneCount == BoneCount, "model loaded");
+		result &= check(gpuModel.skinning == SkinningMode::GPU && gpuModel.bonePalette && gpuModel.bonePalette->rows.size() * sizeof(float) == paletteBytes, "GPU skinning with a 32 bone palette");
+
+		// раскладка атрибутов: индексы костей - uvec4 из байт через glVertexAttribIPointer, веса - vec4
+		unsigned boneIdAttributes = 0, otherIntegerAttributes = 0, boneWeightAttributes = 0;
+		for (const RenderCommand& command : trace.GetCommands())
+		{
+			const std::string_view function = command.function;
+			if (function == "glVertexAttribIPointer")
+			{
+				if (command.args[0] == SKINNING_BONE_IDS_LOCATION && command.args[1] == 4 && command.args[2] == GL_UNSIGNED_BYTE) boneIdAttributes++;
+				else otherIntegerAttributes++;
+			}
+			else if (function == "glVertexAttribPointer" && command.args[0] == SKINNING_BONE_WEIGHTS_LOCATION && command.args[1] == 4 && command.args[2] == GL_FLOAT)
+				boneWeightAttributes++;
+		}
+		result &= check(boneIdAttributes == MeshCount && otherIntegerAttributes == 0, "bone ids are integer attributes at location 6");
+		result &= check(boneWeightAttributes == MeshCount, "bone weights are float attributes at location 7");
+
+		bool bound = false;
+		const RenderStatistics gpuFrame = drawFrame(gpuModel, bound);
+		unsigned paletteRanges = 0;
+		for (const RenderCommand& command : trace.GetCommands())
+		{
+			if (std::string_view(command.function) == "glBindBufferRange" && command.args[1] == SKINNING_PALETTE_BINDING && command.args[4] == paletteBytes)
+				paletteRanges++;
+		}
+		result &= check(bound && gpuFrame.drawCalls == MeshCount, "palette bound before each draw");
+		result &= check(paletteRanges == 1, "one palette range bound for all meshes of the model");
+		result &= check(gpuFrame.bytesUploaded == paletteBytes, "palette pushed once per model per frame");
+
+		const RenderStatistics nextGpuFrame = drawFrame(gpuModel, bound);
+		result &= check(bound && nextGpuFrame.bytesUploaded == paletteBytes, "palette pushed again in the next frame");
+
+		// CPU скининг той же модели переписывает вершины всех сеток каждый кадр
+		NewModel cpuModel = LoadModel(FileName, SkinningMode::CPU);
+		const RenderStatistics cpuFrame = drawFrame(cpuModel, bound);
+		result &= check(bound && cpuModel.skinning == SkinningMode::CPU && cpuFrame.bytesUploaded == MeshCount * GridVertices * sizeof(NewMeshVertex), "CPU skinning rewrites the vertex buffers");
+		result &= check(gpuFrame.bytesUploaded < cpuFrame.bytesUploaded, "GPU skinning uploads less than CPU skinning");
+		std::cout << "    uploaded per frame, " << MeshCount * GridVertices << " vertices: GPU palette " << gpuFrame.bytesUploaded << " bytes, CPU vertices " << cpuFrame.bytesUploaded << " bytes" << std::endl;
+	}
+	std::filesystem::remove(FileName);
+
+	renderSystem.Destroy();
+	trace.Uninstall();
+	return result;
+#else
+	return false;
+#endif
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,10 @@
+﻿#pragma once
+
+/*
+Проверка GPU скининга без окна и драйвера, через RenderTrace в режиме Null.
+Модель из двух сеток с костями загружается в режиме SkinningMode::GPU: индексы костей - целочисленный атрибут 6, веса - атрибут 7, палитра на 32 кости.
+Палитра кадра попадает в кольцевой буфер один раз на модель, следующие сетки используют тот же диапазон. Печатается объем данных кадра против CPU скининга.
+Возвращает false если какая-то проверка не прошла.
+*/
+
+bool GpuSkinningTest();
\ No newline at end of file
@@ -0,0 +1,134 @@
+﻿#include "stdafx.h"
+#include "HeadlessRender.h"
+//-----------------------------------------------------------------------------
+#if PLATFORM_DESKTOP
+namespace
+{
+	const char* vertexShaderText = R"(
+layout(location = 0) in vec3 aPosition;
+layout(location = 1) in vec3 aColor;
+
+uniform mat4 ProjectionMatrix;
+
+out vec3 Color;
+
+void main()
+{
+	gl_Position = ProjectionMatrix * vec4(aPosition, 1.0);
+	Color       = aColor;
+}
+)";
+
+	const char* fragmentShaderText = R"(
+in vec3 Color;
+out vec4 FragmentColor;
+
+void main()
+{
+	FragmentColor = vec4(Color, 1.0);
+}
+)";
+
+	struct Vertex
+	{
+		glm::vec3 pos;
+		glm::vec3 color;
+	} vert[] =
+	{
+		{{ 0.5f,  0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}},
+		{{ 0.5f, -0.5f, 0.0f}, {0.0f, 1.0f, 0.0f}},
+		{{-0.5f, -0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}},
+		{{-0.5f,  0.5f, 0.0f}, {1.0f, 1.0f, 0.0f}},
+	};
+
+	unsigned int indices[] =
+	{
+		0, 1, 3,
+		1, 2, 3
+	};
+
+	constexpr unsigned DrawCount = 16;
+
+	bool check(bool condition, const char* text)
+	{
+		std::cout << (condition ? "    ok: " : "    FAILED: ") << text << std::endl;
+		return condition;
+	}
+}
+#endif
+//-----------------------------------------------------------------------------
+bool HeadlessRenderTest()
+{
+#if PLATFORM_DESKTOP
+	auto& trace = GetRenderTrace();
+	auto& renderSystem = GetRenderSystem();
+	if (!trace.Install(RenderTraceMode::Null) || !renderSystem.Create({}))
+	{
+		trace.Uninstall();
+		return false;
+	}
+
+	bool result = true;
+	{
+		trace.Clear();
+		ShaderProgramRef shader = renderSystem.CreateShaderProgram({ vertexShaderText }, { fragmentShaderText });
+		const Uniform uniformProjectionMatrix = renderSystem.GetUniform(shader, "ProjectionMatrix");
+		VertexBufferRef vb = renderSystem.CreateVertexBuffer(BufferUsage::StaticDraw, static_cast<unsigned>(Countof(vert)), static_cast<unsigned>(sizeof(Vertex)), vert);
+		IndexBufferRef ib = renderSystem.CreateIndexBuffer(BufferUsage::StaticDraw, static_cast<unsigned>(Countof(indices)), IndexFormat::UInt32, indices);
+		const std::vector<VertexAttribute> formatVertex =
+		{
+			{.location = 0, .size = 3, .normalized = false, .stride = sizeof(Vertex), .offset = (void*)offsetof(Vertex, pos)},
+			{.location = 1, .size = 3, .normalized = false, .stride = sizeof(Vertex), .offset = (void*)offsetof(Vertex, color)},
+		};
+		VertexArrayRef vao = renderSystem.CreateVertexArray(vb, ib, formatVertex);
+
+		result &= check(renderSystem.IsValid(shader) && renderSystem.IsValid(uniformProjectionMatrix) && renderSystem.IsValid(vao), "resources created");
+		result &= check(trace.GetUploadedBytes() == sizeof(vert) + sizeof(indices), "vertex and index data uploaded once");
+
+		RenderQueue queue(1);
+		const glm::mat4 projection(1.0f);
+		auto record = [&]()
+		{
+			CommandBuffer& commandBuffer = queue.GetCommandBuffer(0);
+			const UniformValue uniforms[] = { { uniformProjectionMatrix, projection } };
+			for (unsigned i = 0; i < DrawCount; i++)
+			{
+				DrawCommand command;
+				command.vao = vao;
+				command.program = shader;
+				command.uniforms = uniforms;
+				commandBuffer.Draw(MakeRenderSortKey(0, false, shader, 0, static_cast<float>(i)), command);
+			}
+		};
+
+		// первый кадр: программа и вершинный массив устанавливаются один раз на все отрисовки
+		record();
+		trace.Clear();
+		queue.Submit();
+		result &= check(trace.Count("glUseProgram") == 1, "first frame binds the program once");
+		result &= check(trace.Count(RenderCommandType::BindVertexArray) == 1, "first frame binds the vertex array once");
+		// Null драйвер отражает uniform из исходного текста шейдера, поэтому одинаковое значение всех отрисовок доходит до GL один раз
+		result &= check(trace.Count(RenderCommandType::Uniform) == 1, "first frame sets the uniform once");
+		result &= check(trace.Count(RenderCommandType::Draw) == DrawCount, "first frame draws");
+		result &= check(trace.GetUploadedBytes() == 0, "first frame uploads nothing");
+
+		// второй кадр: все состояния уже установлены, до GL доходят только uniform и отрисовки
+		record();
+		trace.Clear();
+		queue.Submit();
+		result &= check(trace.Count("glUseProgram") == 0, "second frame keeps the program");
+		result &= check(trace.Count(RenderCommandType::State) == 0, "second frame keeps the state");
+		result &= check(trace.Count(RenderCommandType::BindVertexArray) == 0, "second frame keeps the vertex array");
+		result &= check(trace.Count(RenderCommandType::Uniform) == 0, "second frame keeps the uniform value");
+		result &= check(trace.Count(RenderCommandType::Draw) == DrawCount, "second frame draws");
+		result &= check(trace.GetUploadedBytes() == 0, "second frame uploads nothing");
+	}
+
+	renderSystem.Destroy();
+	trace.Uninstall();
+	return result;
+#else
+	return false;
+#endif
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
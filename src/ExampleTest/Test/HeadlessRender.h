@@ -0,0 +1,10 @@
+﻿#pragma once
+
+/*
+Проверка рендера без окна и драйвера.
+RenderTrace в режиме Null подменяет вызовы GL, RenderSystem создается без контекста.
+Очередь отрисовки отправляется дважды, по записанным вызовам проверяется что кеш состояний отсекает повторные вызовы.
+Возвращает false если какая-то проверка не прошла.
+*/
+
+bool HeadlessRenderTest();
\ No newline at end of file
@@ -0,0 +1,122 @@
+﻿#include "stdafx.h"
+#include "SceneSerialization.h"
+#include "Engine/Core/IO/JSONValue.h"
+#include "Engine/Core/IO/VectorBuffer.h"
+#include "Engine/Core/Object/ObjectResolver.h"
+//-----------------------------------------------------------------------------
+namespace
+{
+	constexpr float Epsilon = 0.0001f;
+
+	bool check(bool condition, const char* text)
+	{
+		std::cout << (condition ? "    ok: " : "    FAILED: ") << text << std::endl;
+		return condition;
+	}
+
+	// два корня, у первого два ребенка с детьми. Узел "moved" создается корнем и переносится вглубь, сцена сортируется заново
+	void createScene(Scene& scene)
+	{
+		const unsigned root = scene.CreateNode(INVALID_SCENE_NODE, "root");
+		const unsigned left = scene.CreateNode(root, "left");
+		const unsigned right = scene.CreateNode(root, "right");
+		const unsigned leftChild = scene.CreateNode(left, "left child");
+		scene.CreateNode(right, "right child");
+		scene.CreateNode(INVALID_SCENE_NODE, "second root");
+		const unsigned moved = scene.CreateNode(INVALID_SCENE_NODE, "moved");
+		scene.SetParent(moved, leftChild);
+
+		scene.SetTransform(root, glm::vec3(1.0f, 2.0f, 3.0f), glm::quat(std::cos(0.3f), 0.0f, std::sin(0.3f), 0.0f), glm::vec3(2.0f));
+		scene.SetPosition(left, glm::vec3(-1.0f, 0.5f, 0.0f));
+		scene.SetRotation(right, glm::quat(std::cos(0.2f), std::sin(0.2f), 0.0f, 0.0f));
+		scene.SetScale(leftChild, glm::vec3(0.5f, 1.0f, 1.5f));
+		scene.SetPosition(moved, glm::vec3(0.0f, 0.0f, 4.0f));
+	}
+
+	unsigned findNode(const Scene& scene, const std::string& name)
+	{
+		for (unsigned node = 0; node < scene.GetNodeCount(); node++)
+		{
+			if (scene.IsValid(node) && scene.GetName(node) == name)
+				return node;
+		}
+		return INVALID_SCENE_NODE;
+	}
+
+	// узлы сопоставляются по имени, id после загрузки идут в сохраненном порядке
+	bool sameScene(const Scene& expected, const Scene& loaded)
+	{
+		if (expected.GetNodeCount() != loaded.GetNodeCount()) return false;
+		for (unsigned node = 0; node < expected.GetNodeCount(); node++)
+		{
+			const unsigned other = findNode(loaded, expected.GetName(node));
+			if (other == INVALID_SCENE_NODE) return false;
+
+			const unsigned parent = expected.GetParent(node);
+			const unsigned otherParent = loaded.GetParent(other);
+			if ((parent == INVALID_SCENE_NODE) != (otherParent == INVALID_SCENE_NODE)) return false;
+			if (parent != INVALID_SCENE_NODE && expected.GetName(parent) != loaded.GetName(otherParent)) return false;
+
+			if (glm::length(expected.GetPosition(node) - loaded.GetPosition(other)) > Epsilon) return false;
+			if (1.0f - std::abs(glm::dot(expected.GetRotation(node), loaded.GetRotation(other))) > Epsilon) return false;
+			if (glm::length(expected.GetScale(node) - loaded.GetScale(other)) > Epsilon) return false;
+			if (glm::length(expected.GetWorldPosition(node) - loaded.GetWorldPosition(other)) > Epsilon) return false;
+		}
+		return true;
+	}
+}
+//-----------------------------------------------------------------------------
+bool SceneSerializationTest()
+{
+	bool result = true;
+
+	Scene scene;
+	createScene(scene);
+	scene.Update();
+	result &= check(scene.GetLevelCount() == 4, "moved node sorted to the fourth level");
+
+	// двоичный поток
+	{
+		VectorBuffer buffer;
+		scene.Save(buffer);
+		buffer.Seek(0);
+
+		Scene loaded;
+		ObjectResolver resolver;
+		loaded.Load(buffer, resolver);
+		loaded.Update();
+		result &= check(loaded.GetNodeCount() == scene.GetNodeCount(), "binary: node count");
+		result &= check(loaded.GetLevelCount() == scene.GetLevelCount(), "binary: level count");
+		result &= check(sameScene(scene, loaded), "binary: names, parents, local and world transforms");
+	}
+
+	// JSON, через строку
+	JSONValue json;
+	scene.SaveJSON(json);
+	{
+		JSONValue parsed;
+		result &= check(parsed.FromString(json.ToString()), "JSON: parsed");
+
+		Scene loaded;
+		ObjectResolver resolver;
+		loaded.LoadJSON(parsed, resolver);
+		loaded.Update();
+		result &= check(sameScene(scene, loaded), "JSON: names, parents, local and world transforms");
+	}
+
+	// индекс родителя после самого узла не может прийти из Save(): узел "left" (третий в сохраненном порядке) загружается корнем
+	{
+		const unsigned damaged = 2;
+		json["nodes"][damaged]["Parent"] = static_cast<unsigned>(json["nodes"].Size() - 1);
+
+		Scene loaded;
+		ObjectResolver resolver;
+		loaded.LoadJSON(json, resolver);
+		loaded.Update();
+		result &= check(loaded.GetNodeCount() == scene.GetNodeCount(), "damaged parent: all nodes loaded");
+		result &= check(loaded.IsValid(damaged) && loaded.GetParent(damaged) == INVALID_SCENE_NODE, "damaged parent: node loaded as a root");
+	}
+
+	return result;
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
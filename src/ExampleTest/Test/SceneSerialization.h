@@ -0,0 +1,9 @@
+﻿#pragma once
+
+/*
+Проверка сохранения и загрузки Scene: иерархия с перенесенным узлом сохраняется в двоичный поток и в JSON и загружается в новую сцену,
+имена, родители, локальные и мировые трансформации должны совпасть. Поврежденный индекс родителя загружается как корневой узел.
+Возвращает false если какая-то проверка не прошла.
+*/
+
+bool SceneSerializationTest();
\ No newline at end of file
@@ -0,0 +1,131 @@
+﻿#include "stdafx.h"
+#include "StateCache.h"
+//-----------------------------------------------------------------------------
+#if PLATFORM_DESKTOP
+namespace
+{
+	const char* vertexShaderText = R"(
+layout(location = 0) in vec3 aPosition;
+
+void main()
+{
+	gl_Position = vec4(aPosition, 1.0);
+}
+)";
+
+	const char* fragmentShaderText = R"(
+out vec4 FragmentColor;
+
+void main()
+{
+	FragmentColor = vec4(1.0);
+}
+)";
+
+	glm::vec3 vert[] =
+	{
+		{-1.0f, -1.0f, 0.0f},
+		{ 1.0f, -1.0f, 0.0f},
+		{ 0.0f,  1.0f, 0.0f}
+	};
+
+	constexpr unsigned DrawCount = 8;
+
+	bool check(bool condition, const char* text)
+	{
+		std::cout << (condition ? "    ok: " : "    FAILED: ") << text << std::endl;
+		return condition;
+	}
+}
+#endif
+//-----------------------------------------------------------------------------
+bool StateCacheTest()
+{
+#if PLATFORM_DESKTOP
+	auto& trace = GetRenderTrace();
+	auto& renderSystem = GetRenderSystem();
+	if (!trace.Install(RenderTraceMode::Null) || !renderSystem.Create({}))
+	{
+		trace.Uninstall();
+		return false;
+	}
+
+	bool result = true;
+	{
+		ShaderProgramRef shader = renderSystem.CreateShaderProgram({ vertexShaderText }, { fragmentShaderText });
+		VertexBufferRef vb = renderSystem.CreateVertexBuffer(BufferUsage::StaticDraw, static_cast<unsigned>(Countof(vert)), static_cast<unsigned>(sizeof(glm::vec3)), vert);
+		const std::vector<VertexAttribute> formatVertex =
+		{
+			{.location = 0, .size = 3, .normalized = false, .stride = sizeof(glm::vec3), .offset = (void*)0},
+		};
+		VertexArrayRef vao = renderSystem.CreateVertexArray(vb, nullptr, formatVertex);
+
+		// два PipelineState с общей программой, отличаются только смешиванием
+		PipelineStateCreateInfo opaqueInfo;
+		opaqueInfo.program = shader;
+		opaqueInfo.blendState = BlendState{};
+		PipelineStateCreateInfo alphaInfo = opaqueInfo;
+		alphaInfo.blendState = AlphaBlendState;
+		PipelineStateRef opaque = renderSystem.CreatePipelineState(opaqueInfo);
+		PipelineStateRef alpha = renderSystem.CreatePipelineState(alphaInfo);
+		result &= check(renderSystem.IsValid(vao) && opaque && alpha && opaque != alpha, "resources created");
+		result &= check(renderSystem.CreatePipelineState(alphaInfo) == alpha, "equal descriptions share the pipeline state");
+
+		// повторная установка той же программы и того же состояния ничего не вызывает и не сбрасывает текущий PipelineState
+		renderSystem.Bind(alpha);
+		renderSystem.ResetStatistics();
+		trace.Clear();
+		renderSystem.Bind(shader);
+		renderSystem.Bind(AlphaBlendState);
+		renderSystem.Bind(alpha);
+		result &= check(trace.GetCommands().empty(), "redundant binds issue no GL calls");
+		result &= check(renderSystem.GetStatistics().pipelineChanges == 0, "redundant binds keep the current pipeline state");
+
+		// при смене PipelineState устанавливается только отличающееся состояние
+		renderSystem.Bind(opaque);
+		trace.Clear();
+		renderSystem.Bind(alpha);
+		result &= check(trace.Count("glUseProgram") == 0 && trace.Count("glDepthFunc") == 0, "pipeline switch keeps the shared program and depth state");
+		result &= check(trace.Count(RenderCommandType::State) > 0, "pipeline switch sets the blend state");
+
+		RenderQueue queue(1);
+		auto record = [&]()
+		{
+			CommandBuffer& commandBuffer = queue.GetCommandBuffer(0);
+			for (unsigned i = 0; i < DrawCount; i++)
+			{
+				DrawCommand command;
+				command.vao = vao;
+				command.pipeline = i % 2 ? alpha : opaque;
+				commandBuffer.Draw(MakeRenderSortKey(0, i % 2 != 0, command.pipeline, 0, static_cast<float>(i)), command);
+			}
+		};
+
+		// в очереди программа PipelineState не переустанавливается отдельно
+		for (int frame = 0; frame < 2; frame++)
+		{
+			record();
+			renderSystem.ResetStatistics();
+			trace.Clear();
+			queue.Submit();
+			result &= check(trace.Count("glUseProgram") == 0, "queue keeps the shared program");
+			result &= check(renderSystem.GetStatistics().pipelineChanges == 2, "queue switches the pipeline state once per group");
+			result &= check(trace.Count(RenderCommandType::Draw) == DrawCount, "queue draws");
+		}
+
+		// PipelineState, на который больше никто не ссылается, удаляется из кеша в конце кадра и освобождает программу
+		std::weak_ptr<const PipelineState> weakOpaque = opaque;
+		opaque.reset();
+		renderSystem.EndFrame();
+		result &= check(weakOpaque.expired(), "unused pipeline state evicted at the end of the frame");
+		result &= check(renderSystem.CreatePipelineState(alphaInfo) == alpha, "used pipeline state stays cached");
+	}
+
+	renderSystem.Destroy();
+	trace.Uninstall();
+	return result;
+#else
+	return false;
+#endif
+}
+//-----------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,10 @@
+﻿#pragma once
+
+/*
+Проверка кеша состояний рендера без окна и драйвера, через RenderTrace в режиме Null.
+Повторная установка того же состояния не доходит до GL, объект PipelineState с общей программой не переустанавливает ее,
+а неиспользуемые PipelineState удаляются из кеша в конце кадра.
+Возвращает false если какая-то проверка не прошла.
+*/
+
+bool StateCacheTest();
\ No newline at end of file
@@ -24,11 +24,41 @@
 
 #include "OtherRenderDemo/Bumpmapping.h"
 #include "OtherRenderDemo/PostEffectFrameBuffer.h"
+
+#include "Test/HeadlessRender.h"
+#include "Test/StateCache.h"
+#include "Test/GpuSkinning.h"
+#include "Test/SceneSerialization.h"
+
+#include "Benchmark/AllocatorBenchmark.h"
+#include "Benchmark/RefCountBenchmark.h"
+#include "Benchmark/JobSystemBenchmark.h"
+#include "Benchmark/SkinningBenchmark.h"
+#include "Benchmark/AnimationClipBenchmark.h"
+#include "Benchmark/PackageBenchmark.h"
+#include "Benchmark/CookedModelBenchmark.h"
+#include "Benchmark/MeshOptimizerBenchmark.h"
+#include "Benchmark/InstancingBenchmark.h"
+#include "Benchmark/UniformBenchmark.h"
+#include "Benchmark/ShaderCacheBenchmark.h"
+#include "Benchmark/ShaderVariantBenchmark.h"
+#include "Benchmark/PoseGraphBenchmark.h"
+#include "Benchmark/SceneBenchmark.h"
 //-----------------------------------------------------------------------------
 #if defined(_MSC_VER)
 #	pragma comment( lib, "Engine.lib" )
 #endif
 //-----------------------------------------------------------------------------
+// примеры сохраняют бинарники программ шейдеров в каталоге данных пользователя, второй запуск не компилирует шейдеры
+EngineDeviceCreateInfo exampleCreateInfo()
+{
+	EngineDeviceCreateInfo createInfo;
+	const std::string userDataDir = FileSystem::UserDataDir("TinyEngine");
+	if (!userDataDir.empty())
+		createInfo.render.shaderCacheDirectory = userDataDir + "ShaderCache";
+	return createInfo;
+}
+//-----------------------------------------------------------------------------
 int main(
 	[[maybe_unused]] int   argc,
 	[[maybe_unused]] char* argv[])
@@ -61,6 +91,26 @@ int main(
 		std::cout << "OtherDemo:" << std::endl;
 		std::cout << "   od1 - PostEffectFrameBuffer" << std::endl;
 		std::cout << "   od2 - Bumpmapping" << std::endl;
+		std::cout << "Test:" << std::endl;
+		std::cout << "    t1 - Headless Render (Null GL)" << std::endl;
+		std::cout << "    t2 - State Cache (Null GL)" << std::endl;
+		std::cout << "    t3 - GPU Skinning (Null GL)" << std::endl;
+		std::cout << "    t4 - Scene Save and Load" << std::endl;
+		std::cout << "Benchmark:" << std::endl;
+		std::cout << "    p1 - Pool Allocator" << std::endl;
+		std::cout << "    p2 - Reference Counting" << std::endl;
+		std::cout << "    p3 - JobSystem Scaling" << std::endl;
+		std::cout << "    p4 - Skinning" << std::endl;
+		std::cout << "    p5 - Animation Clip" << std::endl;
+		std::cout << "    p6 - Resource Files" << std::endl;
+		std::cout << "    p7 - Cooked Model" << std::endl;
+		std::cout << "    p8 - Mesh Optimizer" << std::endl;
+		std::cout << "    p9 - Instanced Drawing (Null GL)" << std::endl;
+		std::cout << "    p10 - Uniform Updates (Null GL)" << std::endl;
+		std::cout << "    p11 - Shader Program Cache" << std::endl;
+		std::cout << "    p12 - Shader Variant Pre-warm (Null GL)" << std::endl;
+		std::cout << "    p13 - Pose Graph Threads" << std::endl;
+		std::cout << "    p14 - Scene Update" << std::endl;
 
 		std::cout << std::endl;
 
@@ -73,7 +123,7 @@ int main(
 #define START_SCENE(arg, x) \
 		if( read == arg ) \
 		{ \
-			auto engineDevice = EngineDevice::Create({}); \
+			auto engineDevice = EngineDevice::Create(exampleCreateInfo()); \
 			engineDevice->RunApp(std::make_shared<x>()); \
 		}
 		START_SCENE("b1", _001Triangle);
@@ -102,6 +152,41 @@ int main(
 		START_SCENE("od2", Bumpmapping);
 
 #undef START_SCENE
+
+#define START_TEST(arg, x) \
+		if( read == arg ) \
+		{ \
+			std::cout << (x() ? "Passed" : "Failed") << std::endl << std::endl; \
+		}
+		START_TEST("t1", HeadlessRenderTest);
+		START_TEST("t2", StateCacheTest);
+		START_TEST("t3", GpuSkinningTest);
+		START_TEST("t4", SceneSerializationTest);
+
+#undef START_TEST
+
+#define START_BENCHMARK(arg, x) \
+		if( read == arg ) \
+		{ \
+			x(); \
+			std::cout << std::endl; \
+		}
+		START_BENCHMARK("p1", AllocatorBenchmark);
+		START_BENCHMARK("p2", RefCountBenchmark);
+		START_BENCHMARK("p3", JobSystemBenchmark);
+		START_BENCHMARK("p4", SkinningBenchmark);
+		START_BENCHMARK("p5", AnimationClipBenchmark);
+		START_BENCHMARK("p6", PackageBenchmark);
+		START_BENCHMARK("p7", CookedModelBenchmark);
+		START_BENCHMARK("p8", MeshOptimizerBenchmark);
+		START_BENCHMARK("p9", InstancingBenchmark);
+		START_BENCHMARK("p10", UniformBenchmark);
+		START_BENCHMARK("p11", ShaderCacheBenchmark);
+		START_BENCHMARK("p12", ShaderVariantBenchmark);
+		START_BENCHMARK("p13", PoseGraphBenchmark);
+		START_BENCHMARK("p14", SceneBenchmark);
+
+#undef START_BENCHMARK
 	}
 }
 //-----------------------------------------------------------------------------
\ No newline at end of file